@@ -0,0 +1,98 @@
+#include <cstring>
+
+#include "dbcomm/Arena.h"
+
+namespace COMMON
+{
+    namespace DBCOMM
+    {
+        // enough for the alignment of any type
+        static const size_t ARENA_ALIGNMENT = 8;
+
+        const size_t Arena::DEFAULT_CHUNK_SIZE;
+
+        Arena::Arena(size_t chunkSize)
+            : chunk_size_((chunkSize < ARENA_ALIGNMENT) ? ARENA_ALIGNMENT : chunkSize), current_(0), left_(0), bytes_(0)
+        {
+        }
+
+        Arena::~Arena()
+        {
+            for (size_t i = 0; i < chunks_.size(); i++)
+            {
+                delete [] chunks_[i];
+            }
+
+            for (size_t i = 0; i < large_chunks_.size(); i++)
+            {
+                delete [] large_chunks_[i];
+            }
+        }
+
+        char* Arena::Allocate(size_t size)
+        {
+            size = (size + ARENA_ALIGNMENT - 1) & ~(ARENA_ALIGNMENT - 1);
+
+            // a large object does not waste the space left in the current chunk
+            if (size > chunk_size_)
+            {
+                large_chunks_.push_back(new char[size]);
+                bytes_ += size;
+                return large_chunks_.back();
+            }
+
+            if (size > left_)
+            {
+                chunks_.push_back(new char[chunk_size_]);
+                bytes_ += chunk_size_;
+
+                current_ = chunks_.back();
+                left_ = chunk_size_;
+            }
+
+            char* memory = current_;
+            current_ += size;
+            left_ -= size;
+
+            return memory;
+        }
+
+        char* Arena::Copy(const char* data, size_t size)
+        {
+            char* memory = Allocate(size);
+            memcpy(memory, data, size);
+
+            return memory;
+        }
+
+        void Arena::Clear()
+        {
+            for (size_t i = 0; i < large_chunks_.size(); i++)
+            {
+                delete [] large_chunks_[i];
+            }
+            large_chunks_.clear();
+
+            for (size_t i = 1; i < chunks_.size(); i++)
+            {
+                delete [] chunks_[i];
+            }
+
+            if (chunks_.empty())
+            {
+                bytes_ = 0;
+                return;
+            }
+
+            chunks_.resize(1);
+            current_ = chunks_[0];
+            left_ = chunk_size_;
+            bytes_ = chunk_size_;
+        }
+
+        size_t Arena::GetByteCount() const
+        {
+            return bytes_;
+        }
+    }
+}
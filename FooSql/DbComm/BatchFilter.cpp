@@ -1,5 +1,6 @@
 #include "dbcomm/BatchFilter.h"
 
+#include "dbcomm/ValueFormatter.h"
 #include "tool/StringHelper.h"
 
 using namespace std;
@@ -8,22 +9,59 @@ namespace COMMON
 {
     namespace DBCOMM
     {
+        // FNV-1a, 64 bits
+        static const unsigned long long FNV_OFFSET_BASIS = 14695981039346656037ULL;
+        static const unsigned long long FNV_PRIME = 1099511628211ULL;
+        
+        static unsigned long long HashAppend(unsigned long long hash, const string& text)
+        {
+            for (size_t i = 0; i < text.size(); i++)
+            {
+                hash ^= (unsigned char)text[i];
+                hash *= FNV_PRIME;
+            }
+            
+            // a separator, so that "ab" + "c" differs from "a" + "bc"
+            hash ^= 0xFF;
+            hash *= FNV_PRIME;
+            
+            return hash;
+        }
+        
+        // trim the column name, without building a new string for the common case
+        static void PushColumn(vector<string>& columns, const string& column)
+        {
+            if (column.size() != 0 && column[0] != ' ' && column[column.size() - 1] != ' ')
+            {
+                columns.push_back(column);
+            }
+            else
+            {
+                string tmp(column);
+                columns.push_back(TOOL::StringHelper::Trim(tmp, " "));
+            }
+        }
+        
         BatchFilter::BatchFilter()
-            : force_check_(false), has_value_(false)
+            : force_check_(false), has_value_(false), fingerprint_(0), fingerprint_dirty_(true)
         {
         }
         
         BatchFilter::BatchFilter(const BatchFilter& other)
+            : DbActionFilter(other)
         {
             table_name_ = other.table_name_;
             columns_ = other.columns_;
-            values_ << other.values_.str();
+            values_ = other.values_;
             has_value_ = other.has_value_;
             force_check_ = other.force_check_;
+            fingerprint_ = other.fingerprint_;
+            fingerprint_dirty_ = other.fingerprint_dirty_;
+            encoding_stats_ = other.encoding_stats_;
         }
         
         BatchFilter::BatchFilter( string table_name, map<string, Value>& column_value_map, bool forceCheck )
-            : table_name_(table_name), force_check_(forceCheck), has_value_(false)
+            : table_name_(table_name), force_check_(forceCheck), has_value_(false), fingerprint_(0), fingerprint_dirty_(true)
         {
             map<string, Value>::iterator it = column_value_map.begin();
             for (int i = 0; it != column_value_map.end(); it++, i++)
@@ -32,65 +70,107 @@ namespace COMMON
                 
                 if (has_value_)
                 {
-                    values_ << ",";    
+                    values_ += ',';    
                 }
-                values_ << it->second.GetValue();    
+                values_ += it->second.GetValue();    
                 has_value_ = true;
             }
         }
         
         BatchFilter::BatchFilter(string table_name, bool forceCheck)
-            : table_name_(table_name), force_check_(forceCheck), has_value_(false)
+            : table_name_(table_name), force_check_(forceCheck), has_value_(false), fingerprint_(0), fingerprint_dirty_(true)
         {
         }
         
-        void BatchFilter::AppendColumnValue(string column, Value value, bool ignoreColumn)
+        void BatchFilter::AppendColumnValue(const string& column, const Value& value, bool ignoreColumn)
         {
-            if (!ignoreColumn)
-            {
-                columns_.push_back(TOOL::StringHelper::Trim(column, " "));
-            }
-            
-            if (has_value_)
-            {
-                values_ << ",";    
-            }
-            values_ << value.GetValue();    
-            has_value_ = true;
+            AppendColumnValue(column, value.GetValue(), ignoreColumn);
+        }
+        
+        void BatchFilter::AppendColumnValue(const string& column, const string& value, bool ignoreColumn)
+        {
+            StartValue(column, ignoreColumn);
+            values_ += value;    
+        }
+        
+        void BatchFilter::AppendColumnValue(const string& column, int value, bool ignoreColumn)
+        {
+            StartValue(column, ignoreColumn);
+            ValueFormatter::AppendInteger(values_, value);
+        }
+        
+        void BatchFilter::AppendColumnValue(const string& column, long value, bool ignoreColumn)
+        {
+            StartValue(column, ignoreColumn);
+            ValueFormatter::AppendInteger(values_, value);
+        }
+        
+        void BatchFilter::AppendColumnValue(const string& column, long long value, bool ignoreColumn)
+        {
+            StartValue(column, ignoreColumn);
+            ValueFormatter::AppendInteger(values_, value);
+        }
+        
+        void BatchFilter::AppendColumnValue(const string& column, double value, bool ignoreColumn)
+        {
+            StartValue(column, ignoreColumn);
+            ValueFormatter::AppendDouble(values_, value);
+        }
+        
+        void BatchFilter::AppendColumnValue(const string& column, long length, const char* value, 
+                                            bool noNeedQuote, bool needHex, bool ignoreColumn)
+        {
+            StartValue(column, ignoreColumn);
+            ValueFormatter::AppendString(values_, value, length, noNeedQuote, needHex);
+        }
+        
+        void BatchFilter::AppendColumnValue(const string& column, long length, const char* value, 
+                                            const StringEscaper& escaper, bool ignoreColumn)
+        {
+            StartValue(column, ignoreColumn);
+            escaper.AppendQuoted(values_, value, length, &encoding_stats_);
         }
         
-        void BatchFilter::AppendColumnValue(string column, string value, bool ignoreColumn)
+        const StringEscaper::Stats& BatchFilter::GetEncodingStats() const
+        {
+            return encoding_stats_;
+        }
+        
+        void BatchFilter::StartValue(const string& column, bool ignoreColumn)
         {
             if (!ignoreColumn)
             {
-                columns_.push_back(TOOL::StringHelper::Trim(column, " "));
+                PushColumn(columns_, column);
+                fingerprint_dirty_ = true;
             }
             
             if (has_value_)
             {
-                values_ << ",";    
+                values_ += ',';    
             }
-            values_ << value;    
             has_value_ = true;
         }
         
         void BatchFilter::SetTableName(string tableName)
         {
             table_name_ = tableName;
+            fingerprint_dirty_ = true;
         }
         
         void BatchFilter::ClearColumns()
         {
             columns_.clear();
+            fingerprint_dirty_ = true;
         }
             
         void BatchFilter::ClearValues()
         {
-            values_.str("");
+            // the capacity is kept for the next row
+            values_.clear();
             has_value_ = false;
         }
         
-        string BatchFilter::GetTableName()
+        const string& BatchFilter::GetTableName()
         {
             return table_name_;
         }
@@ -100,11 +180,29 @@ namespace COMMON
             return columns_;
         }
         
-        string BatchFilter::GetValues()
+        const string& BatchFilter::GetValues()
         {
-            return values_.str();
+            return values_;
         }        
         
+        unsigned long long BatchFilter::GetFingerprint()
+        {
+            if (fingerprint_dirty_)
+            {
+                unsigned long long hash = HashAppend(FNV_OFFSET_BASIS, table_name_);
+                for (size_t i = 0; i < columns_.size(); i++)
+                {
+                    hash = HashAppend(hash, columns_[i]);
+                }
+                
+                // 0 is kept for "no fingerprint"
+                fingerprint_ = (hash == 0) ? 1 : hash;
+                fingerprint_dirty_ = false;
+            }
+            
+            return fingerprint_;
+        }
+        
         bool BatchFilter::CheckCompatible()
         {
             return force_check_;
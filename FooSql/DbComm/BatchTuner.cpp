@@ -0,0 +1,153 @@
+#include <sstream>
+
+#include "dbcomm/BatchTuner.h"
+
+namespace COMMON
+{
+    namespace DBCOMM
+    {
+        static const char* ReasonName(BatchTuner::Reason reason)
+        {
+            switch (reason)
+            {
+            case BatchTuner::REASON_LATENCY_CEILING:    return "latency above the ceiling";
+            case BatchTuner::REASON_THROUGHPUT_RISING:  return "throughput rising";
+            case BatchTuner::REASON_THROUGHPUT_FALLING: return "throughput falling";
+            default:                                    return "probing";
+            }
+        }
+
+        string BatchTuner::Decision::ToString() const
+        {
+            stringstream ss;
+            ss << location_.ToString() << ": " << old_values_per_batch_ << " -> " << values_per_batch_ << " values, "
+               << "commit " << commit_limit_ << ", " << latency_ << " ms, " << rows_per_second_ << " rows/s, "
+               << ReasonName(reason_);
+            return ss.str();
+        }
+
+        BatchTuner::BatchTuner(double latencyCeiling, int minValues, int maxValues)
+            : latency_ceiling_(latencyCeiling),
+              min_values_((minValues > 1) ? minValues : 1),
+              max_values_(maxValues),
+              window_(4),
+              step_(16),
+              decrease_(0.5),
+              tolerance_(0.05)
+        {
+            if (max_values_ < min_values_)
+            {
+                max_values_ = min_values_;
+            }
+        }
+
+        void BatchTuner::Start(const DbLocation& location, int valuesPerBatch, int commitLimit)
+        {
+            State& state = states_[location];
+            state = State();
+
+            // a transaction keeps the number of statements it had
+            if (commitLimit > 0)
+            {
+                int values = (valuesPerBatch > 1) ? valuesPerBatch : 1;
+                state.batches_per_commit_ = (commitLimit + values - 1) / values;
+            }
+
+            SetValues(state, valuesPerBatch);
+        }
+
+        void BatchTuner::SetValues(State& state, int values)
+        {
+            if (values < min_values_)
+            {
+                values = min_values_;
+            }
+            if (values > max_values_)
+            {
+                values = max_values_;
+            }
+
+            state.values_ = values;
+            state.commit_limit_ = state.batches_per_commit_ * values;
+        }
+
+        bool BatchTuner::Record(const DbLocation& location, long long rows, int statements, long long microSeconds)
+        {
+            State& state = states_[location];
+            state.rows_ += rows;
+            state.micro_seconds_ += microSeconds;
+            state.statements_ += statements;
+            if (state.statements_ < window_)
+            {
+                return false;
+            }
+
+            Decision decision;
+            decision.location_ = location;
+            decision.old_values_per_batch_ = state.values_;
+            decision.latency_ = (double)state.micro_seconds_ / 1000.0 / (double)state.statements_;
+            decision.rows_per_second_ = (double)state.rows_ * 1000000.0 / (double)((state.micro_seconds_ > 0) ? state.micro_seconds_ : 1);
+
+            int values = state.values_;
+            if (decision.latency_ > latency_ceiling_)
+            {
+                // multiplicative decrease, and the next window is not compared with this one
+                decision.reason_ = REASON_LATENCY_CEILING;
+                values = (int)(values * decrease_);
+                state.direction_ = 1;
+                state.last_rows_per_second_ = 0.0;
+            }
+            else
+            {
+                double last = state.last_rows_per_second_;
+                if (last > 0.0 && decision.rows_per_second_ < last * (1.0 - tolerance_))
+                {
+                    decision.reason_ = REASON_THROUGHPUT_FALLING;
+                    state.direction_ = -state.direction_;
+                }
+                else if (last > 0.0 && decision.rows_per_second_ > last * (1.0 + tolerance_))
+                {
+                    decision.reason_ = REASON_THROUGHPUT_RISING;
+                }
+                else
+                {
+                    decision.reason_ = REASON_PROBING;
+                    state.direction_ = 1;
+                }
+
+                values += state.direction_ * step_;
+
+                // the latency grows with the values, do not step beyond the ceiling
+                double per_value = decision.latency_ / state.values_;
+                if (state.direction_ > 0 && per_value > 0.0 && values * per_value > latency_ceiling_)
+                {
+                    int limit = (int)(latency_ceiling_ / per_value);
+                    values = (limit > state.values_) ? limit : state.values_;
+                }
+
+                state.last_rows_per_second_ = decision.rows_per_second_;
+            }
+
+            state.rows_ = 0;
+            state.micro_seconds_ = 0;
+            state.statements_ = 0;
+
+            SetValues(state, values);
+            if (state.values_ == decision.old_values_per_batch_)
+            {
+                return false;
+            }
+
+            decision.values_per_batch_ = state.values_;
+            decision.commit_limit_ = state.commit_limit_;
+            decisions_.push_back(decision);
+            return true;
+        }
+
+        void BatchTuner::TakeDecisions(vector<Decision>& decisions)
+        {
+            decisions.insert(decisions.end(), decisions_.begin(), decisions_.end());
+            decisions_.clear();
+        }
+    }
+}
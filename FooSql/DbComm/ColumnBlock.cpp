@@ -0,0 +1,245 @@
+#include <limits.h>
+
+#include "dbcomm/ColumnBlock.h"
+#include "dbcomm/ValueParser.h"
+
+#include "exception/CodingException.h"
+
+namespace COMMON
+{
+    namespace DBCOMM
+    {
+        ColumnBlock::ColumnBlock(int capacity)
+            : capacity_(1), native_numbers_(false), row_count_(0), column_index_(0), location_(0)
+        {
+            SetCapacity(capacity);
+        }
+
+        void ColumnBlock::SetCapacity(int capacity)
+        {
+            capacity_ = (capacity < 1) ? 1 : capacity;
+        }
+
+        int ColumnBlock::GetCapacity() const
+        {
+            return capacity_;
+        }
+
+        void ColumnBlock::SetNativeNumbers(bool nativeNumbers)
+        {
+            native_numbers_ = nativeNumbers;
+        }
+
+        bool ColumnBlock::IsNativeNumbers() const
+        {
+            return native_numbers_;
+        }
+
+        void ColumnBlock::ParseColumn(int column, RowBlock::ColumnType type)
+        {
+            parse_types_[column] = type;
+        }
+
+        int ColumnBlock::GetRowCount() const
+        {
+            return row_count_;
+        }
+
+        int ColumnBlock::GetColumnCount() const
+        {
+            return (int)columns_.size();
+        }
+
+        RowBlock::ColumnType ColumnBlock::GetColumnType(int column) const
+        {
+            return columns_[column].type_;
+        }
+
+        const unsigned char* ColumnBlock::GetValidity(int column) const
+        {
+            return columns_[column].validity_.empty() ? 0 : &(columns_[column].validity_[0]);
+        }
+
+        int ColumnBlock::GetNullCount(int column) const
+        {
+            return columns_[column].null_count_;
+        }
+
+        const int* ColumnBlock::GetOffsets(int column) const
+        {
+            return columns_[column].offsets_.empty() ? 0 : &(columns_[column].offsets_[0]);
+        }
+
+        const char* ColumnBlock::GetData(int column) const
+        {
+            return columns_[column].data_.data();
+        }
+
+        const long long* ColumnBlock::GetIntegers(int column) const
+        {
+            return columns_[column].integers_.empty() ? 0 : &(columns_[column].integers_[0]);
+        }
+
+        const double* ColumnBlock::GetDoubles(int column) const
+        {
+            return columns_[column].doubles_.empty() ? 0 : &(columns_[column].doubles_[0]);
+        }
+
+        bool ColumnBlock::IsNull(int row, int column) const
+        {
+            return (columns_[column].validity_[row >> 3] & (1 << (row & 7))) == 0;
+        }
+
+        const char* ColumnBlock::GetValue(int row, int column, unsigned long& length) const
+        {
+            const Column& c = columns_[column];
+            length = c.offsets_[row + 1] - c.offsets_[row];
+            return c.data_.data() + c.offsets_[row];
+        }
+
+        map<string, int>* ColumnBlock::GetColumnIndex() const
+        {
+            return column_index_;
+        }
+
+        const DbLocation* ColumnBlock::GetLocation() const
+        {
+            return location_;
+        }
+
+        void ColumnBlock::Assign(RowBlock& rows) throw (COMMON::EXCEPTION::ThrowableException)
+        {
+            row_count_ = 0;
+            columns_.resize(rows.GetColumnCount());
+
+            for (int c = 0; c < (int)columns_.size(); c++)
+            {
+                Column& column = columns_[c];
+
+                column.type_ = rows.GetColumnType(c);
+                map<int, RowBlock::ColumnType>::iterator it = parse_types_.find(c);
+                if (column.type_ == RowBlock::COLUMN_TEXT && it != parse_types_.end())
+                {
+                    column.type_ = it->second;
+                }
+
+                column.validity_.clear();
+                column.null_count_ = 0;
+                column.offsets_.assign(1, 0);
+                column.data_.clear();
+                column.integers_.clear();
+                column.doubles_.clear();
+            }
+
+            Append(rows);
+        }
+
+        void ColumnBlock::Append(RowBlock& rows) throw (COMMON::EXCEPTION::ThrowableException)
+        {
+            int count = rows.GetRowCount();
+
+            // the offsets of the text are of 32 bits, checked before anything is added
+            for (int c = 0; c < (int)columns_.size(); c++)
+            {
+                if (columns_[c].type_ != RowBlock::COLUMN_TEXT)
+                {
+                    continue;
+                }
+
+                size_t bytes = columns_[c].data_.size();
+                for (int r = 0; r < count; r++)
+                {
+                    bytes += rows.IsNull(r, c) ? 0 : rows.GetLength(r, c);
+                }
+
+                if (bytes > (size_t)INT_MAX)
+                {
+                    tr1::shared_ptr<COMMON::EXCEPTION::IException> inner_e(
+                        new COMMON::EXCEPTION::ContainerFullException("ColumnBlock", "the text of a column is beyond its 32-bit offsets"));
+
+                    COMMON::EXCEPTION::ThrowableException e(inner_e);
+                    throw e;
+                }
+            }
+
+            column_index_ = rows.GetColumnIndex();
+            location_ = rows.GetLocation();
+
+            int first = row_count_;
+            row_count_ += count;
+
+            for (int c = 0; c < (int)columns_.size(); c++)
+            {
+                Column& column = columns_[c];
+                RowBlock::ColumnType source = rows.GetColumnType(c);
+
+                column.validity_.resize((row_count_ + 7) / 8, 0);
+
+                for (int r = 0; r < count; r++)
+                {
+                    int row = first + r;
+                    bool null = rows.IsNull(r, c);
+
+                    // a text which is not a number of the type is taken as NULL, not as a valid 0
+                    switch (column.type_)
+                    {
+                    case RowBlock::COLUMN_INTEGER:
+                        {
+                            long long value = 0;
+                            if (!null && source == RowBlock::COLUMN_INTEGER)
+                            {
+                                value = rows.GetInteger(r, c);
+                            }
+                            else if (!null && source == RowBlock::COLUMN_DOUBLE)
+                            {
+                                value = (long long)rows.GetDouble(r, c);
+                            }
+                            else if (!null)
+                            {
+                                null = !ValueParser::ParseInteger(rows.GetValue(r, c), rows.GetLength(r, c), value);
+                            }
+                            column.integers_.push_back(null ? 0 : value);
+                        }
+                        break;
+
+                    case RowBlock::COLUMN_DOUBLE:
+                        {
+                            double value = 0.0;
+                            if (!null && source == RowBlock::COLUMN_DOUBLE)
+                            {
+                                value = rows.GetDouble(r, c);
+                            }
+                            else if (!null && source == RowBlock::COLUMN_INTEGER)
+                            {
+                                value = (double)rows.GetInteger(r, c);
+                            }
+                            else if (!null)
+                            {
+                                null = !ValueParser::ParseDouble(rows.GetValue(r, c), rows.GetLength(r, c), value);
+                            }
+                            column.doubles_.push_back(null ? 0.0 : value);
+                        }
+                        break;
+
+                    default:
+                        if (!null)
+                        {
+                            column.data_.append(rows.GetValue(r, c), rows.GetLength(r, c));
+                        }
+                        column.offsets_.push_back((int)column.data_.size());
+                        break;
+                    }
+
+                    if (null)
+                    {
+                        column.null_count_++;
+                    }
+                    else
+                    {
+                        column.validity_[row >> 3] |= (unsigned char)(1 << (row & 7));
+                    }
+                }
+            }
+        }
+    }
+}
@@ -0,0 +1,12 @@
+#include "dbcomm/ColumnRef.h"
+
+namespace COMMON
+{
+    namespace DBCOMM
+    {
+        ColumnRef::ColumnRef(int index)
+            : index_(index)
+        {
+        }
+    }
+}
@@ -34,7 +34,7 @@ namespace COMMON
         
         bool DB2DbTasks::InitEngine()
         {
-            db_engine_ = tr1::shared_ptr<DB2Engine>(new DB2Engine(db_locations_, shared_from_this()));
+            db_engine_ = tr1::shared_ptr<DB2Engine>(new DB2Engine(db_locations_, shared_from_this(), connections_per_location_));
             db_engine_->InitEngine();
             
             return true;
@@ -47,6 +47,27 @@ namespace COMMON
             return true;
         }       
 
+        DbExecuteAction* DB2DbTasks::BatchInsert( int commitLimit, int valuesLimit)
+        {
+            if (false == CanStartAction())
+            {
+                return 0;
+            }
+
+            current_work_.reset();
+
+            current_work_ = 
+                tr1::shared_ptr<DbBatchAction>(
+                new DB2BatchInsertAction(
+                    shared_from_this(), 
+                    db_engine_, 
+                    is_action_finished_, 
+                    valuesLimit, 
+                    commitLimit));
+
+            return (DbExecuteAction*)current_work_.get();
+        }
+        
         DbExecuteAction* DB2DbTasks::BatchInsertIgnore( int commitLimit, int valuesLimit)
         {
             if (false == CanStartAction())
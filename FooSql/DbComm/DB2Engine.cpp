@@ -1,8 +1,12 @@
 #ifdef DB2_ENV_AVAILABLE
 
+#include <string.h>
+
 #include "dbcomm/CommDef.h"
 #include "dbcomm/DB2Engine.h"
 #include "dbcomm/DbActionFilter.h"
+#include "dbcomm/PreparedFilter.h"
+#include "dbcomm/ValueFormatter.h"
 #include "dbcomm/DbException.h"
 
 #include "tool/StringHelper.h"
@@ -13,8 +17,20 @@ namespace COMMON
 {
     namespace DBCOMM
     {
-        DB2Engine::DB2Engine(vector<DbLocation>& locations, tr1::shared_ptr<IDbTasks> task)
-            : DbEngine(locations, task)
+        // the prepared statements kept by each connection
+        static const int STATEMENT_CACHE_SIZE = 64;
+        
+        // enough for a number bound in text, such as "-1.2345678901234567e-308"
+        static const SQLLEN NUMBER_TEXT_LENGTH = 32;
+        
+        // the widest value bound to an array when fetching blocks, a result set with a wider column is fetched row by row
+        static const SQLLEN BLOCK_VALUE_LENGTH = 32 * 1024;
+        
+        // the most bytes bound for a block, fewer rows are fetched at once if the rows are wide
+        static const SQLLEN BLOCK_BUFFER_LENGTH = 16 * 1024 * 1024;
+        
+        DB2Engine::DB2Engine(vector<DbLocation>& locations, tr1::shared_ptr<IDbTasks> task, int connectionsPerLocation)
+            : DbEngine(locations, task, connectionsPerLocation)
         {    
         }
         
@@ -22,14 +38,9 @@ namespace COMMON
         {
         }
         
-        tr1::shared_ptr<DbEngine::RealHandle> DB2Engine::GetRealHandle(DbLocation& location)
+        tr1::shared_ptr<DbEngine::RealHandle> DB2Engine::CreateRealHandle(DbLocation& location)
         {
-            if (handles_.find(location) == handles_.end())
-            {
-                handles_[location].reset(new Db2RealHandle());
-            }
-            
-            return handles_[location];
+            return tr1::shared_ptr<DbEngine::RealHandle>(new Db2RealHandle());
         }
         
         bool DB2Engine::Connect(void* handle, DbLocation* location, tr1::shared_ptr<IException>& exception) throw ()
@@ -124,6 +135,8 @@ namespace COMMON
             SQLRETURN rc = 0;
             string errorMsg = "";
             
+            ((Db2RealHandle*)handle)->CloseStatements();
+            
 			// free statement handle, while the connection handle will be freed in deconstructor
             rc = SQLFreeHandle(SQL_HANDLE_STMT, ((Db2RealHandle*)handle)->hstmt);
             if ( SQL_SUCCESS != rc )
@@ -180,6 +193,7 @@ namespace COMMON
             
 			// alloc memory if necessary
             ((Db2RealHandle*)handle)->res     = new char* [cols];
+            ((Db2RealHandle*)handle)->row     = new char* [cols];
             ((Db2RealHandle*)handle)->lengths = new unsigned long [cols];
             ((Db2RealHandle*)handle)->col_max_len = new unsigned long [cols];
             ((Db2RealHandle*)handle)->colNum  = cols;
@@ -258,7 +272,7 @@ namespace COMMON
                 CloseOpenRslt( handle, location, exception);
                 ((Db2RealHandle*)handle)->res = 0;
             
-                return (((Db2RealHandle*)handle)->res);
+                return 0;
             }
             if ( SQL_SUCCESS != rc )
             {
@@ -292,8 +306,9 @@ namespace COMMON
                     return 0;
                 }
 
-				// the odbc function will return -1 when a null column is met
+				// the odbc function will return -1 when a null column is met, which is 0 in the row as MySQL does
                 (((Db2RealHandle*)handle)->lengths)[i-1] = (unsigned long)( (real_len < 0) ? 0 : real_len );
+                (((Db2RealHandle*)handle)->row)[i-1] = (real_len == SQL_NULL_DATA) ? 0 : (((Db2RealHandle*)handle)->res)[i-1];
         
                 // assign the data
                 memset( (((Db2RealHandle*)handle)->res)[i-1],
@@ -307,7 +322,7 @@ namespace COMMON
                 }  
             }
             
-            return ( ((Db2RealHandle*)handle)->res );
+            return ( ((Db2RealHandle*)handle)->row );
         }
         
         unsigned long* DB2Engine::GetColumnsActureLength( void* handle, DbLocation* location, tr1::shared_ptr<IException>& exception) throw ()
@@ -441,6 +456,12 @@ namespace COMMON
         
         bool DB2Engine::CloseOpenRslt(void* handle, DbLocation* location, tr1::shared_ptr<IException>& exception) throw ()
         {
+            if ( ((Db2RealHandle*)handle)->block_mode == Db2RealHandle::BLOCK_BOUND )
+            {
+                UnbindColumnArrays((Db2RealHandle*)handle);
+            }
+            ((Db2RealHandle*)handle)->block_mode = Db2RealHandle::BLOCK_NONE;
+            
             if ( ((Db2RealHandle*)handle)->tmpCol != 0 )
             {
                 delete [] ((Db2RealHandle*)handle)->tmpCol;
@@ -449,6 +470,9 @@ namespace COMMON
             
             if ( ((Db2RealHandle*)handle)->res != 0 )
             {
+                // the cursor may be closed before all the rows are fetched
+                SQLFreeStmt(((Db2RealHandle*)handle)->hstmt, SQL_CLOSE);
+                
                 for( int i = 0; i < ((Db2RealHandle*)handle)->colNum; i++ )
                 {
                     delete [] (((Db2RealHandle*)handle)->res)[i];
@@ -457,6 +481,12 @@ namespace COMMON
                 ((Db2RealHandle*)handle)->res = 0;
             }
             
+            if ( ((Db2RealHandle*)handle)->row != 0 )
+            {
+                delete [] ((Db2RealHandle*)handle)->row;
+                ((Db2RealHandle*)handle)->row = 0;
+            }
+            
             if ( ((Db2RealHandle*)handle)->lengths != 0 )
             {
                 delete [] ((Db2RealHandle*)handle)->lengths;
@@ -585,41 +615,561 @@ namespace COMMON
         char* DB2Engine::EscapeString(
             void* handle,  DbLocation* location,  const char* src, long length, tr1::shared_ptr<IException>& exception) throw ()
         {
-            memset(((Db2RealHandle*)handle)->inner_buf_, '\0', sizeof(((Db2RealHandle*)handle)->inner_buf_) );
+			// write "'" twice not regarding the current charset, DB2 has no other escape
+            string& escaped = ((Db2RealHandle*)handle)->escaped_;
+            escaped.clear();
+            StringEscaper(StringEscaper::DIALECT_DB2).Append(escaped, src, length);
             
-			// replace "\0","\r","\t","\n","\b" not regarding the current charset
-            stringstream ss;
-            for (int i = 0; i < length; i++)
+            return const_cast<char*>(escaped.c_str());
+        }
+        
+        StringEscaper DB2Engine::CreateStringEscaper(void* handle, DbLocation* location) throw ()
+        {
+            return StringEscaper(StringEscaper::DIALECT_DB2);
+        }
+        
+        long long DB2Engine::PreparedExecute(void* handle, DbLocation* location, const PreparedFilter* filter, tr1::shared_ptr<IException>& exception) throw ()
+        {
+            Db2RealHandle* real_handle = (Db2RealHandle*)handle;
+            const char* statement = filter->GetData();
+            size_t length = filter->GetLength();
+            
+            // a statement without parameters, such as one with the values written in, is not kept
+            if (filter->GetRowCount() == 1 && filter->GetParamCount(0) == 0)
+            {
+                SQLRETURN rc = SQLExecDirect(real_handle->hstmt, (SQLCHAR*)statement, length);
+                if ( SQL_SUCCESS != rc && SQL_NO_DATA != rc )
+                {
+                    int sqlCode  = rc;
+                    string       errorMsg = "";
+                    errorMsg = ExtractErrMsgStmt(sqlCode, handle, errorMsg);
+                    
+                    exception.reset(new DbCommonExecuteException(*location, errorMsg, sqlCode, statement, length));
+                    return 0;
+                }
+                
+                return GetAffectedRows(handle, location, exception);
+            }
+            
+            int sqlCode = 0;
+            string errorMsg;
+            SQLLEN affectRows = 0;
+            
+            CachedStatement* stmt = GetStatement(real_handle, statement, length, sqlCode, errorMsg);
+            if (stmt != 0 && BindParamArrays(real_handle, stmt, filter, sqlCode, errorMsg))
+            {
+                // all the rows are sent by one call
+                SQLRETURN rc = SQLExecute(stmt->hstmt);
+                if ( SQL_SUCCESS != rc && SQL_NO_DATA != rc )
+                {
+                    sqlCode = rc;
+                    ExtractErrMsgPrepared(sqlCode, stmt->hstmt, errorMsg);
+                    
+                    // the statement may be broken, such as by a lost connection
+                    DropStatement(real_handle, stmt->hstmt);
+                }
+                else if ( SQL_SUCCESS != SQLRowCount(stmt->hstmt, &affectRows) )
+                {
+                    affectRows = 0;
+                }
+            }
+            
+            if (sqlCode != 0)
+            {
+                exception.reset(new DbCommonExecuteException(*location, errorMsg, sqlCode, statement, length));
+                return 0;
+            }
+            
+            return affectRows;
+        }
+        
+        DB2Engine::CachedStatement* DB2Engine::GetStatement( Db2RealHandle* handle, const char* statement, size_t length, int& sqlCode, string& errorMsg )
+        {
+            string sql(statement, length);
+            
+            map<string, CachedStatement>::iterator it = handle->stmts.find(sql);
+            if (it != handle->stmts.end())
+            {
+                it->second.last_use = ++(handle->stmt_uses);
+                return &(it->second);
+            }
+            
+            // make room by freeing the least recently used one
+            if (handle->stmts.size() >= STATEMENT_CACHE_SIZE)
+            {
+                map<string, CachedStatement>::iterator oldest = handle->stmts.begin();
+                for (it = handle->stmts.begin(); it != handle->stmts.end(); it++)
+                {
+                    if (it->second.last_use < oldest->second.last_use)
+                    {
+                        oldest = it;
+                    }
+                }
+                
+                SQLFreeHandle(SQL_HANDLE_STMT, oldest->second.hstmt);
+                handle->stmts.erase(oldest);
+            }
+            
+            SQLHSTMT hstmt;
+            SQLRETURN rc = SQLAllocHandle(SQL_HANDLE_STMT, handle->hdbc, &hstmt);
+            if (rc != SQL_SUCCESS)
+            {
+                sqlCode = rc;
+                errorMsg = ExtractErrMsgDbc(sqlCode, handle, errorMsg);
+                return 0;
+            }
+            
+            rc = SQLPrepare(hstmt, (SQLCHAR*)statement, length);
+            if (rc != SQL_SUCCESS)
             {
-                if (src[i] == '\0')
+                sqlCode = rc;
+                ExtractErrMsgPrepared(sqlCode, hstmt, errorMsg);
+                SQLFreeHandle(SQL_HANDLE_STMT, hstmt);
+                return 0;
+            }
+            
+            SQLSMALLINT count = 0;
+            SQLNumParams(hstmt, &count);
+            
+            CachedStatement& cached = handle->stmts[sql];
+            cached.hstmt = hstmt;
+            cached.last_use = ++(handle->stmt_uses);
+            cached.param_types.resize(count);
+            cached.param_sizes.resize(count);
+            cached.param_digits.resize(count);
+            
+            // the types of the parameters tell how the values are bound
+            for (int i = 0; i < count; i++)
+            {
+                SQLSMALLINT nullable = 0;
+                rc = SQLDescribeParam(hstmt, i + 1, &(cached.param_types[i]), &(cached.param_sizes[i]), &(cached.param_digits[i]), &nullable);
+                if (rc != SQL_SUCCESS)
                 {
-                    ss << "\\0";
+                    cached.param_types[i] = SQL_VARCHAR;
+                    cached.param_sizes[i] = 0;
+                    cached.param_digits[i] = 0;
                 }
-                else if (src[i] == '\r')
+            }
+            
+            return &cached;
+        }
+        
+        void DB2Engine::DropStatement( Db2RealHandle* handle, SQLHSTMT hstmt )
+        {
+            map<string, CachedStatement>::iterator it = handle->stmts.begin();
+            for (; it != handle->stmts.end(); it++)
+            {
+                if (it->second.hstmt == hstmt)
                 {
-                    ss << "\\r";
+                    SQLFreeHandle(SQL_HANDLE_STMT, hstmt);
+                    handle->stmts.erase(it);
+                    return;
                 }
-                else if (src[i] == '\t')
+            }
+        }
+        
+        bool DB2Engine::BindParamArrays( Db2RealHandle* handle, CachedStatement* stmt, const PreparedFilter* filter, int& sqlCode, string& errorMsg )
+        {
+            int rows = filter->GetRowCount();
+            int count = stmt->param_types.size();
+            for (int row = 0; row < rows; row++)
+            {
+                if (filter->GetParamCount(row) != count)
                 {
-                    ss << "\\t";
+                    stringstream ss;
+                    ss << "the statement has " << count << " parameters, but " << filter->GetParamCount(row) << " are bound in row " << row;
+                    errorMsg = ss.str();
+                    sqlCode = -1;
+                    return false;
                 }
-                else if (src[i] == '\n')
+            }
+            
+            if (handle->param_buffers.size() < count)
+            {
+                handle->param_buffers.resize(count);
+                handle->param_indicators.resize(count);
+            }
+            
+            string text;
+            for (int i = 0; i < count; i++)
+            {
+                // the integers or the doubles are bound as they are if all the values of the parameter are,
+                // otherwise all of them are bound in text, or in binary for a binary column
+                bool integers = true;
+                bool doubles = true;
+                SQLLEN width = 1;
+                for (int row = 0; row < rows; row++)
+                {
+                    const PreparedFilter::Param& param = filter->GetParam(row, i);
+                    if (param.type_ == PreparedFilter::PARAM_NULL)
+                    {
+                        continue;
+                    }
+                    
+                    integers = integers && (param.type_ == PreparedFilter::PARAM_INTEGER);
+                    doubles = doubles && (param.type_ == PreparedFilter::PARAM_DOUBLE);
+                    
+                    SQLLEN param_width = (param.type_ == PreparedFilter::PARAM_STRING) ? (SQLLEN)param.length_ : NUMBER_TEXT_LENGTH;
+                    width = (param_width > width) ? param_width : width;
+                }
+                
+                SQLSMALLINT c_type = SQL_C_CHAR;
+                SQLLEN value_size = width;
+                if (integers)
+                {
+                    c_type = SQL_C_SBIGINT;
+                    value_size = sizeof(SQLBIGINT);
+                }
+                else if (doubles)
+                {
+                    c_type = SQL_C_DOUBLE;
+                    value_size = sizeof(SQLDOUBLE);
+                }
+                else if (stmt->param_types[i] == SQL_BINARY || stmt->param_types[i] == SQL_VARBINARY 
+                    || stmt->param_types[i] == SQL_LONGVARBINARY || stmt->param_types[i] == SQL_BLOB)
+                {
+                    c_type = SQL_C_BINARY;
+                }
+                
+                vector<char>& buffer = handle->param_buffers[i];
+                vector<SQLLEN>& indicators = handle->param_indicators[i];
+                buffer.resize(rows * value_size);
+                indicators.resize(rows);
+                
+                for (int row = 0; row < rows; row++)
                 {
-                    ss << "\\n";
+                    const PreparedFilter::Param& param = filter->GetParam(row, i);
+                    char* value = &(buffer[row * value_size]);
+                    
+                    if (param.type_ == PreparedFilter::PARAM_NULL)
+                    {
+                        indicators[row] = SQL_NULL_DATA;
+                    }
+                    else if (c_type == SQL_C_SBIGINT)
+                    {
+                        SQLBIGINT integer = param.integer_;
+                        memcpy(value, &integer, sizeof(integer));
+                        indicators[row] = sizeof(integer);
+                    }
+                    else if (c_type == SQL_C_DOUBLE)
+                    {
+                        SQLDOUBLE real = param.double_;
+                        memcpy(value, &real, sizeof(real));
+                        indicators[row] = sizeof(real);
+                    }
+                    else if (param.type_ == PreparedFilter::PARAM_INTEGER)
+                    {
+                        indicators[row] = ValueFormatter::FormatInteger(param.integer_, value);
+                    }
+                    else if (param.type_ == PreparedFilter::PARAM_DOUBLE)
+                    {
+                        text.clear();
+                        ValueFormatter::AppendDouble(text, param.double_);
+                        memcpy(value, text.data(), text.size());
+                        indicators[row] = text.size();
+                    }
+                    else
+                    {
+                        memcpy(value, filter->GetString(param), param.length_);
+                        indicators[row] = param.length_;
+                    }
                 }
-                else if (src[i] == '\'')
+                
+                SQLULEN column_size = (stmt->param_sizes[i] != 0) ? stmt->param_sizes[i] : (SQLULEN)value_size;
+                SQLRETURN rc = SQLBindParameter(
+                                    stmt->hstmt, 
+                                    (SQLUSMALLINT)(i + 1), 
+                                    SQL_PARAM_INPUT, 
+                                    c_type, 
+                                    stmt->param_types[i], 
+                                    column_size, 
+                                    stmt->param_digits[i], 
+                                    &(buffer[0]), 
+                                    value_size, 
+                                    &(indicators[0]));
+                if (rc != SQL_SUCCESS)
                 {
-                    ss << "\\'";
+                    sqlCode = rc;
+                    ExtractErrMsgPrepared(sqlCode, stmt->hstmt, errorMsg);
+                    return false;
+                }
+            }
+            
+            // a column of values for each parameter, all the rows at once
+            SQLRETURN rc = SQLSetStmtAttr(stmt->hstmt, SQL_ATTR_PARAM_BIND_TYPE, (SQLPOINTER)SQL_PARAM_BIND_BY_COLUMN, 0);
+            if (rc == SQL_SUCCESS)
+            {
+                rc = SQLSetStmtAttr(stmt->hstmt, SQL_ATTR_PARAMSET_SIZE, (SQLPOINTER)(SQLLEN)rows, 0);
+            }
+            if (rc != SQL_SUCCESS)
+            {
+                sqlCode = rc;
+                ExtractErrMsgPrepared(sqlCode, stmt->hstmt, errorMsg);
+                return false;
+            }
+            
+            return true;
+        }
+        
+        string& DB2Engine::ExtractErrMsgPrepared( int& sqlCode, SQLHSTMT hstmt, string &errorMsg)
+        {
+            errorMsg = "";
+        
+            SQLCHAR     buffer[SQL_MAX_MESSAGE_LENGTH];
+            SQLCHAR     sqlstate[SQL_SQLSTATE_SIZE + 1];
+            SQLINTEGER  nagative_sql_code = 0;
+            SQLSMALLINT length;
+            
+            int rec_num = 1;
+            while (SQLGetDiagRec(
+                    SQL_HANDLE_STMT,
+                    hstmt,
+                    rec_num,
+                    sqlstate,
+                    &nagative_sql_code,
+                    buffer,
+                    SQL_MAX_MESSAGE_LENGTH,
+                    &length ) == SQL_SUCCESS )
+            {
+                errorMsg = FormErrMsg(rec_num, sqlstate, nagative_sql_code, buffer);
+                rec_num++;
+            }
+            
+            // keep the return code if there is no diagnostic
+            if (nagative_sql_code != 0)
+            {
+                sqlCode = nagative_sql_code;
+            }
+            
+            return errorMsg;
+        }
+        
+        int DB2Engine::FetchBlock(void* handle, DbLocation* location, RowBlock* block, tr1::shared_ptr<IException>& exception) throw ()
+        {
+            Db2RealHandle* real_handle = (Db2RealHandle*)handle;
+            
+            // the result set is closed once its last row is fetched
+            if (real_handle->res == 0)
+            {
+                block->Reset(real_handle->colNum);
+                return 0;
+            }
+            
+            int sqlCode = 0;
+            string errorMsg = "";
+            
+            if (real_handle->block_mode == Db2RealHandle::BLOCK_NONE)
+            {
+                if (BindColumnArrays(real_handle, block->GetCapacity(), block->IsNativeNumbers(), sqlCode, errorMsg))
+                {
+                    real_handle->block_mode = Db2RealHandle::BLOCK_BOUND;
+                }
+                else if (sqlCode != 0)
+                {
+                    exception.reset(new DbSelectFetchRowException(*location, errorMsg, sqlCode, 0, 0));
+                    return 0;
                 }
                 else
                 {
-                    ss << src[i];
+                    real_handle->block_mode = Db2RealHandle::BLOCK_ROWS;
+                }
+            }
+            
+            if (real_handle->block_mode == Db2RealHandle::BLOCK_ROWS)
+            {
+                return DbEngine::FetchBlock(handle, location, block, exception);
+            }
+            
+            block->Reset(real_handle->colNum);
+            for (int i = 0; i < real_handle->colNum; i++)
+            {
+                if (real_handle->block_types[i] == SQL_C_SBIGINT)
+                {
+                    block->SetColumnType(i, RowBlock::COLUMN_INTEGER);
+                }
+                else if (real_handle->block_types[i] == SQL_C_DOUBLE)
+                {
+                    block->SetColumnType(i, RowBlock::COLUMN_DOUBLE);
                 }
             }
-            string rslt = ss.str();
-            memcpy(((Db2RealHandle*)handle)->inner_buf_, rslt.data(), rslt.length());
             
-            return (char*)(((Db2RealHandle*)handle)->inner_buf_);
+            // the arrays are bound for the capacity of the first block, a smaller block fetches fewer rows
+            int rows = (block->GetCapacity() < real_handle->block_size) ? block->GetCapacity() : real_handle->block_size;
+            SQLRETURN rc = SQLSetStmtAttr(real_handle->hstmt, SQL_ATTR_ROW_ARRAY_SIZE, (SQLPOINTER)(SQLLEN)rows, 0);
+            if (SQL_SUCCESS == rc)
+            {
+                rc = SQLFetch(real_handle->hstmt);
+            }
+            
+            if (SQL_NO_DATA_FOUND == rc)
+            {
+                // no extra data
+                CloseOpenRslt(handle, location, exception);
+                real_handle->res = 0;
+                return 0;
+            }
+            
+            if (SQL_SUCCESS != rc && SQL_SUCCESS_WITH_INFO != rc)
+            {
+                sqlCode = rc;
+                errorMsg = ExtractErrMsgStmt(sqlCode, handle, errorMsg);
+                exception.reset(new DbSelectFetchRowException(*location, errorMsg, sqlCode, 0, 0));
+                return 0;
+            }
+            
+            for (SQLULEN row = 0; row < real_handle->block_fetched; row++)
+            {
+                SQLUSMALLINT status = real_handle->block_status[row];
+                if (status == SQL_ROW_NOROW)
+                {
+                    continue;
+                }
+                
+                if (status == SQL_ROW_ERROR)
+                {
+                    sqlCode = -1;
+                    errorMsg = ExtractErrMsgStmt(sqlCode, handle, errorMsg);
+                    exception.reset(new DbSelectFetchRowException(*location, errorMsg, sqlCode, 0, 0));
+                    return 0;
+                }
+                
+                for (int i = 0; i < real_handle->colNum; i++)
+                {
+                    SQLLEN width = real_handle->block_widths[i];
+                    SQLLEN indicator = real_handle->block_indicators[i][row];
+                    const char* value = &(real_handle->block_buffers[i][row * width]);
+                    
+                    if (indicator == SQL_NULL_DATA)
+                    {
+                        block->AppendNull();
+                    }
+                    else if (real_handle->block_types[i] == SQL_C_SBIGINT)
+                    {
+                        SQLBIGINT number = 0;
+                        memcpy(&number, value, sizeof(number));
+                        block->AppendInteger(number);
+                    }
+                    else if (real_handle->block_types[i] == SQL_C_DOUBLE)
+                    {
+                        double number = 0;
+                        memcpy(&number, value, sizeof(number));
+                        block->AppendDouble(number);
+                    }
+                    else
+                    {
+                        // the value is cut if it does not fit, leaving the room for the '\0'
+                        block->AppendValue(value, (unsigned long)((indicator < width) ? indicator : width - 1));
+                    }
+                }
+            }
+            
+            return block->GetRowCount();
+        }
+        
+        int DB2Engine::GetColumnCount(void* handle, DbLocation* location, tr1::shared_ptr<IException>& exception) throw ()
+        {
+            return ((Db2RealHandle*)handle)->colNum;
+        }
+        
+        bool DB2Engine::BindColumnArrays( Db2RealHandle* handle, int rows, bool nativeNumbers, int& sqlCode, string& errorMsg )
+        {
+            int count = handle->colNum;
+            handle->block_types.resize(count);
+            handle->block_widths.resize(count);
+            
+            SQLLEN row_width = 0;
+            for (int i = 0; i < count; i++)
+            {
+                SQLLEN type = 0;
+                SQLRETURN rc = SQLColAttribute(handle->hstmt, (SQLSMALLINT)(i + 1), SQL_DESC_CONCISE_TYPE, 0, 0, 0, &type);
+                if (SQL_SUCCESS != rc)
+                {
+                    sqlCode = rc;
+                    errorMsg = ExtractErrMsgStmt(sqlCode, handle, errorMsg);
+                    return false;
+                }
+                
+                if (nativeNumbers && (type == SQL_SMALLINT || type == SQL_INTEGER || type == SQL_BIGINT))
+                {
+                    handle->block_types[i] = SQL_C_SBIGINT;
+                    handle->block_widths[i] = sizeof(SQLBIGINT);
+                }
+                else if (nativeNumbers && (type == SQL_DOUBLE || type == SQL_FLOAT || type == SQL_REAL))
+                {
+                    handle->block_types[i] = SQL_C_DOUBLE;
+                    handle->block_widths[i] = sizeof(double);
+                }
+                else
+                {
+                    // the max length of the column includes the '\0'
+                    if ((SQLLEN)(handle->col_max_len[i]) > BLOCK_VALUE_LENGTH)
+                    {
+                        return false;
+                    }
+                    
+                    handle->block_types[i] = SQL_C_CHAR;
+                    handle->block_widths[i] = handle->col_max_len[i];
+                }
+                
+                row_width += handle->block_widths[i] + sizeof(SQLLEN);
+            }
+            
+            if (row_width > 0 && rows > BLOCK_BUFFER_LENGTH / row_width)
+            {
+                rows = BLOCK_BUFFER_LENGTH / row_width;
+            }
+            rows = (rows < 1) ? 1 : rows;
+            
+            handle->block_size = rows;
+            handle->block_fetched = 0;
+            handle->block_status.resize(rows);
+            handle->block_buffers.resize(count);
+            handle->block_indicators.resize(count);
+            
+            SQLRETURN rc = SQLSetStmtAttr(handle->hstmt, SQL_ATTR_ROW_BIND_TYPE, (SQLPOINTER)SQL_BIND_BY_COLUMN, 0);
+            if (SQL_SUCCESS == rc)
+            {
+                rc = SQLSetStmtAttr(handle->hstmt, SQL_ATTR_ROWS_FETCHED_PTR, &(handle->block_fetched), 0);
+            }
+            if (SQL_SUCCESS == rc)
+            {
+                rc = SQLSetStmtAttr(handle->hstmt, SQL_ATTR_ROW_STATUS_PTR, &(handle->block_status[0]), 0);
+            }
+            
+            for (int i = 0; i < count && SQL_SUCCESS == rc; i++)
+            {
+                // the buffers of the former result sets are reused
+                handle->block_buffers[i].resize(rows * handle->block_widths[i]);
+                handle->block_indicators[i].resize(rows);
+                
+                rc = SQLBindCol(handle->hstmt,
+                                (SQLUSMALLINT)(i + 1),
+                                handle->block_types[i],
+                                &(handle->block_buffers[i][0]),
+                                handle->block_widths[i],
+                                &(handle->block_indicators[i][0]));
+            }
+            
+            if (SQL_SUCCESS != rc)
+            {
+                sqlCode = rc;
+                errorMsg = ExtractErrMsgStmt(sqlCode, handle, errorMsg);
+                UnbindColumnArrays(handle);
+                return false;
+            }
+            
+            return true;
+        }
+        
+        void DB2Engine::UnbindColumnArrays( Db2RealHandle* handle )
+        {
+            SQLFreeStmt(handle->hstmt, SQL_UNBIND);
+            SQLSetStmtAttr(handle->hstmt, SQL_ATTR_ROW_ARRAY_SIZE, (SQLPOINTER)(SQLLEN)1, 0);
+            SQLSetStmtAttr(handle->hstmt, SQL_ATTR_ROWS_FETCHED_PTR, 0, 0);
+            SQLSetStmtAttr(handle->hstmt, SQL_ATTR_ROW_STATUS_PTR, 0, 0);
+            
+            handle->block_size = 0;
+            handle->block_fetched = 0;
         }
         
         void DB2Engine::InitThread()
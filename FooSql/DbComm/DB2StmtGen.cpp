@@ -5,8 +5,12 @@
 #include "dbcomm/DB2DbTasks.h"
 #include "dbcomm/Row.h"
 #include "dbcomm/DB2StmtGen.h"
+#include "dbcomm/DbQueryAction.h"
+#include "dbcomm/DbQueryRslt.h"
+#include "dbcomm/PreparedFilter.h"
 
 #include "thread/MutexLockGuard.h"
+#include "tool/StringHelper.h"
 
 using namespace std;
 
@@ -75,67 +79,241 @@ namespace COMMON
         }
         
         ///////////////////////////////////////////////
-        //// DB2ReplaceStmtGen
+        //// DB2ColumnTypes
         ///////////////////////////////////////////////
-        string DB2ReplaceStmtGen::FormStatement(const DbLocation& dbLocation)
+        map<string, map<string, string> > DB2ColumnTypes::column_types_;
+        Mutex DB2ColumnTypes::column_type_mutex_;
+        
+        // form a type as written in CAST(), such as "VARCHAR(64)", from the catalog
+        static string FormColumnType(string typeName, const string& length, const string& scale)
         {
-            if (has_value_ == false)
+            TOOL::StringHelper::Trim(typeName);
+            
+            if (typeName == "CHARACTER" || typeName == "VARCHAR" || typeName == "GRAPHIC" || typeName == "VARGRAPHIC"
+                || typeName == "BINARY" || typeName == "VARBINARY" || typeName == "BLOB" || typeName == "CLOB" || typeName == "DBCLOB")
             {
-                return "";
+                return typeName + "(" + length + ")";
+            }
+            else if (typeName == "DECIMAL")
+            {
+                return typeName + "(" + length + "," + scale + ")";
+            }
+            else if (typeName == "TIMESTAMP")
+            {
+                return typeName + "(" + scale + ")";
+            }
+            else if (typeName == "DECFLOAT")
+            {
+                // the length is in bytes
+                return (length == "8") ? "DECFLOAT(16)" : "DECFLOAT(34)";
             }
             
-			// get the primary key, if none, throw an exception
-            vector<string> pri_key = DB2PriKeys::GetPriKeys(dbLocation, table_name_);
-            
-			// generate an "merge into" statement
+            return typeName;
+        }
+        
+        map<string, string> DB2ColumnTypes::GetColumnTypes(const DbLocation& location, const string& tblName)
+        {
             stringstream ss;
-            ss << "MERGE INTO " << table_name_ << " AS T USING ( "
-                << "SELECT * FROM TABLE ( VALUES " << values_.str() << ")"
-                << ") AS TMPTABLE(" << col_list_ << ") ON "
-                << "(";
+            ss << location.ToString() << tblName;
             
-            for (int i = 0; i < pri_key.size(); i++)
             {
-                ss << "T." << pri_key[i] << "=TMPTABLE." << pri_key[i];
-                if (i != pri_key.size() - 1)
+                MutexLockGuard g(column_type_mutex_);
+                map<string, map<string, string> >::iterator it = column_types_.find(ss.str());
+                if (it != column_types_.end())
                 {
-                    ss << " AND ";
+                    return it->second;
                 }
             }
             
-            ss << ") ";
-            ss << "WHEN MATCHED THEN UPDATE SET ";
-            for (int i = 0; i < columns_.size(); i++)
+            // check whether the schema information is brought with the table name
+            string schema = "";
+            string real_tbl_name = tblName;
+            size_t found = tblName.find_first_of(".");
+            if (found != std::string::npos)
             {
-                ss << columns_[i] << " = TMPTABLE." << columns_[i];
-
-                if (i != columns_.size() - 1)
+                schema = tblName.substr(0, found);
+                real_tbl_name = tblName.substr(found + 1);
+            }
+            
+            stringstream statement;
+            statement << "SELECT COLNAME, TYPENAME, LENGTH, SCALE, TYPESCHEMA FROM SYSCAT.COLUMNS "
+                      << "WHERE TABNAME = UPPER('" << real_tbl_name << "') AND TABSCHEMA = ";
+            if (schema != "")
+            {
+                statement << "UPPER('" << schema << "')";
+            }
+            else
+            {
+                statement << "CURRENT SCHEMA";
+            }
+            
+            // no found before? get it
+            vector<DbLocation> dbLocations_array;
+            dbLocations_array.push_back(location);
+            tr1::shared_ptr<IDbTasks> db2Tasks( new DB2DbTasks(dbLocations_array, true) );
+            db2Tasks->Connect();
+            DbQueryAction* query_action = db2Tasks->Select();
+            QueryFilter filter(statement.str());
+            query_action->Do(&filter);
+            DbQueryRslt* query_rslt = (DbQueryRslt*)query_action->GetRslt();
+            
+            map<string, string> column_types;
+            Row rslt;
+            bool success = false;
+            while ((char**)(rslt = query_rslt->Fetch(success)) != NULL) 
+            {
+                // the distinct types can not be written in CAST() without their schema, leave them unknown
+                string type_schema = rslt[4];
+                TOOL::StringHelper::Trim(type_schema);
+                if (type_schema != "SYSIBM")
                 {
-                    ss << ",";
+                    continue;
                 }
+                
+                column_types[rslt[0]] = FormColumnType(rslt[1], rslt[2], rslt[3]);
             }
-            ss << " WHEN NOT MATCHED THEN INSERT (" << col_list_ << ")";
-            ss << " VALUES" << FormOneList(columns_,"TMPTABLE");
-
-            return ss.str();
+            
+            query_action->EndAction();
+            db2Tasks->Disconnect();
+            
+            MutexLockGuard g(column_type_mutex_);
+            column_types_[ss.str()] = column_types;
+            
+            return column_types;
+        }
+        
+        ///////////////////////////////////////////////
+        //// DB2InsertStmtGen
+        ///////////////////////////////////////////////
+        tr1::shared_ptr<DbActionFilter> DB2InsertStmtGen::FormFilter(const DbLocation& dbLocation, string& buffer)
+        {
+            if (has_value_ == false)
+            {
+                return tr1::shared_ptr<DbActionFilter>();
+            }
+            
+            tr1::shared_ptr<PreparedFilter> filter(new PreparedFilter());
+            if (BindValues(*filter))
+            {
+                // the same statement for any number of rows
+                buffer.clear();
+                buffer.append("INSERT INTO ").append(table_name_);
+                buffer.append(" (").append(col_list_).append(") VALUES (");
+                for (int i = 0; i < columns_.size(); i++)
+                {
+                    buffer.append((i == 0) ? "?" : ",?");
+                }
+                buffer.append(")");
+            }
+            else
+            {
+                // the values are written in the statement, which has no parameter
+                FormStatement(dbLocation, buffer);
+            }
+            
+            filter->SwapContents(buffer);
+            return filter;
         }
         
         ///////////////////////////////////////////////
-        //// DB2InsertIgnoreStmtGen
+        //// DB2MergeStmtGen
         ///////////////////////////////////////////////
-        string DB2InsertIgnoreStmtGen::FormStatement(const DbLocation& dbLocation)
+        DB2MergeStmtGen::DB2MergeStmtGen(bool updateMatched)
+            : update_matched_(updateMatched)
+        {
+        }
+        
+        string DB2MergeStmtGen::FormStatement(const DbLocation& dbLocation)
         {
             if (has_value_ == false)
             {
                 return "";
             }
             
-            // get primary key, if none, throw exception
+            return FormMerge(dbLocation, "SELECT * FROM TABLE ( VALUES " + values_ + ")");
+        }
+        
+        tr1::shared_ptr<DbActionFilter> DB2MergeStmtGen::FormFilter(const DbLocation& dbLocation, string& buffer)
+        {
+            if (has_value_ == false)
+            {
+                return tr1::shared_ptr<DbActionFilter>();
+            }
+            
+            tr1::shared_ptr<PreparedFilter> filter(new PreparedFilter());
+            string source;
+            if (BindValues(*filter) && FormParamSource(dbLocation, source))
+            {
+                // each row of parameters is merged by itself
+                buffer = FormMerge(dbLocation, source);
+            }
+            else
+            {
+                // the values are written in the statement, which has no parameter
+                filter->ClearParams();
+                buffer = FormStatement(dbLocation);
+            }
+            
+            filter->SwapContents(buffer);
+            return filter;
+        }
+        
+        size_t DB2MergeStmtGen::GetStatementSize() const
+        {
+            if (has_value_ == false)
+            {
+                return 0;
+            }
+            
+            // the columns are written again in the UPDATE and INSERT parts, and so may the primary keys
+            // in the ON part, each of them with "TMPTABLE." or "T."
+            return StmtGenerator::GetStatementSize() + col_list_.size() * 5 + columns_.size() * 48 + 160;
+        }
+        
+        bool DB2MergeStmtGen::FormParamSource(const DbLocation& dbLocation, string& source)
+        {
+            // an untyped parameter is not allowed in VALUES
+            map<string, string> types = DB2ColumnTypes::GetColumnTypes(dbLocation, table_name_);
+            
+            source = "VALUES (";
+            for (int i = 0; i < columns_.size(); i++)
+            {
+                // the names are kept in upper case by the catalog, unless they are quoted
+                string name = columns_[i];
+                TOOL::StringHelper::Trim(name);
+                if (name.size() > 1 && name[0] == '"' && name[name.size() - 1] == '"')
+                {
+                    name = name.substr(1, name.size() - 2);
+                }
+                else
+                {
+                    TOOL::StringHelper::ToUper(name);
+                }
+                
+                map<string, string>::iterator it = types.find(name);
+                if (it == types.end())
+                {
+                    return false;
+                }
+                
+                source += (i == 0) ? "CAST(? AS " : ",CAST(? AS ";
+                source += it->second;
+                source += ")";
+            }
+            source += ")";
+            
+            return true;
+        }
+        
+        string DB2MergeStmtGen::FormMerge(const DbLocation& dbLocation, const string& source)
+        {
+			// get the primary key, if none, throw an exception
             vector<string> pri_key = DB2PriKeys::GetPriKeys(dbLocation, table_name_);
             
+			// generate an "merge into" statement
             stringstream ss;
             ss << "MERGE INTO " << table_name_ << " AS T USING ( "
-                << "SELECT * FROM TABLE ( VALUES " << values_.str() << ")"
+                << source
                 << ") AS TMPTABLE(" << col_list_ << ") ON "
                 << "(";
             
@@ -148,8 +326,23 @@ namespace COMMON
                 }
             }
             
-            ss << ") WHEN NOT MATCHED THEN INSERT (" << col_list_ << ")";
-            ss << "  VALUES" << FormOneList(columns_,"TMPTABLE");
+            ss << ") ";
+            if (update_matched_)
+            {
+                ss << "WHEN MATCHED THEN UPDATE SET ";
+                for (int i = 0; i < columns_.size(); i++)
+                {
+                    ss << columns_[i] << " = TMPTABLE." << columns_[i];
+
+                    if (i != columns_.size() - 1)
+                    {
+                        ss << ",";
+                    }
+                }
+                ss << " ";
+            }
+            ss << "WHEN NOT MATCHED THEN INSERT (" << col_list_ << ")";
+            ss << " VALUES" << FormOneList(columns_,"TMPTABLE");
 
             return ss.str();
         }
@@ -157,7 +350,7 @@ namespace COMMON
         ///////////////////////////////////////////////
         //// DB2GetPriKeyStmtGen
         ///////////////////////////////////////////////
-        bool DB2GetPriKeyStmtGen::MakeupStatement(vector<string>& columns, string tableName, string values, bool)
+        bool DB2GetPriKeyStmtGen::MakeupStatement(vector<string>& columns, const string& tableName, const string& values, bool, unsigned long long)
         {
             table_name_ = tableName;
             
@@ -1,36 +1,151 @@
+#include <sys/time.h>
+
 #include "dbcomm/CommDef.h"
 #include "dbcomm/DbTasks.h"
 #include "dbcomm/DbBatchAction.h"
 #include "dbcomm/BatchFilter.h"
+#include "dbcomm/DbExecuteRslt.h"
+
+#include "thread/MutexLockGuard.h"
 
 namespace COMMON
 {
     namespace DBCOMM
     {
+        static long long NowInUs()
+        {
+            struct timeval tv;
+            gettimeofday(&tv, 0);
+            return (long long)tv.tv_sec * 1000000 + tv.tv_usec;
+        }
+        
+        static long long NowInMs()
+        {
+            return NowInUs() / 1000;
+        }
+        
+        // keep the first exception of several steps
+        static void KeepError(tr1::shared_ptr<COMMON::EXCEPTION::ThrowableException>& error, COMMON::EXCEPTION::ThrowableException& e)
+        {
+            if (!error)
+            {
+                error.reset(new COMMON::EXCEPTION::ThrowableException(e));
+            }
+        }
+        
         DbBatchAction::DbBatchAction(
             tr1::shared_ptr<IDbTasks> dbtasks, 
             tr1::shared_ptr<DbEngine> engine, 
             bool& is_action_finished, 
             int values_per_batch, 
             int times_to_commit)
-            : DbInsertAction(dbtasks, engine, is_action_finished, times_to_commit)
+            : DbInsertAction(dbtasks, engine, is_action_finished, times_to_commit), 
+              flush_policy_(values_per_batch), 
+              in_flight_since_(0), 
+              timer_stopping_(false), 
+              timer_failed_(false)
         {
-            values_per_batch_ = values_per_batch;
+            flushes_in_flight_ = engine->GetConnectionsPerLocation();
+            pipelined_ = false;
             
             vector<DbLocation>& dbs = dbtasks->GetDbLocations();
             for (int i = 0; i < dbs.size(); i++)
             {
-                values_now_[dbs[i]] = 0;
+                buffers_[dbs[i]] = vector<TableBuffer>();
+                pending_rows_[dbs[i]] = 0;
+                in_flight_rows_[dbs[i]] = 0;
             }
+            
+            // never grown later, growing would copy the buffers and lose their capacity
+            spare_buffers_.reserve(buffers_.Size() * (flushes_in_flight_ + 1));
         }
 
         DbBatchAction::~DbBatchAction()
         {
+            // the timer must not send anything while the action is going
+            StopTimer();
+            
+            // the filters of the statements in flight are released before the base class waits for them
+            engine_->WaitSubmitted();
+        }
+        
+        bool DbBatchAction::SetPipelined(bool pipelined)
+        {
+            THREAD::MutexLockGuard guard(mutex_);
+            
+            bool old = pipelined_;
+            pipelined_ = pipelined;
+            return old;
+        }
+        
+        void DbBatchAction::SetFlushPolicy(const FlushPolicy& policy)
+        {
+            StopTimer();
+            
+            {
+                THREAD::MutexLockGuard guard(mutex_);
+                flush_policy_ = policy;
+            }
+            
+            StartTimer();
+        }
+        
+        FlushPolicy DbBatchAction::GetFlushPolicy()
+        {
+            THREAD::MutexLockGuard guard(mutex_);
+            return flush_policy_;
+        }
+
+        void DbBatchAction::SetTuner(const tr1::shared_ptr<BatchTuner>& tuner)
+        {
+            THREAD::MutexLockGuard guard(mutex_);
+            
+            tuner_ = tuner;
+            if (!tuner_)
+            {
+                return;
+            }
+            
+            // tuned from the limits given
+            for (int i = 0; i < buffers_.Size(); i++)
+            {
+                DbLocation& location = buffers_.LocationAt(i);
+                tuner_->Start(location, flush_policy_.GetMaxRows(), already_affected_rows_[location].commit_judger_->GetCommitLimit());
+            }
+        }
+        
+        DbRslt* DbBatchAction::GetRslt()
+        {
+            THREAD::MutexLockGuard guard(mutex_);
+            
+            action_rslt_.reset();
+    
+            map<DbLocation, long long> affected_rows;
+            map<DbLocation, AffectedRowRecorder>::iterator it = already_affected_rows_.begin();
+            for (; it != already_affected_rows_.end(); it++)
+            {
+                affected_rows[it->first] = it->second.already_affected_rows_;
+            }
+            
+            vector<BatchTuner::Decision> decisions;
+            if (tuner_)
+            {
+                tuner_->TakeDecisions(decisions);
+            }
+    
+            action_rslt_ = tr1::shared_ptr<DbBatchRslt>(new DbBatchRslt(shared_from_this(), affected_rows, decisions));
+    
+            return action_rslt_.get();
         }
 
         bool DbBatchAction::MakeupStatement(const tr1::shared_ptr<StmtGenerator>& elem, BatchFilter* filter)
         {
-            return elem->MakeupStatement(filter->GetColumns(), filter->GetTableName(), filter->GetValues(), filter->CheckCompatible());
+            return elem->MakeupStatement(
+                filter->GetColumns(), 
+                filter->GetTableName(), 
+                filter->GetValues(), 
+                filter->CheckCompatible(), 
+                filter->GetFingerprint());
         }
 
         bool DbBatchAction::Do(DbActionFilter* filter, map<DbLocation, long long>* affected_rows) throw (COMMON::EXCEPTION::ThrowableException)
@@ -40,7 +155,7 @@ namespace COMMON
 
         bool DbBatchAction::Do(DbActionFilter* f, DbLocation* location, long long* affected_rows) throw (COMMON::EXCEPTION::ThrowableException)
         {
-            bool success = true;
+            THREAD::MutexLockGuard guard(mutex_);
             
             // clear the number of affected rows
             if (affected_rows)
@@ -48,53 +163,214 @@ namespace COMMON
                 *affected_rows = 0;
             }
             
-            // check whether the input statement is compatible with 
-			// the current one, if not do the current one at once
-            unsigned int& value_count = values_now_[*location]; 
-            tr1::shared_ptr<StmtGenerator>& elem = elems_[*location];
+            bool success = true;
+            tr1::shared_ptr<COMMON::EXCEPTION::ThrowableException> error;
+            try
+            {
+                success = DoOne((BatchFilter*)f, *location, affected_rows);
+            }
+            catch (COMMON::EXCEPTION::ThrowableException& e)
+            {
+                success = false;
+                KeepError(error, e);
+            }
+            
+            return FinishCall(success, error);
+        }
+        
+        bool DbBatchAction::DoOne(BatchFilter* filter, const DbLocation& location, long long* affected_rows)
+        {
+            bool success = true;
+            tr1::shared_ptr<COMMON::EXCEPTION::ThrowableException> error;
             
-            BatchFilter* filter = (BatchFilter*)f;
-            bool do_right_now = MakeupStatement(elem, filter);
-            if (do_right_now == true)
+            // the values are buffered even if the statement making room for them fails
+            int victim = -1;
+            int index = FindBuffer(location, filter, victim);
+            try
             {
-                // change the count to meet the limite
-                value_count = values_per_batch_;
+                if (index < 0)
+                {
+                    // all the buffers are taken by other tables, the fullest one makes room
+                    index = victim;
+                    success = FlushOne(location, victim, affected_rows);
+                }
+                else if (IsBeyondPacket(location, GetBuffers(location)[index], filter))
+                {
+                    // split the statement before it goes beyond the packet limit
+                    success = FlushOne(location, index, affected_rows);
+                }
             }
-            else
+            catch (COMMON::EXCEPTION::ThrowableException& e)
             {
-                value_count++;
+                success = false;
+                KeepError(error, e);
             }
-
-            // do we meet the limit?
-            if (value_count == values_per_batch_)
+            
+            try
             {
-                value_count = 0;  
+                success = Append(location, index, filter, affected_rows) && success;
                 
-                string statement = elem->FormStatement(*location);
+                // do we meet the limit?
+                if (IsFull(location, GetBuffers(location)[index]))
+                {
+                    success = FlushOne(location, index, affected_rows) && success;
+                }
+            }
+            catch (COMMON::EXCEPTION::ThrowableException& e)
+            {
+                success = false;
+                KeepError(error, e);
+            }
+            
+            if (error)
+            {
+                throw *error;
+            }
+
+            return success;
+        }
+        
+        vector<DbBatchAction::TableBuffer>& DbBatchAction::GetBuffers(const DbLocation& location)
+        {
+            vector<TableBuffer>& buffers = buffers_[location];
+            
+            // elems_ is filled by the constructors of the sub classes, after this one
+            if (buffers.size() == 0)
+            {
+                buffers.push_back(TableBuffer());
+                buffers.back().elem_ = elems_[location];
+            }
+            
+            return buffers;
+        }
+        
+        int DbBatchAction::FindBuffer(const DbLocation& location, BatchFilter* filter, int& victim)
+        {
+            vector<TableBuffer>& buffers = GetBuffers(location);
+            unsigned long long fingerprint = filter->GetFingerprint();
+            
+            int empty = -1;
+            victim = 0;
+            for (int i = 0; i < (int)buffers.size(); i++)
+            {
+                if (buffers[i].fingerprint_ == fingerprint)
+                {
+                    return i;
+                }
                 
-                elem->ClearContent();
+                if (empty < 0 && buffers[i].values_ == 0)
+                {
+                    empty = i;
+                }
                 
-                if (statement != "")
+                if (buffers[i].values_ > buffers[victim].values_)
+                {
+                    victim = i;
+                }
+            }
+            
+            if (empty >= 0)
+            {
+                return empty;
+            }
+            
+            // a generator which cannot make another keeps one table at a time, as it always did
+            if (buffers.size() < MAX_TABLE_BUFFERS)
+            {
+                StmtGenerator* elem = buffers[0].elem_->NewInstance();
+                if (elem)
                 {
-                    InsertFilter filter(statement);
-                    success = DbInsertAction::Do(&filter, location, affected_rows);
+                    buffers.push_back(TableBuffer());
+                    buffers.back().elem_.reset(elem);
+                    return (int)buffers.size() - 1;
                 }
             }
- 
-            // set the new statement
-            if (do_right_now)
+            
+            return -1;
+        }
+        
+        bool DbBatchAction::IsBeyondPacket(const DbLocation& location, const TableBuffer& buffer, BatchFilter* filter)
+        {
+            if (buffer.values_ == 0)
             {
-                MakeupStatement(elem, (BatchFilter*)f);
-                value_count++;    
+                return false;
             }
-
+            
+            size_t bytes = buffer.elem_->GetStatementSize() + StmtGenerator::GetRowSize(filter->GetValues());
+            return flush_policy_.IsBeyondPacket(location, bytes);
+        }
+        
+        bool DbBatchAction::Append(const DbLocation& location, int index, BatchFilter* filter, long long* affected_rows)
+        {
+            bool success = true;
+            TableBuffer& buffer = GetBuffers(location)[index];
+            
+            // check whether the input statement is compatible with 
+			// the current one, if not do the current one at once
+            tr1::shared_ptr<COMMON::EXCEPTION::ThrowableException> error;
+            if (MakeupStatement(buffer.elem_, filter))
+            {
+                try
+                {
+                    success = FlushOne(location, index, affected_rows);
+                }
+                catch (COMMON::EXCEPTION::ThrowableException& e)
+                {
+                    success = false;
+                    KeepError(error, e);
+                }
+                
+                // set the new statement, whatever happened to the current one
+                MakeupStatement(buffer.elem_, filter);
+            }
+            
+            buffer.fingerprint_ = filter->GetFingerprint();
+            buffer.values_++;
+            
+            // the clock is read only for the age trigger
+            if (buffer.values_ == 1 && flush_policy_.GetMaxAge() != 0)
+            {
+                buffer.buffered_since_ = NowInMs();
+            }
+            
+            if (error)
+            {
+                throw *error;
+            }
+            
             return success;
         }
         
+        bool DbBatchAction::IsFull(const DbLocation& location, const TableBuffer& buffer)
+        {
+            int rows = buffer.values_;
+            size_t bytes = buffer.elem_->GetStatementSize();
+            
+            return tuner_ ? flush_policy_.IsFull(rows, bytes, tuner_->GetValuesPerBatch(location)) : flush_policy_.IsFull(rows, bytes);
+        }
+        
+        void DbBatchAction::RecordSent(const DbLocation& location, long long rows, int statements, long long since)
+        {
+            if (!tuner_ || rows == 0)
+            {
+                return;
+            }
+            
+            // the statements of a DB run at the same time on its connections, so the latency of one is
+            // the wall time of a round of them, not the wall time shared among all of them
+            int rounds = (statements + flushes_in_flight_ - 1) / flushes_in_flight_;
+            if (tuner_->Record(location, rows, rounds, NowInUs() - since))
+            {
+                // counted from the rows affected now, no statement of the DB is running
+                AffectedRowRecorder& recorder = already_affected_rows_[location];
+                recorder.commit_judger_->SetCommitLimit(tuner_->GetCommitLimit(location), recorder.already_affected_rows_);
+            }
+        }
+        
         bool DbBatchAction::Do(
             map<DbLocation, DbActionFilter*>& works, map<DbLocation, long long>* affected_rows) throw (COMMON::EXCEPTION::ThrowableException)
         {
-            bool success = true;
+            THREAD::MutexLockGuard guard(mutex_);
             
             // clear the last result
             if (affected_rows)
@@ -107,114 +383,628 @@ namespace COMMON
                 }
             }
             
-			// we will check the new input statements for compatibility with the exsiting commands.
-			// if they are of different types, that is with different table to insert or different 
-			// specified columns, we should do the exsiting commands right now. 
-            map<DbLocation, tr1::shared_ptr<StmtGenerator> > remains;
+            // every value is buffered whatever happened to the others, the first exception is thrown at last
+            bool success = true;
+            tr1::shared_ptr<COMMON::EXCEPTION::ThrowableException> error;
+            
+			// each new input statement goes to the buffer of its table. If all the buffers are taken
+			// by other tables, or it would make the statement too long, we should do the 
+			// exsiting commands right now. 
+            vector<BufferRef> blocked;
             map<DbLocation, DbActionFilter*>::iterator it = works.begin();
             for (; it != works.end(); it++)
             {
                 BatchFilter* filter = (BatchFilter*)it->second;
-                bool do_right_now = MakeupStatement(elems_[it->first], filter);
-                if (do_right_now == true)
+                int victim = -1;
+                int index = FindBuffer(it->first, filter, victim);
+                if (index < 0)
+                {
+                    blocked.push_back(BufferRef(it->first, victim));
+                }
+                else if (IsBeyondPacket(it->first, GetBuffers(it->first)[index], filter))
                 {
-					// the new input statement is not compatible withe the existing ones.
-					
-					// finish the old ones by specify the current count of values 
-                    values_now_[it->first] = values_per_batch_;
-                    
 					// save the current input statements for later use
-                    remains[it->first] = elems_[it->first];
+                    blocked.push_back(BufferRef(it->first, index));
                 }
                 else
                 {
-					// the new input statement is compatible with the old one, 
-					// only add count.
-                    values_now_[it->first]++;
+                    try
+                    {
+                        success = Append(it->first, index, filter, affected_rows ? &(*affected_rows)[it->first] : 0) && success;
+                    }
+                    catch (COMMON::EXCEPTION::ThrowableException& e)
+                    {
+                        success = false;
+                        KeepError(error, e);
+                    }
+                }
+            }
+            
+            if (blocked.size() != 0)
+            {
+                try
+                {
+                    success = FlushMany(blocked, flushes_in_flight_, affected_rows) && success;
+                }
+                catch (COMMON::EXCEPTION::ThrowableException& e)
+                {
+                    success = false;
+                    KeepError(error, e);
+                }
+                
+                // And now, we should rebuild the new input commands to make it cached.
+                for (size_t i = 0; i < blocked.size(); i++)
+                {
+                    const DbLocation& location = blocked[i].first;
+                    BatchFilter* filter = (BatchFilter*)(works[location]);
+                    try
+                    {
+                        success = Append(location, blocked[i].second, filter, affected_rows ? &(*affected_rows)[location] : 0) && success;
+                    }
+                    catch (COMMON::EXCEPTION::ThrowableException& e)
+                    {
+                        success = false;
+                        KeepError(error, e);
+                    }
                 }
             }
 
-            // now to check each db locations. If they have buffered enough values
+            // now to check the buffers of each db locations. If they have buffered enough values
 			// just finish them.
-			map<DbLocation, DbActionFilter*> real_works;
+            vector<BufferRef> full;
+            for (int i = 0 ; i < buffers_.Size(); i++)
+            {
+                DbLocation& location = buffers_.LocationAt(i);
+                vector<TableBuffer>& buffers = buffers_.ValueAt(i);
+                for (int k = 0; k < (int)buffers.size(); k++)
+                {
+                    if (buffers[k].values_ != 0 && IsFull(location, buffers[k]))
+                    {
+                        full.push_back(BufferRef(location, k));
+                    }
+                }
+            }
             
-            // prepare the vector before using them
-            vector<DbActionFilter> real_filters(values_now_.size());
-            map<DbLocation, unsigned int>::iterator vn_it = values_now_.begin();
-            for (int i = 0 ; vn_it != values_now_.end(); vn_it++, i++)
+            try
             {
-                if (vn_it->second >= values_per_batch_)
+                success = FlushMany(full, flushes_in_flight_, affected_rows) && success;
+            }
+            catch (COMMON::EXCEPTION::ThrowableException& e)
+            {
+                success = false;
+                KeepError(error, e);
+            }
+            
+            return FinishCall(success, error);
+        }
+
+        bool DbBatchAction::EndAction(map<DbLocation, long long>* affected_rows) throw (COMMON::EXCEPTION::ThrowableException)
+        {
+            // nothing is sent by the timer any more
+            StopTimer();
+            
+            THREAD::MutexLockGuard guard(mutex_);
+            
+            if (affected_rows)
+            {
+                affected_rows->clear();
+            }
+
+            // each step is taken whatever happened to the others, the first exception is thrown at last.
+            // So is the failure of the timer, the rows left are still sent and committed.
+            bool success = true;
+            tr1::shared_ptr<COMMON::EXCEPTION::ThrowableException> error;
+
+			// do all the cached but not done commands
+            try
+            {
+                success = DoAllLeft(affected_rows) && success;
+            }
+            catch (COMMON::EXCEPTION::ThrowableException& e)
+            {
+                success = false;
+                KeepError(error, e);
+            }
+
+            try
+            {
+                success = SendPendingFlushes(1, affected_rows) && success;
+            }
+            catch (COMMON::EXCEPTION::ThrowableException& e)
+            {
+                success = false;
+                KeepError(error, e);
+            }
+
+            // the statements still running are counted before the commit
+            try
+            {
+                success = WaitInFlight(affected_rows) && success;
+            }
+            catch (COMMON::EXCEPTION::ThrowableException& e)
+            {
+                success = false;
+                KeepError(error, e);
+            }
+
+            try
+            {
+                success = DbInsertAction::EndAction() && success;
+            }
+            catch (COMMON::EXCEPTION::ThrowableException& e)
+            {
+                success = false;
+                KeepError(error, e);
+            }
+
+            return FinishCall(success, error);
+        }
+        
+        bool DbBatchAction::Do(
+            map<DbLocation, vector<DbActionFilter*> >& works, map<DbLocation, long long>* affected_rows) throw (COMMON::EXCEPTION::ThrowableException)
+        {
+            THREAD::MutexLockGuard guard(mutex_);
+            
+            if (affected_rows)
+            {
+                affected_rows->clear();
+            }
+            
+            // the values are buffered one by one, the statements formed are sent together. Every value
+            // is buffered whatever happened to the others, the first exception is thrown at last.
+            bool success = true;
+            tr1::shared_ptr<COMMON::EXCEPTION::ThrowableException> error;
+            map<DbLocation, vector<DbActionFilter*> >::iterator it = works.begin();
+            for (; it != works.end(); it++)
+            {
+                const DbLocation& location = it->first;
+                for (size_t i = 0; i < it->second.size(); i++)
                 {
-					// limits have been met, do!
-					
-                    // clear the count
-                    vn_it->second = 0;  
-                
-                    // generate SQL statements
-                    string statement = elems_[vn_it->first]->FormStatement(vn_it->first);
-                    
-                    // erase the original contents
-                    elems_[vn_it->first]->ClearContent();
-                    
-                    if (statement == "")
+                    long long rows = 0;
+                    try
                     {
-						// nothing to be done? skip it
-                        continue;
+                        success = DoOne((BatchFilter*)(it->second[i]), location, &rows) && success;
+                    }
+                    catch (COMMON::EXCEPTION::ThrowableException& e)
+                    {
+                        success = false;
+                        KeepError(error, e);
                     }
                     
-                    real_filters[i].SetContents(statement);
-                    real_works[vn_it->first] = &real_filters[i];
-                }                
+                    if (affected_rows)
+                    {
+                        (*affected_rows)[location] += rows;
+                    }
+                }
+            }
+            
+            return FinishCall(success, error);
+        }
+        
+        bool DbBatchAction::FlushOne(const DbLocation& location, int index, long long* affected_rows)
+        {
+            TableBuffer& buffer = GetBuffers(location)[index];
+            long long values = buffer.values_;
+            buffer.values_ = 0;
+            
+            tr1::shared_ptr<DbActionFilter> flush = FormFlush(location, buffer.elem_);
+            if (!flush)
+            {
+                return true;
+            }
+            
+            bool success = true;
+            if (IsFlushDeferred())
+            {
+                // wait for the others, then run them on all the connections of the DB
+                pending_flushes_[location].push_back(flush);
+                pending_rows_[location] += values;
+                
+                map<DbLocation, long long> rows;
+                success = SendPendingFlushes(flushes_in_flight_, &rows);
+                if (affected_rows)
+                {
+                    *affected_rows += rows[location];
+                }
+                
+                return success;
+            }
+            
+            DbLocation target = location;
+            long long rows = 0;
+            long long since = tuner_ ? NowInUs() : 0;
+            success = DbInsertAction::Do(flush.get(), &target, &rows);
+            GiveBackBuffer(*flush);
+            
+            if (success)
+            {
+                RecordSent(location, values, 1, since);
+            }
+            
+            if (success && affected_rows)
+            {
+                *affected_rows += rows;
+            }
+            
+            return success;
+        }
+        
+        bool DbBatchAction::FlushMany(const vector<BufferRef>& buffers, int minCount, map<DbLocation, long long>* affected_rows)
+        {
+            bool success = true;
+            
+            // a DB may have the statements of several tables, they are run one after another
+            map<DbLocation, vector<DbActionFilter*> > real_works;
+            vector<tr1::shared_ptr<DbActionFilter> > real_filters;
+            map<DbLocation, long long> real_values;
+            for (size_t i = 0; i < buffers.size(); i++)
+            {
+                // clear the count, and generate SQL statements
+                const DbLocation& location = buffers[i].first;
+                TableBuffer& buffer = GetBuffers(location)[buffers[i].second];
+                long long values = buffer.values_;
+                buffer.values_ = 0;
+                tr1::shared_ptr<DbActionFilter> flush = FormFlush(location, buffer.elem_);
+                
+                if (!flush)
+                {
+                    // nothing to be done? skip it
+                    continue;
+                }
+                
+                if (IsFlushDeferred())
+                {
+                    // wait for the others, then run them on all the connections of the DB
+                    pending_flushes_[location].push_back(flush);
+                    pending_rows_[location] += values;
+                    continue;
+                }
+                
+                real_filters.push_back(flush);
+                real_works[location].push_back(flush.get());
+                real_values[location] += values;
             }
-           
-            // work?
+            
+            map<DbLocation, long long> rows;
             if (real_works.size() > 0)
             {
-                success = DbInsertAction::Do(real_works, affected_rows);
+                long long since = tuner_ ? NowInUs() : 0;
+                success = DbInsertAction::Do(real_works, &rows);
+                
+                for (size_t i = 0; i < real_filters.size(); i++)
+                {
+                    GiveBackBuffer(*(real_filters[i]));
+                }
+                
+                // the statements of the DBs run at the same time, each DB is taken as long as all of them
+                map<DbLocation, long long>::iterator values_it = real_values.begin();
+                for (; success && values_it != real_values.end(); values_it++)
+                {
+                    RecordSent(values_it->first, values_it->second, (int)real_works[values_it->first].size(), since);
+                }
+            }
+            else if (IsFlushDeferred())
+            {
+                success = SendPendingFlushes(minCount, &rows);
             }
             
-			// if the newly input commands are incompatible with the existing ones,
-			// we should do the exsiting first, which have been done previously.
-			// And now, we should rebuild the new input commands to make it cached.
-            map<DbLocation, tr1::shared_ptr<StmtGenerator> >::iterator remains_it = remains.begin();
-            for ( ; remains_it != remains.end(); remains_it++)
+            if (success && affected_rows)
             {
-                // cause we have done the exsiting commands, no conflicts should happen
-                MakeupStatement(elems_[remains_it->first], (BatchFilter*)(works[remains_it->first]));
-                values_now_[remains_it->first]++;
+                map<DbLocation, long long>::iterator rows_it = rows.begin();
+                for (; rows_it != rows.end(); rows_it++)
+                {
+                    (*affected_rows)[rows_it->first] += rows_it->second;
+                }
             }
-
+            
+            return success;
+        }
+        
+        bool DbBatchAction::SendPendingFlushes(int minCount, map<DbLocation, long long>* affected_rows)
+        {
+            bool success = true;
+            
+            map<DbLocation, vector<DbActionFilter*> > works;
+            map<DbLocation, vector<tr1::shared_ptr<DbActionFilter> > >::iterator it = pending_flushes_.begin();
+            for (; it != pending_flushes_.end(); it++)
+            {
+                if (it->second.size() != 0 && it->second.size() >= (size_t)minCount)
+                {
+                    vector<DbActionFilter*>& filters = works[it->first];
+                    for (size_t i = 0; i < it->second.size(); i++)
+                    {
+                        filters.push_back(it->second[i].get());
+                    }
+                }
+            }
+            
+            if (works.size() == 0)
+            {
+                return success;
+            }
+            
+            if (pipelined_)
+            {
+                // only one group of statements is in flight, the last one must be finished first
+                success = WaitInFlight(affected_rows);
+                if (success)
+                {
+                    in_flight_since_ = tuner_ ? NowInUs() : 0;
+                    in_flight_ = Submit(works);
+                    
+                    // the filters are kept until the statements are finished
+                    map<DbLocation, vector<DbActionFilter*> >::iterator sent_it = works.begin();
+                    for (; sent_it != works.end(); sent_it++)
+                    {
+                        in_flight_filters_[sent_it->first].swap(pending_flushes_[sent_it->first]);
+                        in_flight_rows_[sent_it->first] = pending_rows_[sent_it->first];
+                        pending_rows_[sent_it->first] = 0;
+                    }
+                }
+                
+                return success;
+            }
+            
+            map<DbLocation, long long> rows;
+            long long since = tuner_ ? NowInUs() : 0;
+            success = DbInsertAction::Do(works, &rows);
+            
+            // the statements have been done, whatever the result is
+            map<DbLocation, vector<DbActionFilter*> >::iterator done_it = works.begin();
+            for (; done_it != works.end(); done_it++)
+            {
+                vector<tr1::shared_ptr<DbActionFilter> >& done = pending_flushes_[done_it->first];
+                for (size_t i = 0; i < done.size(); i++)
+                {
+                    GiveBackBuffer(*(done[i]));
+                }
+                
+                if (success)
+                {
+                    RecordSent(done_it->first, pending_rows_[done_it->first], (int)done.size(), since);
+                }
+                pending_rows_[done_it->first] = 0;
+                done.clear();
+            }
+            
+            if (success && affected_rows)
+            {
+                map<DbLocation, long long>::iterator rows_it = rows.begin();
+                for (; rows_it != rows.end(); rows_it++)
+                {
+                    (*affected_rows)[rows_it->first] += rows_it->second;
+                }
+            }
+            
             return success;
         }
 
-        bool DbBatchAction::EndAction(map<DbLocation, long long>* affected_rows) throw (COMMON::EXCEPTION::ThrowableException)
+        bool DbBatchAction::WaitInFlight(map<DbLocation, long long>* affected_rows)
         {
-			// do all the cached but not done commands
-            map<DbLocation, unsigned int>::iterator it = values_now_.begin();
-            for (; it != values_now_.end(); it++)
+            if (!in_flight_)
             {
-                it->second = values_per_batch_;
+                return true;
+            }
+            
+            // give up the statements even if the waiting throws
+            tr1::shared_ptr<DbCompletion> completion;
+            completion.swap(in_flight_);
+            map<DbLocation, vector<tr1::shared_ptr<DbActionFilter> > > filters;
+            filters.swap(in_flight_filters_);
+            
+            bool success = completion->Wait();
+            
+            map<DbLocation, vector<tr1::shared_ptr<DbActionFilter> > >::iterator done_it = filters.begin();
+            for (; done_it != filters.end(); done_it++)
+            {
+                for (size_t i = 0; i < done_it->second.size(); i++)
+                {
+                    GiveBackBuffer(*(done_it->second[i]));
+                }
+                
+                // taken from the sending, so the time of forming the next statements is included
+                if (success)
+                {
+                    RecordSent(done_it->first, in_flight_rows_[done_it->first], (int)done_it->second.size(), in_flight_since_);
+                }
+                in_flight_rows_[done_it->first] = 0;
             }
+            
+            if (success && affected_rows)
+            {
+                map<DbLocation, long long> rows;
+                GetAffectedRows(completion->GetRslt(), &rows);
+                
+                map<DbLocation, long long>::iterator rows_it = rows.begin();
+                for (; rows_it != rows.end(); rows_it++)
+                {
+                    (*affected_rows)[rows_it->first] += rows_it->second;
+                }
+            }
+            
+            return success;
+        }
 
-            return DoAllLeft(affected_rows) && DbInsertAction::EndAction();
+        tr1::shared_ptr<DbActionFilter> DbBatchAction::FormFlush(const DbLocation& location, const tr1::shared_ptr<StmtGenerator>& elem)
+        {
+            // the statement is formed once and handed over to the filter without copying
+            string statement;
+            TakeBuffer(statement);
+            tr1::shared_ptr<DbActionFilter> flush = elem->FormFilter(location, statement);
+            
+            // erase the original contents
+            elem->ClearContent();
+            
+            return flush;
+        }
+        
+        void DbBatchAction::TakeBuffer(string& buffer)
+        {
+            if (spare_buffers_.size() != 0)
+            {
+                buffer.swap(spare_buffers_.back());
+                spare_buffers_.pop_back();
+            }
+        }
+        
+        void DbBatchAction::GiveBackBuffer(DbActionFilter& filter)
+        {
+            // enough for the statements of all the connections at once, the others are freed
+            if (spare_buffers_.size() >= (size_t)(buffers_.Size() * (flushes_in_flight_ + 1)))
+            {
+                return;
+            }
+            
+            spare_buffers_.push_back(string());
+            filter.SwapContents(spare_buffers_.back());
+            spare_buffers_.back().clear();
         }
 
         bool DbBatchAction::DoAllLeft(map<DbLocation, long long>* affected_rows)
         {
-            bool success = false;
+            // the buffers of all the tables are drained
+            vector<BufferRef> left;
+            for (int i = 0; i < buffers_.Size(); i++)
+            {
+                vector<TableBuffer>& buffers = buffers_.ValueAt(i);
+                for (int k = 0; k < (int)buffers.size(); k++)
+                {
+                    if (buffers[k].values_ != 0)
+                    {
+                        left.push_back(BufferRef(buffers_.LocationAt(i), k));
+                    }
+                }
+            }
 
-            map<DbLocation, DbActionFilter*> works;
-            vector<BatchFilter> filters(elems_.size());
+            return FlushMany(left, flushes_in_flight_, affected_rows);
+        }
+        
+        bool DbBatchAction::FinishCall(bool success, tr1::shared_ptr<COMMON::EXCEPTION::ThrowableException>& error) throw (COMMON::EXCEPTION::ThrowableException)
+        {
+            if (timer_failed_)
+            {
+                timer_failed_ = false;
+                tr1::shared_ptr<COMMON::EXCEPTION::ThrowableException> timer;
+                timer.swap(timer_exception_);
+                
+                // the error of the call comes first, the one of the timer is reported on this thread
+                if (success && !error && timer)
+                {
+                    if (IsExceptionMode())
+                    {
+                        error = timer;
+                    }
+                    else
+                    {
+                        SetException(timer);
+                    }
+                }
+                success = false;
+            }
             
-            map<DbLocation, tr1::shared_ptr<StmtGenerator> >::iterator it = elems_.begin();
-            for ( int i = 0; it != elems_.end(); it++, i++)
+            if (error)
             {
-				// generate an empty statement, adjust the counts and execute now
-                works[it->first] = &(filters[i]);
-                values_now_[it->first] = values_per_batch_;
+                throw *error;
             }
-
-            return Do(works, affected_rows);
-        }        
+            
+            return success;
+        }
+        
+        void DbBatchAction::StartTimer()
+        {
+            if (timer_ || flush_policy_.GetMaxAge() == 0)
+            {
+                return;
+            }
+            
+            timer_stopping_ = false;
+            timer_.reset(new THREAD::Thread(RunTimer, this));
+            timer_->Start();
+        }
+        
+        void DbBatchAction::StopTimer()
+        {
+            if (!timer_)
+            {
+                return;
+            }
+            
+            {
+                THREAD::MutexLockGuard guard(mutex_);
+                timer_stopping_ = true;
+                timer_condition_.Notify();
+            }
+            
+            timer_->Join();
+            timer_.reset();
+        }
+        
+        void* DbBatchAction::RunTimer(void* arg)
+        {
+            DbBatchAction* action = (DbBatchAction*)arg;
+            
+            // a value waits for a quarter of the age limit at most beyond it
+            long tick = action->flush_policy_.GetMaxAge() / 4;
+            if (tick < 1)
+            {
+                tick = 1;
+            }
+            
+            // the errors of the timer are kept in timer_exception_, never in the error box of the tasks, which
+            // belongs to the thread of the user
+            DbTasks::SetThreadThrows(true);
+            
+            THREAD::MutexLockGuard guard(action->mutex_);
+            while (!action->timer_stopping_)
+            {
+                action->timer_condition_.TimedWait(action->mutex_, tick);
+                if (!action->timer_stopping_)
+                {
+                    action->FlushExpired();
+                }
+            }
+            
+            return 0;
+        }
+        
+        void DbBatchAction::FlushExpired()
+        {
+            long long now = NowInMs();
+            vector<BufferRef> expired;
+            for (int i = 0; i < buffers_.Size(); i++)
+            {
+                vector<TableBuffer>& buffers = buffers_.ValueAt(i);
+                for (int k = 0; k < (int)buffers.size(); k++)
+                {
+                    if (buffers[k].values_ != 0 && flush_policy_.IsExpired((long)(now - buffers[k].buffered_since_)))
+                    {
+                        expired.push_back(BufferRef(buffers_.LocationAt(i), k));
+                    }
+                }
+            }
+            
+            if (expired.size() == 0)
+            {
+                return;
+            }
+            
+            // nobody waits for the timer, the failure is kept for the next call to report on its own thread
+            try
+            {
+                if (!FlushMany(expired, 1, 0))
+                {
+                    timer_failed_ = true;
+                }
+            }
+            catch (COMMON::EXCEPTION::ThrowableException& e)
+            {
+                timer_failed_ = true;
+                timer_exception_.reset(new COMMON::EXCEPTION::ThrowableException(e));
+            }
+            catch (...)
+            {
+                timer_failed_ = true;
+            }
+        }
     }
 }
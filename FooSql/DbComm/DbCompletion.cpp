@@ -0,0 +1,121 @@
+#include "dbcomm/DbCompletion.h"
+#include "dbcomm/IDbTasks.h"
+
+namespace COMMON
+{
+    namespace DBCOMM
+    {
+        DbCompletion::DbCompletion(tr1::weak_ptr<IDbTasks> task, int commandNum)
+            : latch_(commandNum), task_(task), completed_(false), success_(true), reported_(false)
+        {
+        }
+        
+        DbCompletion::~DbCompletion()
+        {
+            // the engine keeps the handle until IsDone(), which is only true after the last CountDown() has
+            // left the latch, so no working thread uses the commands or the latch now
+            for (size_t i = 0; i < commands_.size(); i++)
+            {
+                delete commands_[i];
+            }
+        }
+        
+        bool DbCompletion::Wait() throw (EXCEPTION::ThrowableException)
+        {
+            latch_.Wait();
+            
+            Complete();
+            
+            return ReportError();
+        }
+        
+        bool DbCompletion::Poll() throw (EXCEPTION::ThrowableException)
+        {
+            if (!latch_.IsDone())
+            {
+                return false;
+            }
+            
+            Complete();
+            
+            ReportError();
+            return true;
+        }
+        
+        void DbCompletion::Then(Callback callback) throw (EXCEPTION::ThrowableException)
+        {
+            if (completed_)
+            {
+                callback(*this);
+            }
+            else
+            {
+                callbacks_.push_back(callback);
+                Poll();
+            }
+        }
+        
+        void DbCompletion::Complete() throw (EXCEPTION::ThrowableException)
+        {
+            if (completed_)
+            {
+                return;
+            }
+            completed_ = true;
+            
+            vector<tr1::shared_ptr<EXCEPTION::IException> > real_exception;
+            for (size_t i = 0; i < commands_.size(); i++)
+            {
+                if (commands_[i]->rslt_.exception)
+                {
+                    real_exception.push_back(commands_[i]->rslt_.exception);
+                }
+                
+                if (owners_[i] != 0)
+                {
+                    rslt_[owners_[i]].push_back(commands_[i]->rslt_.return_items_);
+                }
+            }
+            
+            if (real_exception.size() != 0)
+            {
+                success_ = false;
+                error_.reset(new EXCEPTION::ThrowableException(real_exception));
+            }
+            
+            for (size_t i = 0; i < callbacks_.size(); i++)
+            {
+                callbacks_[i](*this);
+            }
+            callbacks_.clear();
+        }
+        
+        bool DbCompletion::ReportError() throw (EXCEPTION::ThrowableException)
+        {
+            if (success_)
+            {
+                return true;
+            }
+            
+            // the same error is not reported twice
+            if (reported_)
+            {
+                return false;
+            }
+            reported_ = true;
+            
+            tr1::shared_ptr<IDbTasks> tmp = task_.lock();
+            if (tmp == 0 || tmp->IsExceptionMode() == true)
+            {
+                EXCEPTION::ThrowableException e(*error_);
+                throw e;
+            }
+            else
+            {
+                tmp->SetExceptions(error_);
+            }
+            
+            return false;
+        }
+    }
+}
@@ -4,6 +4,11 @@
 #include "dbcomm/DbEngine.h"
 #include "dbcomm/DbTasks.h"
 #include "dbcomm/DbActionFilter.h"
+#include "dbcomm/DbCompletion.h"
+
+#include "exception/CodingException.h"
+
+#include "thread/MutexLockGuard.h"
 
 namespace COMMON
 {
@@ -37,38 +42,64 @@ namespace COMMON
         ActionType_C DbEngine::ActionTypeDef::NOTHING                           =15;
         ActionType_C DbEngine::ActionTypeDef::END_THREAD                        =16;
         
+        /* prepared statements */
+        ActionType_C DbEngine::ActionTypeDef::PREPARED_EXECUTE                  =17;
+        ActionType_C DbEngine::ActionTypeDef::PREPARED_QUERY                    =18;
+        ActionType_C DbEngine::ActionTypeDef::FETCH_BLOCK                       =19;
+        ActionType_C DbEngine::ActionTypeDef::STREAM_QUERY                      =20;
+        
         //////////////////// DbEngine ///////////////////////
+        // capacity of the command ring of each location
+        static const int INPUT_QUEUE_SIZE = 256;
+        
         static void* db_engine_thread(void* param)
         {
             ThreadStartParam* start_param = (ThreadStartParam*)param;
             
             DbEngine* engine = (DbEngine*)start_param->db_engine_;
             
-            engine->RunThread(start_param->location_);
+            engine->RunThread(start_param->location_, start_param->connection_);
         
             return 0;
         }
         
-        DbEngine::DbEngine(vector<DbLocation>& locations, tr1::shared_ptr<IDbTasks> task)
-            : mutex_(), result_reached_cond_()
+        DbEngine::DbEngine(vector<DbLocation>& locations, tr1::shared_ptr<IDbTasks> task, int connectionsPerLocation)
+            : works_done_latch_(0)
         {
             task_ = task;
             
-            thread_start_params_ = new ThreadStartParam [locations.size()];
+            connections_per_location_ = (connectionsPerLocation < 1) ? 1 : connectionsPerLocation;
+            
+            thread_start_params_ = new ThreadStartParam [locations.size() * connections_per_location_];
             
             for (int i = 0; i < locations.size(); i++)
             {
-                // prepare input commands
-                InputCommand* tmp = new InputCommand();
-				tmp->location_ = locations[i];
-                works_[ locations[i] ] = tmp;
+                ConnectionGroup& group = connection_groups_[locations[i]];
+                group.affected_rows_mutex_.reset(new Mutex());
                 
-                // prepare thread input parameters
-                thread_start_params_[i].location_ = locations[i];
-                thread_start_params_[i].db_engine_ = this;
+                for (int c = 0; c < connections_per_location_; c++)
+                {
+                    // prepare input commands
+                    InputCommand* tmp = new InputCommand();
+                    tmp->location_ = locations[i];
+                    tmp->affected_rows_mutex_ = group.affected_rows_mutex_.get();
+                    
+                    // prepare command ring for each connection of the db location.
+                    group.queues_.push_back(
+                        tr1::shared_ptr<SpscQueue<InputCommand*> >(new SpscQueue<InputCommand*>(INPUT_QUEUE_SIZE)));
+                    tmp->queue_ = group.queues_[c].get();
+                    
+                    group.works_.push_back(tmp);
+                    
+                    // prepare thread input parameters
+                    ThreadStartParam& param = thread_start_params_[i * connections_per_location_ + c];
+                    param.location_ = locations[i];
+                    param.db_engine_ = this;
+                    param.connection_ = c;
+                }
                 
-                // prepare blocking queue for each different db locations.
-                input_blocking_queues_[locations[i]];
+                // the first connection serves the single commands
+                works_[ locations[i] ] = group.works_[0];
             }
         }
         
@@ -81,28 +112,39 @@ namespace COMMON
             
             delete [] thread_start_params_;
             
-            map<DbLocation, InputCommand* >::iterator it = works_.begin();
-            while (it != works_.end())
+            for (int i = 0; i < connection_groups_.Size(); i++)
             {
-                delete it->second;
-                it++;
+                ConnectionGroup& group = connection_groups_.ValueAt(i);
+                for (size_t c = 0; c < group.works_.size(); c++)
+                {
+                    delete group.works_[c];
+                }
+            }
+            
+            for (size_t i = 0; i < spare_works_.size(); i++)
+            {
+                delete spare_works_[i];
             }
         }
         
 		// a customer mould in the "producer and customer" design mode.
 		// There is a unique db handle in each thread. That is to say,
 		// the thread should only do its own work related to a specific db location.
-        void DbEngine::RunThread(DbLocation& location)
+        void DbEngine::RunThread(DbLocation& location, int connection)
         {
             InitThread();
         
 			// prevent releasing the handle before the thread's uninitilization.
             {
+                // the ring and the handle never change after InitEngine(), look them up only once
+                SpscQueue<InputCommand*>* input_queue = connection_groups_[location].queues_[connection].get();
+                tr1::shared_ptr<RealHandle> handle = GetRealHandle(location, connection);
+                
                 while(1)
                 {
-					// catch input commands from its own blocking queue.
+					// catch input commands from its own ring.
                     InputCommand* input_param;
-                    input_blocking_queues_[location].Pop(input_param);
+                    input_queue->Pop(input_param);
             
 					// get end command? end it now
                     if (input_param->action_ == ActionTypeDef::END_THREAD)
@@ -110,14 +152,10 @@ namespace COMMON
                         break;
                     }
             
-					// real work here
-                    ReturnParam tmp = RealDo(GetRealHandle(location).get(), input_param);
+					// real work here, the result goes to the command's own slot
+                    input_param->rslt_ = RealDo(handle.get(), input_param);
                     
-                    {
-                        COMMON::THREAD::MutexLockGuard lock(mutex_);
-                        thread_return_param_.push_back(tmp);
-                        result_reached_cond_.Notify();
-                    }
+                    input_param->latch_->CountDown();
                 }
             }
             
@@ -132,10 +170,14 @@ namespace COMMON
             CharacterSetType cs;
             
             tr1::shared_ptr<EXCEPTION::IException> exception;
-            string statement;
+            
+            // the statement is borrowed from the filter, which lives until the command is finished
+            const char* statement = "";
+            size_t statement_length = 0;
             if (inputParam->filter_)
             {
-                statement = inputParam->filter_->GetContents();    
+                statement = inputParam->filter_->GetData();
+                statement_length = inputParam->filter_->GetLength();
             }
             
             switch(inputParam->action_)
@@ -143,6 +185,16 @@ namespace COMMON
             /* Connect and Disconnect */
             case ActionTypeDef::CONNECT:
                 rslt = (void*)Connect((void*)realHandle, &(inputParam->location_), exception);
+                
+                // only the working thread of the first connection writes it, the leader reads it after the connect is done
+                if (rslt != 0)
+                {
+                    ConnectionGroup* group = connection_groups_.Find(inputParam->location_);
+                    if (group != 0 && group->handles_[0].get() == realHandle)
+                    {
+                        group->escaper_ = CreateStringEscaper((void*)realHandle, &(inputParam->location_));
+                    }
+                }
                 break;
             
             case ActionTypeDef::DISCONNECT:
@@ -155,9 +207,9 @@ namespace COMMON
                 rslt = (void*)Query(
                         (void*)realHandle, 
                         &(inputParam->location_), 
-                        statement.data(), 
-                        statement.length(), 
-                        ((map<DbLocation, map<string, int>* >*)(inputParam->filter_->GetAdditionalInfo()))->operator[](inputParam->location_), 
+                        statement, 
+                        statement_length, 
+                        *(((DbLocationMap<map<string, int>* >*)(inputParam->filter_->GetAdditionalInfo()))->Find(inputParam->location_)), 
                         exception);
                 break;
             
@@ -169,6 +221,21 @@ namespace COMMON
                 rslt = (void*)GetColumnsActureLength((void*)realHandle, &(inputParam->location_), exception);
                 break;
             
+            case ActionTypeDef::FETCH_BLOCK:
+                rslt = (void*)(long)FetchBlock((void*)realHandle, &(inputParam->location_), (RowBlock*)(inputParam->filter_->GetAdditionalInfo()), exception);
+                break;
+            
+            case ActionTypeDef::STREAM_QUERY:
+                {
+                    RowStream* stream = (RowStream*)(inputParam->filter_->GetAdditionalInfo());
+                    rslt = (void*)StreamQuery((void*)realHandle, &(inputParam->location_), statement, statement_length, stream, exception);
+                    
+                    // the error goes to the consumer of the stream, who is not waiting for the command
+                    stream->Finish(exception);
+                    exception.reset();
+                }
+                break;
+            
             case ActionTypeDef::CLOSE_OPEN_RSLT:
                 rslt = (void*)CloseOpenRslt((void*)realHandle, &(inputParam->location_), exception);
                 break;
@@ -179,51 +246,23 @@ namespace COMMON
             
             /* execute related work */
             case ActionTypeDef::DELETE:
-                rslt = (void*)Delete((void*)realHandle, &(inputParam->location_), statement.data(), statement.length(), exception);
-                if (inputParam->commit_judger_ != 0)
-                {
-                    *(inputParam->already_affected_rows_) = ((long long)rslt) + *(inputParam->already_affected_rows_);
-                    if( inputParam->commit_judger_->CanDoCommit(*(inputParam->already_affected_rows_) ))
-                    {
-                        (void*)Commit((void*)realHandle, &(inputParam->location_), exception);
-                    }
-                }
+                rslt = (void*)Delete((void*)realHandle, &(inputParam->location_), statement, statement_length, exception);
+                RecordAffectedRows(realHandle, inputParam, (long long)rslt, exception);
                 break;
             
             case ActionTypeDef::UPDATE:
-                rslt = (void*)Update((void*)realHandle, &(inputParam->location_), statement.data(), statement.length(), exception);
-                if (inputParam->commit_judger_ != 0)
-                {
-                    *(inputParam->already_affected_rows_) = ((long long)rslt) + *(inputParam->already_affected_rows_);
-                    if( inputParam->commit_judger_->CanDoCommit(*(inputParam->already_affected_rows_)) )
-                    {
-                        (void*)Commit((void*)realHandle, &(inputParam->location_), exception);
-                    }
-                }
+                rslt = (void*)Update((void*)realHandle, &(inputParam->location_), statement, statement_length, exception);
+                RecordAffectedRows(realHandle, inputParam, (long long)rslt, exception);
                 break;
             
             case ActionTypeDef::TRUNC:
-                rslt = (void*)Truncate((void*)realHandle, &(inputParam->location_), statement.data(), statement.length(), exception);
-                if (inputParam->commit_judger_ != 0)
-                {
-                    *(inputParam->already_affected_rows_) = ((long long)rslt) + *(inputParam->already_affected_rows_);
-                    if( inputParam->commit_judger_->CanDoCommit(*(inputParam->already_affected_rows_) ))
-                    {
-                        (void*)Commit((void*)realHandle, &(inputParam->location_), exception);
-                    }
-                }
+                rslt = (void*)Truncate((void*)realHandle, &(inputParam->location_), statement, statement_length, exception);
+                RecordAffectedRows(realHandle, inputParam, (long long)rslt, exception);
                 break;
             
             case ActionTypeDef::INSERT:
-                rslt = (void*)Insert((void*)realHandle, &(inputParam->location_), statement.data(), statement.length(), exception);
-                if (inputParam->commit_judger_ != 0)
-                {
-                    *(inputParam->already_affected_rows_) = ((long long)rslt) + *(inputParam->already_affected_rows_);
-                    if( inputParam->commit_judger_->CanDoCommit(*(inputParam->already_affected_rows_) ))
-                    {
-                        (void*)Commit((void*)realHandle, &(inputParam->location_), exception);
-                    }
-                }
+                rslt = (void*)Insert((void*)realHandle, &(inputParam->location_), statement, statement_length, exception);
+                RecordAffectedRows(realHandle, inputParam, (long long)rslt, exception);
                 break;
             
             case ActionTypeDef::EXECUTE_ON_EXCEPTION:
@@ -232,15 +271,8 @@ namespace COMMON
                 
 			/* common execute */
             case ActionTypeDef::EXECUTE:    
-                rslt = (void*)Execute((void*)realHandle, &(inputParam->location_), statement.data(), statement.length(), exception);
-                if (inputParam->commit_judger_ != 0)
-                {
-                    *(inputParam->already_affected_rows_) = ((long long)rslt) + *(inputParam->already_affected_rows_);
-                    if( inputParam->commit_judger_->CanDoCommit(*(inputParam->already_affected_rows_) ))
-                    {
-                        (void*)Commit((void*)realHandle, &(inputParam->location_), exception);
-                    }
-                }
+                rslt = (void*)(size_t)Execute((void*)realHandle, &(inputParam->location_), statement, statement_length, exception);
+                RecordAffectedRows(realHandle, inputParam, (long long)rslt, exception);
                 break;
                 
             /* other db operations */
@@ -249,7 +281,22 @@ namespace COMMON
                 break;
             
             case ActionTypeDef::ENCODE_TO_ESCAPED_STRING:
-                rslt = (void*)EscapeString((void*)realHandle, &(inputParam->location_), statement.data(), statement.length(), exception);
+                rslt = (void*)EscapeString((void*)realHandle, &(inputParam->location_), statement, statement_length, exception);
+                break;
+                
+            /* prepared statements, the filter must be a PreparedFilter */
+            case ActionTypeDef::PREPARED_EXECUTE:
+                rslt = (void*)PreparedExecute((void*)realHandle, &(inputParam->location_), (PreparedFilter*)(inputParam->filter_), exception);
+                RecordAffectedRows(realHandle, inputParam, (long long)rslt, exception);
+                break;
+            
+            case ActionTypeDef::PREPARED_QUERY:
+                rslt = (void*)PreparedQuery(
+                        (void*)realHandle, 
+                        &(inputParam->location_), 
+                        (PreparedFilter*)(inputParam->filter_), 
+                        *(((DbLocationMap<map<string, int>* >*)(inputParam->filter_->GetAdditionalInfo()))->Find(inputParam->location_)), 
+                        exception);
                 break;
                 
             /* empty command */
@@ -269,6 +316,136 @@ namespace COMMON
             return toReturn;
         }
         
+        void DbEngine::RecordAffectedRows(
+            RealHandle* realHandle, 
+            InputCommand* inputParam, 
+            long long rows, 
+            tr1::shared_ptr<IException>& exception)
+        {
+            if (inputParam->commit_judger_ != 0)
+            {
+                bool do_commit = false;
+                
+                // the connections of the same location share the counter
+                {
+                    MutexLockGuard lock(*(inputParam->affected_rows_mutex_));
+                    *(inputParam->already_affected_rows_) = rows + *(inputParam->already_affected_rows_);
+                    do_commit = inputParam->commit_judger_->CanDoCommit(*(inputParam->already_affected_rows_));
+                }
+                
+                // only the transaction of the current connection is committed, the
+                // others will be committed by their own statements or by the final COMMIT
+                if (do_commit)
+                {
+                    Commit((void*)realHandle, &(inputParam->location_), exception);
+                }
+            }
+        }
+        
+        long long DbEngine::PreparedExecute(void* handle, DbLocation* location, const PreparedFilter* filter, tr1::shared_ptr<IException>& exception) throw ()
+        {
+            exception.reset(new EXCEPTION::UnknownActionException("prepared statements are not supported by the DBMS"));
+            return 0;
+        }
+        
+        bool DbEngine::PreparedQuery(void* handle, DbLocation* location, const PreparedFilter* filter, map<string, int>* colIndexMap, tr1::shared_ptr<IException>& exception) throw ()
+        {
+            exception.reset(new EXCEPTION::UnknownActionException("prepared statements are not supported by the DBMS"));
+            return false;
+        }
+        
+        int DbEngine::FetchBlock(void* handle, DbLocation* location, RowBlock* block, tr1::shared_ptr<IException>& exception) throw ()
+        {
+            int columns = GetColumnCount(handle, location, exception);
+            block->Reset(columns);
+            
+            // no result set is open
+            if (columns == 0)
+            {
+                return 0;
+            }
+            
+            while (!exception && block->GetRowCount() < block->GetCapacity())
+            {
+                char** row = Fetch(handle, location, exception);
+                if (row == 0 || exception)
+                {
+                    break;
+                }
+                
+                unsigned long* lengths = GetColumnsActureLength(handle, location, exception);
+                if (exception)
+                {
+                    break;
+                }
+                
+                block->AppendRow(row, lengths);
+            }
+            
+            return block->GetRowCount();
+        }
+        
+        int DbEngine::GetColumnCount(void* handle, DbLocation* location, tr1::shared_ptr<IException>& exception) throw ()
+        {
+            exception.reset(new EXCEPTION::UnknownActionException("the number of columns is not supported by the DBMS"));
+            return 0;
+        }
+        
+        bool DbEngine::StreamQuery(void* handle, DbLocation* location, const char* statement, size_t length, RowStream* stream, tr1::shared_ptr<IException>& exception) throw ()
+        {
+            if (!Query(handle, location, statement, length, stream->GetColumnIndex(*location), exception))
+            {
+                return false;
+            }
+            
+            int columns = GetColumnCount(handle, location, exception);
+            
+            RowBlock* block = 0;
+            while (!exception)
+            {
+                if (block == 0)
+                {
+                    // 0 if the consumer does not want any more rows
+                    block = stream->GetFreeBlock(*location);
+                    if (block == 0)
+                    {
+                        break;
+                    }
+                    block->Reset(columns);
+                }
+                
+                char** row = Fetch(handle, location, exception);
+                if (row == 0 || exception)
+                {
+                    break;
+                }
+                
+                unsigned long* lengths = GetColumnsActureLength(handle, location, exception);
+                if (exception)
+                {
+                    break;
+                }
+                
+                block->AppendRow(row, lengths);
+                if (stream->IsBlockFull(block))
+                {
+                    stream->PushBlock(block);
+                    block = 0;
+                }
+            }
+            
+            if (block != 0)
+            {
+                stream->PushBlock(block);
+            }
+            
+            // the rows left are dropped by the DBMS
+            tr1::shared_ptr<IException> close_exception;
+            CloseOpenRslt(handle, location, close_exception);
+            
+            return !exception;
+        }
+        
         void DbEngine::CreateWorks(
             ActionType_C actionType, 
             map<DbLocation, DbActionFilter*>& locFilter,
@@ -306,25 +483,24 @@ namespace COMMON
             map<DbLocation, AffectedRowRecorder>* alreadyAffectedRows,
             vector<InputCommand* >& rslt)
         {
-            map<DbLocation, InputCommand* >::iterator it = works_.begin();
-            while(it != works_.end())
+            for (int i = 0; i < works_.Size(); i++)
             {
-                it->second->action_ = actionType;
+                InputCommand* input = works_.ValueAt(i);
+                
+                input->action_ = actionType;
                 if (alreadyAffectedRows != 0)
                 {
-                    it->second->already_affected_rows_ = &((*alreadyAffectedRows)[it->first].already_affected_rows_);
-                    it->second->commit_judger_ = (*alreadyAffectedRows)[it->first].commit_judger_.get();
+                    input->already_affected_rows_ = &((*alreadyAffectedRows)[input->location_].already_affected_rows_);
+                    input->commit_judger_ = (*alreadyAffectedRows)[input->location_].commit_judger_.get();
                 }
                 else
                 {
-                    it->second->commit_judger_ = 0;
+                    input->commit_judger_ = 0;
                 }
         
-                it->second->filter_ = filter;
+                input->filter_ = filter;
                 
-                rslt.push_back(it->second);
-                
-                it++;
+                rslt.push_back(input);
             }
         }
         
@@ -352,16 +528,19 @@ namespace COMMON
         
         bool DbEngine::InitEngine()
         {
-            // prepare the handle
-            map<DbLocation, InputCommand* >::iterator it = works_.begin();
-            while(it != works_.end())
+            // prepare the handles, one for each connection
+            for (int i = 0; i < connection_groups_.Size(); i++)
             {
-                GetRealHandle(it->second->location_);
-                it++;
+                ConnectionGroup& group = connection_groups_.ValueAt(i);
+                DbLocation& location = group.works_[0]->location_;
+                while (group.handles_.size() < (size_t)connections_per_location_)
+                {
+                    group.handles_.push_back(CreateRealHandle(location));
+                }
             }
             
-			// start a new start for each db location
-            int thread_num = works_.size();
+			// start a new start for each connection of each db location
+            int thread_num = works_.Size() * connections_per_location_;
         
             for ( int i = 0; i < thread_num; i++)
             {
@@ -381,24 +560,21 @@ namespace COMMON
         // uninitialize the engine, to stop the thread pool
         bool DbEngine::UninitEngine()
         {
-            int thread_num = threads_.size();
+            WaitSubmitted();
+            
+            int thread_num = (int)threads_.size();
         
             InputCommand* command = new InputCommand();
             command->action_ = ActionTypeDef::END_THREAD;
         
-            // stop threads by sending END_THREAD signals
-            for (int i = 0; i < thread_num; i++)
+            // stop threads by sending END_THREAD signals, one for each thread.
+            for (int i = 0; i < connection_groups_.Size(); i++)
             {
-                tr1::shared_ptr<InputCommand> input(new InputCommand(ActionTypeDef::END_THREAD));
-                
-                // send end command to each thread.
-                map<DbLocation, BlockingQueue<InputCommand*> >::iterator it = input_blocking_queues_.begin();
-                while (it != input_blocking_queues_.end())
+                ConnectionGroup& group = connection_groups_.ValueAt(i);
+                for (size_t c = 0; c < group.queues_.size(); c++)
                 {
-                    (it->second).Push(command);
-					it++;
+                    group.queues_[c]->Push(command);
                 }
-
             }
         
             // wait all to exit
@@ -419,14 +595,64 @@ namespace COMMON
         {
             vector<const DbLocation*> rslt;
         
-            map<DbLocation, InputCommand* >::iterator it = works_.begin();
-            for ( ; it != works_.end(); it++)
+            for (int i = 0; i < works_.Size(); i++)
             {
-                rslt.push_back(&(it->first));
+                rslt.push_back(&(works_.LocationAt(i)));
             }
         
             return rslt;
         }
+        
+        tr1::shared_ptr<DbEngine::RealHandle> DbEngine::GetRealHandle(DbLocation& location, int connection)
+        {
+            ConnectionGroup* group = connection_groups_.Find(location);
+            if (group == 0 || connection < 0 || (size_t)connection >= group->handles_.size())
+            {
+                return tr1::shared_ptr<RealHandle>();
+            }
+            
+            return group->handles_[connection];
+        }
+        
+        StringEscaper DbEngine::GetStringEscaper(const DbLocation& location)
+        {
+            ConnectionGroup* group = connection_groups_.Find(location);
+            return (group == 0) ? StringEscaper() : group->escaper_;
+        }
+        
+        StringEscaper DbEngine::CreateStringEscaper(void* handle, DbLocation* location) throw ()
+        {
+            return StringEscaper();
+        }
+        
+        bool DbEngine::IsBroadcastAction(ActionType_C actionType)
+        {
+            return actionType == ActionTypeDef::CONNECT 
+                || actionType == ActionTypeDef::DISCONNECT 
+                || actionType == ActionTypeDef::COMMIT;
+        }
+        
+        DbEngine::ReturnParam DbEngine::SyncRealDo(InputCommand* work)
+        {
+            ConnectionGroup& group = connection_groups_[work->location_];
+            
+            ReturnParam toReturn = RealDo(group.handles_[0].get(), work);
+            
+            // the other connections must also connect, disconnect or commit
+            if (IsBroadcastAction(work->action_))
+            {
+                for (size_t c = 1; c < group.handles_.size(); c++)
+                {
+                    ReturnParam other = RealDo(group.handles_[c].get(), work);
+                    if (other.exception && !toReturn.exception)
+                    {
+                        toReturn.exception = other.exception;
+                    }
+                }
+            }
+            
+            return toReturn;
+        }
       
         map<DbLocation*, void*> DbEngine::SyncDo(
                 ActionType_C actionType, 
@@ -434,6 +660,9 @@ namespace COMMON
                 bool & success,
                 map<DbLocation, AffectedRowRecorder>* alreadyAffectedRows) throw (ThrowableException)
         {
+            // the handles are used by the current thread, the working threads must be idle
+            WaitSubmitted();
+            
             success = true;
             map<DbLocation*, void*> rslt;
             
@@ -443,7 +672,7 @@ namespace COMMON
             // do in the current thread
             for (int i = 0; i < work_list.size(); i++)
             {
-                ReturnParam toReturn = RealDo(GetRealHandle(work_list[i]->location_).get(), work_list[i]);
+                ReturnParam toReturn = SyncRealDo(work_list[i]);
                 
                 if (toReturn.exception)
                 {
@@ -466,6 +695,8 @@ namespace COMMON
             bool & success, 
             map<DbLocation, AffectedRowRecorder>* alreadyAffectedRows) throw (ThrowableException)
         {
+            WaitSubmitted();
+            
             success = true;
             map<DbLocation*, void*> rslt;
             
@@ -474,7 +705,7 @@ namespace COMMON
             
             for (int i = 0; i < work_list.size(); i++)
             {
-                ReturnParam toReturn = RealDo(GetRealHandle(work_list[i]->location_).get(), work_list[i]);
+                ReturnParam toReturn = SyncRealDo(work_list[i]);
                 if (toReturn.exception)
                 {
                     EXCEPTION::ThrowableException e(toReturn.exception);
@@ -496,13 +727,15 @@ namespace COMMON
             bool & success,
             map<DbLocation, AffectedRowRecorder>* alreadyAffectedRows) throw (ThrowableException)
         {
+            WaitSubmitted();
+            
             success = true;
             void* rslt = 0;
 
             InputCommand* work;
             CreateWorks(actionType, location, filter, alreadyAffectedRows, work);
             
-            ReturnParam toReturn = RealDo(GetRealHandle(*(const_cast<DbLocation*>(location))).get(), work);
+            ReturnParam toReturn = SyncRealDo(work);
             if (toReturn.exception)
             {
                 EXCEPTION::ThrowableException e(toReturn.exception);
@@ -556,54 +789,277 @@ namespace COMMON
             vector<InputCommand* >& work_list, 
             bool &success)
         {
+            // some commands have to be done by every connection of the location
+            vector<InputCommand* > push_list;
+            AddBroadcastWorks(work_list, push_list);
+            
 			// give commands and wait for result
-            PushWorkAndWait(work_list);
+            PushWorkAndWait(push_list);
         
             // get results
-            map<DbLocation*, void*> rslt = GetRslt();
+            map<DbLocation*, void*> rslt = GetRslt(work_list);
         
             // check whether there are exception, if positive, handle them
-            success = CheckHasException();
+            success = CheckHasException(push_list);
         
             // clear result set
-            ClearRslts();
+            ClearRslts(push_list);
         
             return rslt;
         }
         
+        void DbEngine::AddBroadcastWorks( vector<InputCommand*>& workList, vector<InputCommand*>& pushList )
+        {
+            pushList = workList;
+            
+            if (connections_per_location_ == 1)
+            {
+                return;
+            }
+            
+            for (size_t i = 0; i < workList.size(); i++)
+            {
+                if (IsBroadcastAction(workList[i]->action_))
+                {
+                    ConnectionGroup& group = connection_groups_[workList[i]->location_];
+                    for (size_t c = 1; c < group.works_.size(); c++)
+                    {
+                        InputCommand* copy = group.works_[c];
+                        copy->action_ = workList[i]->action_;
+                        copy->filter_ = workList[i]->filter_;
+                        copy->commit_judger_ = 0;
+                        
+                        pushList.push_back(copy);
+                    }
+                }
+            }
+        }
+        
+        map<DbLocation*, vector<void*> > DbEngine::Do(
+            ActionType_C actionType, 
+            map<DbLocation, vector<DbActionFilter*> >& locFilters, 
+            bool & success,
+            map<DbLocation, AffectedRowRecorder>* alreadyAffectedRows) throw (EXCEPTION::ThrowableException)
+        {
+            success = true;
+            
+            map<DbLocation*, vector<void*> > rslt;
+            
+            // the k-th command of a location is done by the (k % N)-th connection
+            vector<InputCommand* > work_list;
+            vector<DbLocation*> work_owner;
+            size_t spare_used = 0;
+            
+            map<DbLocation, vector<DbActionFilter*> >::iterator it = locFilters.begin();
+            for ( ; it != locFilters.end(); it++)
+            {
+                ConnectionGroup* group_found = connection_groups_.Find(it->first);
+                if (group_found == 0)
+                {
+                    continue;
+                }
+                
+                ConnectionGroup& group = *group_found;
+                DbLocation* owner = &(group.works_[0]->location_);
+                rslt[owner];
+                
+                for (size_t k = 0; k < it->second.size(); k++)
+                {
+                    InputCommand* input = 0;
+                    if (k < group.works_.size())
+                    {
+                        input = group.works_[k];
+                    }
+                    else
+                    {
+                        if (spare_used == spare_works_.size())
+                        {
+                            spare_works_.push_back(new InputCommand());
+                        }
+                        input = spare_works_[spare_used++];
+                        input->location_ = it->first;
+                        input->affected_rows_mutex_ = group.affected_rows_mutex_.get();
+                    }
+                    
+                    input->queue_ = group.queues_[k % group.queues_.size()].get();
+                    input->action_ = actionType;
+                    input->filter_ = it->second[k];
+                    if (alreadyAffectedRows != 0)
+                    {
+                        input->already_affected_rows_ = &((*alreadyAffectedRows)[it->first].already_affected_rows_);
+                        input->commit_judger_ = (*alreadyAffectedRows)[it->first].commit_judger_.get();
+                    }
+                    else
+                    {
+                        input->commit_judger_ = 0;
+                    }
+                    
+                    work_list.push_back(input);
+                    work_owner.push_back(owner);
+                }
+            }
+            
+            PushWorkAndWait(work_list);
+            
+            for (size_t i = 0; i < work_list.size(); i++)
+            {
+                rslt[work_owner[i]].push_back(work_list[i]->rslt_.return_items_);
+            }
+            
+            success = CheckHasException(work_list);
+            
+            ClearRslts(work_list);
+            
+            return rslt;
+        }
+        
+        tr1::shared_ptr<DbCompletion> DbEngine::Submit(
+            ActionType_C actionType, 
+            map<DbLocation, vector<DbActionFilter*> >& locFilters, 
+            map<DbLocation, AffectedRowRecorder>* alreadyAffectedRows)
+        {
+            PruneSubmitted();
+            
+            // the commands belong to the handle, so that the engine is free for other works
+            vector<InputCommand*> work_list;
+            vector<DbLocation*> work_owner;
+            
+            map<DbLocation, vector<DbActionFilter*> >::iterator it = locFilters.begin();
+            for ( ; it != locFilters.end(); it++)
+            {
+                ConnectionGroup* group_found = connection_groups_.Find(it->first);
+                if (group_found == 0)
+                {
+                    continue;
+                }
+                
+                ConnectionGroup& group = *group_found;
+                DbLocation* owner = &(group.works_[0]->location_);
+                
+                for (size_t k = 0; k < it->second.size(); k++)
+                {
+                    // the k-th command of a location is done by the (k % N)-th connection
+                    for (size_t c = 0; c < group.queues_.size(); c++)
+                    {
+                        if (c != k % group.queues_.size() && !IsBroadcastAction(actionType))
+                        {
+                            continue;
+                        }
+                        
+                        InputCommand* input = new InputCommand();
+                        input->location_ = it->first;
+                        input->affected_rows_mutex_ = group.affected_rows_mutex_.get();
+                        input->queue_ = group.queues_[c].get();
+                        input->action_ = actionType;
+                        input->filter_ = it->second[k];
+                        
+                        // the copies of a broadcast command neither commit nor give results
+                        if (alreadyAffectedRows != 0 && c == k % group.queues_.size())
+                        {
+                            input->already_affected_rows_ = &((*alreadyAffectedRows)[it->first].already_affected_rows_);
+                            input->commit_judger_ = (*alreadyAffectedRows)[it->first].commit_judger_.get();
+                        }
+                        else
+                        {
+                            input->commit_judger_ = 0;
+                        }
+                        
+                        work_list.push_back(input);
+                        work_owner.push_back(c == k % group.queues_.size() ? owner : 0);
+                    }
+                }
+            }
+            
+            tr1::shared_ptr<DbCompletion> completion(new DbCompletion(task_, (int)work_list.size()));
+            completion->commands_.swap(work_list);
+            completion->owners_.swap(work_owner);
+            
+            for (size_t i = 0; i < completion->commands_.size(); i++)
+            {
+                completion->commands_[i]->latch_ = &(completion->latch_);
+                completion->commands_[i]->queue_->Push(completion->commands_[i]);
+            }
+            
+            // keep the commands alive until the working threads have finished them
+            if (!completion->IsDone())
+            {
+                submitted_.push_back(completion);
+            }
+            
+            return completion;
+        }
+        
+        tr1::shared_ptr<DbCompletion> DbEngine::Submit(
+            ActionType_C actionType, 
+            map<DbLocation, DbActionFilter*>& locFilter, 
+            map<DbLocation, AffectedRowRecorder>* alreadyAffectedRows)
+        {
+            map<DbLocation, vector<DbActionFilter*> > loc_filters;
+            
+            map<DbLocation, DbActionFilter*>::iterator it = locFilter.begin();
+            for ( ; it != locFilter.end(); it++)
+            {
+                loc_filters[it->first].push_back(it->second);
+            }
+            
+            return Submit(actionType, loc_filters, alreadyAffectedRows);
+        }
+        
+        void DbEngine::WaitSubmitted()
+        {
+            for (size_t i = 0; i < submitted_.size(); i++)
+            {
+                submitted_[i]->latch_.Wait();
+            }
+            
+            submitted_.clear();
+        }
+        
+        void DbEngine::PruneSubmitted()
+        {
+            size_t kept = 0;
+            for (size_t i = 0; i < submitted_.size(); i++)
+            {
+                if (!submitted_[i]->IsDone())
+                {
+                    submitted_[kept++] = submitted_[i];
+                }
+            }
+            
+            submitted_.resize(kept);
+        }
+        
         void DbEngine::PushWorkAndWait( vector<InputCommand*>& workList )
         {
             int work_count = workList.size();
         
             if (work_count != 0)
             {
+                // arm the latch before any working thread can count it down
+                works_done_latch_.Reset(work_count);
+                
                 for (int i = 0; i < work_count; i++)
                 {
-                    input_blocking_queues_[ workList[i]->location_ ].Push(workList[i]);
+                    workList[i]->latch_ = &works_done_latch_;
+                    workList[i]->queue_->Push(workList[i]);
                 }
         
                 // wait until all results come out
-                {
-                    COMMON::THREAD::MutexLockGuard lock(mutex_);
-                    while (thread_return_param_.size() < work_count)
-                    {
-                        result_reached_cond_.Wait(mutex_);
-                    }
-                }        
+                works_done_latch_.Wait();
             }
         }
         
-        bool DbEngine::CheckHasException() throw (EXCEPTION::ThrowableException)
+        bool DbEngine::CheckHasException(vector<InputCommand*>& workList) throw (EXCEPTION::ThrowableException)
         {
             bool success = true;
 
             vector<tr1::shared_ptr<EXCEPTION::IException> > real_exception;
-            for (int i = 0; i < thread_return_param_.size(); i++)
+            for (size_t i = 0; i < workList.size(); i++)
             {
-                if (thread_return_param_[i].exception.use_count() != 0)
+                if (workList[i]->rslt_.exception.use_count() != 0)
                 {
                     // exception happened
-                    real_exception.push_back(thread_return_param_[i].exception);
+                    real_exception.push_back(workList[i]->rslt_.exception);
                 }
             }
         
@@ -615,7 +1071,7 @@ namespace COMMON
                 if (tmp == 0 || tmp->IsExceptionMode() == true)
                 {
                     // clear results
-                    ClearRslts();
+                    ClearRslts(workList);
         
                     EXCEPTION::ThrowableException e(real_exception);
                     throw e;
@@ -631,18 +1087,21 @@ namespace COMMON
             return success;
         }
         
-        void DbEngine::ClearRslts()
+        void DbEngine::ClearRslts(vector<InputCommand*>& workList)
         {
-            COMMON::THREAD::MutexLockGuard lock(mutex_);
-            thread_return_param_.clear();
+            for (size_t i = 0; i < workList.size(); i++)
+            {
+                workList[i]->rslt_.exception.reset();
+                workList[i]->rslt_.return_items_ = 0;
+            }
         }
         
-        map<DbLocation*, void*> DbEngine::GetRslt()
+        map<DbLocation*, void*> DbEngine::GetRslt(vector<InputCommand*>& workList)
         {
             map<DbLocation*, void*> rslt;
-            for (int i = 0; i < thread_return_param_.size(); i++)
+            for (size_t i = 0; i < workList.size(); i++)
             {
-                rslt[thread_return_param_[i].location] = thread_return_param_[i].return_items_;
+                rslt[workList[i]->rslt_.location] = workList[i]->rslt_.return_items_;
             }
         
             return rslt;
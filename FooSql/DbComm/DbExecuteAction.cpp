@@ -22,6 +22,8 @@ namespace COMMON
 
         DbExecuteAction::~DbExecuteAction()
         {
+            // the submitted statements are still counting into already_affected_rows_
+            engine_->WaitSubmitted();
         }
     
         DbRslt* DbExecuteAction::GetRslt()
@@ -153,6 +155,68 @@ namespace COMMON
             return success;
         }
     
+        bool DbExecuteAction::Do(
+            map<DbLocation, vector<DbActionFilter*> >& works, map<DbLocation, long long>* affected_rows) throw (EXCEPTION::ThrowableException)
+        {
+            bool success = true;
+    
+            if (works.size() == 0)
+            {
+                return success;
+            }
+            
+            map<DbLocation*, vector<void*> > work_rslt = 
+                engine_->Do(
+                    GetRealActionType(), 
+                    works, 
+                    success, 
+                    &already_affected_rows_);
+            
+            if (success)
+            {
+                map<DbLocation*, vector<void*> >::iterator it = work_rslt.begin();
+                for (; it != work_rslt.end(); it++)
+                {
+                    SetActionedDbInfo(it->first);
+                }
+                
+                GetAffectedRows(work_rslt, affected_rows);
+            }
+            
+            return success;
+        }
+        
+        tr1::shared_ptr<DbCompletion> DbExecuteAction::Submit(map<DbLocation, vector<DbActionFilter*> >& works)
+        {
+            tr1::shared_ptr<DbCompletion> completion = 
+                engine_->Submit(
+                    GetRealActionType(), 
+                    works, 
+                    &already_affected_rows_);
+            
+            map<DbLocation, vector<DbActionFilter*> >::iterator it = works.begin();
+            for (; it != works.end(); it++)
+            {
+                DbLocation location = it->first;
+                SetActionedDbInfo(&location);
+            }
+            
+            return completion;
+        }
+        
+        tr1::shared_ptr<DbCompletion> DbExecuteAction::Submit(map<DbLocation, DbActionFilter*>& works)
+        {
+            tr1::shared_ptr<DbCompletion> completion = 
+                engine_->Submit(
+                    GetRealActionType(), 
+                    works, 
+                    &already_affected_rows_);
+            
+            SetActionedDbInfo(works);
+            
+            return completion;
+        }
+    
         void DbExecuteAction::GetAffectedRows(
             map<DbLocation*, void*>& workRslt, map<DbLocation, long long>* affected_rows)
         {
@@ -170,5 +234,27 @@ namespace COMMON
                 }	
             }  
         }
+        
+        void DbExecuteAction::GetAffectedRows(
+            map<DbLocation*, vector<void*> >& workRslt, map<DbLocation, long long>* affected_rows)
+        {
+            if (affected_rows == 0)
+            {
+                return;
+            }
+            
+            affected_rows->clear();
+    
+            map<DbLocation*, vector<void*> >::iterator it = workRslt.begin();
+            for (; it != workRslt.end(); it++)
+            {
+                long long rows = 0;
+                for (size_t i = 0; i < it->second.size(); i++)
+                {
+                    rows += (long long)(it->second[i]);
+                }
+                (*affected_rows)[*(it->first)] = rows;
+            }
+        }
     }
 }
\ No newline at end of file
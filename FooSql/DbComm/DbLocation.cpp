@@ -0,0 +1,59 @@
+#include <map>
+
+#include "dbcomm/DbLocation.h"
+
+#include "thread/Mutex.h"
+#include "thread/MutexLockGuard.h"
+
+using namespace COMMON::THREAD;
+
+namespace COMMON
+{
+    namespace DBCOMM
+    {
+        // the handles given out, shared by all the tasks in the process
+        static Mutex& GetHandlesMutex()
+        {
+            static Mutex handles_mutex;
+            return handles_mutex;
+        }
+        
+        static map<string, int>& GetHandles()
+        {
+            static map<string, int> handles;
+            return handles;
+        }
+        
+        int DbLocation::Intern(const DbLocation& location)
+        {
+            // the fields are separated, so that "ab" + "c" differs from "a" + "bc"
+            string key;
+            key.reserve(location.ip_.size() + location.port_.size() + location.db_id_.size() + location.user_.size() + 3);
+            key.append(location.ip_).append(1, '\0');
+            key.append(location.port_).append(1, '\0');
+            key.append(location.db_id_).append(1, '\0');
+            key.append(location.user_);
+            
+            MutexLockGuard lock(GetHandlesMutex());
+            
+            map<string, int>& handles = GetHandles();
+            map<string, int>::iterator it = handles.find(key);
+            if (it != handles.end())
+            {
+                return it->second;
+            }
+            
+            int handle = (int)handles.size();
+            handles[key] = handle;
+            
+            return handle;
+        }
+        
+        int DbLocation::HandleCount()
+        {
+            MutexLockGuard lock(GetHandlesMutex());
+            
+            return (int)GetHandles().size();
+        }
+    }
+}
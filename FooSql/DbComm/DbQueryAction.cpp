@@ -28,11 +28,9 @@ namespace COMMON
 
         DbQueryAction::~DbQueryAction()
         {
-            map<DbLocation, map<string, int>* > ::iterator it = column_name_index_map_.begin();
-            while (it != column_name_index_map_.end())
+            for (int i = 0; i < column_name_index_map_.Size(); i++)
             {
-                delete it->second;
-                it++;
+                delete column_name_index_map_.ValueAt(i);
             }
         }
 
@@ -104,15 +102,7 @@ namespace COMMON
             }
             
             // begin to work
-            map<DbLocation*, void*> rslt;
-            if (works.size() == 1)
-            {
-                rslt = engine_->SyncDo(DbEngine::ActionTypeDef::QUERY, works, success);    
-            }
-            else
-            {
-                rslt = engine_->Do(DbEngine::ActionTypeDef::QUERY, works, success);    
-            }
+            map<DbLocation*, void*> rslt = OpenRslt(works, success);
 
             if (success)
             {   
@@ -162,9 +152,108 @@ namespace COMMON
 
         map<string, int>* DbQueryAction::GetColumnStringIndex(DbLocation& location)
         {
-            return column_name_index_map_[location];
+            map<string, int>** index = column_name_index_map_.Find(location);
+            return (index == 0) ? 0 : *index;
         } 
 
+        map<DbLocation*, void*> DbQueryAction::OpenRslt(map<DbLocation, DbActionFilter*>& works, bool& success) throw (EXCEPTION::ThrowableException)
+        {
+            if (works.size() == 1)
+            {
+                return engine_->SyncDo(GetQueryActionType(), works, success);    
+            }
+            else
+            {
+                return engine_->Do(GetQueryActionType(), works, success);    
+            }
+        }
+
+        ////////////////////////////////////////////
+        // DbStreamQueryAction
+        ////////////////////////////////////////////
+        DbStreamQueryAction::DbStreamQueryAction(
+            tr1::shared_ptr<IDbTasks> dbtasks, tr1::shared_ptr<DbEngine> engine, bool& isActionFinished, int maxRows, size_t maxBytes, bool unordered)
+            : DbQueryAction(dbtasks, engine, isActionFinished), max_rows_(maxRows), max_bytes_(maxBytes), unordered_(unordered)
+        {
+        }
+
+        DbStreamQueryAction::~DbStreamQueryAction()
+        {
+            // the working threads must leave the streams before they are freed
+            StopStreams();
+        }
+
+        bool DbStreamQueryAction::EndAction(map<DbLocation, long long>* affected_rows) throw (EXCEPTION::ThrowableException)
+        {
+            StopStreams();
+            
+            return DbQueryAction::EndAction(affected_rows);
+        }
+
+        RowStream* DbStreamQueryAction::GetRowStream(DbLocation& location)
+        {
+            tr1::shared_ptr<RowStream>* stream = streams_.Find(location);
+            return (stream == 0) ? 0 : stream->get();
+        }
+
+        map<DbLocation*, void*> DbStreamQueryAction::OpenRslt(map<DbLocation, DbActionFilter*>& works, bool& success) throw (EXCEPTION::ThrowableException)
+        {
+            // the rows of the last query are dropped
+            StopStreams();
+            stream_filters_.clear();
+            
+            map<DbLocation*, void*> rslt;
+            map<DbLocation, DbActionFilter*> stream_works;
+            
+            tr1::shared_ptr<RowStream> stream;
+            map<DbLocation, DbActionFilter*>::iterator it = works.begin();
+            for (; it != works.end(); it++)
+            {
+                DbLocation& location = const_cast<DbLocation&>(it->first);
+                
+                if (!unordered_ || !stream)
+                {
+                    stream.reset(new RowStream(max_rows_, max_bytes_));
+                }
+                streams_[location] = stream;
+                
+                // the rows are tagged with the location kept by the map
+                stream->AddSource(&(streams_.LocationAt(streams_.Position(location))), GetColumnStringIndex(location));
+                
+
+                tr1::shared_ptr<DbActionFilter> filter(new DbActionFilter(it->second->GetData(), it->second->GetLength(), stream.get()));
+                stream_filters_.push_back(filter);
+                
+                stream_works[location] = filter.get();
+                rslt[&location] = 0;
+            }
+            
+            // the errors are given by the streams
+            completion_ = engine_->Submit(DbEngine::ActionTypeDef::STREAM_QUERY, stream_works);
+            success = true;
+            
+            return rslt;
+        }
+
+        void DbStreamQueryAction::StopStreams()
+        {
+            for (int i = 0; i < streams_.Size(); i++)
+            {
+                if (streams_.ValueAt(i))
+                {
+                    streams_.ValueAt(i)->Cancel();
+                }
+            }
+            
+            if (completion_)
+            {
+                completion_->Wait();
+                completion_.reset();
+            }
+            
+            streams_.Clear();
+        }
+
         ////////////////////////////////////////////
         // DbGetPriKeysAction
         ////////////////////////////////////////////
@@ -3,6 +3,8 @@
 #include "dbcomm/DbAction.h"
 #include "dbcomm/DbQueryAction.h"
 #include "dbcomm/Row.h"
+#include "dbcomm/RowBlock.h"
+#include "dbcomm/RowStream.h"
 
 namespace COMMON
 {
@@ -56,6 +58,18 @@ namespace COMMON
             Row rslt;
             success = true;
 
+            // the rows read ahead are got without going through the working thread
+            RowStream* stream = query_action_->GetRowStream(*const_cast<DbLocation*>(target));
+            if (stream != 0)
+            {
+                char** row = stream->Fetch();
+                success = (row != 0) || CheckStream(stream);
+
+                // the rows of an unordered query may come from any connection
+                const DbLocation* source = (row != 0) ? stream->GetCurrentLocation() : target;
+                return Row(row, query_action_->GetColumnStringIndex(*const_cast<DbLocation*>(source)));
+            }
+
             DbActionFilter filter;
             void* t = engine_->SyncDo(DbEngine::ActionTypeDef::FETCH, target, &filter, success);
 
@@ -67,11 +81,40 @@ namespace COMMON
             return rslt;
         }
 
+        const DbLocation* DbQueryRslt::GetCurrentLocation()
+        {
+            if (current_fetch_db_index_ >= (int)db_locations_.size())
+            {
+                return 0;
+            }
+
+            RowStream* stream = query_action_->GetRowStream(db_locations_[current_fetch_db_index_]);
+            if (stream != 0)
+            {
+                return stream->GetCurrentLocation();
+            }
+
+            return &(db_locations_[current_fetch_db_index_]);
+        }
+
         map<DbLocation, Row> DbQueryRslt::Fetch(vector<DbLocation*>& locations, bool& success, bool getNull)
         {
             map<DbLocation, Row> rslt;
             success = true;
 
+            if (!locations.empty() && query_action_->GetRowStream(*(locations[0])) != 0)
+            {
+                for (size_t i = 0; i < locations.size() && success; i++)
+                {
+                    Row row = Fetch(locations[i], success);
+                    if (success && (((char**)row) != 0 || getNull))
+                    {
+                        rslt[*(locations[i])] = row;
+                    }
+                }
+                return rslt;
+            }
+
             // simulate an input
             DbActionFilter filter;
             map<DbLocation, DbActionFilter*> input;
@@ -97,6 +140,159 @@ namespace COMMON
             return rslt;
         }
 
+        ColumnRef DbQueryRslt::GetColumnRef(const string& column) throw (COMMON::EXCEPTION::ThrowableException)
+        {
+            map<string, int>* index = 0;
+            for (size_t i = 0; i < db_locations_.size() && index == 0; i++)
+            {
+                index = query_action_->GetColumnStringIndex(db_locations_[i]);
+            }
+
+            map<string, int> empty;
+            Row names(0, (index == 0) ? &empty : index);
+
+            return ColumnRef(names.GetIndexByColName(column));
+        }
+
+        int DbQueryRslt::FetchBlock(RowBlock& block, bool& success)
+        {
+            int rows = 0;
+            success = true;
+
+            while (current_fetch_db_index_ < (int)db_locations_.size())
+            {
+                rows = FetchBlock(&(db_locations_[current_fetch_db_index_]), block, success);
+                if (!success || rows != 0)
+                {
+                    break;
+                }
+
+                // go to the next target
+                current_fetch_db_index_++;
+            }
+
+            return rows;
+        }
+
+        int DbQueryRslt::FetchBlock(const DbLocation* target, RowBlock& block, bool& success)
+        {
+            int rows = 0;
+            success = true;
+
+            RowStream* stream = query_action_->GetRowStream(*const_cast<DbLocation*>(target));
+            if (stream != 0)
+            {
+                rows = stream->FetchBlock(block);
+                success = (rows != 0) || CheckStream(stream);
+
+                const DbLocation* source = (rows != 0) ? block.GetLocation() : target;
+                block.SetColumnIndex(query_action_->GetColumnStringIndex(*const_cast<DbLocation*>(source)));
+                return rows;
+            }
+
+            DbActionFilter filter;
+            filter.SetAdditionalInfo(&block);
+            void* t = engine_->SyncDo(DbEngine::ActionTypeDef::FETCH_BLOCK, target, &filter, success);
+
+            if (success)
+            {
+                rows = (int)(long)t;
+                block.SetColumnIndex(query_action_->GetColumnStringIndex(*const_cast<DbLocation*>(target)));
+                block.SetLocation(target);
+            }
+
+            return rows;
+        }
+
+        int DbQueryRslt::FetchColumns(ColumnBlock& block, bool& success)
+        {
+            column_rows_.SetCapacity(block.GetCapacity());
+            column_rows_.SetNativeNumbers(block.IsNativeNumbers());
+
+            int rows = FetchBlock(column_rows_, success);
+            block.Assign(column_rows_);
+
+            return rows;
+        }
+
+        int DbQueryRslt::FetchColumns(const DbLocation* target, ColumnBlock& block, bool& success)
+        {
+            column_rows_.SetCapacity(block.GetCapacity());
+            column_rows_.SetNativeNumbers(block.IsNativeNumbers());
+
+            int rows = FetchBlock(target, column_rows_, success);
+            block.Assign(column_rows_);
+
+            return rows;
+        }
+
+        RowBlock& DbQueryRslt::FetchMany(int n, bool& success)
+        {
+            rows_.SetCapacity(n);
+            FetchBlock(rows_, success);
+
+            return rows_;
+        }
+
+        long long DbQueryRslt::ForEachRow(RowVisitor visitor, bool& success, int blockRows)
+        {
+            long long visited = 0;
+            success = true;
+
+            rows_.SetCapacity(blockRows);
+            while (FetchBlock(rows_, success) > 0)
+            {
+                int count = rows_.GetRowCount();
+                for (int i = 0; i < count; i++)
+                {
+                    Row row = rows_.GetRow(i);
+                    visited++;
+
+                    if (!visitor(row, rows_.GetLengths(i)))
+                    {
+                        return visited;
+                    }
+                }
+            }
+
+            return visited;
+        }
+
+        void DbQueryRslt::Close(const DbLocation* target, bool& success)
+        {
+            success = true;
+
+            // the working thread closes the result set when it stops
+            RowStream* stream = query_action_->GetRowStream(*const_cast<DbLocation*>(target));
+            if (stream != 0)
+            {
+                stream->Cancel();
+                return;
+            }
+
+            DbActionFilter filter;
+            engine_->SyncDo(DbEngine::ActionTypeDef::CLOSE_OPEN_RSLT, target, &filter, success);
+        }
+
+        bool DbQueryRslt::CheckStream(RowStream* stream) throw (EXCEPTION::ThrowableException)
+        {
+            tr1::shared_ptr<EXCEPTION::IException> exception = stream->GetException();
+            if (!exception)
+            {
+                return true;
+            }
+
+            if (query_action_->IsExceptionMode())
+            {
+                EXCEPTION::ThrowableException e(exception);
+                throw e;
+            }
+
+            tr1::shared_ptr<EXCEPTION::ThrowableException> e(new EXCEPTION::ThrowableException(exception));
+            SetException(e);
+            return false;
+        }
+
         unsigned long* DbQueryRslt::GetCurrentRowColumnsLength(bool& success)
         {
             unsigned long* rsltColumnLength = 0;
@@ -112,6 +308,12 @@ namespace COMMON
             unsigned long* rsltColumnLength = 0;
             success = true;
 
+            RowStream* stream = query_action_->GetRowStream(*const_cast<DbLocation*>(target));
+            if (stream != 0)
+            {
+                return stream->GetCurrentLengths();
+            }
+
             DbActionFilter f;
             void* t = engine_->Do(DbEngine::ActionTypeDef::GET_COLUMNS_LENGTHS, target, &f, success);
 
@@ -128,6 +330,19 @@ namespace COMMON
             map<DbLocation, unsigned long*> rslt;
             success = true;
 
+            if (!locations.empty() && query_action_->GetRowStream(*(locations[0])) != 0)
+            {
+                for (size_t i = 0; i < locations.size(); i++)
+                {
+                    unsigned long* lengths = GetCurrentRowColumnsLength(locations[i], success);
+                    if (lengths != 0 || getNull)
+                    {
+                        rslt[*(locations[i])] = lengths;
+                    }
+                }
+                return rslt;
+            }
+
             // simulate an input
             DbActionFilter filter;
             map<DbLocation, DbActionFilter*> input;
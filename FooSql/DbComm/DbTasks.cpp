@@ -16,6 +16,9 @@ namespace COMMON
 {
     namespace DBCOMM
     {
+        // whether the errors of the thread are thrown whatever the mode is
+        static __thread bool t_threadThrows = false;
+        
         ////////////  DbTasks  ////////////////////////
         DbTasks::DbTasks(vector<DbLocation>& dbLocations, bool exception)
         {
@@ -23,6 +26,7 @@ namespace COMMON
             is_connected_    = false;
             is_action_finished_ = true;
             is_engine_initialized_ = false;
+            connections_per_location_ = 1;
             
             db_locations_ = dbLocations;
         }
@@ -104,6 +108,16 @@ namespace COMMON
             return success;
         }
 
+        bool DbTasks::IsExceptionMode()
+        {
+            return exception_ || t_threadThrows;
+        }
+        
+        void DbTasks::SetThreadThrows(bool throws)
+        {
+            t_threadThrows = throws;
+        }
+        
         vector<DbLocation>& DbTasks::GetDbLocations()
         {
             return db_locations_;
@@ -146,6 +160,21 @@ namespace COMMON
             return (DbQueryAction*)current_work_.get();
         }
 
+        DbQueryAction* DbTasks::StreamSelect( 
+            int maxRows /*= RowStream::DEFAULT_MAX_ROWS*/, size_t maxBytes /*= RowStream::DEFAULT_MAX_BYTES*/, bool unordered /*= false*/ )
+        {
+            if (false == CanStartAction())
+            {
+                return 0;
+            }
+
+            current_work_.reset();
+            
+            current_work_ = tr1::shared_ptr<DbStreamQueryAction>(
+                            new DbStreamQueryAction(shared_from_this(), db_engine_, is_action_finished_, maxRows, maxBytes, unordered));
+            return (DbQueryAction*)current_work_.get();
+        }
+
         DbExecuteAction* DbTasks::Insert( int commitLimit /*= 5000*/ )
         {
             if (false == CanStartAction())
@@ -246,6 +275,11 @@ namespace COMMON
                                     shared_from_this(), db_engine_, is_action_finished_));
             return (DbExecuteAction*)current_work_.get();
         }
+        
+        StringEscaper DbTasks::GetStringEscaper(const DbLocation& location)
+        {
+            return (db_engine_.get() == 0) ? StringEscaper() : db_engine_->GetStringEscaper(location);
+        }
 
     }
 }
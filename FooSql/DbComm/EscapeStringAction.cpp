@@ -17,22 +17,27 @@ namespace COMMON
             return DbEngine::ActionTypeDef::ENCODE_TO_ESCAPED_STRING; 
         }
 
-        void EscapeStringAction::PrepareEscapedString(map<DbLocation*, void*>& workRslt)
+        void EscapeStringAction::PrepareEscapedString(map<DbLocation, vector<DbActionFilter*> >& works)
         {
             escaped_strings_.clear();
             escaped_strings_index_.clear();
 
-            map<DbLocation*, void*>::iterator it = workRslt.begin();
-            int i = 0;
-            for (; it != workRslt.end(); it++)
+            // escaped on this thread by the escaper of each connection, without going to the working threads
+            map<DbLocation, vector<DbActionFilter*> >::iterator it = works.begin();
+            for (; it != works.end(); it++)
             {
-                escaped_strings_.push_back(string((char*)(it->second)));
-                escaped_strings_index_[*(it->first)] = i;
+                escaped_strings_index_[it->first] = (int)escaped_strings_.size();
+                for (size_t i = 0; i < it->second.size(); i++)
+                {
+                    escaped_strings_.push_back(string());
+                    engine_->GetStringEscaper(it->first).Append(
+                        escaped_strings_.back(), it->second[i]->GetData(), it->second[i]->GetLength());
+                }
             }
             
             current_escaped_string_index_ = 0;
         }
-        
+
         bool EscapeStringAction::Do(DbActionFilter* filter, map<DbLocation, long long>* affected_rows) throw (COMMON::EXCEPTION::ThrowableException)
         {
             return DbAction::Do(filter, affected_rows);
@@ -46,21 +51,22 @@ namespace COMMON
         bool EscapeStringAction::Do(
             map<DbLocation, DbActionFilter*>& works, map<DbLocation, long long>* affected_rows) throw (COMMON::EXCEPTION::ThrowableException)
         {
-            bool success = true;
-
-            if (works.size() == 0)
+            map<DbLocation, vector<DbActionFilter*> > all_works;
+            map<DbLocation, DbActionFilter*>::iterator it = works.begin();
+            for (; it != works.end(); it++)
             {
-                return success;
-            }
-
-            map<DbLocation*, void*> workRslt = engine_->SyncDo(GetRealActionType(), works, success);
-
-            if (success)
-            {
-                PrepareEscapedString(workRslt);
+                all_works[it->first].push_back(it->second);
             }
+            
+            PrepareEscapedString(all_works);
+            return true;
+        }
 
-            return success;
+        bool EscapeStringAction::Do(
+            map<DbLocation, vector<DbActionFilter*> >& works, map<DbLocation, long long>* affected_rows) throw (COMMON::EXCEPTION::ThrowableException)
+        {
+            PrepareEscapedString(works);
+            return true;
         }
 
         DbRslt* EscapeStringAction::GetRslt()
@@ -0,0 +1,334 @@
+#include <algorithm>
+#include <cstring>
+
+#include "dbcomm/ExternalSort.h"
+#include "dbcomm/RowRecord.h"
+#include "dbcomm/ValueParser.h"
+
+namespace COMMON
+{
+    namespace DBCOMM
+    {
+        // compare the keys of two rows
+        static int CompareKeys(const char* left, const char* right)
+        {
+            size_t left_length = 0;
+            size_t right_length = 0;
+            const char* left_key = RowRecord::GetKey(left, left_length);
+            const char* right_key = RowRecord::GetKey(right, right_length);
+
+            int order = memcmp(left_key, right_key, (left_length < right_length) ? left_length : right_length);
+            if (order != 0)
+            {
+                return order;
+            }
+
+            return (left_length < right_length) ? -1 : ((left_length > right_length) ? 1 : 0);
+        }
+
+        bool ExternalSort::EntryOrder::operator()(const Entry& left, const Entry& right) const
+        {
+            if (left.prefix_ != right.prefix_)
+            {
+                return left.prefix_ < right.prefix_;
+            }
+
+            return CompareKeys(left.record_, right.record_) < 0;
+        }
+
+        bool ExternalSort::SourceOrder::operator()(int left, int right) const
+        {
+            // the heap keeps the largest one on the top, so the order is reversed
+            return EntryOrder()(sort_->sources_[right].current_, sort_->sources_[left].current_);
+        }
+
+        ExternalSort::ExternalSort(size_t memoryLimit, const string& spillDirectory)
+            : memory_limit_(memoryLimit), spill_directory_(spillDirectory),
+              arena_((memoryLimit / 16 < Arena::DEFAULT_CHUNK_SIZE) ? memoryLimit / 16 : Arena::DEFAULT_CHUNK_SIZE),
+              last_(-1), finished_(false), columns_(0), location_(0)
+        {
+        }
+
+        ExternalSort::~ExternalSort()
+        {
+            for (size_t i = 0; i < runs_.size(); i++)
+            {
+                delete runs_[i];
+            }
+        }
+
+        void ExternalSort::AddKey(int column, bool numeric, bool descending)
+        {
+            Key key;
+            key.column_ = column;
+            key.numeric_ = numeric;
+            key.descending_ = descending;
+            keys_.push_back(key);
+        }
+
+        void ExternalSort::Add(RowBlock& block) throw (COMMON::EXCEPTION::ThrowableException)
+        {
+            int rows = block.GetRowCount();
+            if (rows == 0)
+            {
+                return;
+            }
+
+            columns_ = block.GetColumnCount();
+            if (column_index_.empty() && block.GetColumnIndex() != 0)
+            {
+                column_index_ = *(block.GetColumnIndex());
+            }
+
+            for (int r = 0; r < rows; r++)
+            {
+                FormKey(block, r);
+                RowRecord::Encode(block, r, key_, record_);
+
+                Entry entry;
+                entry.prefix_ = GetPrefix(key_.data(), key_.size());
+                entry.record_ = arena_.Copy(record_.data(), record_.size());
+                entries_.push_back(entry);
+
+                if (arena_.GetByteCount() + entries_.capacity() * sizeof(Entry) > memory_limit_)
+                {
+                    Spill();
+                }
+            }
+        }
+
+        long long ExternalSort::Add(DbQueryRslt* rslt, bool& success) throw (COMMON::EXCEPTION::ThrowableException)
+        {
+            long long rows = 0;
+            RowBlock block;
+            int count = 0;
+
+            while ((count = rslt->FetchBlock(block, success)) > 0)
+            {
+                Add(block);
+                rows += count;
+            }
+
+            return rows;
+        }
+
+        Row ExternalSort::Fetch(bool& success) throw (COMMON::EXCEPTION::ThrowableException)
+        {
+            success = true;
+
+            if (!finished_)
+            {
+                Finish();
+            }
+
+            // the source of the last row goes on, the row is valid until now
+            if (last_ >= 0)
+            {
+                if (Advance(sources_[last_]))
+                {
+                    heap_.push_back(last_);
+                    push_heap(heap_.begin(), heap_.end(), SourceOrder(this));
+                }
+                last_ = -1;
+            }
+
+            if (heap_.empty())
+            {
+                return Row();
+            }
+
+            pop_heap(heap_.begin(), heap_.end(), SourceOrder(this));
+            last_ = heap_.back();
+            heap_.pop_back();
+
+            const char* record = sources_[last_].current_.record_;
+            RowRecord::Decode(record, columns_, &(values_[0]), &(lengths_[0]));
+            location_ = RowRecord::GetLocation(record);
+
+            return Row(&(values_[0]), &column_index_);
+        }
+
+        unsigned long* ExternalSort::GetCurrentRowColumnsLength()
+        {
+            return lengths_.empty() ? 0 : &(lengths_[0]);
+        }
+
+        const DbLocation* ExternalSort::GetCurrentLocation()
+        {
+            return location_;
+        }
+
+        int ExternalSort::GetSpilledRunCount() const
+        {
+            return (int)runs_.size();
+        }
+
+        void ExternalSort::FormKey(RowBlock& block, int row)
+        {
+            // each key is a flag of NULL, followed by the value if it is not NULL. A number is formed so that
+            // the bytes are ordered as the numbers are. A string ends by two '\0', and a '\0' in it is
+            // followed by 0xff. A descending key has all of its bits reversed.
+            key_.clear();
+            for (size_t k = 0; k < keys_.size(); k++)
+            {
+                int column = keys_[k].column_;
+                size_t start = key_.size();
+
+                if (block.IsNull(row, column))
+                {
+                    key_ += '\0';
+                }
+                else if (keys_[k].numeric_)
+                {
+                    double value = 0.0;
+                    switch (block.GetColumnType(column))
+                    {
+                    case RowBlock::COLUMN_INTEGER:
+                        value = (double)block.GetInteger(row, column);
+                        break;
+
+                    case RowBlock::COLUMN_DOUBLE:
+                        value = block.GetDouble(row, column);
+                        break;
+
+                    default:
+                        // read without the locale, not a number is 0
+                        if (!ValueParser::ParseDouble(block.GetValue(row, column), block.GetLength(row, column), value))
+                        {
+                            value = 0.0;
+                        }
+                        break;
+                    }
+
+                    unsigned long long bits = 0;
+                    memcpy(&bits, &value, sizeof(bits));
+                    bits = ((bits >> 63) != 0) ? ~bits : (bits | (1ULL << 63));
+
+                    key_ += '\1';
+                    for (int shift = 56; shift >= 0; shift -= 8)
+                    {
+                        key_ += (char)((bits >> shift) & 0xff);
+                    }
+                }
+                else
+                {
+                    const char* value = block.GetValue(row, column);
+                    unsigned long length = block.GetLength(row, column);
+
+                    key_ += '\1';
+                    for (unsigned long i = 0; i < length; i++)
+                    {
+                        key_ += value[i];
+                        if (value[i] == '\0')
+                        {
+                            key_ += '\xff';
+                        }
+                    }
+                    key_.append(2, '\0');
+                }
+
+                if (keys_[k].descending_)
+                {
+                    for (size_t i = start; i < key_.size(); i++)
+                    {
+                        key_[i] = ~key_[i];
+                    }
+                }
+            }
+        }
+
+        unsigned long long ExternalSort::GetPrefix(const char* key, size_t length)
+        {
+            unsigned long long prefix = 0;
+            for (size_t i = 0; i < 8; i++)
+            {
+                prefix = (prefix << 8) | ((i < length) ? (unsigned char)key[i] : 0);
+            }
+
+            return prefix;
+        }
+
+        void ExternalSort::Spill() throw (COMMON::EXCEPTION::ThrowableException)
+        {
+            sort(entries_.begin(), entries_.end(), EntryOrder());
+
+            SpillFile* run = new SpillFile(spill_directory_);
+            runs_.push_back(run);
+
+            for (size_t i = 0; i < entries_.size(); i++)
+            {
+                run->Write(entries_[i].record_, RowRecord::GetSize(entries_[i].record_));
+            }
+
+            entries_.clear();
+            arena_.Clear();
+        }
+
+        void ExternalSort::Finish() throw (COMMON::EXCEPTION::ThrowableException)
+        {
+            finished_ = true;
+            sort(entries_.begin(), entries_.end(), EntryOrder());
+
+            values_.resize(columns_ + 1);
+            lengths_.resize(columns_ + 1);
+
+            for (size_t i = 0; i < runs_.size(); i++)
+            {
+                Source source;
+                source.next_ = runs_[i]->Map();
+                source.end_ = source.next_ + runs_[i]->GetSize();
+                source.index_ = 0;
+                source.memory_ = false;
+                sources_.push_back(source);
+            }
+
+            if (!entries_.empty())
+            {
+                Source source;
+                source.next_ = 0;
+                source.end_ = 0;
+                source.index_ = 0;
+                source.memory_ = true;
+                sources_.push_back(source);
+            }
+
+            for (int i = 0; i < (int)sources_.size(); i++)
+            {
+                if (Advance(sources_[i]))
+                {
+                    heap_.push_back(i);
+                }
+            }
+
+            make_heap(heap_.begin(), heap_.end(), SourceOrder(this));
+        }
+
+        bool ExternalSort::Advance(Source& source)
+        {
+            if (source.memory_)
+            {
+                if (source.index_ >= (int)entries_.size())
+                {
+                    return false;
+                }
+
+                source.current_ = entries_[source.index_++];
+                return true;
+            }
+
+            if (source.next_ >= source.end_)
+            {
+                return false;
+            }
+
+            size_t length = 0;
+            const char* key = RowRecord::GetKey(source.next_, length);
+
+            source.current_.record_ = source.next_;
+            source.current_.prefix_ = GetPrefix(key, length);
+            source.next_ += RowRecord::GetSize(source.next_);
+
+            return true;
+        }
+    }
+}
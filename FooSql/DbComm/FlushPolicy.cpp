@@ -0,0 +1,31 @@
+#include "dbcomm/FlushPolicy.h"
+
+namespace COMMON
+{
+    namespace DBCOMM
+    {
+        FlushPolicy::FlushPolicy(int maxRows, size_t maxBytes, long maxAge)
+            : max_rows_(1), max_bytes_(maxBytes), max_age_(0), default_packet_limit_(0)
+        {
+            SetMaxRows(maxRows);
+            SetMaxAge(maxAge);
+        }
+
+        void FlushPolicy::SetMaxRows(int maxRows)
+        {
+            max_rows_ = (maxRows > 1) ? maxRows : 1;
+        }
+
+        size_t FlushPolicy::GetPacketLimit(const DbLocation& location) const
+        {
+            map<DbLocation, size_t>::const_iterator it = packet_limits_.find(location);
+            return (it != packet_limits_.end()) ? it->second : default_packet_limit_;
+        }
+
+        bool FlushPolicy::IsBeyondPacket(const DbLocation& location, size_t bytes) const
+        {
+            size_t limit = GetPacketLimit(location);
+            return limit != 0 && bytes > limit;
+        }
+    }
+}
@@ -0,0 +1,663 @@
+#include <cstring>
+
+#include "dbcomm/HashAggregator.h"
+#include "dbcomm/DbQueryAction.h"
+#include "dbcomm/RowStream.h"
+#include "dbcomm/ValueParser.h"
+
+#include "thread/Thread.h"
+#include "thread/MutexLockGuard.h"
+
+namespace COMMON
+{
+    namespace DBCOMM
+    {
+        // the groups merged by a thread at least, or the merge is not worth the threads
+        static const int MERGE_GROUPS_PER_THREAD = 4096;
+
+        // parse a number in text without the locale, kept as an integer if it is. Not a number is 0.
+        static void ParseNumber(const char* text, size_t length, bool& integral, long long& integer, double& value)
+        {
+            integral = ValueParser::ParseInteger(text, length, integer);
+            if (integral)
+            {
+                value = (double)integer;
+                return;
+            }
+
+            integer = 0;
+            if (!ValueParser::ParseDouble(text, length, value))
+            {
+                value = 0.0;
+            }
+        }
+
+        // read a number of a block
+        static void ReadNumber(RowBlock& block, int row, int column, bool& integral, long long& integer, double& value)
+        {
+            switch (block.GetColumnType(column))
+            {
+            case RowBlock::COLUMN_INTEGER:
+                integral = true;
+                integer = block.GetInteger(row, column);
+                value = (double)integer;
+                break;
+
+            case RowBlock::COLUMN_DOUBLE:
+                integral = false;
+                integer = 0;
+                value = block.GetDouble(row, column);
+                break;
+
+            default:
+                ParseNumber(block.GetValue(row, column), block.GetLength(row, column), integral, integer, value);
+                break;
+            }
+        }
+
+        HashAggregator::HashAggregator(int threads)
+            : threads_(threads), rslt_(0), next_location_(0), rows_(0)
+        {
+            if (threads_ <= 0)
+            {
+                threads_ = (int)THREAD::Thread::HardwareConcurrency();
+            }
+
+            if (threads_ <= 0)
+            {
+                threads_ = 1;
+            }
+        }
+
+        HashAggregator::~HashAggregator()
+        {
+            Clear();
+        }
+
+        void HashAggregator::AddGroupColumn(int column)
+        {
+            group_columns_.push_back(column);
+        }
+
+        int HashAggregator::AddAggregate(Function function, int column, bool distinct)
+        {
+            Aggregate aggregate;
+            aggregate.function_ = function;
+            aggregate.column_ = column;
+            aggregate.count_column_ = -1;
+            aggregate.distinct_ = distinct && column >= 0;
+            aggregate.partial_ = false;
+            aggregates_.push_back(aggregate);
+
+            return (int)(group_columns_.size() + aggregates_.size()) - 1;
+        }
+
+        int HashAggregator::AddPartial(Function function, int column, int countColumn)
+        {
+            Aggregate aggregate;
+            aggregate.function_ = function;
+            aggregate.column_ = column;
+            aggregate.count_column_ = countColumn;
+            aggregate.distinct_ = false;
+            aggregate.partial_ = true;
+            aggregates_.push_back(aggregate);
+
+            return (int)(group_columns_.size() + aggregates_.size()) - 1;
+        }
+
+        void HashAggregator::Add(RowBlock& block)
+        {
+            if (tables_.empty())
+            {
+                tables_.push_back(new Table());
+            }
+
+            AddBlock(*(tables_[0]), block);
+        }
+
+        long long HashAggregator::Add(DbQueryRslt* rslt, bool& success) throw (COMMON::EXCEPTION::ThrowableException)
+        {
+            success = true;
+
+            // the connections are added at once only when each of them has its own stream
+            vector<DbLocation>& locations = rslt->db_locations_;
+            RowStream* first = locations.empty() ? 0 : rslt->query_action_->GetRowStream(locations[0]);
+            bool parallel = (threads_ > 1 && first != 0 && locations.size() > 1 && 
+                rslt->query_action_->GetRowStream(locations[1]) != first);
+
+            if (!parallel)
+            {
+                if (tables_.empty())
+                {
+                    tables_.push_back(new Table());
+                }
+
+                long long rows = 0;
+                RowBlock block;
+                int count = 0;
+                while ((count = rslt->FetchBlock(block, success)) > 0)
+                {
+                    AddBlock(*(tables_[0]), block);
+                    rows += count;
+                }
+
+                return rows;
+            }
+
+            rslt_ = rslt;
+            next_location_ = 0;
+            rows_ = 0;
+
+            // each thread adds to a table of its own
+            int threads = (threads_ < (int)locations.size()) ? threads_ : (int)locations.size();
+            for (int i = 0; i < threads; i++)
+            {
+                tables_.push_back(new Table());
+            }
+
+            RunThreads(threads, (int)tables_.size() - threads, RunAddStreams);
+            rslt_ = 0;
+
+            // the errors met by the working threads are reported by the streams
+            for (size_t i = 0; i < locations.size() && success; i++)
+            {
+                RowBlock block;
+                rslt->FetchBlock(&(locations[i]), block, success);
+            }
+
+            return rows_;
+        }
+
+        int HashAggregator::GetGroupCount()
+        {
+            MergeTables();
+
+            int groups = 0;
+            for (size_t i = 0; i < tables_.size(); i++)
+            {
+                groups += tables_[i]->groups_.GetCount();
+            }
+
+            return groups;
+        }
+
+        int HashAggregator::GetResult(RowBlock& block)
+        {
+            MergeTables();
+
+            int aggregates = (int)aggregates_.size();
+            int keys = (int)group_columns_.size();
+            block.Reset(keys + aggregates);
+            block.SetColumnIndex(0);
+            block.SetLocation(0);
+
+            // a column is kept as integers only if all of its values are
+            for (int a = 0; a < aggregates; a++)
+            {
+                Function function = aggregates_[a].function_;
+                bool integral = (function != AVG);
+
+                for (size_t t = 0; t < tables_.size() && integral && function != COUNT; t++)
+                {
+                    vector<Accumulator>& values = tables_[t]->values_;
+                    for (size_t i = (size_t)a; i < values.size() && integral; i += (size_t)aggregates)
+                    {
+                        integral = !values[i].has_value_ || values[i].integral_;
+                    }
+                }
+
+                block.SetColumnType(keys + a, integral ? RowBlock::COLUMN_INTEGER : RowBlock::COLUMN_DOUBLE);
+            }
+
+            // the aggregates of no rows at all
+            if (keys == 0 && GetGroupCount() == 0)
+            {
+                for (int a = 0; a < aggregates; a++)
+                {
+                    if (aggregates_[a].function_ == COUNT)
+                    {
+                        block.AppendInteger(0);
+                    }
+                    else
+                    {
+                        block.AppendNull();
+                    }
+                }
+            }
+
+            for (size_t t = 0; t < tables_.size(); t++)
+            {
+                Table& table = *(tables_[t]);
+                for (int g = 0; g < table.groups_.GetCount(); g++)
+                {
+                    // the group columns, see AddBlock()
+                    const char* key = table.groups_.GetKey(g);
+                    for (int k = 0; k < keys; k++)
+                    {
+                        if (*(key++) == '\0')
+                        {
+                            block.AppendNull();
+                            continue;
+                        }
+
+                        unsigned int length = 0;
+                        memcpy(&length, key, sizeof(length));
+                        key += sizeof(length);
+
+                        block.AppendValue(key, length);
+                        key += length;
+                    }
+
+                    for (int a = 0; a < aggregates; a++)
+                    {
+                        const Accumulator& value = table.values_[g * aggregates + a];
+                        double number = value.integral_ ? (double)value.integer_ : value.double_;
+
+                        if (aggregates_[a].function_ == COUNT)
+                        {
+                            block.AppendInteger(value.count_);
+                        }
+                        else if (!value.has_value_ || (aggregates_[a].function_ == AVG && value.count_ == 0))
+                        {
+                            block.AppendNull();
+                        }
+                        else if (aggregates_[a].function_ == AVG)
+                        {
+                            block.AppendDouble(number / (double)value.count_);
+                        }
+                        else if (block.GetColumnType(keys + a) == RowBlock::COLUMN_INTEGER)
+                        {
+                            block.AppendInteger(value.integer_);
+                        }
+                        else
+                        {
+                            block.AppendDouble(number);
+                        }
+                    }
+                }
+            }
+
+            return block.GetRowCount();
+        }
+
+        void HashAggregator::Clear()
+        {
+            for (size_t i = 0; i < tables_.size(); i++)
+            {
+                delete tables_[i];
+            }
+            tables_.clear();
+        }
+
+        void* HashAggregator::RunAddStreams(void* arg)
+        {
+            Work* work = (Work*)arg;
+            work->aggregator_->AddStreams(work->index_);
+            return 0;
+        }
+
+        void* HashAggregator::RunMergePart(void* arg)
+        {
+            Work* work = (Work*)arg;
+            work->aggregator_->MergePart(work->index_);
+            return 0;
+        }
+
+        void HashAggregator::AddBlock(Table& table, RowBlock& block)
+        {
+            int aggregates = (int)aggregates_.size();
+            int rows = block.GetRowCount();
+
+            for (int r = 0; r < rows; r++)
+            {
+                // each group column is a flag of NULL, followed by the length and the value if it is not NULL
+                table.key_.clear();
+                for (size_t k = 0; k < group_columns_.size(); k++)
+                {
+                    int column = group_columns_[k];
+                    if (block.IsNull(r, column))
+                    {
+                        table.key_ += '\0';
+                        continue;
+                    }
+
+                    unsigned int length = (unsigned int)block.GetLength(r, column);
+                    table.key_ += '\1';
+                    table.key_.append((const char*)&length, sizeof(length));
+                    table.key_.append(block.GetValue(r, column), length);
+                }
+
+                bool inserted = false;
+                int group = table.groups_.Insert(table.key_.data(), table.key_.size(), 
+                    HashKeyTable::Hash(table.key_.data(), table.key_.size()), inserted);
+
+                if (inserted)
+                {
+                    Accumulator empty = { 0, 0, 0.0, true, false };
+                    table.values_.resize(table.values_.size() + aggregates, empty);
+                }
+
+                for (int a = 0; a < aggregates; a++)
+                {
+                    AddValue(table, group, a, block, r);
+                }
+            }
+        }
+
+        void HashAggregator::AddValue(Table& table, int group, int aggregate, RowBlock& block, int row)
+        {
+            const Aggregate& info = aggregates_[aggregate];
+            Accumulator& accumulator = table.values_[group * aggregates_.size() + aggregate];
+
+            if (info.column_ < 0)
+            {
+                accumulator.count_++;
+                return;
+            }
+
+            if (block.IsNull(row, info.column_))
+            {
+                return;
+            }
+
+            // a value is only added the first time it is met by the group
+            if (info.distinct_)
+            {
+                unsigned long length = block.GetLength(row, info.column_);
+
+                table.key_.assign((const char*)&group, sizeof(group));
+                table.key_.append((const char*)&aggregate, sizeof(aggregate));
+                table.key_.append(block.GetValue(row, info.column_), length);
+
+                bool inserted = false;
+                table.distincts_.Insert(table.key_.data(), table.key_.size(), 
+                    HashKeyTable::Hash(table.key_.data(), table.key_.size()), inserted);
+
+                if (!inserted)
+                {
+                    return;
+                }
+            }
+
+            if (info.function_ == COUNT && !info.partial_)
+            {
+                accumulator.count_++;
+                return;
+            }
+
+            bool integral = true;
+            long long integer = 0;
+            double value = 0.0;
+            ReadNumber(block, row, info.column_, integral, integer, value);
+
+            long long count = 1;
+            if (info.partial_ && info.function_ == AVG && info.count_column_ >= 0)
+            {
+                if (block.IsNull(row, info.count_column_))
+                {
+                    return;
+                }
+
+                bool countIntegral = true;
+                double countValue = 0.0;
+                ReadNumber(block, row, info.count_column_, countIntegral, count, countValue);
+                count = countIntegral ? count : (long long)countValue;
+            }
+
+            Update(accumulator, info, integral, integer, value, count);
+        }
+
+        void HashAggregator::Update(Accumulator& accumulator, const Aggregate& aggregate, bool integral, long long integer, double value, long long count)
+        {
+            if (aggregate.function_ == COUNT)
+            {
+                accumulator.count_ += integral ? integer : (long long)value;
+                return;
+            }
+
+            accumulator.count_ += count;
+
+            if (aggregate.function_ == SUM || aggregate.function_ == AVG)
+            {
+                if (accumulator.integral_ && integral)
+                {
+                    accumulator.integer_ += integer;
+                }
+                else
+                {
+                    // the sum is kept as a floating point number since then
+                    if (accumulator.integral_)
+                    {
+                        accumulator.double_ = (double)accumulator.integer_;
+                        accumulator.integral_ = false;
+                    }
+                    accumulator.double_ += value;
+                }
+
+                accumulator.has_value_ = true;
+                return;
+            }
+
+            bool replace = !accumulator.has_value_;
+            if (!replace)
+            {
+                int order = 0;
+                if (accumulator.integral_ && integral)
+                {
+                    order = (integer < accumulator.integer_) ? -1 : ((integer > accumulator.integer_) ? 1 : 0);
+                }
+                else
+                {
+                    double current = accumulator.integral_ ? (double)accumulator.integer_ : accumulator.double_;
+                    order = (value < current) ? -1 : ((value > current) ? 1 : 0);
+                }
+
+                replace = (aggregate.function_ == MIN) ? (order < 0) : (order > 0);
+            }
+
+            if (replace)
+            {
+                accumulator.integer_ = integer;
+                accumulator.double_ = value;
+                accumulator.integral_ = integral;
+                accumulator.has_value_ = true;
+            }
+        }
+
+        void HashAggregator::AddStreams(int index)
+        {
+            Table& table = *(tables_[index]);
+            RowBlock block;
+            long long rows = 0;
+
+            while (true)
+            {
+                int location = 0;
+                {
+                    THREAD::MutexLockGuard guard(mutex_);
+                    location = next_location_++;
+                }
+
+                if (location >= (int)rslt_->db_locations_.size())
+                {
+                    break;
+                }
+
+                RowStream* stream = rslt_->query_action_->GetRowStream(rslt_->db_locations_[location]);
+                int count = 0;
+                while ((count = stream->FetchBlock(block)) > 0)
+                {
+                    AddBlock(table, block);
+                    rows += count;
+                }
+            }
+
+            THREAD::MutexLockGuard guard(mutex_);
+            rows_ += rows;
+        }
+
+        void HashAggregator::MergePart(int part)
+        {
+            Table& target = *(merged_[part]);
+            int aggregates = (int)aggregates_.size();
+            Accumulator empty = { 0, 0, 0.0, true, false };
+
+            for (size_t t = 0; t < tables_.size(); t++)
+            {
+                Table& source = *(tables_[t]);
+                for (int g = 0; g < source.groups_.GetCount(); g++)
+                {
+                    if (GetPart(source.groups_.GetHash(g)) != part)
+                    {
+                        continue;
+                    }
+
+                    bool inserted = false;
+                    int group = target.groups_.Insert(source.groups_.GetKey(g), source.groups_.GetKeyLength(g), 
+                        source.groups_.GetHash(g), inserted);
+                    if (inserted)
+                    {
+                        target.values_.resize(target.values_.size() + aggregates, empty);
+                    }
+
+                    // only this thread touches the groups of its part
+                    group_map_[t][g] = group;
+
+                    for (int a = 0; a < aggregates; a++)
+                    {
+                        const Accumulator& value = source.values_[g * aggregates + a];
+                        if (aggregates_[a].distinct_)
+                        {
+                            continue;
+                        }
+
+                        if (aggregates_[a].function_ == COUNT)
+                        {
+                            target.values_[group * aggregates + a].count_ += value.count_;
+                        }
+                        else if (value.has_value_)
+                        {
+                            // the double of an integral accumulator is not kept up to date
+                            Update(target.values_[group * aggregates + a], aggregates_[a], value.integral_, value.integer_, 
+                                value.integral_ ? (double)value.integer_ : value.double_, value.count_);
+                        }
+                    }
+                }
+            }
+
+            // the distinct values are added again, the same value may be met by several tables
+            for (size_t t = 0; t < tables_.size(); t++)
+            {
+                Table& source = *(tables_[t]);
+                for (int d = 0; d < source.distincts_.GetCount(); d++)
+                {
+                    const char* key = source.distincts_.GetKey(d);
+                    int group = 0;
+                    int aggregate = 0;
+                    memcpy(&group, key, sizeof(group));
+                    memcpy(&aggregate, key + sizeof(group), sizeof(aggregate));
+
+                    if (GetPart(source.groups_.GetHash(group)) != part)
+                    {
+                        continue;
+                    }
+
+                    group = group_map_[t][group];
+                    size_t header = sizeof(group) + sizeof(aggregate);
+
+                    target.key_.assign((const char*)&group, sizeof(group));
+                    target.key_.append((const char*)&aggregate, sizeof(aggregate));
+                    target.key_.append(key + header, source.distincts_.GetKeyLength(d) - header);
+
+                    bool inserted = false;
+                    target.distincts_.Insert(target.key_.data(), target.key_.size(), 
+                        HashKeyTable::Hash(target.key_.data(), target.key_.size()), inserted);
+                    if (!inserted)
+                    {
+                        continue;
+                    }
+
+                    Accumulator& accumulator = target.values_[group * aggregates + aggregate];
+                    if (aggregates_[aggregate].function_ == COUNT)
+                    {
+                        accumulator.count_++;
+                        continue;
+                    }
+
+                    // the value is kept in text, ended by the key
+                    string text(key + header, source.distincts_.GetKeyLength(d) - header);
+                    bool integral = true;
+                    long long integer = 0;
+                    double value = 0.0;
+                    ParseNumber(text.c_str(), text.size(), integral, integer, value);
+
+                    Update(accumulator, aggregates_[aggregate], integral, integer, value, 1);
+                }
+            }
+        }
+
+        void HashAggregator::MergeTables()
+        {
+            if (tables_.size() <= 1)
+            {
+                return;
+            }
+
+            int groups = 0;
+            group_map_.resize(tables_.size());
+            for (size_t t = 0; t < tables_.size(); t++)
+            {
+                groups += tables_[t]->groups_.GetCount();
+                group_map_[t].assign(tables_[t]->groups_.GetCount(), -1);
+            }
+
+            int parts = groups / MERGE_GROUPS_PER_THREAD + 1;
+            parts = (parts < threads_) ? parts : threads_;
+
+            for (int i = 0; i < parts; i++)
+            {
+                merged_.push_back(new Table());
+            }
+
+            RunThreads(parts, 0, RunMergePart);
+
+            Clear();
+            tables_.swap(merged_);
+            group_map_.clear();
+        }
+
+        void HashAggregator::RunThreads(int count, int first, void* (*work)(void*))
+        {
+            vector<Work> works(count);
+            for (int i = 0; i < count; i++)
+            {
+                works[i].aggregator_ = this;
+                works[i].index_ = first + i;
+            }
+
+            if (count == 1)
+            {
+                work(&(works[0]));
+                return;
+            }
+
+            vector<tr1::shared_ptr<THREAD::Thread> > threads;
+            for (int i = 0; i < count; i++)
+            {
+                threads.push_back(tr1::shared_ptr<THREAD::Thread>(new THREAD::Thread(work, &(works[i]))));
+                threads.back()->Start();
+            }
+
+            for (int i = 0; i < count; i++)
+            {
+                threads[i]->Join();
+            }
+        }
+
+        int HashAggregator::GetPart(unsigned int hash) const
+        {
+            // the high bits, since the low ones place the groups in the tables
+            return (int)(((unsigned long long)hash * merged_.size()) >> 32);
+        }
+    }
+}
@@ -0,0 +1,377 @@
+#include <cstring>
+
+#include "dbcomm/HashJoin.h"
+#include "dbcomm/RowRecord.h"
+
+namespace COMMON
+{
+    namespace DBCOMM
+    {
+        HashJoin::HashJoin(size_t memoryLimit, const string& spillDirectory)
+            : memory_limit_(memoryLimit), bytes_(0), build_columns_(0), probe_columns_(0),
+              build_names_(false), probe_names_(false), phase_(PHASE_BUILD), probe_rslt_(0),
+              probe_row_(-1), spilled_part_(-1), match_part_(-1), match_(-1), location_(0)
+        {
+            for (int i = 0; i < PARTS; i++)
+            {
+                parts_.push_back(new Part(spillDirectory));
+            }
+        }
+
+        HashJoin::~HashJoin()
+        {
+            for (size_t i = 0; i < parts_.size(); i++)
+            {
+                delete parts_[i];
+            }
+        }
+
+        void HashJoin::AddKey(int buildColumn, int probeColumn)
+        {
+            build_keys_.push_back(buildColumn);
+            probe_keys_.push_back(probeColumn);
+        }
+
+        void HashJoin::Build(RowBlock& block) throw (COMMON::EXCEPTION::ThrowableException)
+        {
+            int rows = block.GetRowCount();
+            if (rows == 0)
+            {
+                return;
+            }
+
+            build_columns_ = block.GetColumnCount();
+            if (!build_names_ && block.GetColumnIndex() != 0)
+            {
+                AddColumnNames(block.GetColumnIndex(), 0);
+                build_names_ = true;
+            }
+
+            for (int r = 0; r < rows; r++)
+            {
+                if (!FormKey(block, r, build_keys_))
+                {
+                    continue;
+                }
+
+                RowRecord::Encode(block, r, key_, record_);
+                Part& part = *(parts_[GetPart(HashKeyTable::Hash(key_.data(), key_.size()))]);
+
+                if (part.spilled_)
+                {
+                    part.build_file_.Write(record_.data(), record_.size());
+                    continue;
+                }
+
+                part.rows_.push_back(part.arena_.Copy(record_.data(), record_.size()));
+                part.bytes_ += record_.size();
+                bytes_ += record_.size();
+
+                if (memory_limit_ > 0 && bytes_ > memory_limit_)
+                {
+                    SpillLargest();
+                }
+            }
+        }
+
+        long long HashJoin::Build(DbQueryRslt* rslt, bool& success) throw (COMMON::EXCEPTION::ThrowableException)
+        {
+            long long rows = 0;
+            RowBlock block;
+            int count = 0;
+
+            while ((count = rslt->FetchBlock(block, success)) > 0)
+            {
+                Build(block);
+                rows += count;
+            }
+
+            return rows;
+        }
+
+        void HashJoin::Probe(DbQueryRslt* rslt)
+        {
+            probe_rslt_ = rslt;
+            phase_ = PHASE_PROBE;
+
+            for (size_t i = 0; i < parts_.size(); i++)
+            {
+                if (!parts_[i]->spilled_)
+                {
+                    Index(*(parts_[i]));
+                }
+            }
+        }
+
+        Row HashJoin::Fetch(bool& success) throw (COMMON::EXCEPTION::ThrowableException)
+        {
+            success = true;
+
+            while (match_ < 0)
+            {
+                if (!NextProbe(success))
+                {
+                    return Row();
+                }
+            }
+
+            // the probe columns are formed by NextProbe()
+            Part& part = *(parts_[match_part_]);
+            RowRecord::Decode(part.rows_[match_], build_columns_, &(values_[0]), &(lengths_[0]));
+            match_ = part.next_[match_];
+
+            return Row(&(values_[0]), &column_index_);
+        }
+
+        unsigned long* HashJoin::GetCurrentRowColumnsLength()
+        {
+            return lengths_.empty() ? 0 : &(lengths_[0]);
+        }
+
+        const DbLocation* HashJoin::GetCurrentLocation()
+        {
+            return location_;
+        }
+
+        int HashJoin::GetSpilledPartCount() const
+        {
+            int count = 0;
+            for (size_t i = 0; i < parts_.size(); i++)
+            {
+                count += parts_[i]->spilled_ ? 1 : 0;
+            }
+
+            return count;
+        }
+
+        bool HashJoin::FormKey(RowBlock& block, int row, const vector<int>& columns)
+        {
+            key_.clear();
+            for (size_t k = 0; k < columns.size(); k++)
+            {
+                int column = columns[k];
+                if (block.IsNull(row, column))
+                {
+                    return false;
+                }
+
+                unsigned int length = (unsigned int)block.GetLength(row, column);
+                key_.append((const char*)&length, sizeof(length));
+                key_.append(block.GetValue(row, column), length);
+            }
+
+            return true;
+        }
+
+        void HashJoin::SpillLargest() throw (COMMON::EXCEPTION::ThrowableException)
+        {
+            Part* largest = 0;
+            for (size_t i = 0; i < parts_.size(); i++)
+            {
+                if (!parts_[i]->spilled_ && (largest == 0 || parts_[i]->bytes_ > largest->bytes_))
+                {
+                    largest = parts_[i];
+                }
+            }
+
+            if (largest == 0)
+            {
+                return;
+            }
+
+            for (size_t i = 0; i < largest->rows_.size(); i++)
+            {
+                largest->build_file_.Write(largest->rows_[i], RowRecord::GetSize(largest->rows_[i]));
+            }
+
+            bytes_ -= largest->bytes_;
+            largest->bytes_ = 0;
+            largest->rows_.clear();
+            largest->arena_.Clear();
+            largest->spilled_ = true;
+        }
+
+        void HashJoin::Index(Part& part)
+        {
+            part.keys_.Clear();
+            part.first_.clear();
+            part.next_.assign(part.rows_.size(), -1);
+
+            // the rows are chained backwards, so those of a key are joined in the order they are added
+            for (int i = (int)part.rows_.size() - 1; i >= 0; i--)
+            {
+                size_t length = 0;
+                const char* data = RowRecord::GetKey(part.rows_[i], length);
+
+                bool inserted = false;
+                int key = part.keys_.Insert(data, length, HashKeyTable::Hash(data, length), inserted);
+                if (inserted)
+                {
+                    part.first_.push_back(-1);
+                }
+
+                part.next_[i] = part.first_[key];
+                part.first_[key] = i;
+            }
+        }
+
+        void HashJoin::Load(Part& part) throw (COMMON::EXCEPTION::ThrowableException)
+        {
+            part.build_file_.Rewind();
+            part.probe_file_.Rewind();
+
+            string buffer;
+            while (ReadRecord(part.build_file_, buffer))
+            {
+                part.rows_.push_back(part.arena_.Copy(buffer.data(), buffer.size()));
+            }
+
+            Index(part);
+        }
+
+        bool HashJoin::ReadRecord(SpillFile& file, string& buffer) throw (COMMON::EXCEPTION::ThrowableException)
+        {
+            unsigned int size = 0;
+            if (!file.Read((char*)&size, sizeof(size)))
+            {
+                return false;
+            }
+
+            buffer.resize(size + sizeof(size));
+            memcpy(&(buffer[0]), &size, sizeof(size));
+
+            return file.Read(&(buffer[sizeof(size)]), size);
+        }
+
+        bool HashJoin::NextProbe(bool& success) throw (COMMON::EXCEPTION::ThrowableException)
+        {
+            while (phase_ == PHASE_PROBE)
+            {
+                probe_row_++;
+                if (probe_row_ >= block_.GetRowCount())
+                {
+                    probe_row_ = -1;
+                    if (probe_rslt_->FetchBlock(block_, success) == 0)
+                    {
+                        if (!success)
+                        {
+                            return false;
+                        }
+
+                        phase_ = PHASE_SPILLED;
+                        break;
+                    }
+
+                    probe_columns_ = block_.GetColumnCount();
+                    values_.resize(build_columns_ + probe_columns_);
+                    lengths_.resize(build_columns_ + probe_columns_);
+
+                    if (!probe_names_ && block_.GetColumnIndex() != 0)
+                    {
+                        AddColumnNames(block_.GetColumnIndex(), build_columns_);
+                        probe_names_ = true;
+                    }
+                    continue;
+                }
+
+                if (!FormKey(block_, probe_row_, probe_keys_))
+                {
+                    continue;
+                }
+
+                unsigned int hash = HashKeyTable::Hash(key_.data(), key_.size());
+                int index = GetPart(hash);
+                Part& part = *(parts_[index]);
+
+                // joined when the part is read back
+                if (part.spilled_)
+                {
+                    RowRecord::Encode(block_, probe_row_, key_, record_);
+                    part.probe_file_.Write(record_.data(), record_.size());
+                    continue;
+                }
+
+                int key = part.keys_.Find(key_.data(), key_.size(), hash);
+                if (key < 0)
+                {
+                    continue;
+                }
+
+                char** values = (char**)block_.GetRow(probe_row_);
+                unsigned long* lengths = block_.GetLengths(probe_row_);
+                for (int c = 0; c < probe_columns_; c++)
+                {
+                    values_[build_columns_ + c] = values[c];
+                    lengths_[build_columns_ + c] = lengths[c];
+                }
+
+                location_ = block_.GetLocation();
+                match_part_ = index;
+                match_ = part.first_[key];
+                return true;
+            }
+
+            while (phase_ == PHASE_SPILLED)
+            {
+                if (spilled_part_ >= 0 && ReadRecord(parts_[spilled_part_]->probe_file_, probe_record_))
+                {
+                    Part& part = *(parts_[spilled_part_]);
+                    const char* record = probe_record_.data();
+
+                    size_t length = 0;
+                    const char* data = RowRecord::GetKey(record, length);
+
+                    int key = part.keys_.Find(data, length, HashKeyTable::Hash(data, length));
+                    if (key < 0)
+                    {
+                        continue;
+                    }
+
+                    RowRecord::Decode(record, probe_columns_, &(values_[build_columns_]), &(lengths_[build_columns_]));
+                    location_ = RowRecord::GetLocation(record);
+                    match_part_ = spilled_part_;
+                    match_ = part.first_[key];
+                    return true;
+                }
+
+                // the part joined is not needed any more
+                if (spilled_part_ >= 0)
+                {
+                    Part& part = *(parts_[spilled_part_]);
+                    part.rows_.clear();
+                    part.arena_.Clear();
+                    part.keys_.Clear();
+                }
+
+                do
+                {
+                    spilled_part_++;
+                } while (spilled_part_ < (int)parts_.size() && !parts_[spilled_part_]->spilled_);
+
+                if (spilled_part_ >= (int)parts_.size())
+                {
+                    phase_ = PHASE_DONE;
+                    break;
+                }
+
+                Load(*(parts_[spilled_part_]));
+            }
+
+            return false;
+        }
+
+        int HashJoin::GetPart(unsigned int hash) const
+        {
+            // the high bits, since the low ones place the keys in the tables
+            return (int)(((unsigned long long)hash * PARTS) >> 32);
+        }
+
+        void HashJoin::AddColumnNames(map<string, int>* names, int first)
+        {
+            for (map<string, int>::iterator it = names->begin(); it != names->end(); ++it)
+            {
+                column_index_.insert(make_pair(it->first, first + it->second));
+            }
+        }
+    }
+}
@@ -0,0 +1,137 @@
+#include <cstring>
+
+#include "dbcomm/HashKeyTable.h"
+
+namespace COMMON
+{
+    namespace DBCOMM
+    {
+        HashKeyTable::HashKeyTable(int capacity)
+        {
+            // the slots are at most half full
+            size_t slots = 16;
+            while (slots < (size_t)capacity * 2)
+            {
+                slots *= 2;
+            }
+
+            slots_.assign(slots, -1);
+            mask_ = slots - 1;
+        }
+
+        unsigned int HashKeyTable::Hash(const char* key, size_t length)
+        {
+            // FNV-1a, with the bits mixed at last, since both the low and the high bits are used
+            unsigned int hash = 2166136261u;
+            for (size_t i = 0; i < length; i++)
+            {
+                hash = (hash ^ (unsigned char)key[i]) * 16777619u;
+            }
+
+            hash ^= hash >> 16;
+            hash *= 0x85ebca6bu;
+            hash ^= hash >> 13;
+            hash *= 0xc2b2ae35u;
+            hash ^= hash >> 16;
+
+            return hash;
+        }
+
+        int HashKeyTable::Find(const char* key, size_t length, unsigned int hash) const
+        {
+            for (size_t slot = hash & mask_; ; slot = (slot + 1) & mask_)
+            {
+                int index = slots_[slot];
+                if (index < 0)
+                {
+                    return -1;
+                }
+
+                const Entry& entry = entries_[index];
+                if (entry.hash_ == hash && entry.length_ == length && memcmp(entry.key_, key, length) == 0)
+                {
+                    return index;
+                }
+            }
+        }
+
+        int HashKeyTable::Insert(const char* key, size_t length, unsigned int hash, bool& inserted)
+        {
+            size_t slot = hash & mask_;
+            for (; slots_[slot] >= 0; slot = (slot + 1) & mask_)
+            {
+                const Entry& entry = entries_[slots_[slot]];
+                if (entry.hash_ == hash && entry.length_ == length && memcmp(entry.key_, key, length) == 0)
+                {
+                    inserted = false;
+                    return slots_[slot];
+                }
+            }
+
+            Entry entry;
+            entry.key_ = arena_.Copy(key, length);
+            entry.length_ = length;
+            entry.hash_ = hash;
+
+            int index = (int)entries_.size();
+            entries_.push_back(entry);
+            slots_[slot] = index;
+            inserted = true;
+
+            if (entries_.size() * 2 > slots_.size())
+            {
+                Grow();
+            }
+
+            return index;
+        }
+
+        int HashKeyTable::GetCount() const
+        {
+            return (int)entries_.size();
+        }
+
+        const char* HashKeyTable::GetKey(int index) const
+        {
+            return entries_[index].key_;
+        }
+
+        size_t HashKeyTable::GetKeyLength(int index) const
+        {
+            return entries_[index].length_;
+        }
+
+        unsigned int HashKeyTable::GetHash(int index) const
+        {
+            return entries_[index].hash_;
+        }
+
+        size_t HashKeyTable::GetByteCount() const
+        {
+            return arena_.GetByteCount() + entries_.capacity() * sizeof(Entry) + slots_.capacity() * sizeof(int);
+        }
+
+        void HashKeyTable::Clear()
+        {
+            arena_.Clear();
+            entries_.clear();
+            slots_.assign(slots_.size(), -1);
+        }
+
+        void HashKeyTable::Grow()
+        {
+            slots_.assign(slots_.size() * 2, -1);
+            mask_ = slots_.size() - 1;
+
+            for (int i = 0; i < (int)entries_.size(); i++)
+            {
+                size_t slot = entries_[i].hash_ & mask_;
+                while (slots_[slot] >= 0)
+                {
+                    slot = (slot + 1) & mask_;
+                }
+                slots_[slot] = i;
+            }
+        }
+    }
+}
@@ -0,0 +1,186 @@
+#include <algorithm>
+#include <cstring>
+
+#include "dbcomm/MergeCursor.h"
+#include "dbcomm/ValueParser.h"
+
+namespace COMMON
+{
+    namespace DBCOMM
+    {
+        // the number of a value, read without the locale, 0 if it is not a number
+        static double ToNumber(const char* text)
+        {
+            double value = 0.0;
+            if (!ValueParser::ParseDouble(text, strlen(text), value))
+            {
+                value = 0.0;
+            }
+            return value;
+        }
+
+        bool ColumnOrder::operator()(Row& left, Row& right) const
+        {
+            const char* a = descending_ ? right[column_] : left[column_];
+            const char* b = descending_ ? left[column_] : right[column_];
+
+            if (a == 0 || b == 0)
+            {
+                return a == 0 && b != 0;
+            }
+
+            if (numeric_)
+            {
+                return ToNumber(a) < ToNumber(b);
+            }
+
+            return strcmp(a, b) < 0;
+        }
+
+        bool MergeCursor::ShardOrder::operator()(int left, int right) const
+        {
+            // the heap keeps the largest one on the top, so the order is reversed
+            return cursor_->less_(cursor_->shards_[right].current_, cursor_->shards_[left].current_);
+        }
+
+        MergeCursor::MergeCursor(DbQueryRslt* rslt, RowComparator less, long long limit, int blockRows)
+            : rslt_(rslt), less_(less), limit_(limit), given_(0), last_(-1), started_(false), closed_(false)
+        {
+            // no more rows than the limit are fetched from a connection
+            if (limit_ > 0 && limit_ < blockRows)
+            {
+                blockRows = (int)limit_;
+            }
+
+            shards_.resize(rslt_->db_locations_.size());
+            for (size_t i = 0; i < shards_.size(); i++)
+            {
+                shards_[i].location_ = &(rslt_->db_locations_[i]);
+                shards_[i].block_.SetCapacity(blockRows);
+                shards_[i].row_ = -1;
+                shards_[i].done_ = false;
+            }
+
+            heap_.reserve(shards_.size());
+        }
+
+        Row MergeCursor::Fetch(bool& success) throw (COMMON::EXCEPTION::ThrowableException)
+        {
+            success = true;
+
+            if (closed_)
+            {
+                last_ = -1;
+                return Row();
+            }
+
+            if (!started_)
+            {
+                // the first row of each connection
+                started_ = true;
+                for (int i = 0; i < (int)shards_.size(); i++)
+                {
+                    if (Advance(i, success))
+                    {
+                        heap_.push_back(i);
+                    }
+                    else if (!success)
+                    {
+                        return Row();
+                    }
+                }
+
+                make_heap(heap_.begin(), heap_.end(), ShardOrder(this));
+            }
+            else if (last_ >= 0)
+            {
+                // the connection of the last row goes on, the row is valid until now
+                int shard = last_;
+                last_ = -1;
+
+                if (Advance(shard, success))
+                {
+                    heap_.push_back(shard);
+                    push_heap(heap_.begin(), heap_.end(), ShardOrder(this));
+                }
+                else if (!success)
+                {
+                    return Row();
+                }
+            }
+
+            if (heap_.empty())
+            {
+                return Row();
+            }
+
+            pop_heap(heap_.begin(), heap_.end(), ShardOrder(this));
+            last_ = heap_.back();
+            heap_.pop_back();
+            given_++;
+
+            // the rows left are not needed, the row given stays in its block
+            if (limit_ > 0 && given_ >= limit_)
+            {
+                Close(success);
+            }
+
+            return shards_[last_].current_;
+        }
+
+        unsigned long* MergeCursor::GetCurrentRowColumnsLength()
+        {
+            if (last_ < 0)
+            {
+                return 0;
+            }
+
+            return shards_[last_].block_.GetLengths(shards_[last_].row_);
+        }
+
+        const DbLocation* MergeCursor::GetCurrentLocation()
+        {
+            return (last_ < 0) ? 0 : shards_[last_].location_;
+        }
+
+        void MergeCursor::Close(bool& success) throw (COMMON::EXCEPTION::ThrowableException)
+        {
+            success = true;
+            closed_ = true;
+            heap_.clear();
+
+            for (size_t i = 0; i < shards_.size() && success; i++)
+            {
+                if (!shards_[i].done_)
+                {
+                    shards_[i].done_ = true;
+                    rslt_->Close(shards_[i].location_, success);
+                }
+            }
+        }
+
+        bool MergeCursor::Advance(int shard, bool& success)
+        {
+            Shard& s = shards_[shard];
+            if (s.done_)
+            {
+                return false;
+            }
+
+            s.row_++;
+            if (s.row_ >= s.block_.GetRowCount())
+            {
+                if (rslt_->FetchBlock(s.location_, s.block_, success) == 0)
+                {
+                    s.done_ = true;
+                    return false;
+                }
+
+                s.row_ = 0;
+            }
+
+            s.current_ = s.block_.GetRow(s.row_);
+            return true;
+        }
+    }
+}
@@ -98,9 +98,44 @@ namespace COMMON
             return (DbQueryAction*)current_work_.get();
         }
 
+        DbExecuteAction* MysqlDbTasks::PreparedExecute( int commitLimit /*= 5000*/ )
+        {
+            if (false == CanStartAction())
+            {
+                return 0;
+            }
+
+            current_work_.reset();
+
+            current_work_ = tr1::shared_ptr<DbPreparedExecuteAction>(
+                            new DbPreparedExecuteAction(
+                                shared_from_this(), 
+                                db_engine_, 
+                                is_action_finished_, 
+                                commitLimit));
+            return (DbExecuteAction*)current_work_.get();
+        }
+        
+        DbQueryAction* MysqlDbTasks::PreparedSelect()
+        {
+            if (false == CanStartAction())
+            {
+                return 0;
+            }
+
+            current_work_.reset();
+
+            current_work_ = tr1::shared_ptr<DbPreparedQueryAction>(
+                            new DbPreparedQueryAction(
+                                shared_from_this(), 
+                                db_engine_, 
+                                is_action_finished_));
+            return (DbQueryAction*)current_work_.get();
+        }
+
         bool MysqlDbTasks::InitEngine()
         {
-            db_engine_ = tr1::shared_ptr<MysqlEngine>(new MysqlEngine(db_locations_, shared_from_this()));
+            db_engine_ = tr1::shared_ptr<MysqlEngine>(new MysqlEngine(db_locations_, shared_from_this(), connections_per_location_));
             db_engine_->InitEngine();
             
             return true;
@@ -1,5 +1,8 @@
 #ifdef MYSQL_ENV_AVAILABLE
 
+#include <string.h>
+#include <sstream>
+
 #include "dbcomm/CommDef.h"
 #include "dbcomm/MysqlEngine.h"
 #include "dbcomm/DbActionFilter.h"
@@ -15,12 +18,18 @@ namespace COMMON
 {
     namespace DBCOMM
     {
+        // the number of prepared statements kept by each connection
+        static const int STATEMENT_CACHE_SIZE = 64;
+        
+        // the first size of the buffer for a column of a prepared statement, it grows for longer values
+        static const unsigned long INITIAL_COLUMN_BUFFER_SIZE = 256;
+        
         /////////////////////////////
         // MysqlEngine
         /////////////////////////////
         
-        MysqlEngine::MysqlEngine(vector<DbLocation>& locations, tr1::shared_ptr<IDbTasks> task)
-            : DbEngine(locations, task)
+        MysqlEngine::MysqlEngine(vector<DbLocation>& locations, tr1::shared_ptr<IDbTasks> task, int connectionsPerLocation)
+            : DbEngine(locations, task, connectionsPerLocation)
         {
         }
         
@@ -28,14 +37,9 @@ namespace COMMON
         {
         }
         
-        tr1::shared_ptr<DbEngine::RealHandle> MysqlEngine::GetRealHandle(DbLocation& location)
+        tr1::shared_ptr<DbEngine::RealHandle> MysqlEngine::CreateRealHandle(DbLocation& location)
         {
-            if (handles_.find(location) == handles_.end())
-            {
-                handles_[location].reset(new MysqlRealHandle());
-            }
-            
-            return handles_[location];
+            return tr1::shared_ptr<DbEngine::RealHandle>(new MysqlRealHandle());
         }
         
         bool MysqlEngine::Connect(void* handle, DbLocation* location, tr1::shared_ptr<COMMON::EXCEPTION::IException>& exception) throw ()
@@ -69,6 +73,7 @@ namespace COMMON
         bool MysqlEngine::Disconnect(void* handle, DbLocation* location, tr1::shared_ptr<COMMON::EXCEPTION::IException>& exception) throw ()
         {
             // no exception will be thrown from mysql_close()
+            ((MysqlRealHandle*)handle)->CloseStatements();
             mysql_close(&(((MysqlRealHandle*)handle)->mysql));
             
             return true;
@@ -127,6 +132,11 @@ namespace COMMON
         
         char** MysqlEngine::Fetch(void* handle, DbLocation* location, tr1::shared_ptr<COMMON::EXCEPTION::IException>& exception) throw ()
         {
+            if (((MysqlRealHandle*)handle)->stmt != 0)
+            {
+                return FetchStatement((MysqlRealHandle*)handle, location, exception);
+            }
+            
             int sqlCode = 0;
         
             char ** rsltRow = 0;
@@ -150,8 +160,28 @@ namespace COMMON
             return rsltRow;
         }
         
+        int MysqlEngine::GetColumnCount(void* handle, DbLocation* location, tr1::shared_ptr<COMMON::EXCEPTION::IException>& exception) throw ()
+        {
+            if (((MysqlRealHandle*)handle)->stmt != 0)
+            {
+                return ((MysqlRealHandle*)handle)->result_binds.size();
+            }
+            
+            if (((MysqlRealHandle*)handle)->res == 0)
+            {
+                return 0;
+            }
+            
+            return mysql_num_fields(((MysqlRealHandle*)handle)->res);
+        }
+        
         unsigned long* MysqlEngine::GetColumnsActureLength( void* handle, DbLocation* location, tr1::shared_ptr<COMMON::EXCEPTION::IException>& exception) throw ()
         {
+            if (((MysqlRealHandle*)handle)->stmt != 0)
+            {
+                return &(((MysqlRealHandle*)handle)->result_lengths[0]);
+            }
+            
             int sqlCode = 0;
             unsigned long* rsltColumnLength = 0;
             
@@ -203,6 +233,14 @@ namespace COMMON
         bool MysqlEngine::CloseOpenRslt(void* handle, DbLocation* location, tr1::shared_ptr<COMMON::EXCEPTION::IException>& exception) throw ()
         {
             // no exception will be thrown out
+            if (((MysqlRealHandle*)handle)->stmt != 0)
+            {
+                // the statement is kept for the next time, the cursor, if any, is closed
+                mysql_stmt_free_result(((MysqlRealHandle*)handle)->stmt);
+                ((MysqlRealHandle*)handle)->stmt = 0;
+                return true;
+            }
+            
             mysql_free_result(((MysqlRealHandle*)handle)->res);
             ((MysqlRealHandle*)handle)->res = 0;
         
@@ -314,16 +352,392 @@ namespace COMMON
         char* MysqlEngine::EscapeString(
             void* handle,  DbLocation* location,  const char* src, long length, tr1::shared_ptr<COMMON::EXCEPTION::IException>& exception) throw ()
         {
+            // the escaped string is at most twice as long, with a '\0' at the end
+            string& escaped = ((MysqlRealHandle*)handle)->escaped_;
+            escaped.resize(length * 2 + 1);
+            
             // no exception will be thrown out
             unsigned long real_length = 
                 mysql_real_escape_string(
                     &(((MysqlRealHandle*)handle)->mysql), 
-                    ((MysqlRealHandle*)handle)->inner_buf_, 
+                    &escaped[0], 
                     src, 
                     length);
+            escaped.resize(real_length);
+        
+            return const_cast<char*>(escaped.c_str());
+        }
+        
+        StringEscaper MysqlEngine::CreateStringEscaper(void* handle, DbLocation* location) throw ()
+        {
+            const char* name = mysql_character_set_name(&(((MysqlRealHandle*)handle)->mysql));
+            return StringEscaper(StringEscaper::DIALECT_MYSQL, StringEscaper::CharsetFromName((name == 0) ? "" : name));
+        }
+        
+        long long MysqlEngine::PreparedExecute(void* handle, DbLocation* location, const PreparedFilter* filter, tr1::shared_ptr<COMMON::EXCEPTION::IException>& exception) throw ()
+        {
+            MysqlRealHandle* real_handle = (MysqlRealHandle*)handle;
+            const char* statement = filter->GetData();
+            size_t length = filter->GetLength();
+            
+            int sqlCode = 0;
+            string errorMsg;
+            long long affectRows = 0;
+            
+            MYSQL_STMT* stmt = GetStatement(real_handle, statement, length, sqlCode, errorMsg);
+            
+            // the same statement for all the rows, only the parameters are sent again
+            int rows = filter->GetRowCount();
+            for (int row = 0; stmt != 0 && row < rows; row++)
+            {
+                if (!BindParams(real_handle, stmt, filter, row, sqlCode, errorMsg))
+                {
+                    break;
+                }
+                
+                if (0 != mysql_stmt_execute(stmt))
+                {
+                    ExtractStmtErrMsg(stmt, sqlCode, errorMsg);
+                    
+                    // the statement may be broken, such as by a lost connection
+                    DropStatement(real_handle, stmt);
+                    break;
+                }
+                
+                affectRows += mysql_stmt_affected_rows(stmt);
+                
+                if (mysql_stmt_field_count(stmt) != 0)
+                {
+                    mysql_stmt_free_result(stmt);
+                }
+            }
+            
+            if (sqlCode != 0)
+            {
+                exception.reset(new COMMON::EXCEPTION::DB::DbCommonExecuteException(*location, errorMsg, sqlCode, statement, length));
+            }
+            
+            return affectRows;
+        }
+        
+        bool MysqlEngine::PreparedQuery(
+            void* handle, DbLocation* location, const PreparedFilter* filter, map<string, int>* colIndexMap, tr1::shared_ptr<COMMON::EXCEPTION::IException>& exception) throw ()
+        {
+            MysqlRealHandle* real_handle = (MysqlRealHandle*)handle;
+            const char* statement = filter->GetData();
+            size_t length = filter->GetLength();
+            
+            int sqlCode = 0;
+            string errorMsg;
+            
+            MYSQL_STMT* stmt = GetStatement(real_handle, statement, length, sqlCode, errorMsg);
+            if (stmt != 0 && BindParams(real_handle, stmt, filter, 0, sqlCode, errorMsg))
+            {
+                // a read-only cursor sends the rows in groups as they are fetched, the attributes 
+                // are set every time since the statement may be used with other ones before
+                unsigned long cursorType = (filter->GetPrefetchRows() != 0) ? CURSOR_TYPE_READ_ONLY : CURSOR_TYPE_NO_CURSOR;
+                unsigned long prefetchRows = (filter->GetPrefetchRows() != 0) ? filter->GetPrefetchRows() : 1;
+                mysql_stmt_attr_set(stmt, STMT_ATTR_CURSOR_TYPE, &cursorType);
+                mysql_stmt_attr_set(stmt, STMT_ATTR_PREFETCH_ROWS, &prefetchRows);
+                
+                if (0 != mysql_stmt_execute(stmt))
+                {
+                    ExtractStmtErrMsg(stmt, sqlCode, errorMsg);
+                    DropStatement(real_handle, stmt);
+                }
+            }
+            
+            if (sqlCode != 0)
+            {
+                exception.reset(new COMMON::EXCEPTION::DB::DbSelectExecuteException(*location, errorMsg, sqlCode, statement, length));
+                return false;
+            }
+            
+            // open the result set
+            if (!BindResult(real_handle, stmt, colIndexMap, sqlCode, errorMsg))
+            {
+                mysql_stmt_free_result(stmt);
+                exception.reset(new COMMON::EXCEPTION::DB::DbSelectOpenException(*location, errorMsg, sqlCode, statement, length));
+                return false;
+            }
+            
+            real_handle->stmt = stmt;
+            return true;
+        }
+        
+        MYSQL_STMT* MysqlEngine::GetStatement( MysqlRealHandle* handle, const char* statement, size_t length, int& sqlCode, string& errorMsg )
+        {
+            string sql(statement, length);
+            
+            map<string, CachedStatement>::iterator it = handle->stmts.find(sql);
+            if (it != handle->stmts.end())
+            {
+                it->second.last_use = ++(handle->stmt_uses);
+                return it->second.stmt;
+            }
+            
+            // make room by closing the least recently used one, but not the one with an open result set
+            if (handle->stmts.size() >= STATEMENT_CACHE_SIZE)
+            {
+                map<string, CachedStatement>::iterator oldest = handle->stmts.end();
+                for (it = handle->stmts.begin(); it != handle->stmts.end(); it++)
+                {
+                    if (it->second.stmt != handle->stmt 
+                        && (oldest == handle->stmts.end() || it->second.last_use < oldest->second.last_use))
+                    {
+                        oldest = it;
+                    }
+                }
+                
+                if (oldest != handle->stmts.end())
+                {
+                    mysql_stmt_close(oldest->second.stmt);
+                    handle->stmts.erase(oldest);
+                }
+            }
+            
+            MYSQL_STMT* stmt = mysql_stmt_init(&(handle->mysql));
+            if (stmt == 0)
+            {
+                sqlCode = mysql_errno(&(handle->mysql));
+                ExtractErrMsg(sqlCode, handle, errorMsg);
+                if (sqlCode == 0)
+                {
+                    errorMsg = "mysql_stmt_init() failed";
+                    sqlCode = -1;
+                }
+                return 0;
+            }
+            
+            if (0 != mysql_stmt_prepare(stmt, statement, length))
+            {
+                ExtractStmtErrMsg(stmt, sqlCode, errorMsg);
+                mysql_stmt_close(stmt);
+                return 0;
+            }
+            
+            CachedStatement& cached = handle->stmts[sql];
+            cached.stmt = stmt;
+            cached.last_use = ++(handle->stmt_uses);
+            
+            return stmt;
+        }
+        
+        void MysqlEngine::DropStatement( MysqlRealHandle* handle, MYSQL_STMT* stmt )
+        {
+            map<string, CachedStatement>::iterator it = handle->stmts.begin();
+            for (; it != handle->stmts.end(); it++)
+            {
+                if (it->second.stmt == stmt)
+                {
+                    mysql_stmt_close(stmt);
+                    handle->stmts.erase(it);
+                    return;
+                }
+            }
+        }
+        
+        bool MysqlEngine::BindParams( MysqlRealHandle* handle, MYSQL_STMT* stmt, const PreparedFilter* filter, int row, int& sqlCode, string& errorMsg )
+        {
+            int count = filter->GetParamCount(row);
+            if (count != mysql_stmt_param_count(stmt))
+            {
+                stringstream ss;
+                ss << "the statement has " << mysql_stmt_param_count(stmt) << " parameters, but " << count << " are bound in row " << row;
+                errorMsg = ss.str();
+                sqlCode = -1;
+                return false;
+            }
+            
+            if (count == 0)
+            {
+                return true;
+            }
+            
+            handle->param_binds.resize(count);
+            handle->param_lengths.resize(count);
+            memset(&(handle->param_binds[0]), 0, sizeof(MYSQL_BIND) * count);
+            
+            for (int i = 0; i < count; i++)
+            {
+                const PreparedFilter::Param& param = filter->GetParam(row, i);
+                MYSQL_BIND& bind = handle->param_binds[i];
+                
+                // the values stay in the filter until the command is finished
+                switch (param.type_)
+                {
+                case PreparedFilter::PARAM_NULL:
+                    bind.buffer_type = MYSQL_TYPE_NULL;
+                    break;
+                    
+                case PreparedFilter::PARAM_INTEGER:
+                    bind.buffer_type = MYSQL_TYPE_LONGLONG;
+                    bind.buffer = (void*)&(param.integer_);
+                    break;
+                    
+                case PreparedFilter::PARAM_DOUBLE:
+                    bind.buffer_type = MYSQL_TYPE_DOUBLE;
+                    bind.buffer = (void*)&(param.double_);
+                    break;
+                    
+                case PreparedFilter::PARAM_STRING:
+                    handle->param_lengths[i] = param.length_;
+                    bind.buffer_type = MYSQL_TYPE_BLOB;
+                    bind.buffer = (void*)filter->GetString(param);
+                    bind.buffer_length = param.length_;
+                    bind.length = &(handle->param_lengths[i]);
+                    break;
+                }
+            }
+            
+            if (0 != mysql_stmt_bind_param(stmt, &(handle->param_binds[0])))
+            {
+                ExtractStmtErrMsg(stmt, sqlCode, errorMsg);
+                return false;
+            }
+            
+            return true;
+        }
         
-            // a string ending with '\0' should be generated after the above call
-            return ((MysqlRealHandle*)handle)->inner_buf_;
+        bool MysqlEngine::BindResult( MysqlRealHandle* handle, MYSQL_STMT* stmt, map<string, int>* colIndexMap, int& sqlCode, string& errorMsg )
+        {
+            MYSQL_RES* metadata = mysql_stmt_result_metadata(stmt);
+            if (metadata == 0)
+            {
+                ExtractStmtErrMsg(stmt, sqlCode, errorMsg);
+                if (sqlCode == 0)
+                {
+                    errorMsg = "the statement does not give a result set";
+                    sqlCode = -1;
+                }
+                return false;
+            }
+            
+            int count = mysql_num_fields(metadata);
+            
+            handle->result_binds.resize(count);
+            handle->result_buffers.resize(count);
+            handle->result_lengths.resize(count);
+            handle->result_nulls.resize(count);
+            handle->result_errors.resize(count);
+            handle->result_row.resize(count);
+            memset(&(handle->result_binds[0]), 0, sizeof(MYSQL_BIND) * count);
+            
+            // find out the map for column name and its index, and get every column as a string
+            colIndexMap->clear();
+            MYSQL_FIELD* fields = mysql_fetch_fields(metadata);
+            for (int i = 0; i < count; i++)
+            {
+                string name(fields[i].name);
+                TOOL::StringHelper::ToLower(name);
+                TOOL::StringHelper::Trim(name, " \t");
+                (*colIndexMap)[name] = i;
+                
+                // the buffers are kept from the last time if they are big enough
+                unsigned long size = fields[i].length + 1;
+                if (size > INITIAL_COLUMN_BUFFER_SIZE)
+                {
+                    size = INITIAL_COLUMN_BUFFER_SIZE;
+                }
+                if (handle->result_buffers[i].size() < size)
+                {
+                    handle->result_buffers[i].resize(size);
+                }
+                
+                MYSQL_BIND& bind = handle->result_binds[i];
+                bind.buffer_type = MYSQL_TYPE_STRING;
+                bind.buffer = &(handle->result_buffers[i][0]);
+                bind.buffer_length = handle->result_buffers[i].size() - 1;
+                bind.length = &(handle->result_lengths[i]);
+                bind.is_null = &(handle->result_nulls[i]);
+                bind.error = &(handle->result_errors[i]);
+            }
+            
+            mysql_free_result(metadata);
+            
+            if (0 != mysql_stmt_bind_result(stmt, &(handle->result_binds[0])))
+            {
+                ExtractStmtErrMsg(stmt, sqlCode, errorMsg);
+                return false;
+            }
+            
+            return true;
+        }
+        
+        char** MysqlEngine::FetchStatement( MysqlRealHandle* handle, DbLocation* location, tr1::shared_ptr<COMMON::EXCEPTION::IException>& exception )
+        {
+            MYSQL_STMT* stmt = handle->stmt;
+            
+            int rslt = mysql_stmt_fetch(stmt);
+            if (rslt == MYSQL_NO_DATA)
+            {
+                // reach the end
+                return 0;
+            }
+            
+            if (rslt != 0 && rslt != MYSQL_DATA_TRUNCATED)
+            {
+                int sqlCode = 0;
+                string errorMsg;
+                ExtractStmtErrMsg(stmt, sqlCode, errorMsg);
+                exception.reset(new COMMON::EXCEPTION::DB::DbSelectFetchRowException(*location, errorMsg, sqlCode, 0, 0));
+                return 0;
+            }
+            
+            int count = handle->result_binds.size();
+            
+            if (rslt == MYSQL_DATA_TRUNCATED)
+            {
+                // grow the buffers of the long values, read them again, and keep the bigger 
+                // buffers for the next rows
+                for (int i = 0; i < count; i++)
+                {
+                    if (!handle->result_errors[i] || handle->result_nulls[i])
+                    {
+                        continue;
+                    }
+                    
+                    MYSQL_BIND& bind = handle->result_binds[i];
+                    handle->result_buffers[i].resize(handle->result_lengths[i] + 1);
+                    bind.buffer = &(handle->result_buffers[i][0]);
+                    bind.buffer_length = handle->result_lengths[i];
+                    
+                    if (0 != mysql_stmt_fetch_column(stmt, &bind, i, 0))
+                    {
+                        int sqlCode = 0;
+                        string errorMsg;
+                        ExtractStmtErrMsg(stmt, sqlCode, errorMsg);
+                        exception.reset(new COMMON::EXCEPTION::DB::DbSelectFetchRowException(*location, errorMsg, sqlCode, 0, 0));
+                        return 0;
+                    }
+                }
+                
+                mysql_stmt_bind_result(stmt, &(handle->result_binds[0]));
+            }
+            
+            for (int i = 0; i < count; i++)
+            {
+                if (handle->result_nulls[i])
+                {
+                    handle->result_row[i] = 0;
+                    handle->result_lengths[i] = 0;
+                }
+                else
+                {
+                    handle->result_buffers[i][handle->result_lengths[i]] = '\0';
+                    handle->result_row[i] = &(handle->result_buffers[i][0]);
+                }
+            }
+            
+            return &(handle->result_row[0]);
+        }
+        
+        string& MysqlEngine::ExtractStmtErrMsg( MYSQL_STMT* stmt, int& sqlCode, string& errorMsg )
+        {
+            sqlCode = mysql_stmt_errno(stmt);
+            errorMsg = mysql_stmt_error(stmt);
+            
+            return errorMsg;
         }
         
         void MysqlEngine::InitThread()
@@ -11,17 +11,15 @@ namespace COMMON
         /////////////////////////////////////////
         string MysqlReplaceStmtGen::FormStatement(const DbLocation& dbLocation)
         {
-            if (has_value_ == false)
-            {
-                return "";
-            }
-            
-            stringstream statement;
-            statement << "REPLACE INTO " << table_name_ << " (" << col_list_ << ") VALUES";
+            string statement;
+            FormStatement(dbLocation, statement);
 
-            statement << values_.str();
-
-            return statement.str();
+            return statement;
+        }
+        
+        void MysqlReplaceStmtGen::FormStatement(const DbLocation& dbLocation, string& statement)
+        {
+            FormValuesStatement("REPLACE INTO", statement);
         }
         
         /////////////////////////////////////////
@@ -29,23 +27,21 @@ namespace COMMON
         /////////////////////////////////////////
         string MysqlInsertIgnoreStmtGen::FormStatement(const DbLocation& dbLocation)
         {
-            if (has_value_ == false)
-            {
-                return "";
-            }
-            
-            stringstream statement;
-            statement << "INSERT IGNORE INTO " << table_name_ << " (" << col_list_ << ") VALUES";
+            string statement;
+            FormStatement(dbLocation, statement);
 
-            statement << values_.str();
-
-            return statement.str();
+            return statement;
+        }
+        
+        void MysqlInsertIgnoreStmtGen::FormStatement(const DbLocation& dbLocation, string& statement)
+        {
+            FormValuesStatement("INSERT IGNORE INTO", statement);
         }
         
         /////////////////////////////////////////
         // MysqlGetPriKeyStmtGen
         /////////////////////////////////////////
-        bool MysqlGetPriKeyStmtGen::MakeupStatement(vector<string>& columns, string tableName, string values, bool)
+        bool MysqlGetPriKeyStmtGen::MakeupStatement(vector<string>& columns, const string& tableName, const string& values, bool, unsigned long long)
         {
             table_name_ = tableName;
             
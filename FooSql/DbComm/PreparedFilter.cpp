@@ -0,0 +1,120 @@
+#include "dbcomm/PreparedFilter.h"
+
+namespace COMMON
+{
+    namespace DBCOMM
+    {
+        PreparedFilter::PreparedFilter(const string& statement)
+            : DbActionFilter(statement), prefetch_rows_(0)
+        {
+        }
+
+        void PreparedFilter::BindNull()
+        {
+            NewParam(PARAM_NULL);
+        }
+
+        void PreparedFilter::Bind(int value)
+        {
+            NewParam(PARAM_INTEGER).integer_ = value;
+        }
+
+        void PreparedFilter::Bind(long value)
+        {
+            NewParam(PARAM_INTEGER).integer_ = value;
+        }
+
+        void PreparedFilter::Bind(long long value)
+        {
+            NewParam(PARAM_INTEGER).integer_ = value;
+        }
+
+        void PreparedFilter::Bind(double value)
+        {
+            NewParam(PARAM_DOUBLE).double_ = value;
+        }
+
+        void PreparedFilter::Bind(const string& value)
+        {
+            Bind(value.size(), value.data());
+        }
+
+        void PreparedFilter::Bind(long length, const char* value)
+        {
+            Param& param = NewParam(PARAM_STRING);
+            param.offset_ = strings_.size();
+            param.length_ = length;
+
+            strings_.append(value, length);
+        }
+
+        void PreparedFilter::NextRow()
+        {
+            row_ends_.push_back(params_.size());
+        }
+
+        void PreparedFilter::ClearParams()
+        {
+            params_.clear();
+            row_ends_.clear();
+            strings_.clear();
+        }
+
+        int PreparedFilter::GetRowCount() const
+        {
+            // the row not ended yet counts, and so does the only row of a statement without parameters
+            int rows = (int)row_ends_.size();
+            if (params_.size() > RowBegin(rows) || rows == 0)
+            {
+                return rows + 1;
+            }
+
+            return rows;
+        }
+
+        int PreparedFilter::GetParamCount(int row) const
+        {
+            size_t end = ((size_t)row < row_ends_.size()) ? row_ends_[row] : params_.size();
+            return (int)(end - RowBegin(row));
+        }
+
+        const PreparedFilter::Param& PreparedFilter::GetParam(int row, int index) const
+        {
+            return params_[RowBegin(row) + index];
+        }
+
+        const char* PreparedFilter::GetString(const Param& param) const
+        {
+            return strings_.data() + param.offset_;
+        }
+
+        void PreparedFilter::SetPrefetchRows(unsigned long prefetchRows)
+        {
+            prefetch_rows_ = prefetchRows;
+        }
+
+        unsigned long PreparedFilter::GetPrefetchRows() const
+        {
+            return prefetch_rows_;
+        }
+
+        size_t PreparedFilter::RowBegin(int row) const
+        {
+            return (row == 0) ? 0 : row_ends_[row - 1];
+        }
+
+        PreparedFilter::Param& PreparedFilter::NewParam(ParamType type)
+        {
+            params_.push_back(Param());
+
+            Param& param = params_.back();
+            param.type_ = type;
+            param.integer_ = 0;
+            param.double_ = 0;
+            param.offset_ = 0;
+            param.length_ = 0;
+
+            return param;
+        }
+    }
+}
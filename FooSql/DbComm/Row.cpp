@@ -1,17 +1,26 @@
+#include <string.h>
+#include <limits.h>
 #include <sstream>
+
 #include "dbcomm/Row.h"
+#include "dbcomm/ValueParser.h"
 
 namespace COMMON
 {
     namespace DBCOMM
     {
         Row::Row(char** row, map<string, int>* column_index)
-                : row_(row), column_index_(column_index)
+                : row_(row), column_index_(column_index), lengths_(0)
+        {
+        }
+
+        Row::Row(char** row, map<string, int>* column_index, unsigned long* lengths)
+                : row_(row), column_index_(column_index), lengths_(lengths)
         {
         }
 
         Row::Row()
-            : row_(0), column_index_(0)
+            : row_(0), column_index_(0), lengths_(0)
         {
         }
         
@@ -29,6 +38,7 @@ namespace COMMON
 
             row_ = other.row_;
             column_index_ = other.column_index_;
+            lengths_ = other.lengths_;
             return *this;
         }
 
@@ -37,12 +47,10 @@ namespace COMMON
             return row_;
         }
 
-        const char* Row::operator [](string colName) const throw(ThrowableException)
+        const char* Row::operator [](const string& colName) const throw(ThrowableException)
         {
-            TOOL::StringHelper::ToLower(colName);
-            TOOL::StringHelper::Trim(colName, " \t");
-
-            if (column_index_->find(colName) == column_index_->end())
+            map<string, int>::const_iterator it = Find(colName);
+            if (it == column_index_->end())
             {
                 tr1::shared_ptr<IException> inner_e(
                     new ObjectNotExistingInContainerException(colName, string("valid items are as follows : ") + FormCandidates()));		
@@ -51,7 +59,7 @@ namespace COMMON
                 throw e;
             }
 
-            return row_[(*column_index_)[colName]];
+            return row_[it->second];
         }
 
         const char* Row::operator [](int index)
@@ -59,12 +67,10 @@ namespace COMMON
             return row_[index];
         }
         
-        int Row::GetIndexByColName(string colName) const throw(ThrowableException)
+        int Row::GetIndexByColName(const string& colName) const throw(ThrowableException)
         {
-            TOOL::StringHelper::ToLower(colName);
-            TOOL::StringHelper::Trim(colName, " \t");
-            
-            if (column_index_->find(colName) == column_index_->end())
+            map<string, int>::const_iterator it = Find(colName);
+            if (it == column_index_->end())
             {
                 tr1::shared_ptr<IException> inner_e(
                     new ObjectNotExistingInContainerException(colName, string("The valid items are ") + FormCandidates()));		
@@ -73,9 +79,73 @@ namespace COMMON
                 throw e;
             }
             
-            return (*column_index_)[colName];
+            return it->second;
         }      
 		
+        map<string, int>::const_iterator Row::Find(const string& colName) const
+        {
+            // the names are kept in lower case, so most names are found without a copy
+            map<string, int>::const_iterator it = column_index_->find(colName);
+            if (it != column_index_->end())
+            {
+                return it;
+            }
+
+            string name(colName);
+            TOOL::StringHelper::ToLower(name);
+            TOOL::StringHelper::Trim(name, " \t");
+
+            return column_index_->find(name);
+        }
+
+        const char* Row::GetString(const ColumnRef& column, unsigned long& length) const
+        {
+            int index = column.GetIndex();
+            const char* value = row_[index];
+            length = (value == 0) ? 0 : ((lengths_ != 0) ? lengths_[index] : strlen(value));
+            return value;
+        }
+
+        bool Row::GetInt32(const ColumnRef& column, int& value) const
+        {
+            long long integer = 0;
+            if (!GetInt64(column, integer) || integer < INT_MIN || integer > INT_MAX)
+            {
+                return false;
+            }
+
+            value = (int)integer;
+            return true;
+        }
+
+        bool Row::GetInt64(const ColumnRef& column, long long& value) const
+        {
+            unsigned long length = 0;
+            const char* text = GetString(column, length);
+            return text != 0 && ValueParser::ParseInteger(text, length, value);
+        }
+
+        bool Row::GetUInt64(const ColumnRef& column, unsigned long long& value) const
+        {
+            unsigned long length = 0;
+            const char* text = GetString(column, length);
+            return text != 0 && ValueParser::ParseUnsigned(text, length, value);
+        }
+
+        bool Row::GetDouble(const ColumnRef& column, double& value) const
+        {
+            unsigned long length = 0;
+            const char* text = GetString(column, length);
+            return text != 0 && ValueParser::ParseDouble(text, length, value);
+        }
+
+        bool Row::GetBool(const ColumnRef& column, bool& value) const
+        {
+            unsigned long length = 0;
+            const char* text = GetString(column, length);
+            return text != 0 && ValueParser::ParseBool(text, length, value);
+        }
+
         string Row::FormCandidates() const
         {
             stringstream ss;
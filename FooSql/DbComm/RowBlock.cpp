@@ -0,0 +1,322 @@
+#include <algorithm>
+
+#include "dbcomm/RowBlock.h"
+#include "dbcomm/ValueFormatter.h"
+#include "dbcomm/ValueParser.h"
+
+namespace COMMON
+{
+    namespace DBCOMM
+    {
+        RowBlock::RowBlock(int capacity)
+            : capacity_(1), native_numbers_(false), column_count_(0), column_index_(0), location_(0), materialized_(0)
+        {
+            SetCapacity(capacity);
+        }
+
+        void RowBlock::SetCapacity(int capacity)
+        {
+            capacity_ = (capacity < 1) ? 1 : capacity;
+        }
+
+        int RowBlock::GetCapacity() const
+        {
+            return capacity_;
+        }
+
+        void RowBlock::SetNativeNumbers(bool nativeNumbers)
+        {
+            native_numbers_ = nativeNumbers;
+        }
+
+        bool RowBlock::IsNativeNumbers() const
+        {
+            return native_numbers_;
+        }
+
+        int RowBlock::GetRowCount() const
+        {
+            return (column_count_ == 0) ? 0 : (int)(nulls_.size() / column_count_);
+        }
+
+        int RowBlock::GetColumnCount() const
+        {
+            return column_count_;
+        }
+
+        RowBlock::ColumnType RowBlock::GetColumnType(int column) const
+        {
+            return column_types_[column];
+        }
+
+        Row RowBlock::GetRow(int row)
+        {
+            Materialize();
+            return Row(&(pointers_[row * column_count_]), column_index_, &(lengths_[row * column_count_]));
+        }
+
+        unsigned long* RowBlock::GetLengths(int row)
+        {
+            Materialize();
+            return &(lengths_[row * column_count_]);
+        }
+
+        bool RowBlock::IsNull(int row, int column) const
+        {
+            return nulls_[row * column_count_ + column] != 0;
+        }
+
+        const char* RowBlock::GetValue(int row, int column)
+        {
+            Materialize();
+            return pointers_[row * column_count_ + column];
+        }
+
+        unsigned long RowBlock::GetLength(int row, int column)
+        {
+            Materialize();
+            return lengths_[row * column_count_ + column];
+        }
+
+        long long RowBlock::GetInteger(int row, int column) const
+        {
+            return numbers_[row * column_count_ + column].integer_;
+        }
+
+        double RowBlock::GetDouble(int row, int column) const
+        {
+            return numbers_[row * column_count_ + column].double_;
+        }
+
+        int RowBlock::ParseIntegers(int column, long long* values) const
+        {
+            int rows = GetRowCount();
+            int failed = 0;
+            ColumnType type = column_types_[column];
+            const char* base = data_.data();
+            for (int row = 0, i = column; row < rows; row++, i += column_count_)
+            {
+                long long value = 0;
+                bool ok = (nulls_[i] == 0);
+                if (ok && type == COLUMN_TEXT)
+                {
+                    ok = ValueParser::ParseInteger(base + offsets_[i], lengths_[i], value);
+                }
+                else if (ok)
+                {
+                    value = (type == COLUMN_INTEGER) ? numbers_[i].integer_ : (long long)numbers_[i].double_;
+                }
+
+                values[row] = ok ? value : 0;
+                failed += ok ? 0 : 1;
+            }
+            return failed;
+        }
+
+        int RowBlock::ParseDoubles(int column, double* values) const
+        {
+            int rows = GetRowCount();
+            int failed = 0;
+            ColumnType type = column_types_[column];
+            const char* base = data_.data();
+            for (int row = 0, i = column; row < rows; row++, i += column_count_)
+            {
+                double value = 0.0;
+                bool ok = (nulls_[i] == 0);
+                if (ok && type == COLUMN_TEXT)
+                {
+                    ok = ValueParser::ParseDouble(base + offsets_[i], lengths_[i], value);
+                }
+                else if (ok)
+                {
+                    value = (type == COLUMN_DOUBLE) ? numbers_[i].double_ : (double)numbers_[i].integer_;
+                }
+
+                values[row] = ok ? value : 0.0;
+                failed += ok ? 0 : 1;
+            }
+            return failed;
+        }
+
+        map<string, int>* RowBlock::GetColumnIndex() const
+        {
+            return column_index_;
+        }
+
+        const DbLocation* RowBlock::GetLocation() const
+        {
+            return location_;
+        }
+
+        size_t RowBlock::GetByteCount() const
+        {
+            return data_.size();
+        }
+
+        void RowBlock::Swap(RowBlock& other)
+        {
+            std::swap(column_count_, other.column_count_);
+            std::swap(column_index_, other.column_index_);
+            std::swap(location_, other.location_);
+            std::swap(materialized_, other.materialized_);
+
+            column_types_.swap(other.column_types_);
+            data_.swap(other.data_);
+            offsets_.swap(other.offsets_);
+            lengths_.swap(other.lengths_);
+            nulls_.swap(other.nulls_);
+            numbers_.swap(other.numbers_);
+            pointers_.swap(other.pointers_);
+
+            // a short string may be kept inside the string object, which is not swapped with the object
+            UpdatePointers(pointers_.size());
+            other.UpdatePointers(other.pointers_.size());
+        }
+
+        void RowBlock::Reset(int columnCount)
+        {
+            column_count_ = columnCount;
+            column_types_.assign(columnCount, COLUMN_TEXT);
+
+            data_.clear();
+            offsets_.clear();
+            lengths_.clear();
+            nulls_.clear();
+            numbers_.clear();
+            pointers_.clear();
+            materialized_ = 0;
+        }
+
+        void RowBlock::SetColumnIndex(map<string, int>* columnIndex)
+        {
+            column_index_ = columnIndex;
+        }
+
+        void RowBlock::SetLocation(const DbLocation* location)
+        {
+            location_ = location;
+        }
+
+        void RowBlock::SetColumnType(int column, ColumnType type)
+        {
+            column_types_[column] = type;
+        }
+
+        void RowBlock::AppendValue(const char* value, unsigned long length)
+        {
+            Number number;
+            number.integer_ = 0;
+
+            offsets_.push_back(data_.size());
+            lengths_.push_back(length);
+            nulls_.push_back(0);
+            numbers_.push_back(number);
+
+            data_.append(value, length);
+            data_ += '\0';
+        }
+
+        void RowBlock::AppendNull()
+        {
+            Number number;
+            number.integer_ = 0;
+
+            offsets_.push_back(0);
+            lengths_.push_back(0);
+            nulls_.push_back(1);
+            numbers_.push_back(number);
+        }
+
+        void RowBlock::AppendInteger(long long value)
+        {
+            Number number;
+            number.integer_ = value;
+
+            // the text is formed when it is read
+            offsets_.push_back(0);
+            lengths_.push_back(0);
+            nulls_.push_back(0);
+            numbers_.push_back(number);
+        }
+
+        void RowBlock::AppendDouble(double value)
+        {
+            Number number;
+            number.double_ = value;
+
+            offsets_.push_back(0);
+            lengths_.push_back(0);
+            nulls_.push_back(0);
+            numbers_.push_back(number);
+        }
+
+        void RowBlock::AppendRow(char** values, unsigned long* lengths)
+        {
+            for (int i = 0; i < column_count_; i++)
+            {
+                if (values[i] == 0)
+                {
+                    AppendNull();
+                }
+                else
+                {
+                    AppendValue(values[i], lengths[i]);
+                }
+            }
+        }
+
+        void RowBlock::Materialize()
+        {
+            size_t count = nulls_.size();
+            if (materialized_ == count)
+            {
+                return;
+            }
+
+            // the text of the numbers goes after all the other values
+            bool has_numbers = false;
+            for (int column = 0; column < column_count_; column++)
+            {
+                has_numbers = has_numbers || (column_types_[column] != COLUMN_TEXT);
+            }
+
+            if (has_numbers)
+            {
+                for (size_t i = materialized_; i < count; i++)
+                {
+                    ColumnType type = column_types_[i % column_count_];
+                    if (type == COLUMN_TEXT || nulls_[i] != 0)
+                    {
+                        continue;
+                    }
+
+                    offsets_[i] = data_.size();
+                    if (type == COLUMN_INTEGER)
+                    {
+                        ValueFormatter::AppendInteger(data_, numbers_[i].integer_);
+                    }
+                    else
+                    {
+                        ValueFormatter::AppendDouble(data_, numbers_[i].double_);
+                    }
+                    lengths_[i] = data_.size() - offsets_[i];
+                    data_ += '\0';
+                }
+            }
+
+            // the pointers stay valid until more rows are added or the block is filled again
+            UpdatePointers(count);
+            materialized_ = count;
+        }
+
+        void RowBlock::UpdatePointers(size_t count)
+        {
+            pointers_.resize(count);
+            char* base = const_cast<char*>(data_.data());
+            for (size_t i = 0; i < count; i++)
+            {
+                pointers_[i] = (nulls_[i] != 0) ? 0 : base + offsets_[i];
+            }
+        }
+    }
+}
@@ -0,0 +1,90 @@
+#include <cstring>
+
+#include "dbcomm/RowRecord.h"
+
+namespace COMMON
+{
+    namespace DBCOMM
+    {
+        // the size and the length of the key before the key
+        static const size_t RECORD_HEADER = 8;
+
+        void RowRecord::Encode(RowBlock& block, int row, const string& key, string& record)
+        {
+            unsigned int size = 0;
+            unsigned int key_length = (unsigned int)key.size();
+            const DbLocation* location = block.GetLocation();
+
+            record.assign((const char*)&size, sizeof(size));
+            record.append((const char*)&key_length, sizeof(key_length));
+            record.append(key);
+            record.append((const char*)&location, sizeof(location));
+
+            int columns = block.GetColumnCount();
+            for (int c = 0; c < columns; c++)
+            {
+                int length = block.IsNull(row, c) ? -1 : (int)block.GetLength(row, c);
+                record.append((const char*)&length, sizeof(length));
+
+                if (length >= 0)
+                {
+                    record.append(block.GetValue(row, c), length);
+                    record += '\0';
+                }
+            }
+
+            size = (unsigned int)(record.size() - sizeof(size));
+            memcpy(&(record[0]), &size, sizeof(size));
+        }
+
+        size_t RowRecord::GetSize(const char* record)
+        {
+            unsigned int size = 0;
+            memcpy(&size, record, sizeof(size));
+            return size + sizeof(size);
+        }
+
+        const char* RowRecord::GetKey(const char* record, size_t& length)
+        {
+            unsigned int key_length = 0;
+            memcpy(&key_length, record + 4, sizeof(key_length));
+
+            length = key_length;
+            return record + RECORD_HEADER;
+        }
+
+        const DbLocation* RowRecord::GetLocation(const char* record)
+        {
+            size_t key_length = 0;
+            const char* key = GetKey(record, key_length);
+
+            const DbLocation* location = 0;
+            memcpy(&location, key + key_length, sizeof(location));
+            return location;
+        }
+
+        void RowRecord::Decode(const char* record, int count, char** values, unsigned long* lengths)
+        {
+            size_t key_length = 0;
+            const char* p = GetKey(record, key_length) + key_length + sizeof(const DbLocation*);
+
+            for (int c = 0; c < count; c++)
+            {
+                int length = 0;
+                memcpy(&length, p, sizeof(length));
+                p += sizeof(length);
+
+                if (length < 0)
+                {
+                    values[c] = 0;
+                    lengths[c] = 0;
+                    continue;
+                }
+
+                values[c] = const_cast<char*>(p);
+                lengths[c] = length;
+                p += length + 1;
+            }
+        }
+    }
+}
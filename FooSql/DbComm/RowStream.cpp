@@ -0,0 +1,225 @@
+#include "dbcomm/RowStream.h"
+
+#include "thread/MutexLockGuard.h"
+
+namespace COMMON
+{
+    namespace DBCOMM
+    {
+        RowStream::RowStream(int maxRows, size_t maxBytes)
+            : max_rows_((maxRows < 1) ? 1 : maxRows),
+              max_bytes_((maxBytes < 1) ? 1 : maxBytes),
+              kept_rows_(0),
+              kept_bytes_(0),
+              running_(0),
+              finished_(false),
+              cancelled_(false),
+              current_(0),
+              current_rows_(0),
+              current_bytes_(0),
+              current_row_(-1)
+        {
+            // several blocks are kept at once, so that the working thread goes on while a block is read
+            block_rows_ = (max_rows_ < RowBlock::DEFAULT_CAPACITY) ? max_rows_ : RowBlock::DEFAULT_CAPACITY;
+            block_bytes_ = (max_bytes_ / 4 < 1) ? 1 : max_bytes_ / 4;
+        }
+
+        RowStream::~RowStream()
+        {
+            for (size_t i = 0; i < blocks_.size(); i++)
+            {
+                delete blocks_[i];
+            }
+        }
+
+        char** RowStream::Fetch()
+        {
+            current_row_++;
+            while (current_ == 0 || current_row_ >= current_->GetRowCount())
+            {
+                if (!NextBlock())
+                {
+                    return 0;
+                }
+            }
+
+            return (char**)(current_->GetRow(current_row_));
+        }
+
+        unsigned long* RowStream::GetCurrentLengths()
+        {
+            if (current_ == 0 || current_row_ >= current_->GetRowCount())
+            {
+                return 0;
+            }
+
+            return current_->GetLengths(current_row_);
+        }
+
+        const DbLocation* RowStream::GetCurrentLocation()
+        {
+            if (current_ == 0 || current_row_ >= current_->GetRowCount())
+            {
+                return 0;
+            }
+
+            return current_->GetLocation();
+        }
+
+        int RowStream::FetchBlock(RowBlock& block)
+        {
+            if (!NextBlock())
+            {
+                block.Reset(0);
+                return 0;
+            }
+
+            // the old rows of the caller go back to the stream to be filled again
+            block.Swap(*current_);
+
+            THREAD::MutexLockGuard guard(mutex_);
+            ReleaseCurrent();
+
+            return block.GetRowCount();
+        }
+
+        void RowStream::Cancel()
+        {
+            THREAD::MutexLockGuard guard(mutex_);
+            cancelled_ = true;
+            not_full_.NotifyAll();
+        }
+
+        tr1::shared_ptr<EXCEPTION::IException> RowStream::GetException()
+        {
+            THREAD::MutexLockGuard guard(mutex_);
+            return exception_;
+        }
+
+        void RowStream::AddSource(const DbLocation* location, map<string, int>* columnIndex)
+        {
+            Source& source = sources_[*location];
+            source.location_ = location;
+            source.column_index_ = columnIndex;
+
+            running_++;
+        }
+
+        map<string, int>* RowStream::GetColumnIndex(const DbLocation& location)
+        {
+            Source* source = sources_.Find(location);
+            return (source == 0) ? 0 : source->column_index_;
+        }
+
+        RowBlock* RowStream::GetFreeBlock(const DbLocation& location)
+        {
+            THREAD::MutexLockGuard guard(mutex_);
+
+            // at least one block is kept, however large it is
+            while (!cancelled_ && kept_rows_ > 0 &&
+                (kept_rows_ + block_rows_ > max_rows_ || kept_bytes_ + block_bytes_ > max_bytes_))
+            {
+                not_full_.Wait(mutex_);
+            }
+
+            if (cancelled_)
+            {
+                return 0;
+            }
+
+            if (free_blocks_.empty())
+            {
+                blocks_.push_back(new RowBlock(block_rows_));
+                free_blocks_.push_back(blocks_.back());
+            }
+
+            RowBlock* block = free_blocks_.back();
+            free_blocks_.pop_back();
+
+            Source* source = sources_.Find(location);
+            block->SetLocation((source == 0) ? 0 : source->location_);
+
+            return block;
+        }
+
+        void RowStream::PushBlock(RowBlock* block)
+        {
+            THREAD::MutexLockGuard guard(mutex_);
+
+            if (block->GetRowCount() == 0 || cancelled_)
+            {
+                free_blocks_.push_back(block);
+                return;
+            }
+
+            kept_rows_ += block->GetRowCount();
+            kept_bytes_ += block->GetByteCount();
+            ready_blocks_.push_back(block);
+
+            not_empty_.Notify();
+        }
+
+        bool RowStream::IsBlockFull(const RowBlock* block) const
+        {
+            return block->GetRowCount() >= block_rows_ || block->GetByteCount() >= block_bytes_;
+        }
+
+        void RowStream::Finish(const tr1::shared_ptr<EXCEPTION::IException>& exception)
+        {
+            THREAD::MutexLockGuard guard(mutex_);
+
+            running_--;
+            finished_ = (running_ <= 0);
+
+            if (!exception_)
+            {
+                exception_ = exception;
+            }
+
+            not_empty_.NotifyAll();
+        }
+
+        bool RowStream::NextBlock()
+        {
+            THREAD::MutexLockGuard guard(mutex_);
+
+            ReleaseCurrent();
+
+            while (ready_blocks_.empty() && !finished_)
+            {
+                not_empty_.Wait(mutex_);
+            }
+
+            // the rows read before an error are still given
+            if (ready_blocks_.empty())
+            {
+                return false;
+            }
+
+            current_ = ready_blocks_.front();
+            ready_blocks_.pop_front();
+
+            current_rows_ = current_->GetRowCount();
+            current_bytes_ = current_->GetByteCount();
+            current_row_ = 0;
+
+            return true;
+        }
+
+        void RowStream::ReleaseCurrent()
+        {
+            if (current_ == 0)
+            {
+                return;
+            }
+
+            kept_rows_ -= current_rows_;
+            kept_bytes_ -= current_bytes_;
+            free_blocks_.push_back(current_);
+            current_ = 0;
+
+            // several connections may be waiting
+            not_full_.NotifyAll();
+        }
+    }
+}
@@ -0,0 +1,166 @@
+#include <errno.h>
+#include <string.h>
+#include <stdlib.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <vector>
+
+#include "dbcomm/SpillFile.h"
+
+#include "exception/FileException.h"
+
+namespace COMMON
+{
+    namespace DBCOMM
+    {
+        SpillFile::SpillFile(const string& directory)
+            : directory_(directory), name_("temporary file"), file_(0), size_(0), mapping_(0)
+        {
+        }
+
+        SpillFile::~SpillFile()
+        {
+            if (mapping_ != 0)
+            {
+                munmap(mapping_, size_);
+            }
+
+            if (file_ != 0)
+            {
+                fclose(file_);
+            }
+        }
+
+        void SpillFile::Write(const char* data, size_t size) throw (COMMON::EXCEPTION::ThrowableException)
+        {
+            if (file_ == 0)
+            {
+                Open();
+            }
+
+            if (fwrite(data, 1, size, file_) != size)
+            {
+                tr1::shared_ptr<EXCEPTION::IException> inner_e(
+                    new EXCEPTION::FileWriteException(name_, errno, strerror(errno)));
+
+                EXCEPTION::ThrowableException e(inner_e);
+                throw e;
+            }
+
+            size_ += size;
+        }
+
+        void SpillFile::Rewind() throw (COMMON::EXCEPTION::ThrowableException)
+        {
+            if (file_ == 0)
+            {
+                return;
+            }
+
+            if (fflush(file_) != 0 || fseek(file_, 0, SEEK_SET) != 0)
+            {
+                tr1::shared_ptr<EXCEPTION::IException> inner_e(
+                    new EXCEPTION::FileReadException(name_, errno, strerror(errno)));
+
+                EXCEPTION::ThrowableException e(inner_e);
+                throw e;
+            }
+        }
+
+        bool SpillFile::Read(char* data, size_t size) throw (COMMON::EXCEPTION::ThrowableException)
+        {
+            if (file_ == 0)
+            {
+                return false;
+            }
+
+            size_t read = fread(data, 1, size, file_);
+            if (read == size)
+            {
+                return true;
+            }
+
+            if (ferror(file_))
+            {
+                tr1::shared_ptr<EXCEPTION::IException> inner_e(
+                    new EXCEPTION::FileReadException(name_, errno, strerror(errno)));
+
+                EXCEPTION::ThrowableException e(inner_e);
+                throw e;
+            }
+
+            return false;
+        }
+
+        const char* SpillFile::Map() throw (COMMON::EXCEPTION::ThrowableException)
+        {
+            if (mapping_ != 0 || file_ == 0 || size_ == 0)
+            {
+                return (const char*)mapping_;
+            }
+
+            void* mapping = MAP_FAILED;
+            if (fflush(file_) == 0)
+            {
+                mapping = mmap(0, size_, PROT_READ, MAP_PRIVATE, fileno(file_), 0);
+            }
+
+            if (mapping == MAP_FAILED)
+            {
+                tr1::shared_ptr<EXCEPTION::IException> inner_e(
+                    new EXCEPTION::FileReadException(name_, errno, strerror(errno)));
+
+                EXCEPTION::ThrowableException e(inner_e);
+                throw e;
+            }
+
+            // the pages are read one after another
+            madvise(mapping, size_, MADV_SEQUENTIAL);
+            mapping_ = mapping;
+
+            return (const char*)mapping_;
+        }
+
+        size_t SpillFile::GetSize() const
+        {
+            return size_;
+        }
+
+        void SpillFile::Open() throw (COMMON::EXCEPTION::ThrowableException)
+        {
+            if (directory_.empty())
+            {
+                file_ = tmpfile();
+            }
+            else
+            {
+                name_ = directory_ + "/foosql_spill_XXXXXX";
+
+                vector<char> path(name_.begin(), name_.end());
+                path.push_back('\0');
+
+                int fd = mkstemp(&(path[0]));
+                if (fd >= 0)
+                {
+                    name_ = &(path[0]);
+                    unlink(&(path[0]));
+
+                    file_ = fdopen(fd, "w+b");
+                    if (file_ == 0)
+                    {
+                        close(fd);
+                    }
+                }
+            }
+
+            if (file_ == 0)
+            {
+                tr1::shared_ptr<EXCEPTION::IException> inner_e(
+                    new EXCEPTION::FileOpenException(name_, errno, strerror(errno)));
+
+                EXCEPTION::ThrowableException e(inner_e);
+                throw e;
+            }
+        }
+    }
+}
@@ -1,23 +1,271 @@
+#include <string.h>
+#include <strings.h>
 #include <sstream>
 
 #include "dbcomm/StmtGenerator.h"
+#include "dbcomm/PreparedFilter.h"
 
 namespace COMMON
 {
     namespace DBCOMM
     {
+        // the longest integers read without checking the overflow
+        static const size_t MAX_SAFE_INTEGER_DIGITS = 18;
+        
+        static const char* SkipSpaces(const char* p, const char* end)
+        {
+            while (p < end && (*p == ' ' || *p == '\t' || *p == '\r' || *p == '\n'))
+            {
+                p++;
+            }
+            return p;
+        }
+        
+        static int HexDigit(char c)
+        {
+            if (c >= '0' && c <= '9')
+            {
+                return c - '0';
+            }
+            if (c >= 'a' && c <= 'f')
+            {
+                return c - 'a' + 10;
+            }
+            if (c >= 'A' && c <= 'F')
+            {
+                return c - 'A' + 10;
+            }
+            return -1;
+        }
+        
+        // whether it is a number like -12, 1.5 or 1e+300
+        static bool IsNumber(const char* p, const char* end)
+        {
+            if (p < end && (*p == '-' || *p == '+'))
+            {
+                p++;
+            }
+            
+            const char* digits = p;
+            while (p < end && *p >= '0' && *p <= '9')
+            {
+                p++;
+            }
+            if (p < end && *p == '.')
+            {
+                p++;
+                while (p < end && *p >= '0' && *p <= '9')
+                {
+                    p++;
+                }
+            }
+            if (p == digits || (p == digits + 1 && *digits == '.'))
+            {
+                return false;
+            }
+            
+            if (p < end && (*p == 'e' || *p == 'E'))
+            {
+                p++;
+                if (p < end && (*p == '-' || *p == '+'))
+                {
+                    p++;
+                }
+                const char* exponent = p;
+                while (p < end && *p >= '0' && *p <= '9')
+                {
+                    p++;
+                }
+                if (p == exponent)
+                {
+                    return false;
+                }
+            }
+            
+            return p == end;
+        }
+        
+        // read an integer like -12, false if it is not one or it may overflow
+        static bool ReadInteger(const char* p, const char* end, long long& value)
+        {
+            bool negative = (p < end && *p == '-');
+            if (p < end && (*p == '-' || *p == '+'))
+            {
+                p++;
+            }
+            if (p == end || (size_t)(end - p) > MAX_SAFE_INTEGER_DIGITS)
+            {
+                return false;
+            }
+            
+            value = 0;
+            for (; p < end; p++)
+            {
+                if (*p < '0' || *p > '9')
+                {
+                    return false;
+                }
+                value = value * 10 + (*p - '0');
+            }
+            
+            if (negative)
+            {
+                value = -value;
+            }
+            return true;
+        }
+        
+        // bind a literal at p, and move p after it
+        static bool BindLiteral(const char*& p, const char* end, PreparedFilter& filter, string& decoded)
+        {
+            p = SkipSpaces(p, end);
+            if (p == end)
+            {
+                return false;
+            }
+            
+            // a string, in which a quote is written twice
+            if (*p == '\'')
+            {
+                decoded.clear();
+                p++;
+                while (true)
+                {
+                    const char* quote = (const char*)memchr(p, '\'', end - p);
+                    if (quote == 0)
+                    {
+                        return false;
+                    }
+                    decoded.append(p, quote - p);
+                    p = quote + 1;
+                    
+                    if (p < end && *p == '\'')
+                    {
+                        decoded += '\'';
+                        p++;
+                        continue;
+                    }
+                    break;
+                }
+                
+                filter.Bind(decoded.size(), decoded.data());
+                return true;
+            }
+            
+            // a string in hex, such as X'6162'
+            if ((*p == 'X' || *p == 'x') && p + 1 < end && p[1] == '\'')
+            {
+                decoded.clear();
+                p += 2;
+                while (p + 1 < end && *p != '\'')
+                {
+                    int high = HexDigit(p[0]);
+                    int low = HexDigit(p[1]);
+                    if (high < 0 || low < 0)
+                    {
+                        return false;
+                    }
+                    decoded += (char)((high << 4) | low);
+                    p += 2;
+                }
+                if (p == end || *p != '\'')
+                {
+                    return false;
+                }
+                p++;
+                
+                filter.Bind(decoded.size(), decoded.data());
+                return true;
+            }
+            
+            // a number or NULL, which ends before the next ',' or ')'
+            const char* begin = p;
+            while (p < end && *p != ',' && *p != ')')
+            {
+                p++;
+            }
+            const char* last = p;
+            while (last > begin && (last[-1] == ' ' || last[-1] == '\t'))
+            {
+                last--;
+            }
+            
+            if (last - begin == 4 && strncasecmp(begin, "NULL", 4) == 0)
+            {
+                filter.BindNull();
+                return true;
+            }
+            
+            if (!IsNumber(begin, last))
+            {
+                return false;
+            }
+            
+            // the other numbers are kept as they are written, no digit of a DECIMAL is lost
+            long long integer = 0;
+            if (ReadInteger(begin, last, integer))
+            {
+                filter.Bind(integer);
+            }
+            else
+            {
+                filter.Bind(last - begin, begin);
+            }
+            return true;
+        }
+        
+        // bind the rows of values like "(v1,v2),(v3,v4)", false if any of them is not a literal
+        static bool BindRows(const string& values, int columns, PreparedFilter& filter)
+        {
+            string decoded;
+            const char* p = values.data();
+            const char* end = p + values.size();
+            while (p < end)
+            {
+                if (*p != '(')
+                {
+                    return false;
+                }
+                p++;
+                
+                for (int i = 0; i < columns; i++)
+                {
+                    if (!BindLiteral(p, end, filter, decoded))
+                    {
+                        return false;
+                    }
+                    
+                    p = SkipSpaces(p, end);
+                    char separator = (i == columns - 1) ? ')' : ',';
+                    if (p == end || *p != separator)
+                    {
+                        return false;
+                    }
+                    p++;
+                }
+                filter.NextRow();
+                
+                if (p < end && *p++ != ',')
+                {
+                    return false;
+                }
+            }
+            
+            return true;
+        }
+        
         /////////////////////////////////////////////////
         ///// StmtGenerator
         /////////////////////////////////////////////////
         StmtGenerator::StmtGenerator()
-            : clear_all_(false), has_value_(false)
+            : clear_all_(false), has_value_(false), fingerprint_(0)
         {
         }
         
         void StmtGenerator::ClearContent()
         {
             // VALUEֵһҪյ
-            values_.str("");
+            values_.clear();
             has_value_ = false;
             
             if (clear_all_)
@@ -25,21 +273,48 @@ namespace COMMON
                 col_list_ = "";
                 table_name_ = "";
                 columns_.clear();    
+                fingerprint_ = 0;
             }            
         }
 
+        size_t StmtGenerator::GetStatementSize() const
+        {
+            if (has_value_ == false)
+            {
+                return 0;
+            }
+            
+            // the head, such as "INSERT IGNORE INTO", the spaces and the brackets
+            return table_name_.size() + col_list_.size() + values_.size() + 32;
+        }
+
         string StmtGenerator::GetTblName()
         {
             return table_name_;
         }
         
-        bool StmtGenerator::MakeupStatement( vector<string>& columns, string tableName, string values, bool forceCheck )
+        bool StmtGenerator::MakeupStatement( 
+            vector<string>& columns, const string& tableName, const string& values, bool forceCheck, unsigned long long fingerprint )
         {
             clear_all_ = false;
             
             // if an empty input was given, skip it
-            if (columns.size() == 0 || values == "" || tableName == "")
+            if (columns.size() == 0 || values.empty() || tableName.empty())
+            {
+                return false;
+            }
+            
+            if (fingerprint != 0 && col_list_ != "")
             {
+                if (fingerprint != fingerprint_)
+                {
+                    // another table or other columns
+                    clear_all_ = true;
+                    return true;
+                }
+                
+                // the same table and columns, no strings need to be compared
+                AppendValues(values);
                 return false;
             }
             
@@ -83,14 +358,23 @@ namespace COMMON
                 std::copy(columns.begin(), columns.end(), columns_.begin());    
             }
 
+            fingerprint_ = fingerprint;
+            
+            AppendValues(values);
+            
+            return false;
+        }
+        
+        void StmtGenerator::AppendValues(const string& values)
+        {
             if (has_value_ == true)
             {
-                values_ << ",";
+                values_ += ',';
             }
-            values_ << "(" << values << ")";
+            values_ += '(';
+            values_ += values;
+            values_ += ')';
             has_value_ = true;
-            
-            return false;
         }
 
         string StmtGenerator::FormOneList( vector<string>& toForm , string prefix)
@@ -115,22 +399,76 @@ namespace COMMON
 
             return ss.str();
         }
+        
+        void StmtGenerator::FormStatement(const DbLocation& dbLocation, string& statement)
+        {
+            string formed = FormStatement(dbLocation);
+            statement.swap(formed);
+        }
+        
+        tr1::shared_ptr<DbActionFilter> StmtGenerator::FormFilter(const DbLocation& dbLocation, string& buffer)
+        {
+            tr1::shared_ptr<DbActionFilter> filter;
+            
+            FormStatement(dbLocation, buffer);
+            if (buffer != "")
+            {
+                filter.reset(new InsertFilter());
+                filter->SwapContents(buffer);
+            }
+            
+            return filter;
+        }
+        
+        bool StmtGenerator::BindValues(PreparedFilter& filter)
+        {
+            filter.ClearParams();
+            
+            if (has_value_ == false || columns_.size() == 0)
+            {
+                return false;
+            }
+            
+            // nothing is left bound when a value is not a literal, the values are then sent in the statement
+            if (!BindRows(values_, (int)columns_.size(), filter))
+            {
+                filter.ClearParams();
+                return false;
+            }
+            
+            return true;
+        }
+        
+        void StmtGenerator::FormValuesStatement(const char* head, string& statement)
+        {
+            statement.clear();
+            
+            if (has_value_ == false)
+            {
+                return;
+            }
+            
+            // the values may be megabytes, allocate once and copy them once
+            statement.reserve(strlen(head) + table_name_.size() + col_list_.size() + values_.size() + 16);
+            statement.append(head).append(" ").append(table_name_);
+            statement.append(" (").append(col_list_).append(") VALUES");
+            statement.append(values_);
+        }
 
         ////////////////////////////////////////////////////////
         //// InsertStmtGen
         ////////////////////////////////////////////////////////
         string InsertStmtGen::FormStatement(const DbLocation& dbLocation)
         {
-            if (has_value_ == false)
-            {
-                return "";
-            }
-            
-            stringstream statement;
-            statement << "INSERT INTO " << table_name_ << " (" << col_list_ << ") VALUES";
-            statement << values_.str();
+            string statement;
+            FormStatement(dbLocation, statement);
 
-            return statement.str();
+            return statement;
+        }
+        
+        void InsertStmtGen::FormStatement(const DbLocation& dbLocation, string& statement)
+        {
+            FormValuesStatement("INSERT INTO", statement);
         }
     }
 }
@@ -0,0 +1,340 @@
+#include <string.h>
+#include <strings.h>
+
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif
+
+#include "dbcomm/StringEscaper.h"
+#include "dbcomm/ValueFormatter.h"
+
+namespace COMMON
+{
+    namespace DBCOMM
+    {
+        // the lead and trail bytes of a two-byte char of a multi-byte character set
+        struct MultiByteRanges
+        {
+            const char* name_;
+            StringEscaper::Charset charset_;
+            unsigned char lead_[2];
+            unsigned char trails_[3][2];
+        };
+
+        static const MultiByteRanges MULTI_BYTE_RANGES[] =
+        {
+            { "gbk",     StringEscaper::CHARSET_GBK,     { 0x81, 0xFE }, { { 0x40, 0x7E }, { 0x80, 0xFE }, { 0x00, 0x00 } } },
+            // a four-byte char is read as two pairs, whose second bytes are digits
+            { "gb18030", StringEscaper::CHARSET_GB18030, { 0x81, 0xFE }, { { 0x30, 0x39 }, { 0x40, 0x7E }, { 0x80, 0xFE } } },
+            { "big5",    StringEscaper::CHARSET_BIG5,    { 0xA1, 0xF9 }, { { 0x40, 0x7E }, { 0xA1, 0xFE }, { 0x00, 0x00 } } },
+            { "sjis",    StringEscaper::CHARSET_SJIS,    { 0x81, 0xFC }, { { 0x40, 0x7E }, { 0x80, 0xFC }, { 0x00, 0x00 } } },
+            { "cp932",   StringEscaper::CHARSET_SJIS,    { 0x81, 0xFC }, { { 0x40, 0x7E }, { 0x80, 0xFC }, { 0x00, 0x00 } } }
+        };
+
+        static const int MULTI_BYTE_RANGE_COUNT = sizeof(MULTI_BYTE_RANGES) / sizeof(MULTI_BYTE_RANGES[0]);
+
+        static const char* const UTF8_NAMES[] = { "utf8", "utf8mb3", "utf8mb4", "utf-8" };
+
+        // the length of the UTF-8 char at the beginning of src, which is not ASCII, 0 if it is invalid.
+        // The overlong forms, the surrogates and the ones above U+10FFFF are invalid.
+        static size_t Utf8CharLength(const unsigned char* src, size_t length)
+        {
+            unsigned char c = src[0];
+            size_t n = 0;
+            unsigned char low = 0x80, high = 0xBF;
+            if (c >= 0xC2 && c <= 0xDF)
+            {
+                n = 2;
+            }
+            else if (c >= 0xE0 && c <= 0xEF)
+            {
+                n = 3;
+                low = (c == 0xE0) ? 0xA0 : 0x80;
+                high = (c == 0xED) ? 0x9F : 0xBF;
+            }
+            else if (c >= 0xF0 && c <= 0xF4)
+            {
+                n = 4;
+                low = (c == 0xF0) ? 0x90 : 0x80;
+                high = (c == 0xF4) ? 0x8F : 0xBF;
+            }
+
+            if (n == 0 || n > length || src[1] < low || src[1] > high)
+            {
+                return 0;
+            }
+
+            for (size_t i = 2; i < n; i++)
+            {
+                if (src[i] < 0x80 || src[i] > 0xBF)
+                {
+                    return 0;
+                }
+            }
+            return n;
+        }
+
+        StringEscaper::StringEscaper(Dialect dialect, Charset charset)
+            : dialect_(dialect), charset_(charset), has_leads_(false), escape_('\\'), special_count_(0)
+        {
+            memset(kinds_, KIND_PLAIN, sizeof(kinds_));
+            memset(replacements_, 0, sizeof(replacements_));
+            memset(trails_, 0, sizeof(trails_));
+
+            if (dialect == DIALECT_MYSQL)
+            {
+                AddSpecial('\0', '0');
+                AddSpecial('\n', 'n');
+                AddSpecial('\r', 'r');
+                AddSpecial('\\', '\\');
+                AddSpecial('\'', '\'');
+                AddSpecial('"', '"');
+                AddSpecial('\032', 'Z');
+            }
+            else
+            {
+                // only a quotation mark is written twice, the control chars are kept in the string
+                escape_ = '\'';
+                AddSpecial('\'', '\'');
+            }
+
+            for (int i = 0; i < MULTI_BYTE_RANGE_COUNT; i++)
+            {
+                const MultiByteRanges& ranges = MULTI_BYTE_RANGES[i];
+                if (ranges.charset_ != charset)
+                {
+                    continue;
+                }
+
+                has_leads_ = true;
+                for (int b = ranges.lead_[0]; b <= ranges.lead_[1]; b++)
+                {
+                    kinds_[b] = KIND_LEAD;
+                }
+
+                for (int r = 0; r < 3; r++)
+                {
+                    for (int b = ranges.trails_[r][0]; ranges.trails_[r][1] != 0 && b <= ranges.trails_[r][1]; b++)
+                    {
+                        trails_[b] = 1;
+                    }
+                }
+                break;
+            }
+        }
+
+        void StringEscaper::AddSpecial(char c, char replacement)
+        {
+            kinds_[(unsigned char)c] = KIND_ESCAPE;
+            replacements_[(unsigned char)c] = replacement;
+            specials_[special_count_++] = c;
+        }
+
+        StringEscaper::Charset StringEscaper::CharsetFromName(const string& name)
+        {
+            for (int i = 0; i < MULTI_BYTE_RANGE_COUNT; i++)
+            {
+                if (strcasecmp(name.c_str(), MULTI_BYTE_RANGES[i].name_) == 0)
+                {
+                    return MULTI_BYTE_RANGES[i].charset_;
+                }
+            }
+
+            for (size_t i = 0; i < sizeof(UTF8_NAMES) / sizeof(UTF8_NAMES[0]); i++)
+            {
+                if (strcasecmp(name.c_str(), UTF8_NAMES[i]) == 0)
+                {
+                    return CHARSET_UTF8;
+                }
+            }
+
+            return CHARSET_SINGLE_BYTE;
+        }
+
+        void StringEscaper::Append(string& out, const char* src, size_t length) const
+        {
+            if (length == 0)
+            {
+                return;
+            }
+
+            // the escaped string is at most twice as long, the buffer is cut to the real length at last
+            size_t start = out.size();
+            out.resize(start + length * 2);
+            char* const begin = &out[start];
+            char* dst = begin;
+            size_t i = 0;
+
+            while (i < length)
+            {
+#ifdef __SSE2__
+                // copy 16 bytes at once while none of them is special, or the lead of a multi-byte char
+                if (i + 16 <= length)
+                {
+                    __m128i chunk = _mm_loadu_si128((const __m128i*)(src + i));
+                    __m128i hits = has_leads_ ? chunk : _mm_setzero_si128();
+                    for (int k = 0; k < special_count_; k++)
+                    {
+                        hits = _mm_or_si128(hits, _mm_cmpeq_epi8(chunk, _mm_set1_epi8(specials_[k])));
+                    }
+
+                    int mask = _mm_movemask_epi8(hits);
+                    if (mask == 0)
+                    {
+                        _mm_storeu_si128((__m128i*)dst, chunk);
+                        dst += 16;
+                        i += 16;
+                        continue;
+                    }
+
+                    int run = __builtin_ctz(mask);
+                    memcpy(dst, src + i, run);
+                    dst += run;
+                    i += run;
+                }
+#endif
+                unsigned char c = (unsigned char)src[i];
+                switch (kinds_[c])
+                {
+                case KIND_ESCAPE:
+                    *dst++ = escape_;
+                    *dst++ = replacements_[c];
+                    i++;
+                    break;
+
+                case KIND_LEAD:
+                    if (i + 1 < length && trails_[(unsigned char)src[i + 1]] != 0)
+                    {
+                        *dst++ = (char)c;
+                        *dst++ = src[i + 1];
+                        i += 2;
+                        break;
+                    }
+
+                    // a lead byte without a valid second byte would take the next one, such as the escape char
+                    // of a quotation mark, as its second byte on the server. It is escaped by itself, as
+                    // mysql_real_escape_string() does.
+                    if (dialect_ == DIALECT_MYSQL)
+                    {
+                        *dst++ = escape_;
+                    }
+                    *dst++ = (char)c;
+                    i++;
+                    break;
+
+                default:
+                    *dst++ = (char)c;
+                    i++;
+                    break;
+                }
+            }
+
+            out.resize(start + (dst - begin));
+        }
+
+        bool StringEscaper::IsValid(const char* src, size_t length) const
+        {
+            if (charset_ == CHARSET_SINGLE_BYTE)
+            {
+                return true;
+            }
+
+            const unsigned char* s = (const unsigned char*)src;
+            size_t i = 0;
+            while (i < length)
+            {
+#ifdef __SSE2__
+                // the ASCII bytes are valid in all the character sets, skip 16 of them at once
+                if (i + 16 <= length)
+                {
+                    int mask = _mm_movemask_epi8(_mm_loadu_si128((const __m128i*)(s + i)));
+                    if (mask == 0)
+                    {
+                        i += 16;
+                        continue;
+                    }
+                    i += __builtin_ctz(mask);
+                }
+#endif
+                if (s[i] < 0x80)
+                {
+                    i++;
+                    continue;
+                }
+
+                size_t n = (charset_ == CHARSET_UTF8) ? Utf8CharLength(s + i, length - i) : MultiByteCharLength(s + i, length - i);
+                if (n == 0)
+                {
+                    return false;
+                }
+                i += n;
+            }
+            return true;
+        }
+
+        size_t StringEscaper::MultiByteCharLength(const unsigned char* src, size_t length) const
+        {
+            if (kinds_[src[0]] != KIND_LEAD)
+            {
+                // the half-width katakana of SJIS are the only single bytes above 0x7F
+                return (charset_ == CHARSET_SJIS && src[0] >= 0xA1 && src[0] <= 0xDF) ? 1 : 0;
+            }
+
+            if (length < 2 || trails_[src[1]] == 0)
+            {
+                return 0;
+            }
+
+            if (charset_ != CHARSET_GB18030 || src[1] > 0x39)
+            {
+                return 2;
+            }
+
+            // a four-byte char of GB18030: lead, digit, lead, digit
+            return (length >= 4 && kinds_[src[2]] == KIND_LEAD && src[3] >= 0x30 && src[3] <= 0x39) ? 4 : 0;
+        }
+
+        void StringEscaper::AppendQuoted(string& out, const char* src, size_t length, Stats* stats) const
+        {
+            if (!IsValid(src, length))
+            {
+                ValueFormatter::AppendString(out, src, length, false, true);
+                if (stats != 0)
+                {
+                    stats->hex_values_++;
+                }
+                return;
+            }
+
+            size_t start = out.size();
+            out += '\'';
+            Append(out, src, length);
+            out += '\'';
+
+            // X'...' would take 3 bytes and 2 for each byte
+            if (stats != 0)
+            {
+                stats->plain_values_++;
+                stats->bytes_saved_ += (long long)(length * 2 + 3) - (long long)(out.size() - start);
+            }
+        }
+
+        string StringEscaper::Escape(const char* src, size_t length) const
+        {
+            string out;
+            Append(out, src, length);
+            return out;
+        }
+
+        void StringEscaper::Escape(const vector<string>& sources, vector<string>& escaped) const
+        {
+            escaped.resize(sources.size());
+            for (size_t i = 0; i < sources.size(); i++)
+            {
+                // the buffers of the strings given are kept
+                escaped[i].clear();
+                Append(escaped[i], sources[i].data(), sources[i].size());
+            }
+        }
+    }
+}
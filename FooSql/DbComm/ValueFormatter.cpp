@@ -0,0 +1,230 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <locale.h>
+
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif
+
+#include "dbcomm/ValueFormatter.h"
+
+namespace COMMON
+{
+    namespace DBCOMM
+    {
+        // "00" to "99", two digits are written at once
+        static const char DIGIT_PAIRS[201] =
+            "00010203040506070809"
+            "10111213141516171819"
+            "20212223242526272829"
+            "30313233343536373839"
+            "40414243444546474849"
+            "50515253545556575859"
+            "60616263646566676869"
+            "70717273747576777879"
+            "80818283848586878889"
+            "90919293949596979899";
+
+        static const char HEX_DIGITS[17] = "0123456789abcdef";
+
+        // a statement always has the point as '.', whatever LC_NUMERIC of the process is
+        static const locale_t C_NUMERIC = newlocale(LC_NUMERIC_MASK, "C", (locale_t)0);
+
+        // the powers of 10 that a double holds exactly
+        static const double POW10[16] =
+        {
+            1e0, 1e1, 1e2, 1e3, 1e4, 1e5, 1e6, 1e7, 1e8, 1e9, 1e10, 1e11, 1e12, 1e13, 1e14, 1e15
+        };
+
+        // below 2^53, every integer is exact in a double
+        static const double MAX_EXACT_INTEGER = 9007199254740992.0;
+
+        // Write a double with a few decimals, such as 12.25 or 0.1, if it reads back with no more
+        // than 15 of them. m / 10^k is rounded once when read back, as m and 10^k are exact, so
+        // comparing it with the value tells if "m / 10^k" reads back without calling strtod.
+        static bool AppendShortDecimal(string& out, double value)
+        {
+            for (int k = 1; k < 16; k++)
+            {
+                double scaled = value * POW10[k];
+                if (scaled >= MAX_EXACT_INTEGER || scaled <= -MAX_EXACT_INTEGER)
+                {
+                    return false;
+                }
+
+                long long m = (long long)(scaled < 0 ? scaled - 0.5 : scaled + 0.5);
+                if ((double)m / POW10[k] != value)
+                {
+                    continue;
+                }
+
+                unsigned long long u = (m < 0) ? 0ULL - (unsigned long long)m : (unsigned long long)m;
+                unsigned long long unit = (unsigned long long)POW10[k];
+
+                if (m < 0)
+                {
+                    out += '-';
+                }
+
+                char digits[ValueFormatter::MAX_INTEGER_LENGTH];
+                out.append(digits, ValueFormatter::FormatInteger((long long)(u / unit), digits));
+                out += '.';
+
+                // the decimals with their leading zeros, the smallest k has no trailing ones
+                int length = ValueFormatter::FormatInteger((long long)(u % unit), digits);
+                out.append(k - length, '0');
+                out.append(digits, length);
+                return true;
+            }
+
+            return false;
+        }
+
+        int ValueFormatter::FormatInteger(long long value, char* out)
+        {
+            // work on the unsigned value, so that the minimum long long is fine
+            unsigned long long u = (value < 0) ? 0ULL - (unsigned long long)value : (unsigned long long)value;
+
+            // from the end of a local buffer to the front
+            char buffer[MAX_INTEGER_LENGTH];
+            char* p = buffer + MAX_INTEGER_LENGTH;
+
+            while (u >= 100)
+            {
+                unsigned int pair = (unsigned int)(u % 100) * 2;
+                u /= 100;
+                p -= 2;
+                p[0] = DIGIT_PAIRS[pair];
+                p[1] = DIGIT_PAIRS[pair + 1];
+            }
+
+            if (u >= 10)
+            {
+                unsigned int pair = (unsigned int)u * 2;
+                p -= 2;
+                p[0] = DIGIT_PAIRS[pair];
+                p[1] = DIGIT_PAIRS[pair + 1];
+            }
+            else
+            {
+                *--p = (char)('0' + u);
+            }
+
+            if (value < 0)
+            {
+                *--p = '-';
+            }
+
+            int length = (int)(buffer + MAX_INTEGER_LENGTH - p);
+            memcpy(out, p, length);
+
+            return length;
+        }
+
+        void ValueFormatter::AppendInteger(string& out, long long value)
+        {
+            char buffer[MAX_INTEGER_LENGTH];
+            out.append(buffer, FormatInteger(value, buffer));
+        }
+
+        void ValueFormatter::AppendDouble(string& out, double value)
+        {
+            // an integral double is written as an integer, the most common case
+            if (value >= -1e15 && value <= 1e15 && value == (double)(long long)value)
+            {
+                AppendInteger(out, (long long)value);
+                return;
+            }
+
+            if (AppendShortDecimal(out, value))
+            {
+                return;
+            }
+
+            // 15 digits are enough for most doubles, 17 for all of them. Take the first
+            // one that reads back, "%g" has removed the trailing zeros. Both are done in the
+            // C locale of this thread.
+            char buffer[32];
+            int length = 0;
+            locale_t old_locale = uselocale(C_NUMERIC);
+            for (int precision = 15; precision <= 17; precision++)
+            {
+                length = snprintf(buffer, sizeof(buffer), "%.*g", precision, value);
+                if (precision == 17 || strtod(buffer, 0) == value)
+                {
+                    break;
+                }
+            }
+            uselocale(old_locale);
+
+            out.append(buffer, length);
+        }
+
+        void ValueFormatter::AppendHex(string& out, const char* value, size_t length)
+        {
+            size_t start = out.size();
+            out.resize(start + length * 2);
+
+            char* dest = &out[start];
+            const unsigned char* src = (const unsigned char*)value;
+            size_t i = 0;
+
+#ifdef __SSE2__
+            // 16 bytes to 32 chars at once: split the nibbles, turn them into ASCII,
+            // then interleave the high and the low ones
+            const __m128i low_mask = _mm_set1_epi8(0x0F);
+            const __m128i nine = _mm_set1_epi8(9);
+            const __m128i zero_char = _mm_set1_epi8('0');
+            const __m128i letter_gap = _mm_set1_epi8('a' - '0' - 10);
+
+            for (; i + 16 <= length; i += 16)
+            {
+                __m128i bytes = _mm_loadu_si128((const __m128i*)(src + i));
+
+                __m128i high = _mm_and_si128(_mm_srli_epi16(bytes, 4), low_mask);
+                __m128i low = _mm_and_si128(bytes, low_mask);
+
+                high = _mm_add_epi8(_mm_add_epi8(high, zero_char), _mm_and_si128(_mm_cmpgt_epi8(high, nine), letter_gap));
+                low = _mm_add_epi8(_mm_add_epi8(low, zero_char), _mm_and_si128(_mm_cmpgt_epi8(low, nine), letter_gap));
+
+                _mm_storeu_si128((__m128i*)(dest + i * 2), _mm_unpacklo_epi8(high, low));
+                _mm_storeu_si128((__m128i*)(dest + i * 2 + 16), _mm_unpackhi_epi8(high, low));
+            }
+#endif
+
+            for (; i < length; i++)
+            {
+                dest[i * 2] = HEX_DIGITS[src[i] >> 4];
+                dest[i * 2 + 1] = HEX_DIGITS[src[i] & 0x0F];
+            }
+        }
+
+        void ValueFormatter::AppendString(string& out, const char* value, size_t length, bool noNeedQuote, bool needHex)
+        {
+            if (needHex)
+            {
+                out += 'X';
+            }
+
+            if (!noNeedQuote)
+            {
+                out += '\'';
+            }
+
+            if (needHex)
+            {
+                AppendHex(out, value, length);
+            }
+            else
+            {
+                out.append(value, length);
+            }
+
+            if (!noNeedQuote)
+            {
+                out += '\'';
+            }
+        }
+    }
+}
@@ -0,0 +1,257 @@
+#include <stdlib.h>
+#include <string.h>
+#include <locale.h>
+
+#include <string>
+
+#include "dbcomm/ValueParser.h"
+
+using namespace std;
+
+namespace COMMON
+{
+    namespace DBCOMM
+    {
+        // the powers of 10 that a double holds exactly
+        static const double POW10[23] =
+        {
+            1e0, 1e1, 1e2, 1e3, 1e4, 1e5, 1e6, 1e7, 1e8, 1e9, 1e10, 1e11,
+            1e12, 1e13, 1e14, 1e15, 1e16, 1e17, 1e18, 1e19, 1e20, 1e21, 1e22
+        };
+
+        // below 2^53, every integer is exact in a double
+        static const unsigned long long MAX_EXACT_INTEGER = 9007199254740992ULL;
+
+        // at most 19 digits are kept of a double, which never overflow 64 bits
+        static const int MAX_MANTISSA_DIGITS = 19;
+
+        // a longer text of a double is copied on the heap to be ended by '\0'
+        static const size_t MAX_STACK_TEXT = 64;
+
+        // the texts are always in the C locale, whatever LC_NUMERIC of the process is
+        static const locale_t C_NUMERIC = newlocale(LC_NUMERIC_MASK, "C", (locale_t)0);
+
+        static inline bool IsBlank(char c)
+        {
+            return c == ' ' || c == '\t';
+        }
+
+        static inline void SkipBlanks(const char*& begin, const char*& end)
+        {
+            while (begin < end && IsBlank(*begin)) begin++;
+            while (end > begin && IsBlank(end[-1])) end--;
+        }
+
+        // read the digits from begin to end, all of which must be digits
+        static inline bool ParseDigits(const char* begin, const char* end, unsigned long long limit, unsigned long long& value)
+        {
+            if (begin == end)
+            {
+                return false;
+            }
+
+            unsigned long long v = 0;
+            for (const char* p = begin; p < end; p++)
+            {
+                unsigned int digit = (unsigned int)(unsigned char)(*p) - '0';
+                if (digit > 9)
+                {
+                    return false;
+                }
+
+                // only the 20th digit or more may go beyond the limit
+                if (p - begin >= 18 && (v > (limit - digit) / 10))
+                {
+                    return false;
+                }
+                v = v * 10 + digit;
+            }
+
+            value = v;
+            return true;
+        }
+
+        bool ValueParser::ParseInteger(const char* text, size_t length, long long& value)
+        {
+            const char* begin = text;
+            const char* end = text + length;
+            SkipBlanks(begin, end);
+
+            bool negative = false;
+            if (begin < end && (*begin == '-' || *begin == '+'))
+            {
+                negative = (*begin == '-');
+                begin++;
+            }
+
+            unsigned long long limit = negative ? 9223372036854775808ULL : 9223372036854775807ULL;
+            unsigned long long v = 0;
+            if (!ParseDigits(begin, end, limit, v))
+            {
+                return false;
+            }
+
+            value = negative ? (long long)(0ULL - v) : (long long)v;
+            return true;
+        }
+
+        bool ValueParser::ParseUnsigned(const char* text, size_t length, unsigned long long& value)
+        {
+            const char* begin = text;
+            const char* end = text + length;
+            SkipBlanks(begin, end);
+
+            if (begin < end && *begin == '+')
+            {
+                begin++;
+            }
+
+            return ParseDigits(begin, end, 18446744073709551615ULL, value);
+        }
+
+        bool ValueParser::ParseDouble(const char* text, size_t length, double& value)
+        {
+            const char* begin = text;
+            const char* end = text + length;
+            SkipBlanks(begin, end);
+
+            const char* p = begin;
+            bool negative = false;
+            if (p < end && (*p == '-' || *p == '+'))
+            {
+                negative = (*p == '-');
+                p++;
+            }
+
+            // the digits are read as an integer mantissa and a power of 10
+            unsigned long long mantissa = 0;
+            int digits = 0;
+            int exponent = 0;
+            bool any_digit = false;
+            bool truncated = false;
+            for (; p < end && (unsigned int)(*p - '0') <= 9; p++)
+            {
+                any_digit = true;
+                if (digits < MAX_MANTISSA_DIGITS)
+                {
+                    mantissa = mantissa * 10 + (unsigned int)(*p - '0');
+                    digits += (mantissa != 0) ? 1 : 0;
+                }
+                else
+                {
+                    truncated = truncated || (*p != '0');
+                    exponent++;
+                }
+            }
+
+            if (p < end && *p == '.')
+            {
+                for (p++; p < end && (unsigned int)(*p - '0') <= 9; p++)
+                {
+                    any_digit = true;
+                    if (digits < MAX_MANTISSA_DIGITS)
+                    {
+                        mantissa = mantissa * 10 + (unsigned int)(*p - '0');
+                        digits += (mantissa != 0) ? 1 : 0;
+                        exponent--;
+                    }
+                    else
+                    {
+                        truncated = truncated || (*p != '0');
+                    }
+                }
+            }
+
+            if (!any_digit)
+            {
+                return false;
+            }
+
+            if (p < end && (*p == 'e' || *p == 'E'))
+            {
+                p++;
+                bool negative_exponent = false;
+                if (p < end && (*p == '-' || *p == '+'))
+                {
+                    negative_exponent = (*p == '-');
+                    p++;
+                }
+
+                if (p == end)
+                {
+                    return false;
+                }
+
+                int e = 0;
+                for (; p < end && (unsigned int)(*p - '0') <= 9; p++)
+                {
+                    // a bigger exponent only gives 0 or infinity, which strtod() works out
+                    if (e < 100000)
+                    {
+                        e = e * 10 + (*p - '0');
+                    }
+                }
+                exponent += negative_exponent ? -e : e;
+            }
+
+            if (p != end)
+            {
+                return false;
+            }
+
+            // both the mantissa and the power of 10 are exact, so the result is rounded only once
+            if (!truncated && mantissa <= MAX_EXACT_INTEGER && exponent >= -22 && exponent <= 22)
+            {
+                double d = (double)mantissa;
+                d = (exponent < 0) ? d / POW10[-exponent] : d * POW10[exponent];
+                value = negative ? -d : d;
+                return true;
+            }
+
+            // the rare ones, such as 17 digits or big exponents, are left to strtod() in the C locale
+            size_t size = end - begin;
+            if (size < MAX_STACK_TEXT)
+            {
+                char buffer[MAX_STACK_TEXT];
+                memcpy(buffer, begin, size);
+                buffer[size] = '\0';
+                value = strtod_l(buffer, 0, C_NUMERIC);
+            }
+            else
+            {
+                string buffer(begin, size);
+                value = strtod_l(buffer.c_str(), 0, C_NUMERIC);
+            }
+            return true;
+        }
+
+        bool ValueParser::ParseBool(const char* text, size_t length, bool& value)
+        {
+            const char* begin = text;
+            const char* end = text + length;
+            SkipBlanks(begin, end);
+
+            size_t size = end - begin;
+            if (size == 4 && strncasecmp(begin, "true", 4) == 0)
+            {
+                value = true;
+                return true;
+            }
+
+            if (size == 5 && strncasecmp(begin, "false", 5) == 0)
+            {
+                value = false;
+                return true;
+            }
+
+            long long integer = 0;
+            if (!ParseInteger(begin, size, integer))
+            {
+                return false;
+            }
+
+            value = (integer != 0);
+            return true;
+        }
+    }
+}
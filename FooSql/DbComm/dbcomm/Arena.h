@@ -0,0 +1,74 @@
+/// @file Arena.h
+/// @brief The file defines a memory arena for many small objects freed at once.
+
+/// @author Aicro Ai
+/// @date 2015/6/25
+
+#ifndef COMMON_DBCOMM_ARENA_H_
+#define COMMON_DBCOMM_ARENA_H_
+
+#include <cstddef>
+#include <vector>
+
+using namespace std;
+
+namespace COMMON
+{
+    namespace DBCOMM
+    {
+        /// @brief A memory arena. The memory is taken from large chunks one after another, and is only
+        /// freed when the arena is cleared or destroyed, so keys and values copied into it cost no
+        /// allocation of their own.
+        class Arena
+        {
+        public:
+            /// @brief The default number of bytes of a chunk
+            static const size_t DEFAULT_CHUNK_SIZE = 64 * 1024;
+
+        public:
+            /// @brief Constructor
+            /// @param chunkSize the number of bytes of a chunk. A larger object gets a chunk of its own.
+            explicit Arena(size_t chunkSize = DEFAULT_CHUNK_SIZE);
+
+            ~Arena();
+
+            /// @brief Get memory, aligned for any type
+            /// @param size the number of bytes
+            /// @return the memory, valid until the arena is cleared
+            char* Allocate(size_t size);
+
+            /// @brief Copy data into the arena
+            /// @param data the data
+            /// @param size the number of bytes
+            /// @return the copy, valid until the arena is cleared
+            char* Copy(const char* data, size_t size);
+
+            /// @brief Free all the memory got from the arena. The first chunk is kept for reuse.
+            void Clear();
+
+            /// @brief Get the number of bytes of all the chunks
+            /// @return the number of bytes
+            size_t GetByteCount() const;
+
+        private:
+            Arena(const Arena&);
+            Arena& operator=(const Arena&);
+
+        private:
+            size_t chunk_size_;
+
+            vector<char*> chunks_;
+
+            // the objects larger than a chunk
+            vector<char*> large_chunks_;
+
+            // the free space of the last chunk
+            char* current_;
+            size_t left_;
+
+            size_t bytes_;
+        };
+    }
+}
+
+#endif
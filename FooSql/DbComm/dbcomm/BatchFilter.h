@@ -33,13 +33,22 @@ namespace COMMON
             vector<string> columns_;
             
             /// @brief a list of values
-            stringstream values_;
+            string values_;
             
             /// @brief whether we have value currently
             bool has_value_;
             
             /// @brief to force check the compatibility?
             bool force_check_;
+            
+            /// @brief a hash of the table name and the columns, see GetFingerprint()
+            unsigned long long fingerprint_;
+            
+            /// @brief whether the table name or the columns have changed since the hash
+            bool fingerprint_dirty_;
+            
+            /// @brief how the strings appended with an escaper are written, see GetEncodingStats()
+            StringEscaper::Stats encoding_stats_;
         public:
 			/// @brief Constructor.
 			/// @param table_name table name
@@ -66,13 +75,51 @@ namespace COMMON
             /// @param value value
 			/// @param ignoreColumn should we ignore appending the column. It is useful
 			/// when you want to save the time by not copying columns.
-            void AppendColumnValue(string column, Value value, bool ignoreColumn);
+            void AppendColumnValue(const string& column, const Value& value, bool ignoreColumn);
             
 			/// @brief Append column and its associate value seperately
 			/// @param column column
             /// @param value value
 			/// @param ignoreColumn should we ignore appending the column. It is useful
-            void AppendColumnValue(string column, string value, bool ignoreColumn);
+            void AppendColumnValue(const string& column, const string& value, bool ignoreColumn);
+            
+            /// @brief Append column and its associate value seperately. The value is written straight into
+            /// the values, the same as @c Value(int) gives, without building a @c Value first.
+            /// @param column column
+            /// @param value value
+            /// @param ignoreColumn should we ignore appending the column.
+            void AppendColumnValue(const string& column, int value, bool ignoreColumn);
+            
+            /// @brief The same as AppendColumnValue(const string&, int, bool), for a long value
+            void AppendColumnValue(const string& column, long value, bool ignoreColumn);
+            
+            /// @brief The same as AppendColumnValue(const string&, int, bool), for a long long value
+            void AppendColumnValue(const string& column, long long value, bool ignoreColumn);
+            
+            /// @brief The same as AppendColumnValue(const string&, int, bool), for a double value
+            void AppendColumnValue(const string& column, double value, bool ignoreColumn);
+            
+            /// @brief Append column and its associate value seperately. The value is written straight into
+            /// the values, the same as @c Value(long, const char*, bool, bool) gives.
+            /// @param column column
+            /// @param length the length of the value buffer
+            /// @param value the buffer for the value
+            /// @param noNeedQuote true means no need to put a quotation mark around value
+            /// @param needHex true means we want to convert the value to its hex format explicitly
+            /// @param ignoreColumn should we ignore appending the column.
+            void AppendColumnValue(const string& column, long length, const char* value, 
+                                   bool noNeedQuote, bool needHex, bool ignoreColumn);
+            
+            /// @brief Append column and its associate value seperately. The value is written straight into the values,
+            /// the same as @c Value(long, const char*, const StringEscaper&, StringEscaper::Stats*) gives: quoted and
+            /// escaped if it is valid in the character set of the escaper, in hex if not.
+            /// @param column column
+            /// @param length the length of the value buffer
+            /// @param value the buffer for the value
+            /// @param escaper the escaper of the connection the statement goes to
+            /// @param ignoreColumn should we ignore appending the column.
+            void AppendColumnValue(const string& column, long length, const char* value, 
+                                   const StringEscaper& escaper, bool ignoreColumn);
         
             /// @brief clear columns only
             void ClearColumns();
@@ -87,7 +134,7 @@ namespace COMMON
         public:
             /// @brief Get table name
             /// @return the table name
-            string GetTableName();
+            const string& GetTableName();
             
 			/// @brief Get the associate column names
 			/// @return The associated column names.
@@ -95,11 +142,26 @@ namespace COMMON
             
 			/// @brief Get associated values
 			/// @return The associated values
-            string GetValues();
+            const string& GetValues();
+            
+            /// @brief Get a hash of the table name and the columns. Two filters with the same fingerprint
+            /// go into the same statement, so the generators compare the fingerprints instead of the strings.
+            /// @return the FNV-1a hash of the table name and the column names, never 0
+            /// @note Changes made through the reference returned by @c GetColumns() are not seen.
+            unsigned long long GetFingerprint();
+            
+            /// @brief Get how many strings appended with an escaper are sent as they are and how many in hex,
+            /// and the bytes saved by not writing all of them in hex. They are kept when the values are cleared.
+            /// @return the numbers
+            const StringEscaper::Stats& GetEncodingStats() const;
             
             /// @brief should we need to check the compatibility?
             /// @return the necessity for checking the compatibility
             bool CheckCompatible();
+            
+        private:
+            // push the column if needed, and put a separator before the new value
+            void StartValue(const string& column, bool ignoreColumn);
         };
     }
 }
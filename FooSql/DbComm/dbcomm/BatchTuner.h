@@ -0,0 +1,169 @@
+/// @file BatchTuner.h
+/// @brief The file defines a controller tuning the values per statement and the commit limit of a batch action.
+
+/// @author Aicro Ai
+/// @date 2015/7/8
+
+#ifndef COMMON_DBCOMM_BATCHTUNER_H_
+#define COMMON_DBCOMM_BATCHTUNER_H_
+
+#include <string>
+#include <vector>
+
+#include "dbcomm/DbLocation.h"
+#include "dbcomm/DbLocationMap.h"
+
+using namespace std;
+
+namespace COMMON
+{
+    namespace DBCOMM
+    {
+        /// @brief Tunes the number of values per statement of each DB for a @c DbBatchAction, instead of a
+        /// valuesLimit tuned by hand for each table and each DB. The latency and the rows per second of
+        /// the statements are watched in windows of a few statements, and at the end of each window:
+        ///  - if the average latency is above the ceiling, the values per statement are cut by a factor,
+        ///  - otherwise they are moved a step in the direction which raises the rows per second. The
+        ///    direction is reversed when the rows per second fall, and it is back to growing when they
+        ///    stay flat. A step never goes beyond the ceiling as the latency of a value is expected.
+        ///
+        /// The commit limit follows the values per statement, so that a transaction keeps the number of
+        /// statements it had with the limits given to @c IDbTasks::BatchInsert() and the like.
+        class BatchTuner
+        {
+        public:
+            /// @brief Why the values per statement are changed
+            enum Reason
+            {
+                /// the latency is above the ceiling, the values are cut by a factor
+                REASON_LATENCY_CEILING,
+                /// the rows per second rise, the values keep moving in the same direction
+                REASON_THROUGHPUT_RISING,
+                /// the rows per second fall, the values move in the other direction
+                REASON_THROUGHPUT_FALLING,
+                /// the rows per second stay flat, the values grow to find more
+                REASON_PROBING
+            };
+
+            /// @brief A change of the values per statement of a DB
+            struct Decision
+            {
+                /// @brief the DB
+                DbLocation location_;
+
+                /// @brief why they are changed
+                Reason reason_;
+
+                /// @brief the values per statement before and after
+                int old_values_per_batch_;
+                int values_per_batch_;
+
+                /// @brief the commit limit after, 0 for never
+                int commit_limit_;
+
+                /// @brief the average latency of the statements of the window in milliseconds
+                double latency_;
+
+                /// @brief the rows per second of the statements of the window
+                double rows_per_second_;
+
+                /// @brief Describe the decision to be logged
+                /// @return such as "db1: 100 -> 125 values, commit 50000, 12.5 ms, 8000 rows/s, probing"
+                string ToString() const;
+            };
+
+        public:
+            /// @brief Constructor
+            /// @param latencyCeiling the longest average latency of a statement in milliseconds
+            /// @param minValues the fewest values per statement, at least 1
+            /// @param maxValues the most values per statement
+            explicit BatchTuner(double latencyCeiling = 1000.0, int minValues = 1, int maxValues = 10000);
+
+            /// @brief Set the number of statements watched before each decision
+            /// @param statements the number, 4 by default
+            void SetWindow(int statements) { window_ = (statements > 1) ? statements : 1; }
+
+            /// @brief Set how many values a statement grows or shrinks by at a step
+            /// @param values the number, 16 by default
+            void SetStep(int values) { step_ = (values > 1) ? values : 1; }
+
+            /// @brief Set the factor the values are cut by when the latency is above the ceiling
+            /// @param factor between 0 and 1, 0.5 by default
+            void SetDecrease(double factor) { decrease_ = (factor > 0.0 && factor < 1.0) ? factor : 0.5; }
+
+            /// @brief Start tuning a DB from the limits given
+            /// @param location the DB
+            /// @param valuesPerBatch the values per statement to start from
+            /// @param commitLimit the commit limit to start from, 0 for never
+            void Start(const DbLocation& location, int valuesPerBatch, int commitLimit);
+
+            /// @brief Record statements finished for a DB, and decide at the end of a window
+            /// @param location the DB
+            /// @param rows the number of values of the statements
+            /// @param statements the number of statements. Statements running at the same time on several
+            /// connections are given as the rounds of them, so that each is one sample of the latency.
+            /// @param microSeconds the wall time the statements took
+            /// @return true if the values per statement of the DB are changed
+            bool Record(const DbLocation& location, long long rows, int statements, long long microSeconds);
+
+            /// @brief Get the values per statement of a DB
+            /// @param location the DB
+            /// @return the values per statement
+            int GetValuesPerBatch(const DbLocation& location) { return states_[location].values_; }
+
+            /// @brief Get the commit limit of a DB
+            /// @param location the DB
+            /// @return the commit limit, 0 for never
+            int GetCommitLimit(const DbLocation& location) { return states_[location].commit_limit_; }
+
+            /// @brief Take the decisions made since the last call
+            /// @param decisions output parameter. The decisions are appended to it in the order they are made.
+            void TakeDecisions(vector<Decision>& decisions);
+
+        private:
+            // what is tuned and watched of a DB
+            struct State
+            {
+                State()
+                    : values_(1), commit_limit_(0), batches_per_commit_(0), direction_(1),
+                      last_rows_per_second_(0.0), rows_(0), micro_seconds_(0), statements_(0) {}
+
+                int values_;
+                int commit_limit_;
+
+                // the statements per transaction kept by the commit limit, 0 for never committing
+                int batches_per_commit_;
+
+                // 1 to grow, -1 to shrink
+                int direction_;
+
+                // the rows per second of the last window, 0 if it is not to be compared with
+                double last_rows_per_second_;
+
+                // the window
+                long long rows_;
+                long long micro_seconds_;
+                int statements_;
+            };
+
+            // keep the values in the bounds, and the commit limit with them
+            void SetValues(State& state, int values);
+
+        private:
+            double latency_ceiling_;
+            int min_values_;
+            int max_values_;
+            int window_;
+            int step_;
+            double decrease_;
+
+            // the rows per second are taken as flat within this ratio
+            double tolerance_;
+
+            DbLocationMap<State> states_;
+            vector<Decision> decisions_;
+        };
+    }
+}
+
+#endif
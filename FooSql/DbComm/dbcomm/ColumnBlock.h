@@ -0,0 +1,178 @@
+/// @file ColumnBlock.h
+/// @brief The file defines a block of rows kept column by column, for scanning a column at once.
+
+/// @author Aicro Ai
+/// @date 2015/6/28
+
+#ifndef COMMON_DBCOMM_COLUMNBLOCK_H_
+#define COMMON_DBCOMM_COLUMNBLOCK_H_
+
+#include <string>
+#include <vector>
+#include <map>
+
+#include "dbcomm/RowBlock.h"
+
+#include "exception/ThrowableException.h"
+
+using namespace std;
+
+namespace COMMON
+{
+    namespace DBCOMM
+    {
+        class DbLocation;
+
+        /// @brief A block of rows fetched at once by @c DbQueryRslt::FetchColumns(), kept column by column.
+        /// The buffers of a column are laid out as Apache Arrow does, so a column is scanned by a simple
+        /// loop, or handed to the code reading Arrow arrays without copying:
+        ///   - a validity bitmap, where bit i, the least significant first, is 1 if row i is not NULL
+        ///   - for a COLUMN_TEXT column, the values one after another without '\0', and the offsets of them
+        ///     in 32 bits, one more than the rows, so the length of row i is offsets[i + 1] - offsets[i].
+        ///     So the values of a column are 2GB at most.
+        ///   - for a COLUMN_INTEGER or COLUMN_DOUBLE column, the values in 64 bits, 0 for NULL
+        ///
+        /// The buffers are kept when the block is filled again.
+        class ColumnBlock
+        {
+        public:
+            /// @brief The default number of rows of a block
+            enum { DEFAULT_CAPACITY = 1024 };
+
+        public:
+            /// @brief Constructor
+            /// @param capacity the max number of rows fetched into the block at once
+            explicit ColumnBlock(int capacity = DEFAULT_CAPACITY);
+
+            /// @brief Set the max number of rows fetched into the block at once
+            /// @param capacity the number of rows, at least 1
+            void SetCapacity(int capacity);
+
+            /// @brief Get the max number of rows fetched into the block at once
+            /// @return the number of rows
+            int GetCapacity() const;
+
+            /// @brief Ask the DBMS to send the numbers in their binary form, see @c RowBlock::SetNativeNumbers()
+            /// @param nativeNumbers true to fetch the numbers in their binary form. It is off by default.
+            void SetNativeNumbers(bool nativeNumbers);
+
+            /// @brief Whether the numbers are asked for in their binary form
+            /// @return true if so
+            bool IsNativeNumbers() const;
+
+            /// @brief Ask for a column sent in text to be parsed into numbers when the block is filled,
+            /// which is kept for all the blocks filled later. A value which is not a number of the type
+            /// is taken as NULL, and counted by @c GetNullCount().
+            /// @param column the position of the column, begin with 0
+            /// @param type COLUMN_INTEGER or COLUMN_DOUBLE, COLUMN_TEXT to keep the text
+            void ParseColumn(int column, RowBlock::ColumnType type);
+
+            /// @brief Get the number of rows in the block
+            /// @return the number of rows
+            int GetRowCount() const;
+
+            /// @brief Get the number of columns
+            /// @return the number of columns
+            int GetColumnCount() const;
+
+            /// @brief Get how the values of a column are kept
+            /// @param column the position of the column, begin with 0
+            /// @return the type
+            RowBlock::ColumnType GetColumnType(int column) const;
+
+            /// @brief Get the validity bitmap of a column
+            /// @param column the position of the column, begin with 0
+            /// @return the bitmap, (rows + 7) / 8 bytes
+            const unsigned char* GetValidity(int column) const;
+
+            /// @brief Get the number of NULLs of a column
+            /// @param column the position of the column, begin with 0
+            /// @return the number of NULLs
+            int GetNullCount(int column) const;
+
+            /// @brief Get the offsets of the values of a COLUMN_TEXT column
+            /// @param column the position of the column, begin with 0
+            /// @return the offsets, rows + 1 of them
+            const int* GetOffsets(int column) const;
+
+            /// @brief Get the values of a COLUMN_TEXT column
+            /// @param column the position of the column, begin with 0
+            /// @return the values one after another
+            const char* GetData(int column) const;
+
+            /// @brief Get the values of a COLUMN_INTEGER column
+            /// @param column the position of the column, begin with 0
+            /// @return the values, one for each row
+            const long long* GetIntegers(int column) const;
+
+            /// @brief Get the values of a COLUMN_DOUBLE column
+            /// @param column the position of the column, begin with 0
+            /// @return the values, one for each row
+            const double* GetDoubles(int column) const;
+
+            /// @brief Whether a value is NULL
+            /// @param row the position of the row, begin with 0
+            /// @param column the position of the column, begin with 0
+            /// @return true if it is NULL
+            bool IsNull(int row, int column) const;
+
+            /// @brief Get a value of a COLUMN_TEXT column, which is not ended by '\0'
+            /// @param row the position of the row, begin with 0
+            /// @param column the position of the column, begin with 0
+            /// @param length the length of the value
+            /// @return the value
+            const char* GetValue(int row, int column, unsigned long& length) const;
+
+            /// @brief Get the map of the column names and their positions
+            /// @return the map, 0 if it is not known
+            map<string, int>* GetColumnIndex() const;
+
+            /// @brief Get the connection the rows come from
+            /// @return the connection
+            const DbLocation* GetLocation() const;
+
+            /// @brief Remove all the rows and fill the block with the rows of a block kept row by row
+            /// @param rows the rows
+            /// @note A @c ContainerFullException is thrown if a text column would go beyond its 32-bit offsets.
+            /// The block is left empty.
+            void Assign(RowBlock& rows) throw (COMMON::EXCEPTION::ThrowableException);
+
+            /// @brief Add the rows of a block kept row by row, which have the same columns as the rows in the block
+            /// @param rows the rows
+            /// @note A @c ContainerFullException is thrown if a text column would go beyond its 32-bit offsets.
+            /// No row is added then.
+            void Append(RowBlock& rows) throw (COMMON::EXCEPTION::ThrowableException);
+
+        private:
+            // the buffers of a column
+            struct Column
+            {
+                RowBlock::ColumnType type_;
+                vector<unsigned char> validity_;
+                int null_count_;
+                vector<int> offsets_;
+                string data_;
+                vector<long long> integers_;
+                vector<double> doubles_;
+            };
+
+        private:
+            int capacity_;
+
+            bool native_numbers_;
+
+            // the types asked for by ParseColumn()
+            map<int, RowBlock::ColumnType> parse_types_;
+
+            int row_count_;
+
+            vector<Column> columns_;
+
+            map<string, int>* column_index_;
+
+            const DbLocation* location_;
+        };
+    }
+}
+
+#endif
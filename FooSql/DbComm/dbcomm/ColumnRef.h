@@ -0,0 +1,38 @@
+/// @file ColumnRef.h
+/// @brief The file defines a handle of a column resolved from its name once.
+
+/// @author Aicro Ai
+/// @date 2015/6/29
+
+#ifndef COMMON_DBCOMM_COLUMNREF_H_
+#define COMMON_DBCOMM_COLUMNREF_H_
+
+namespace COMMON
+{
+    namespace DBCOMM
+    {
+        /// @brief The position of a column found by its name once, see @c DbQueryRslt::GetColumnRef(). A row
+        /// gives the value of it without looking up the name again, so resolve the columns before the loop
+        /// over the rows, and use the handles in it.
+        class ColumnRef
+        {
+        public:
+            /// @brief Constructor
+            /// @param index the position of the column, begin with 0, -1 for none
+            explicit ColumnRef(int index = -1);
+
+            /// @brief Get the position of the column
+            /// @return the position, begin with 0, -1 for none
+            int GetIndex() const { return index_; }
+
+            /// @brief Whether it refers to a column
+            /// @return true if so
+            bool IsValid() const { return index_ >= 0; }
+
+        private:
+            int index_;
+        };
+    }
+}
+
+#endif
@@ -27,6 +27,8 @@ namespace COMMON
             
             virtual ~DB2DbTasks() throw ();
             
+            virtual DbExecuteAction* BatchInsert( int commitLimit = 5000, int valuesLimit = 10);
+            
             virtual DbExecuteAction* BatchInsertIgnore( int commitLimit, int valuesLimit);
             
             DbExecuteAction* BatchReplace( int commitLimit, int valuesLimit);
@@ -21,6 +21,8 @@ extern "C"
 }
 
 #include <string>
+#include <vector>
+#include <map>
 #include <algorithm>
 
 #include "dbcomm/DbEngine.h"
@@ -34,6 +36,25 @@ namespace COMMON
         class DB2Engine : public DbEngine
         {
         private:
+            /// @brief A prepared statement kept by a connection
+            struct CachedStatement
+            {
+                /// @brief the statement handle
+                SQLHSTMT hstmt;
+                
+                /// @brief when it was used last time, to find the least recently used one
+                unsigned long long last_use;
+                
+                /// @brief the SQL types of the parameters
+                vector<SQLSMALLINT> param_types;
+                
+                /// @brief the sizes of the parameters, such as 64 for a VARCHAR(64)
+                vector<SQLULEN> param_sizes;
+                
+                /// @brief the decimal digits of the parameters
+                vector<SQLSMALLINT> param_digits;
+            };
+            
             /// @brief A handle wrapper for CLI
             class Db2RealHandle : public RealHandle
             {
@@ -42,10 +63,15 @@ namespace COMMON
                     : RealHandle()
                 {
                     res    = 0;
+                    row    = 0;
                     tmpCol = 0;
                     colNum = 0;
                     maxLen = 0;
                     lengths = 0;
+                    stmt_uses = 0;
+                    block_mode = BLOCK_NONE;
+                    block_size = 0;
+                    block_fetched = 0;
                     
                     //
                     rc = SQLAllocHandle(SQL_HANDLE_ENV,SQL_NULL_HANDLE,&henv);
@@ -56,10 +82,23 @@ namespace COMMON
                 
                 virtual ~Db2RealHandle()
                 {
+                    CloseStatements();
+                    
                     rc = SQLFreeHandle(SQL_HANDLE_DBC,hdbc);
 
                     rc = SQLFreeHandle(SQL_HANDLE_ENV,henv);
                 }
+                
+                /// @brief Free all the prepared statements, they must be freed before disconnecting
+                void CloseStatements()
+                {
+                    map<string, CachedStatement>::iterator it = stmts.begin();
+                    for (; it != stmts.end(); it++)
+                    {
+                        SQLFreeHandle(SQL_HANDLE_STMT, it->second.hstmt);
+                    }
+                    stmts.clear();
+                }
 
             public:
                 /// @brief environment handle
@@ -77,6 +116,9 @@ namespace COMMON
                 /// @brief result set
                 char**    res;
                 
+                /// @brief the values of the current row, pointing to res, 0 for NULL
+                char**    row;
+                
 				/// @brief a buffer for SQLGetData.
                 char*     tmpCol;     
                 
@@ -91,15 +133,60 @@ namespace COMMON
                 
 				/// @brief the real length of the each columns in the current row
                 unsigned long*   lengths;
+                
+                /// @brief the prepared statements of the connection, keyed by their SQL text
+                map<string, CachedStatement> stmts;
+                
+                /// @brief counts the uses of the prepared statements
+                unsigned long long stmt_uses;
+                
+                /// @brief the arrays of the parameters, a column of values for each parameter
+                vector<vector<char> > param_buffers;
+                
+                /// @brief the lengths of the values in @c param_buffers, or SQL_NULL_DATA
+                vector<vector<SQLLEN> > param_indicators;
+                
+                /// @brief how the open result set is fetched by blocks
+                enum BlockMode
+                {
+                    /// @brief no block has been fetched yet
+                    BLOCK_NONE,
+                    
+                    /// @brief the columns are bound to @c block_buffers
+                    BLOCK_BOUND,
+                    
+                    /// @brief the columns cannot be bound, the rows are fetched one by one
+                    BLOCK_ROWS
+                } block_mode;
+                
+                /// @brief the number of rows fetched by one SQLFetch when the columns are bound
+                int block_size;
+                
+                /// @brief the arrays the columns are bound to, a column of values for each one
+                vector<vector<char> > block_buffers;
+                
+                /// @brief the lengths of the values in @c block_buffers, or SQL_NULL_DATA
+                vector<vector<SQLLEN> > block_indicators;
+                
+                /// @brief the C types the columns are bound as
+                vector<SQLSMALLINT> block_types;
+                
+                /// @brief the width of a value in @c block_buffers of each column
+                vector<SQLLEN> block_widths;
+                
+                /// @brief the status of each row fetched by the last SQLFetch
+                vector<SQLUSMALLINT> block_status;
+                
+                /// @brief the number of rows fetched by the last SQLFetch
+                SQLULEN block_fetched;
             };
-            /// @brief handles for each connections
-            map<DbLocation, tr1::shared_ptr<Db2RealHandle> > handles_;
 
         public:
             /// @brief Constructor
             /// @param locations locations to connect
             /// @param task the @c IDbTasks that generate this instance
-            DB2Engine(vector<DbLocation>& locations, tr1::shared_ptr<IDbTasks> task);
+            /// @param connectionsPerLocation the number of connections to each location
+            DB2Engine(vector<DbLocation>& locations, tr1::shared_ptr<IDbTasks> task, int connectionsPerLocation = 1);
             
             virtual ~DB2Engine();
                 
@@ -130,6 +217,20 @@ namespace COMMON
             virtual unsigned int    Execute(void* handle,  DbLocation* location, const char* statement, size_t length, tr1::shared_ptr<IException>& exception) throw ();
 
             virtual char*   EscapeString(void* handle, DbLocation* location, const char* src, long length, tr1::shared_ptr<IException>& exception) throw ();
+            
+            virtual StringEscaper   CreateStringEscaper(void* handle, DbLocation* location) throw ();
+            
+            /// @brief Execute a prepared statement for all the rows of parameters by one call. The parameters
+            /// are bound as arrays, a column of values for each one, so the statement is prepared once
+            /// whatever the number of rows is. A statement without parameters is executed directly.
+            virtual long long       PreparedExecute(void* handle,  DbLocation* location, const PreparedFilter* filter, tr1::shared_ptr<IException>& exception) throw ();
+            
+            /// @brief Fetch a block of rows by one call. The columns are bound to arrays on the first block
+            /// of a result set, and the numbers are bound in binary if the block asks for it. A result set with
+            /// a column too wide to be bound, such as a LOB, is fetched row by row.
+            virtual int             FetchBlock(void* handle, DbLocation* location, RowBlock* block, tr1::shared_ptr<IException>& exception) throw ();
+            
+            virtual int             GetColumnCount(void* handle, DbLocation* location, tr1::shared_ptr<IException>& exception) throw ();
       
         protected:
             long long GetAffectedRows( long long &affectRows, void* handle, int sqlCode, string errorMsg );
@@ -139,7 +240,7 @@ namespace COMMON
                 
             virtual void UninitThread();
             
-            virtual tr1::shared_ptr<DbEngine::RealHandle> GetRealHandle(DbLocation& location);
+            virtual tr1::shared_ptr<DbEngine::RealHandle> CreateRealHandle(DbLocation& location);
             
         private:
             // Get error msg from an statement handle
@@ -152,6 +253,25 @@ namespace COMMON
             string& ExtractErrMsgEnv( int& sqlCode, void* handle,string &errorMsg);
             
             string FormErrMsg(int recNum, SQLCHAR* sqlstate, int nagativeSqlCode, SQLCHAR* errMsg);
+            
+            // Get error msg from a prepared statement handle
+            string& ExtractErrMsgPrepared( int& sqlCode, SQLHSTMT hstmt, string &errorMsg);
+            
+            // Get the prepared statement from the cache, or prepare it. 0 on error.
+            CachedStatement* GetStatement( Db2RealHandle* handle, const char* statement, size_t length, int& sqlCode, string& errorMsg );
+            
+            // Free a prepared statement and remove it from the cache
+            void DropStatement( Db2RealHandle* handle, SQLHSTMT hstmt );
+            
+            // Bind all the rows of parameters of the filter as arrays
+            bool BindParamArrays( Db2RealHandle* handle, CachedStatement* stmt, const PreparedFilter* filter, int& sqlCode, string& errorMsg );
+            
+            // Bind the columns of the open result set to arrays of the given number of rows.
+            // False if a column is too wide to be bound, or on error.
+            bool BindColumnArrays( Db2RealHandle* handle, int rows, bool nativeNumbers, int& sqlCode, string& errorMsg );
+            
+            // Unbind the columns bound by BindColumnArrays
+            void UnbindColumnArrays( Db2RealHandle* handle );
         };
     }
 }
@@ -15,6 +15,40 @@ namespace COMMON
 {
     namespace DBCOMM
     {
+        /// @brief A multi-value INSERT action for DB2. The values are sent as arrays of parameters
+        /// of a prepared statement, see @c DB2InsertStmtGen.
+        class DB2BatchInsertAction : public DbBatchAction
+        {
+        public:
+            /// @brief Constructor
+			/// @param dbtasks a pointer to a @c DbTasks instance that generate the action
+            /// @param engine the real engine instance underline
+            /// @param isActionFinished a signal to inform the @c DbTasks instance, the parent of this action, whether the action is finished
+			/// @param valuesPerBatch This parameter indicates the limit of buffered values. If it has been reached, we should send a full statement to the server
+			/// @param timesToCommit This parameter indicates the limit of uncommited affected rows. If it has been reached, we should send a commit statement to the server
+            DB2BatchInsertAction(            
+                tr1::shared_ptr<IDbTasks> dbtasks, 
+                tr1::shared_ptr<DbEngine> engine, 
+                bool& isActionFinished, 
+                int valuesPerBatch, 
+                int timesToCommit)
+                : DbBatchAction(
+                    dbtasks, engine, isActionFinished, valuesPerBatch, timesToCommit)
+            {
+                vector<DbLocation>& allDb = task_.lock()->GetDbLocations();
+                for (int i = 0; i < allDb.size(); i++)
+                {
+                    elems_[allDb[i]].reset(new DB2InsertStmtGen());
+                }
+            }
+
+            virtual ~DB2BatchInsertAction() {}
+            
+        protected:
+            // the statements are formed into PreparedFilter
+            virtual ActionType_C GetRealActionType() { return DbEngine::ActionTypeDef::PREPARED_EXECUTE; }
+        };
+        
         /// @brief A INSERT-ON-DUPLICATE-PRI-KEY-UPDATE action for DB2
         class DB2ReplaceBatchAction : public DbBatchAction
         {
@@ -42,6 +76,10 @@ namespace COMMON
             }
 
             virtual ~DB2ReplaceBatchAction() {}
+            
+        protected:
+            // the statements are formed into PreparedFilter
+            virtual ActionType_C GetRealActionType() { return DbEngine::ActionTypeDef::PREPARED_EXECUTE; }
         };   
         
         /// @brief DB2Ķ
@@ -96,6 +134,10 @@ namespace COMMON
             }
 
             virtual ~DB2InsertIgnoreBatchAction() {}
+            
+        protected:
+            // the statements are formed into PreparedFilter
+            virtual ActionType_C GetRealActionType() { return DbEngine::ActionTypeDef::PREPARED_EXECUTE; }
         }; 
     }
 }
@@ -44,20 +44,78 @@ namespace COMMON
             static void SetPriKeys(const DbLocation& location, const string& tblName, vector<string>& priKeys);    
         };
         
+        /// @brief INNER USE ONLY. The class is used to globally buffer the types of the columns of all DB2 tables,
+        /// such as "VARCHAR(64)", which type the parameters of a MERGE INTO statement.
+        class DB2ColumnTypes
+        {
+        private:
+            // The column type buffers.
+            // The KEY is a string composed by connected DB information and table name.
+            // The VALUE is the types of the columns, keyed by the column names in upper case.
+            static map<string, map<string, string> > column_types_;
+            
+            // The mutex to ensure that the global buffer for column types may be sequenced accessed
+            static Mutex column_type_mutex_;
+            
+        public:
+            // The method is to get the types of the columns of a table
+            static map<string, string> GetColumnTypes(const DbLocation& location, const string& tblName);
+        };
+        
+        /// @brief INNER USE ONLY. The class is to generate a multi-value INSERT statement for DB2.
+        /// If all the values are literals, the statement is "INSERT INTO tbl (col1,col2) VALUES (?,?)"
+        /// with the values bound as arrays of parameters, so it is prepared once whatever the number of values is.
+        class DB2InsertStmtGen : public InsertStmtGen
+        {
+        public:
+            virtual StmtGenerator* NewInstance() const { return new DB2InsertStmtGen(); }
+            
+            virtual tr1::shared_ptr<DbActionFilter> FormFilter(const DbLocation& dbLocation, string& buffer);
+        };
+        
+        /// @brief INNER USE ONLY. The base class to generate a MERGE INTO statement. If all the values are
+        /// literals, the rows are read from a row of typed parameters, such as "VALUES (CAST(? AS INTEGER))", 
+        /// with the values bound as arrays of parameters. Otherwise the values are written in the statement.
+        class DB2MergeStmtGen : public StmtGenerator
+        {
+        public:
+            /// @brief Constructor
+            /// @param updateMatched whether to update the rows with the same primary keys, or leave them alone
+            explicit DB2MergeStmtGen(bool updateMatched);
+            
+            virtual StmtGenerator* NewInstance() const { return new DB2MergeStmtGen(update_matched_); }
+            
+            virtual string FormStatement(const DbLocation& dbLocation);
+            
+            virtual tr1::shared_ptr<DbActionFilter> FormFilter(const DbLocation& dbLocation, string& buffer);
+            
+            virtual size_t GetStatementSize() const;
+            
+        private:
+            // form the statement, merging the rows of the source
+            string FormMerge(const DbLocation& dbLocation, const string& source);
+            
+            // form a row of typed parameters, false if the type of a column is unknown
+            bool FormParamSource(const DbLocation& dbLocation, string& source);
+            
+        private:
+            bool update_matched_;
+        };
+        
         /// @brief INNER USE ONLY. The class is to generate a INSERT-UPDATE statement.
 		/// For DB2, that will be MERGE INTO statement.
-        class DB2ReplaceStmtGen : public StmtGenerator
+        class DB2ReplaceStmtGen : public DB2MergeStmtGen
         {
         public:
-            virtual string FormStatement(const DbLocation& dbLocation);
+            DB2ReplaceStmtGen() : DB2MergeStmtGen(true) {}
         };
         
         /// @brief INNER USE ONLY. The class is to generate a INSERT-IGNORE statement.
 		/// For DB2, that will be MERGE INTO statement.
-        class DB2InsertIgnoreStmtGen : public StmtGenerator
+        class DB2InsertIgnoreStmtGen : public DB2MergeStmtGen
         {
         public:
-            virtual string FormStatement(const DbLocation& dbLocation);
+            DB2InsertIgnoreStmtGen() : DB2MergeStmtGen(false) {}
         };
         
         /// @brief ڲͣҪƴճӦDB2Ļȡ䡣
@@ -66,7 +124,7 @@ namespace COMMON
         class DB2GetPriKeyStmtGen : public StmtGenerator
         {
         public:
-            virtual bool MakeupStatement(vector<string>&, string, string , bool);
+            virtual bool MakeupStatement(vector<string>&, const string&, const string&, bool, unsigned long long);
             
             virtual string FormStatement(const DbLocation& dbLocation);
         };
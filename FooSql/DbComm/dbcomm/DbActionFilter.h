@@ -28,9 +28,9 @@ namespace COMMON
 			/// @param commands the commands to send
 			/// @param additionInfo additional information to send, usually it is ignored
             DbActionFilter(string contents, void* additionInfo = 0) 
+                : contents_(contents)
             {   
                 addition_info_ = additionInfo;
-                contents_ << contents;
             }
 
 			/// @brief Constructor
@@ -38,9 +38,9 @@ namespace COMMON
 			/// @param length the length of the command buffer
 			/// @param additionInfo additional information to send, usually it is ignored
             DbActionFilter(const char* contents, long length, void* additionInfo = 0) 
+                : contents_(contents, length)
             { 
                 addition_info_ = additionInfo;
-                contents_.write(contents, length);
             }
     
 			/// @brief Copy Constructor
@@ -59,8 +59,10 @@ namespace COMMON
                     return *this;
                 }
     
-                SetContents(other.contents_.str());
+                contents_ = other.contents_;
                 addition_info_ = other.addition_info_;
+                
+                return *this;
             }
     
 			/// @brief Explicitly set the commands
@@ -68,8 +70,7 @@ namespace COMMON
 			/// @param length the length of the command buffer
             void SetContents(const char* contents, long length) 
             { 
-                contents_.str("");
-                contents_.write(contents, length);
+                contents_.assign(contents, length);
             }
     
 			/// @brief Explicitly set the commands
@@ -79,11 +80,34 @@ namespace COMMON
                 SetContents(contents.c_str(), contents.size());
             }
 			
+			/// @brief Exchange the commands with a buffer, without copying. It is the way to hand 
+			/// a large statement, such as a multi-value INSERT, to the filter.
+			/// @param contents the buffer holding the commands to send. It gets the old commands.
+            void SwapContents(string& contents)
+            {
+                contents_.swap(contents);
+            }
+			
 			/// @brief Get the inner commands
 			/// @return inner commands
             string GetContents()
             {
-            	return contents_.str();
+            	return contents_;
+            }
+            
+			/// @brief Get the inner commands without copying them. The buffer is valid until the
+			/// commands are changed.
+			/// @return the buffer of the inner commands
+            const char* GetData() const
+            {
+                return contents_.data();
+            }
+            
+			/// @brief Get the length of the inner commands
+			/// @return the length of the inner commands
+            size_t GetLength() const
+            {
+                return contents_.size();
             }
             
 			/// @brief Get the inner additional information if any
@@ -101,7 +125,7 @@ namespace COMMON
             }
             
         private:
-            stringstream contents_;
+            string contents_;
             
             void* addition_info_;
         };
@@ -7,9 +7,16 @@
 #ifndef COMMON_DBCOMM_BATCHACTION_H_
 #define COMMON_DBCOMM_BATCHACTION_H_
 
+#include "dbcomm/IDbTasks.h"
 #include "dbcomm/DbExecuteAction.h"
 #include "dbcomm/BatchFilter.h"
 #include "dbcomm/StmtGenerator.h"
+#include "dbcomm/FlushPolicy.h"
+#include "dbcomm/BatchTuner.h"
+
+#include "thread/Mutex.h"
+#include "thread/Condition.h"
+#include "thread/Thread.h"
 
 namespace COMMON
 {
@@ -18,18 +25,85 @@ namespace COMMON
         /// @brief The base class for batch action. It is designed according to strategy design pattern, 
 		/// that it just defines some common works and framework for batch operations, while the details are left
 		/// for concrete @c StatementGenerator instance.
+        ///
+        /// The values of different tables, or of different columns of a table, are buffered apart for each DB, 
+        /// so the rows of several tables may come in turn without sending small statements. Each buffer is
+        /// sent by the flush policy by itself, so the statements of different tables may not run in the order
+        /// their rows came.
         class DbBatchAction : public DbInsertAction
         {
         protected:
-            // This parameter indicates the limit of buffered values. 
-			// If it has been reached, we should send a full statement to the server
-            int values_per_batch_;
+            // The values of one table and columns buffered for a DB
+            struct TableBuffer
+            {
+                TableBuffer() : fingerprint_(0), values_(0), buffered_since_(0) {}
+                
+                // the BatchFilter::GetFingerprint() of the table and columns, 0 for none yet
+                unsigned long long fingerprint_;
+                
+                // the generator buffering the values
+                tr1::shared_ptr<StmtGenerator> elem_;
+                
+                // the number of values buffered
+                unsigned int values_;
+                
+                // the milliseconds when the first of the values came, for the age trigger
+                long long buffered_since_;
+            };
+            
+            // A buffer of a DB, by its position in buffers_
+            typedef pair<DbLocation, int> BufferRef;
 
-            // A buffer recording already affected rows for each DB connections.
-            map<DbLocation, unsigned int> values_now_;
+            // When the buffered values are sent as a statement, see SetFlushPolicy()
+            FlushPolicy flush_policy_;
 
 			// A buffer storing different concrete statement generator for each DB connections.
-            map<DbLocation, tr1::shared_ptr<StmtGenerator> > elems_;
+            // It is the first of the buffers of the DB, and the others are made from it.
+            DbLocationMap<tr1::shared_ptr<StmtGenerator> > elems_;
+
+            // The buffers of each DB, one for each table and columns, at most MAX_TABLE_BUFFERS of them.
+            // When all of them are taken, the fullest one is sent to make room for another table.
+            static const int MAX_TABLE_BUFFERS = 16;
+            DbLocationMap<vector<TableBuffer> > buffers_;
+
+            // The number of formed statements sent together to one DB. It is the number of 
+            // connections to each DB, so that the statements run at the same time.
+            int flushes_in_flight_;
+
+            // Formed statements waiting for the others to be sent together.
+            map<DbLocation, vector<tr1::shared_ptr<DbActionFilter> > > pending_flushes_;
+
+            // Whether the formed statements are sent without waiting for them, see SetPipelined().
+            bool pipelined_;
+
+            // The statements sent but not waited for in the pipelined mode, and their filters.
+            tr1::shared_ptr<DbCompletion> in_flight_;
+            map<DbLocation, vector<tr1::shared_ptr<DbActionFilter> > > in_flight_filters_;
+
+            // The buffers of the finished statements, reused to form the next ones.
+            vector<string> spare_buffers_;
+
+            // The controller of the values per statement and the commit limits, see SetTuner().
+            tr1::shared_ptr<BatchTuner> tuner_;
+
+            // The values of the statements waiting in pending_flushes_ and in flight, for the tuner,
+            // and when those in flight were sent.
+            DbLocationMap<long long> pending_rows_;
+            DbLocationMap<long long> in_flight_rows_;
+            long long in_flight_since_;
+
+            // Held by the calls and the timer, which both send the buffered values.
+            THREAD::Mutex mutex_;
+
+            // The timer sending the buffered values too old, and the condition to stop it.
+            tr1::shared_ptr<THREAD::Thread> timer_;
+            THREAD::Condition timer_condition_;
+            bool timer_stopping_;
+
+            // The failure of the statements sent by the timer, reported by the next Do() or EndAction() on
+            // the thread of the user. The timer always throws its errors to keep them here.
+            bool timer_failed_;
+            tr1::shared_ptr<COMMON::EXCEPTION::ThrowableException> timer_exception_;
 
         public:
 			/// @brief Constructor
@@ -53,14 +127,113 @@ namespace COMMON
 
             virtual bool Do(map<DbLocation, DbActionFilter*>& works, map<DbLocation, long long>* affected_rows = 0) throw (COMMON::EXCEPTION::ThrowableException);
 
+            virtual bool Do(map<DbLocation, vector<DbActionFilter*> >& works, map<DbLocation, long long>* affected_rows = 0) throw (COMMON::EXCEPTION::ThrowableException);
+
             virtual bool EndAction(map<DbLocation, long long>* affected_rows = 0) throw (COMMON::EXCEPTION::ThrowableException);
+
+            /// @brief Set the pipelined mode. In this mode a formed statement is sent without waiting for it, 
+            /// and it is waited for only when the next one is formed. So the server executes a statement while 
+            /// the next one is being made up. As a result, the affected rows returned by @c Do() are those of 
+            /// the statements finished during the call, and the errors of a statement are reported by the next
+            /// @c Do() or @c EndAction().
+            /// @param pipelined true to use the pipelined mode. It is off by default.
+            /// @return the old mode
+            bool SetPipelined(bool pipelined);
+
+            /// @brief Set when the buffered values of a DB are sent as a statement. If the policy has an age
+            /// limit, a background timer sends the values buffered for too long, even if no more values come.
+            /// The rows affected by the statements of the timer are not returned by @c Do(), but they are
+            /// counted in @c GetRslt(), and their errors are reported by the next @c Do() or @c EndAction(),
+            /// after the values given to it are buffered, and only if it has no error of its own.
+            /// @c EndAction() reports them after the values left are sent and committed.
+            /// @param policy the policy. By default only the rows are limited, by the valuesLimit given to
+            /// @c IDbTasks::BatchInsert() and the like.
+            void SetFlushPolicy(const FlushPolicy& policy);
+
+            /// @brief Get when the buffered values of a DB are sent as a statement
+            /// @return the policy
+            FlushPolicy GetFlushPolicy();
+
+            /// @brief Tune the values per statement and the commit limit of each DB by the latency and the
+            /// rows per second of its statements, instead of the valuesLimit and commitLimit given. They
+            /// are tuned from those limits. The decisions are got by @c DbBatchRslt::GetTuningDecisions()
+            /// of @c GetRslt(). The other triggers of the flush policy still work.
+            /// @param tuner the controller, empty to stop tuning. The limits tuned so far are kept.
+            void SetTuner(const tr1::shared_ptr<BatchTuner>& tuner);
+
+            /// @brief Get the result, a @c DbBatchRslt
+            /// @return the result
+            virtual DbRslt* GetRslt();
          
         private:
             // Make up the whole statement. The concrete work is done by the elem. The commands are passed by filter.
             bool MakeupStatement(const tr1::shared_ptr<StmtGenerator>& elem, BatchFilter* filter);
 
+            // Buffer the values of a filter for a DB, and send the buffered ones if the policy says so
+            bool DoOne(BatchFilter* filter, const DbLocation& location, long long* affected_rows);
+
+            // Get the buffers of a DB, the first of which is made of elems_
+            vector<TableBuffer>& GetBuffers(const DbLocation& location);
+
+            // Find the position of the buffer of the table and columns of a filter for a DB, taking an empty
+            // one or making one if there is none. -1 if all the buffers are taken, and the one to be sent to
+            // make room is put in victim.
+            int FindBuffer(const DbLocation& location, BatchFilter* filter, int& victim);
+
+            // Whether the row of a filter would make the statement of a buffer go beyond the packet limit
+            bool IsBeyondPacket(const DbLocation& location, const TableBuffer& buffer, BatchFilter* filter);
+
+            // Put the values of a filter into a buffer of a DB, which may be of another table if it is empty.
+            // The values of the buffer are sent first if they are not compatible with them.
+            bool Append(const DbLocation& location, int buffer, BatchFilter* filter, long long* affected_rows);
+
+            // Whether the values of a buffer of a DB are to be sent because of their rows or bytes
+            bool IsFull(const DbLocation& location, const TableBuffer& buffer);
+
+            // Tell the tuner about statements finished for a DB since a time, and follow its commit limit.
+            // Nothing of the DB may be running.
+            void RecordSent(const DbLocation& location, long long rows, int statements, long long since);
+
+            // Send the values of a buffer of a DB. The affected rows are added to affected_rows.
+            bool FlushOne(const DbLocation& location, int buffer, long long* affected_rows);
+
+            // Send the values of several buffers together. With the deferred statements, those of the
+            // DBs having at least minCount of them are sent. The affected rows are added to affected_rows.
+            bool FlushMany(const vector<BufferRef>& buffers, int minCount, map<DbLocation, long long>* affected_rows);
+
             // Do all the left work
             bool DoAllLeft(map<DbLocation, long long>* affected_rows = 0);
+
+            // End a call: throw the first exception of the call, or else report the failure of the statements
+            // sent by the timer in the mode of the tasks. Returns whether both succeeded.
+            bool FinishCall(bool success, tr1::shared_ptr<COMMON::EXCEPTION::ThrowableException>& error) throw (COMMON::EXCEPTION::ThrowableException);
+
+            // Start the timer if the policy has an age limit, or stop it
+            void StartTimer();
+            void StopTimer();
+
+            // The loop of the timer, and the sending of the values too old
+            static void* RunTimer(void* arg);
+            void FlushExpired();
+
+            // Send the waiting statements of those DBs having at least minCount of them. 
+            // The affected rows are added to affected_rows.
+            bool SendPendingFlushes(int minCount, map<DbLocation, long long>* affected_rows = 0);
+
+            // Wait for the statements sent in the pipelined mode. The affected rows are added to affected_rows.
+            bool WaitInFlight(map<DbLocation, long long>* affected_rows = 0);
+
+            // Form the buffered values of a DB into the filter to send, and clear them. Empty if there is none.
+            tr1::shared_ptr<DbActionFilter> FormFlush(const DbLocation& location, const tr1::shared_ptr<StmtGenerator>& elem);
+            
+            // Take a buffer to form a statement in, which has kept the capacity of a finished statement
+            void TakeBuffer(string& buffer);
+
+            // Give the buffer of a finished statement back for reusing
+            void GiveBackBuffer(DbActionFilter& filter);
+
+            // Whether the formed statements should be kept and sent by SendPendingFlushes()
+            bool IsFlushDeferred() const { return flushes_in_flight_ > 1 || pipelined_; }
         };
 
         /// @brief An action for multi-value insert work.
@@ -6,16 +6,28 @@
 
 #include "dbcomm/DbQueryAction.h"
 #include "dbcomm/DbExecuteAction.h"
+#include "dbcomm/DbBatchAction.h"
 #include "dbcomm/EscapeStringAction.h"
+#include "dbcomm/DbCompletion.h"
 
 #include "dbcomm/DbActionFilter.h"
 #include "dbcomm/DbActionFilter.h"
 #include "dbcomm/BatchFilter.h"
+#include "dbcomm/PreparedFilter.h"
 
 #include "dbcomm/DbQueryRslt.h"
 #include "dbcomm/DbExecuteRslt.h"
 
 #include "dbcomm/Row.h"
+#include "dbcomm/RowBlock.h"
+#include "dbcomm/RowStream.h"
+#include "dbcomm/MergeCursor.h"
+#include "dbcomm/HashAggregator.h"
+#include "dbcomm/HashJoin.h"
+#include "dbcomm/ExternalSort.h"
+#include "dbcomm/ColumnBlock.h"
+#include "dbcomm/ColumnRef.h"
+#include "dbcomm/StringEscaper.h"
 #include "dbcomm/Value.h"
 
 #include "exception/ThrowableException.h"
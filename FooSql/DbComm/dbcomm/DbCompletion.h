@@ -0,0 +1,114 @@
+/// @file DbCompletion.h
+/// @brief The file defines a handle for the commands submitted to @c DbEngine without waiting.
+
+/// @author Aicro Ai
+/// @date 2015/6/9
+
+#ifndef COMMON_DBCOMM_DBCOMPLETION_H_
+#define COMMON_DBCOMM_DBCOMPLETION_H_
+
+#include <map>
+#include <vector>
+#include <tr1/memory>
+#include <tr1/functional>
+
+#include "dbcomm/DbEngine.h"
+
+#include "exception/ThrowableException.h"
+
+#include "thread/CountDownLatch.h"
+
+using namespace std;
+
+namespace COMMON
+{
+    namespace DBCOMM
+    {
+        class IDbTasks;
+        
+        /// @brief A handle, like a future, for the commands given by @c DbEngine::Submit(). 
+        /// The commands are running in the working threads while the caller goes on. The 
+        /// results can be got by waiting for, or polling, the handle.
+        ///
+        /// Errors are handled as @c DbEngine::Do() does: they are thrown in the exception mode, 
+        /// otherwise @c Wait() or @c Poll() returns false and the error can be got by @c IDbTasks::GetLastError().
+        /// An error is reported only once, by the first call finding the commands finished. The later calls
+        /// return the same result without throwing or setting the error again.
+        class DbCompletion
+        {
+        public:
+            /// @brief The function called when the commands are finished
+            typedef tr1::function<void (DbCompletion&)> Callback;
+            
+            ~DbCompletion();
+            
+            /// @brief Wait until all the commands are finished.
+            /// @return success or not
+            bool Wait() throw (COMMON::EXCEPTION::ThrowableException);
+            
+            /// @brief Check whether all the commands are finished, without blocking.
+            /// @return true means finished, then @c IsSuccess() tells the result.
+            bool Poll() throw (COMMON::EXCEPTION::ThrowableException);
+            
+            /// @brief Register a function to call when the commands are finished. The function is called
+            /// by the thread which finds the commands finished in @c Wait() or @c Poll(), or at once if 
+            /// that has happened.
+            /// @note The working threads never call it. If nobody waits for or polls the handle, the 
+            /// function is never called, even though the commands are finished.
+            /// @param callback the function to call
+            void Then(Callback callback) throw (COMMON::EXCEPTION::ThrowableException);
+            
+            /// @brief Whether the commands are successful. Only meaningful after they are finished.
+            /// @return true means no error
+            bool IsSuccess() const { return success_; }
+            
+            /// @brief Get the results of the commands. Only meaningful after they are finished.
+            /// @return A map for affected connections and their associate results, in the same order as the commands
+            map<DbLocation*, vector<void*> >& GetRslt() { return rslt_; }
+            
+        private:
+            friend class DbEngine;
+            
+            DbCompletion(tr1::weak_ptr<IDbTasks> task, int commandNum);
+            
+            DbCompletion(const DbCompletion&);
+            DbCompletion& operator=(const DbCompletion&);
+            
+            // whether the working threads have finished all the commands
+            bool IsDone() const { return latch_.IsDone(); }
+            
+            // collect the results and call the callbacks, only at the first time
+            void Complete() throw (COMMON::EXCEPTION::ThrowableException);
+            
+            // report the error according to the exception mode
+            bool ReportError() throw (COMMON::EXCEPTION::ThrowableException);
+            
+        private:
+            // the commands, owned by the handle
+            vector<DbEngine::InputCommand*> commands_;
+            
+            // which location each of the commands belongs to, 0 for the copies of broadcast commands
+            vector<DbLocation*> owners_;
+            
+            // counted down by the working threads
+            CountDownLatch latch_;
+            
+            tr1::weak_ptr<IDbTasks> task_;
+            
+            map<DbLocation*, vector<void*> > rslt_;
+            
+            vector<Callback> callbacks_;
+            
+            bool completed_;
+            
+            bool success_;
+            
+            // whether the error has been thrown or set to the tasks
+            bool reported_;
+            
+            tr1::shared_ptr<COMMON::EXCEPTION::ThrowableException> error_;
+        };
+    }
+}
+
+#endif
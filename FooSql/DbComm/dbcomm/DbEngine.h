@@ -13,14 +13,20 @@
 
 #include "dbcomm/CommDef.h"
 #include "dbcomm/DbLocation.h"
+#include "dbcomm/DbLocationMap.h"
 #include "dbcomm/DbActionFilter.h"
+#include "dbcomm/PreparedFilter.h"
+#include "dbcomm/RowBlock.h"
+#include "dbcomm/RowStream.h"
+#include "dbcomm/StringEscaper.h"
 
 #include "exception/IException.h"
 #include "exception/ThrowableException.h"
 
 #include "thread/Mutex.h"
 #include "thread/Condition.h"
-#include "thread/BlockingQueue.h"
+#include "thread/SpscQueue.h"
+#include "thread/CountDownLatch.h"
 #include "thread/Thread.h"
 
 using namespace std;
@@ -46,15 +52,33 @@ namespace COMMON
             /// @brief times to reach commit limit.
             unsigned int commit_limit_reach_times_;
             
+            /// @brief the affected rows when the limit was set, from which the limit is counted
+            long long base_rows_;
+            
         public:
             /// @brief Constructor.
             /// @param commitLimit the limit for affected rows before a commit
             CommitJudger(int commitLimit)
-                : commit_limit_reach_times_(0), commit_limit_(commitLimit)
+                : commit_limit_reach_times_(0), commit_limit_(commitLimit), base_rows_(0)
             {
             }
             
             virtual ~CommitJudger() {}
+            
+            /// @brief Get the limit for affected rows before a commit
+            /// @return the limit, 0 for never
+            int GetCommitLimit() const { return commit_limit_; }
+            
+            /// @brief Change the limit for affected rows before a commit. It must not be called while a 
+            /// statement counted by the judger is running.
+            /// @param commitLimit the new limit, 0 for never
+            /// @param affectedRows affected rows currently, from which the new limit is counted
+            void SetCommitLimit(int commitLimit, long long affectedRows)
+            {
+                commit_limit_ = commitLimit;
+                commit_limit_reach_times_ = 0;
+                base_rows_ = affectedRows;
+            }
         
             /// @brief Judge whether we should do a commit or not.
             /// @param affectedRows affected rows currently
@@ -71,7 +95,7 @@ namespace COMMON
 				// the default way is to reach the commit_limit_
                 bool do_commit = false;
 
-                unsigned int times = affectedRows / commit_limit_;
+                unsigned int times = (unsigned int)((affectedRows - base_rows_) / commit_limit_);
                 if (commit_limit_reach_times_ < times)
                 {
                     commit_limit_reach_times_ = times;
@@ -93,12 +117,16 @@ namespace COMMON
         };
         
         class DbEngine;
+        class DbCompletion;
 		
 		/// @brief INNER USE ONLY. The parameter for thread to start.
         struct ThreadStartParam
         {
             DbLocation location_;
             DbEngine* db_engine_;
+            
+            // which connection of the location the thread serves
+            int connection_;
         };
 		
         /// @brief The class which defines all the necessary methods for the concrete DBPMs to implements.
@@ -108,6 +136,8 @@ namespace COMMON
 		/// according to their own underneath HANDLE.
 		class DbEngine : public tr1::enable_shared_from_this<DbEngine>
         {
+            friend class DbCompletion;
+            
         public:
             /// @brief The type of commands, which has formed a set of signal for outside component to communicate
             class ActionTypeDef
@@ -153,9 +183,32 @@ namespace COMMON
                 static ActionType_C NOTHING                         ;
                 /// @brief END THREAD commands
                 static ActionType_C END_THREAD                      ;
+                
+                /// @brief Execute a prepared statement, with a @c PreparedFilter
+                static ActionType_C PREPARED_EXECUTE                ;
+                /// @brief Query by a prepared statement and open the result set, with a @c PreparedFilter
+                static ActionType_C PREPARED_QUERY                  ;
+                
+                /// @brief Fetch a block of rows, the @c RowBlock is the additional information of the filter
+                static ActionType_C FETCH_BLOCK                     ;
+                /// @brief Query and read all the rows ahead into a @c RowStream, which is the additional information of the filter
+                static ActionType_C STREAM_QUERY                    ;
             };
             
         protected:
+            /// @brief A wrapper for results from working threads
+            struct ReturnParam
+            {
+                /// @brief exceptions happened
+                tr1::shared_ptr<IException> exception;
+                
+                /// @brief items to return 
+                void* return_items_; 
+                
+                /// @brief the DB information that represents connection
+                DbLocation* location;
+            };
+            
             /// @brief The commands to transfer to the working threads, including action type, commands and connection.
             class InputCommand
             {
@@ -167,6 +220,10 @@ namespace COMMON
                 { 
                     already_affected_rows_ = 0;
                     commit_judger_ = 0;
+                    filter_ = 0;
+                    latch_ = 0;
+                    queue_ = 0;
+                    affected_rows_mutex_ = 0;
                 }
                 
             public:
@@ -184,6 +241,19 @@ namespace COMMON
 				
                 /// @brief The DB location info which delegates the connection information
                 DbLocation  location_;
+                
+                /// @brief The result slot, written only by the working thread of @c location_
+                ReturnParam rslt_;
+                
+                /// @brief The latch to count down when @c rslt_ is ready
+                CountDownLatch* latch_;
+                
+                /// @brief The ring to the working thread which will do the command
+                SpscQueue<InputCommand*>* queue_;
+                
+                /// @brief Guards @c already_affected_rows_ and @c commit_judger_, which are shared by 
+                /// all the connections of @c location_
+                Mutex* affected_rows_mutex_;
             };
             
             /// @brief The handle wrapper
@@ -195,6 +265,9 @@ namespace COMMON
                 
 				// extra buffer for additional information to convert to the working thread
                 char inner_buf_[4096 + 1];
+                
+                // the result of @c EscapeString(), which grows with the strings
+                string escaped_;
             };
 
         protected:
@@ -202,7 +275,7 @@ namespace COMMON
             tr1::weak_ptr<IDbTasks>                          task_;
             
             /// @brief The buffer for tasks input.
-            map<DbLocation, InputCommand* >    works_;
+            DbLocationMap<InputCommand*>    works_;
             
         private:
             // handles for all the working threads
@@ -211,35 +284,49 @@ namespace COMMON
             // the parameters for thread to start
             ThreadStartParam* thread_start_params_;
             
-            // Mutex and Conditions for getting results from working threads
-            Mutex       mutex_;
-            Condition   result_reached_cond_;
+            // counted down by the working threads, one for each command pushed
+            CountDownLatch works_done_latch_;
+            
+            // commands used when more commands than connections are sent to a location at once
+            vector<InputCommand*> spare_works_;
+            
+            // submitted but maybe not finished commands, kept until they are finished
+            vector<tr1::shared_ptr<DbCompletion> > submitted_;
 
         protected:
-            /// @brief A blocking queue for communication between leader thread and working threads
-            map<DbLocation, BlockingQueue<InputCommand* > > input_blocking_queues_;
-
-            /// @brief A wrapper for results from working threads
-            struct ReturnParam
+            /// @brief All the connections to one DB location. Each connection owns a handle, 
+            /// a working thread and a ring for communication between the leader thread and that 
+            /// working thread. The leader thread is the only producer and the working thread is the only consumer.
+            struct ConnectionGroup
             {
-                /// @brief exceptions happened
-                tr1::shared_ptr<IException> exception;
+                /// @brief handles, one for each connection
+                vector<tr1::shared_ptr<RealHandle> > handles_;
                 
-                /// @brief items to return 
-                void* return_items_; 
+                /// @brief rings, one for each connection
+                vector<tr1::shared_ptr<SpscQueue<InputCommand*> > > queues_;
                 
-                /// @brief the DB information that represents connection
-                DbLocation* location;
+                /// @brief reusable commands, one for each connection. The first one is the same as in @c works_
+                vector<InputCommand*> works_;
+                
+                /// @brief guards the affected rows of the location
+                tr1::shared_ptr<Mutex> affected_rows_mutex_;
+                
+                /// @brief the escaper following the character set of the first connection, set when it connects
+                StringEscaper escaper_;
             };
             
-            /// @brief A queue for output results
-            vector<ReturnParam> thread_return_param_;
+            /// @brief The connections of each DB location
+            DbLocationMap<ConnectionGroup> connection_groups_;
+            
+            /// @brief The number of connections (and working threads) to each DB location
+            int connections_per_location_;
 
         public:
             /// @brief Constructor
             /// @param locations a list of DB information to connect
             /// @param task a pointer to the @c IDbTasks that has created this instance
-            DbEngine(vector<DbLocation>& locations, tr1::shared_ptr<IDbTasks> task);
+            /// @param connectionsPerLocation the number of connections, each served by its own working thread, to each DB location
+            DbEngine(vector<DbLocation>& locations, tr1::shared_ptr<IDbTasks> task, int connectionsPerLocation = 1);
             
             virtual ~DbEngine();
 
@@ -287,6 +374,51 @@ namespace COMMON
                     bool & success,
                     map<DbLocation, AffectedRowRecorder>* alreadyAffectedRows = 0) throw (ThrowableException);
 
+            /// @brief Asynchronise do several commands for each of a range of specific connected DBs. 
+            /// The commands of a DB are spread over its connections, so that up to @c GetConnectionsPerLocation()
+            /// of them are running at the same time.
+            /// @param actionType The action type
+			/// @param locFilters the DB information, which illustrate the connection, and their associated commands to be executed
+            /// @param success output parameter, indicating whether the methods is success or not
+            /// @param alreadyAffectedRows optional. If it is not 0, the number of affected rows will
+			/// be added to it.
+			/// @return A map for affected connections and their associate results, in the same order as the commands
+            /// @note Each connection has its own transaction. Commands sent together must not conflict with each other.
+            virtual map<DbLocation*, vector<void*> > Do(
+                    ActionType_C actionType, 
+                    map<DbLocation, vector<DbActionFilter*> >& locFilters, 
+                    bool & success,
+                    map<DbLocation, AffectedRowRecorder>* alreadyAffectedRows = 0) throw (ThrowableException);
+
+            /// @brief Send several commands for each of a range of specific connected DBs, without waiting for them.
+            /// The commands are spread over the connections as @c Do() does.
+            /// @param actionType The action type
+			/// @param locFilters the DB information, which illustrate the connection, and their associated commands to be executed. 
+            /// The filters must be kept until the commands are finished.
+            /// @param alreadyAffectedRows optional. If it is not 0, the number of affected rows will
+			/// be added to it. It must be kept until the commands are finished.
+			/// @return A handle to wait for, or to poll, the results
+            virtual tr1::shared_ptr<DbCompletion> Submit(
+                    ActionType_C actionType, 
+                    map<DbLocation, vector<DbActionFilter*> >& locFilters, 
+                    map<DbLocation, AffectedRowRecorder>* alreadyAffectedRows = 0);
+
+            /// @brief Send a command for each of a range of specific connected DBs, without waiting for them.
+            /// @param actionType The action type
+			/// @param locFilter the DB information, which illustrate the connection, and their associated commands to be executed.
+            /// The filters must be kept until the commands are finished.
+            /// @param alreadyAffectedRows optional. If it is not 0, the number of affected rows will
+			/// be added to it. It must be kept until the commands are finished.
+			/// @return A handle to wait for, or to poll, the results
+            virtual tr1::shared_ptr<DbCompletion> Submit(
+                    ActionType_C actionType, 
+                    map<DbLocation, DbActionFilter*>& locFilter, 
+                    map<DbLocation, AffectedRowRecorder>* alreadyAffectedRows = 0);
+
+            /// @brief Wait until all the submitted commands are finished. Their results are still kept 
+            /// by their @c DbCompletion.
+            void WaitSubmitted();
+
             /// @brief Synchronise do the tasks input. This method will do the input commands for 
 			/// all the connected DB illustrated in the constructor.
             /// @param actionType The action type
@@ -332,7 +464,7 @@ namespace COMMON
                     map<DbLocation, AffectedRowRecorder>* alreadyAffectedRows = 0) throw (ThrowableException);                    
                     
             // Run the threads
-            void RunThread(DbLocation& location);
+            void RunThread(DbLocation& location, int connection);
 
             /// @brief Initialize the engine
             /// @return success or not
@@ -349,20 +481,45 @@ namespace COMMON
             /// @brief Get connected DB locations
             /// @return connected DB locations
             vector<const DbLocation*> GetDbLocations();
+            
+            /// @brief Get the number of connections to each DB location
+            /// @return the number of connections to each DB location
+            int GetConnectionsPerLocation() const { return connections_per_location_; }
+            
+            /// @brief Get the escaper of strings following the character set of a DB location, which runs on the
+            /// calling thread. It is known after the location is connected.
+            /// @param location the DB location
+            /// @return the escaper, a default one if the location is unknown
+            StringEscaper GetStringEscaper(const DbLocation& location);
 
         private:
-            bool CheckHasException() throw (ThrowableException);
+            bool CheckHasException(vector<InputCommand*>& workList) throw (ThrowableException);
 
             void PushWorkAndWait( vector<InputCommand*>& workList );
+            
+            // add the copies of the commands that must be done by all the connections of a location
+            void AddBroadcastWorks( vector<InputCommand*>& workList, vector<InputCommand*>& pushList );
+            
+            // do a command on the current thread, with the handle(s) of its location
+            ReturnParam SyncRealDo( InputCommand* work );
 
-            map<DbLocation*, void*> GetRslt();
+            map<DbLocation*, void*> GetRslt(vector<InputCommand*>& workList);
 
-            void ClearRslts();
+            void ClearRslts(vector<InputCommand*>& workList);
 
             // a helper methods to do commands, check exceptions and get results
             map<DbLocation*, void*> AsyncDoCheckGetRslt( 
                 vector<InputCommand*>& work_list, 
                 bool &success );
+            
+            // a helper method to add the affected rows of a command, and to commit if necessary
+            void RecordAffectedRows( RealHandle* realHandle, InputCommand* inputParam, long long rows, tr1::shared_ptr<IException>& exception );
+            
+            // whether the action should be done by all the connections of a location
+            static bool IsBroadcastAction( ActionType_C actionType );
+            
+            // forget the submitted commands which have finished
+            void PruneSubmitted();
 
         protected:
             /// @brief Create tasks that can be processed by working threads from the raw commands
@@ -409,8 +566,15 @@ namespace COMMON
             
             /// @brief Get related handles
 			/// @param location the connection that handle belongs to
+            /// @param connection which one of the connections to the location
 			/// @return that handle belongs to the specific connection
-            virtual tr1::shared_ptr<RealHandle> GetRealHandle(DbLocation& location) = 0;
+            tr1::shared_ptr<RealHandle> GetRealHandle(DbLocation& location, int connection = 0);
+            
+            /// @brief Create a new handle for a connection. It will be called @c GetConnectionsPerLocation()
+            /// times for each location during @c InitEngine()
+			/// @param location the connection that handle belongs to
+			/// @return a new handle
+            virtual tr1::shared_ptr<RealHandle> CreateRealHandle(DbLocation& location) = 0;
             
 			// a helper method to do the work
             DbEngine::ReturnParam RealDo(RealHandle* realHandle, InputCommand* inputParam);  
@@ -535,6 +699,65 @@ namespace COMMON
             /// @param exception output parameter. It is the exception that may be occur in the operation
             /// @return the result escaped string, terminated by '\0'
             virtual char*   EscapeString(void* handle, DbLocation* location, const char* src, long length, tr1::shared_ptr<IException>& exception) throw ()  = 0;
+            
+            /// @brief Create the escaper of strings following the character set of a connection, just after it connects.
+            /// The default one escapes as MYSQL does in a single-byte character set.
+            /// @param handle handle for the connection
+            /// @param location DB location representing the connection
+            /// @return the escaper
+            virtual StringEscaper   CreateStringEscaper(void* handle, DbLocation* location) throw ();
+            
+            // Prepared statements, only for the DBMS supporting them. The default ones report an @c UnknownActionException.
+            
+            /// @brief Execute a prepared statement once for each row of parameters
+            /// @param handle handle for the connection
+            /// @param location DB location representing the connection
+            /// @param filter the statement and its parameters
+            /// @param exception output parameter. It is the exception that may be occur in the operation
+            /// @return the number of affected rows of all the rows of parameters
+            virtual long long       PreparedExecute(void* handle,  DbLocation* location, const PreparedFilter* filter, tr1::shared_ptr<IException>& exception) throw ();
+            
+            /// @brief Query by a prepared statement with the first row of parameters, and open the result set.
+            /// The rows are got by @c Fetch() and closed by @c CloseOpenRslt() as a normal query.
+            /// @param handle handle for the connection
+            /// @param location DB location representing the connection
+            /// @param filter the statement and its parameters
+            /// @param colIndexMap output parameter. The map for the column names and their positions
+            /// @param exception output parameter. It is the exception that may be occur in the operation
+            /// @return success or not
+            virtual bool            PreparedQuery(void* handle, DbLocation* location, const PreparedFilter* filter, map<string, int>* colIndexMap, tr1::shared_ptr<IException>& exception) throw ();
+            
+            // Block fetch
+            
+            /// @brief Fetch up to @c RowBlock::GetCapacity() rows from an open result set into a block. 
+            /// The default one fetches them one by one by @c Fetch().
+            /// @param handle handle for the connection
+            /// @param location DB location representing the connection
+            /// @param block the block to fill, its old rows are removed
+            /// @param exception output parameter. It is the exception that may be occur in the operation
+            /// @return the number of rows fetched, 0 if there is no more rows left
+            virtual int             FetchBlock(void* handle, DbLocation* location, RowBlock* block, tr1::shared_ptr<IException>& exception) throw ();
+            
+            /// @brief Get the number of columns of an open result set. The default one reports an @c UnknownActionException.
+            /// @param handle handle for the connection
+            /// @param location DB location representing the connection
+            /// @param exception output parameter. It is the exception that may be occur in the operation
+            /// @return the number of columns
+            virtual int             GetColumnCount(void* handle, DbLocation* location, tr1::shared_ptr<IException>& exception) throw ();
+            
+            // Streaming
+            
+            /// @brief Query, and read all the rows into a stream until the end or until the stream is cancelled, 
+            /// then close the result set. It runs in the working thread, waiting when the stream is full.
+            /// The default one reads the rows by @c Fetch() and @c GetColumnsActureLength().
+            /// @param handle handle for the connection
+            /// @param location DB location representing the connection
+            /// @param statement the buffer for query statement to perform
+            /// @param length the length of the query buffer
+            /// @param stream the stream to fill. Its map of column names is filled by the query.
+            /// @param exception output parameter. It is the exception that may be occur in the operation
+            /// @return success or not
+            virtual bool            StreamQuery(void* handle, DbLocation* location, const char* statement, size_t length, RowStream* stream, tr1::shared_ptr<IException>& exception) throw ();
         };
     }
 }
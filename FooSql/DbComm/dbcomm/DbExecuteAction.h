@@ -7,6 +7,7 @@
 #define COMMON_DBCOMM_DBEXECUTEACTION_H_
 
 #include "dbcomm/DbAction.h"
+#include "dbcomm/DbCompletion.h"
 
 namespace COMMON
 {
@@ -39,6 +40,26 @@ namespace COMMON
             
             virtual bool Do(map<DbLocation, DbActionFilter*>& works, map<DbLocation, long long>* affected_rows = 0) throw (EXCEPTION::ThrowableException);
 
+            /// @brief Do several statements for each DB. The statements of a DB are spread over its connections,
+            /// see @c IDbTasks::SetConnectionsPerLocation().
+            /// @param works the DB information and their associated statements
+            /// @param affected_rows optional. The sum of the affected rows of the statements of each DB
+            /// @return success or not
+            virtual bool Do(map<DbLocation, vector<DbActionFilter*> >& works, map<DbLocation, long long>* affected_rows = 0) throw (EXCEPTION::ThrowableException);
+
+            /// @brief Send several statements for each DB without waiting for them, so that the next 
+            /// statements can be prepared meanwhile. The statements of a DB are spread over its connections.
+            /// @param works the DB information and their associated statements. The filters must be kept
+            /// until the returned handle is finished.
+            /// @return A handle to wait for the statements. Its results are the affected rows of each statement.
+            virtual tr1::shared_ptr<DbCompletion> Submit(map<DbLocation, vector<DbActionFilter*> >& works);
+
+            /// @brief Send a statement for each DB without waiting for them.
+            /// @param works the DB information and their associated statement. The filters must be kept
+            /// until the returned handle is finished.
+            /// @return A handle to wait for the statements. Its results are the affected rows of each statement.
+            virtual tr1::shared_ptr<DbCompletion> Submit(map<DbLocation, DbActionFilter*>& works);
+
         protected:
             /// @brief Get the current action type. 
 			/// This is the methods to be inherited by expanding class to illustrate 
@@ -48,6 +69,9 @@ namespace COMMON
 
         protected:
             virtual void GetAffectedRows(map<DbLocation*, void*>& workRslt, map<DbLocation, long long>* affected_rows);
+
+            /// @brief Sum up the affected rows of the statements of each DB
+            void GetAffectedRows(map<DbLocation*, vector<void*> >& workRslt, map<DbLocation, long long>* affected_rows);
         };
 
         /// @brief The action for DELETE operation
@@ -113,6 +137,23 @@ namespace COMMON
 
             virtual ActionType_C GetRealActionType() { return DbEngine::ActionTypeDef::TRUNC; }
         };
+
+        /// @brief The action for executing prepared statements. The filters must be @c PreparedFilter, 
+        /// each of them is executed once for each of its rows of parameters.
+        class DbPreparedExecuteAction : public DbExecuteAction
+        {
+        public:
+			/// @brief Constructor
+			/// @param dbtasks a pointer to a @c DbTasks instance that generate the action
+            /// @param engine the real engine instance underline
+            /// @param isActionFinished a signal to inform the @c DbTasks instance, the parent of this action, whether the action is finished
+			/// @param timesToCommit This parameter indicates the limit of uncommited affected rows. If it has been reached, we should send a commit statement to the server
+            DbPreparedExecuteAction(tr1::shared_ptr<IDbTasks> dbtasks, tr1::shared_ptr<DbEngine> engine, bool& isActionFinished, int timesToCommit = 5000)
+                : DbExecuteAction(dbtasks, engine, isActionFinished, timesToCommit) {}
+
+        protected:
+            virtual ActionType_C GetRealActionType() { return DbEngine::ActionTypeDef::PREPARED_EXECUTE; }
+        };
     }
 }
 
@@ -8,6 +8,7 @@
 
 #include "dbcomm/CommDef.h"
 #include "dbcomm/DbRslt.h"
+#include "dbcomm/BatchTuner.h"
 
 namespace COMMON
 {
@@ -60,6 +61,29 @@ namespace COMMON
         
         /// @brief The result holder for INSERT-UPDATE
         class DbInsertUpdateRslt : public DbExecuteRslt {};
+        
+        /// @brief The result holder for a batch action, with the decisions of its @c BatchTuner
+        class DbBatchRslt : public DbExecuteRslt
+        {
+        public:
+            /// @brief Constructor
+            /// @param action The @c DbAction from which this result comes from.
+            /// @param affectedRows the affected rows of the last execute operation
+            /// @param decisions the changes of the values per statement made since the last result
+            DbBatchRslt(
+                tr1::shared_ptr<DbAction> action, 
+                map<DbLocation, long long>& affectedRows, 
+                const vector<BatchTuner::Decision>& decisions)
+                : DbExecuteRslt(action, affectedRows), decisions_(decisions) {}
+            
+            /// @brief Get the changes of the values per statement and the commit limits made by the 
+            /// @c BatchTuner of the action since the last result was got, to be logged
+            /// @return the decisions in the order they are made, empty if the action is not tuned
+            const vector<BatchTuner::Decision>& GetTuningDecisions() const { return decisions_; }
+            
+        protected:
+            vector<BatchTuner::Decision> decisions_;
+        };
     }
 }
 
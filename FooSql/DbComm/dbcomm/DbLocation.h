@@ -31,11 +31,12 @@ namespace COMMON
             
             mutable bool comfirmed_;  // is the detail comfirmed
             mutable string id_;       // a unique ID of the structures having the same details
+            mutable volatile int handle_;  // the interned handle, -1 until it is first asked for
 
         public:
             /// @brief Default constructor
             DbLocation() 
-                :comfirmed_(true) {}
+                :comfirmed_(true), handle_(-1) {}
 
             /// @brief Constructor
             /// @param ip the IP of the connection
@@ -44,7 +45,7 @@ namespace COMMON
             /// @param user the user name
             /// @param password the password associated to the user name
             DbLocation(string ip, string port, string dbId, string user, string password)
-            : ip_(ip), port_(port), db_id_(dbId), user_(user), password_(password), comfirmed_(true)
+            : ip_(ip), port_(port), db_id_(dbId), user_(user), password_(password), comfirmed_(true), handle_(-1)
             {
             }
 
@@ -54,7 +55,7 @@ namespace COMMON
             
             /// @brief Set the DB name explicitly
             /// @param val the db name
-            void SetDbId(std::string val) { comfirmed_ = true; db_id_ = val; }
+            void SetDbId(std::string val) { comfirmed_ = true; db_id_ = val; handle_ = -1; }
 
             /// @brief Get the port explicitly
             /// @return the port
@@ -62,7 +63,7 @@ namespace COMMON
             
             /// @brief Set the port explicitly
             /// @param val the port
-            void SetPort(std::string val) { comfirmed_ = true; port_ = val; }
+            void SetPort(std::string val) { comfirmed_ = true; port_ = val; handle_ = -1; }
 
             /// @brief Get the ip of the connection
             /// @return the IP
@@ -70,7 +71,7 @@ namespace COMMON
             
             /// @brief Set the IP explicitly
             /// @param val the IP
-            void SetIp(std::string val) { comfirmed_ = true; ip_ = val; }
+            void SetIp(std::string val) { comfirmed_ = true; ip_ = val; handle_ = -1; }
 
             /// @brief Get the user name explicitly
             /// @return the user name
@@ -78,7 +79,7 @@ namespace COMMON
             
             /// @brief Set the user explicitly
             /// @param user the user name
-            void SetUser(string user) { comfirmed_ = true; user_ = user; }
+            void SetUser(string user) { comfirmed_ = true; user_ = user; handle_ = -1; }
 
             /// @brief Get the password explicitly
             /// @return the password
@@ -127,16 +128,41 @@ namespace COMMON
                 this->db_id_     = other.db_id_;
                 this->user_      = other.user_;
                 this->password_  = other.password_;
+                this->comfirmed_ = other.comfirmed_;
+                this->id_        = other.id_;
+                this->handle_    = other.handle_;
                 
                 return *this;
             }
             
-            // to make the structure able to be set in the std::set
+            // to make the structure able to be set in the std::set. The locations are ordered as they are interned.
             friend bool operator < (const DbLocation &my, const DbLocation &other)
             {
-                return (my.ip_ + my.port_ + my.db_id_ + my.user_) < (other.ip_ + other.port_ + other.db_id_ + other.user_);
+                return my.Handle() < other.Handle();
             }
 
+            /// @brief Get the interned handle of the location. The locations with the same IP, port, 
+            /// DB name and user share a handle. The handles are small integers counted from 0 in the 
+            /// order the locations are first seen in the process, so they can be used as array indexes.
+            /// The handle is given when it is first asked for, not when the details are set, so a location
+            /// being filled, or never used as a key, takes none. Copies made after that share it.
+            /// @return the handle
+            int Handle() const
+            {
+                // the same details always get the same handle, so the threads asking at once store the same one
+                int handle = handle_;
+                if (handle < 0)
+                {
+                    handle = Intern(*this);
+                    handle_ = handle;
+                }
+                return handle;
+            }
+
+            /// @brief Get the number of the handles given out, that is, the biggest handle plus 1
+            /// @return the number of handles
+            static int HandleCount();
+
             /// @brief Get the descriptions of the connection
             /// @return the descriptions of the connection
             string ToString() const
@@ -169,6 +195,10 @@ namespace COMMON
             {
                 return ((const DbLocation*)this)->ID();
             }
+
+        private:
+            // look up or give out the handle of the details
+            static int Intern(const DbLocation& location);
         } ;
     }
 }
@@ -0,0 +1,107 @@
+/// @file DbLocationMap.h
+/// @brief The file defines a flat container keyed by @c DbLocation, looked up by the interned handles.
+
+/// @author Aicro Ai
+/// @date 2015/6/12
+
+#ifndef COMMON_DBCOMM_DBLOCATIONMAP_H_
+#define COMMON_DBCOMM_DBLOCATIONMAP_H_
+
+#include <deque>
+#include <vector>
+
+#include "dbcomm/DbLocation.h"
+
+using namespace std;
+
+namespace COMMON
+{
+    namespace DBCOMM
+    {
+        /// @brief A container from @c DbLocation to T. A lookup is an array access by @c DbLocation::Handle(),
+        /// no strings are compared. The entries are kept in the order they are added, and can be
+        /// traversed by the positions from 0 to Size() - 1.
+        /// @note The references to the entries and their locations stay valid when more are added.
+        template<typename T>
+        class DbLocationMap
+        {
+        public:
+            /// @brief Get the value of a location. A default value is added if the location is not there.
+            /// @param location the location
+            /// @return the value
+            T& operator[](const DbLocation& location)
+            {
+                size_t handle = (size_t)location.Handle();
+                if (handle >= positions_.size())
+                {
+                    positions_.resize(handle + 1, -1);
+                }
+
+                int& position = positions_[handle];
+                if (position < 0)
+                {
+                    position = (int)locations_.size();
+                    locations_.push_back(location);
+                    values_.push_back(T());
+                }
+
+                return values_[position];
+            }
+
+            /// @brief Find the value of a location.
+            /// @param location the location
+            /// @return the value, 0 if the location is not there
+            T* Find(const DbLocation& location)
+            {
+                int position = Position(location);
+                return (position < 0) ? 0 : &(values_[position]);
+            }
+
+            /// @brief Find the value of a location.
+            /// @param location the location
+            /// @return the value, 0 if the location is not there
+            const T* Find(const DbLocation& location) const
+            {
+                int position = Position(location);
+                return (position < 0) ? 0 : &(values_[position]);
+            }
+
+            /// @brief Get the position of a location
+            /// @param location the location
+            /// @return the position, -1 if the location is not there
+            int Position(const DbLocation& location) const
+            {
+                size_t handle = (size_t)location.Handle();
+                return (handle < positions_.size()) ? positions_[handle] : -1;
+            }
+
+            /// @brief Get the number of the locations
+            int Size() const { return (int)locations_.size(); }
+
+            /// @brief Get the location at a position
+            /// @param position from 0 to Size() - 1
+            DbLocation& LocationAt(int position) { return locations_[position]; }
+
+            /// @brief Get the value at a position
+            /// @param position from 0 to Size() - 1
+            T& ValueAt(int position) { return values_[position]; }
+
+            /// @brief Remove all the locations
+            void Clear()
+            {
+                positions_.clear();
+                locations_.clear();
+                values_.clear();
+            }
+
+        private:
+            // the position of each handle, -1 for the absent ones
+            vector<int> positions_;
+
+            deque<DbLocation> locations_;
+            deque<T> values_;
+        };
+    }
+}
+
+#endif
@@ -11,6 +11,8 @@
 #include "dbcomm/DbActionFilter.h"
 #include "dbcomm/DbAction.h"
 #include "dbcomm/StmtGenerator.h"
+#include "dbcomm/RowStream.h"
+#include "dbcomm/DbCompletion.h"
 
 #include "exception/IException.h"
 
@@ -29,7 +31,7 @@ namespace COMMON
             bool is_rslt_opened_;
 
             // a mapping for columns' name and its position for each connections.
-            map<DbLocation, map<string, int>* >  column_name_index_map_;
+            DbLocationMap<map<string, int>* >  column_name_index_map_;
 
         public:
             /// @brief Constructor
@@ -54,8 +56,99 @@ namespace COMMON
             /// @return The mapping for column name and its associated position for a specific connection
             virtual map<string, int>* GetColumnStringIndex(DbLocation& location);
 
+            /// @brief INTERNAL USE ONLY. Get the stream the rows of a specific connection are read ahead into
+            /// @return the stream, 0 if the rows are fetched on demand
+            virtual RowStream* GetRowStream(DbLocation& location) { return 0; }
+
         protected:
             void GetAffectedRows(map<DbLocation*, void*>* work_rslt, map<DbLocation, long long>* affected_rows);
+            
+            /// @brief Get the command to open the result set. 
+            /// @return The command to open the result set
+            virtual ActionType_C GetQueryActionType() { return DbEngine::ActionTypeDef::QUERY; }
+
+            /// @brief Send the commands to open the result sets
+            /// @param works the connections and their filters, whose additional information is the map of column names
+            /// @param success output parameter, success or not
+            /// @return the results of the commands
+            virtual map<DbLocation*, void*> OpenRslt(map<DbLocation, DbActionFilter*>& works, bool& success) throw (COMMON::EXCEPTION::ThrowableException);
+        };
+        
+        /// @brief The action for querying with the rows read ahead. The working thread of each connection reads 
+        /// the rows into a bounded @c RowStream while the caller handles the rows already read, so a row is got 
+        /// without going through the working thread. 
+        ///
+        /// The rows of each connection are read into a stream of its own and given connection by connection, or,
+        /// if the action is unordered, the rows of all the connections are read into one stream at the same time 
+        /// and given in the order they arrive. Then @c DbQueryRslt::GetCurrentLocation() tells where a row comes from.
+        ///
+        /// Each connection is busy until its rows are all read or the action is ended, the other commands to it 
+        /// wait for that.
+        class DbStreamQueryAction : public DbQueryAction
+        {
+        public:
+            /// @brief Constructor
+			/// @param dbtasks a pointer to a @c DbTasks instance that generate the action
+            /// @param engine the real engine instance underline
+            /// @param isActionFinished a signal to inform the @c DbTasks instance, the parent of this action, whether the action is finished
+            /// @param maxRows the max number of rows read ahead for each connection
+            /// @param maxBytes the max number of bytes of the rows read ahead for each connection
+            /// @param unordered true to read the rows of all the connections into one stream, which is bounded by @c maxRows and @c maxBytes
+            DbStreamQueryAction(
+                tr1::shared_ptr<IDbTasks> dbtasks, 
+                tr1::shared_ptr<DbEngine> engine, 
+                bool& isActionFinished, 
+                int maxRows = RowStream::DEFAULT_MAX_ROWS, 
+                size_t maxBytes = RowStream::DEFAULT_MAX_BYTES,
+                bool unordered = false);
+
+            ~DbStreamQueryAction();
+
+            virtual bool EndAction(map<DbLocation, long long>* affected_rows = 0) throw (COMMON::EXCEPTION::ThrowableException);
+
+            virtual RowStream* GetRowStream(DbLocation& location);
+
+        protected:
+            virtual map<DbLocation*, void*> OpenRslt(map<DbLocation, DbActionFilter*>& works, bool& success) throw (COMMON::EXCEPTION::ThrowableException);
+
+        private:
+            // stop the working threads reading and wait for them
+            void StopStreams();
+
+        private:
+            int max_rows_;
+
+            size_t max_bytes_;
+
+            bool unordered_;
+
+            // the stream of each connection, the same one for all if unordered
+            DbLocationMap<tr1::shared_ptr<RowStream> > streams_;
+
+            // copies of the filters, which are used by the working threads after Do() returns
+            vector<tr1::shared_ptr<DbActionFilter> > stream_filters_;
+
+            // the commands reading the rows
+            tr1::shared_ptr<DbCompletion> completion_;
+        };
+        
+        /// @brief The action for querying by prepared statements. The filters must be @c PreparedFilter, 
+        /// the first row of parameters of each of them is used. The rows are fetched in the binary form 
+        /// and given as strings, the same as a normal query.
+        class DbPreparedQueryAction : public DbQueryAction
+        {
+        public:
+            /// @brief Constructor
+			/// @param dbtasks a pointer to a @c DbTasks instance that generate the action
+            /// @param engine the real engine instance underline
+            /// @param isActionFinished a signal to inform the @c DbTasks instance, the parent of this action, whether the action is finished
+            DbPreparedQueryAction(tr1::shared_ptr<IDbTasks> dbtasks, tr1::shared_ptr<DbEngine> engine, bool& isActionFinished)
+                : DbQueryAction(dbtasks, engine, isActionFinished) 
+            {
+            }
+            
+        protected:
+            virtual ActionType_C GetQueryActionType() { return DbEngine::ActionTypeDef::PREPARED_QUERY; }
         };
         
         /// @brief An action for getting primary keys of a table
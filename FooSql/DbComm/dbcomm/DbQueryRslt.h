@@ -7,9 +7,13 @@
 #define COMMON_DBCOMM_DBQUERYRSLT_H_
 
 #include <map>
+#include <tr1/functional>
 
 #include "dbcomm/CommDef.h"
 #include "dbcomm/DbRslt.h"
+#include "dbcomm/RowBlock.h"
+#include "dbcomm/ColumnBlock.h"
+#include "dbcomm/ColumnRef.h"
 
 using namespace std;
 
@@ -19,11 +23,20 @@ namespace COMMON
     {
         class DbEngine;
         class Row;
+        class RowStream;
         class DbQueryAction;
         
         /// @brief The class representing the result of the query
         class DbQueryRslt : public DbRslt
         {
+            friend class MergeCursor;
+            friend class HashAggregator;
+
+        public:
+            /// @brief The function called by @c ForEachRow() for each row, with the lengths of its columns.
+            /// Return false to stop.
+            typedef tr1::function<bool (Row& row, unsigned long* lengths)> RowVisitor;
+
         public:
             /// @brief Constructor
             /// @param action the Action object from which this result comes from
@@ -42,6 +55,18 @@ namespace COMMON
             /// @return the next row. If there is no more rows left, an object with 0 inside will be returned.
             virtual Row Fetch(const DbLocation* target, bool& success);
 
+            /// @brief Get the connection the row given by the last @c Fetch(bool&) comes from. It is useful when
+            /// the rows of all the connections are mixed, see @c DbTasks::StreamSelect().
+            /// @return the connection, 0 if there is no more rows left
+            virtual const DbLocation* GetCurrentLocation();
+
+            /// @brief Find a column by its name once for all the rows, after the query is done. All the
+            /// connections give the same columns, so it is valid for the rows of any of them.
+            /// @param column the column name
+            /// @return the column to get the values of the rows by, see @c Row::operator[](const ColumnRef&)
+            /// @note If the column name specified cannot be found, an exception will be thrown out
+            virtual ColumnRef GetColumnRef(const string& column) throw (COMMON::EXCEPTION::ThrowableException);
+
             /// @brief Fetch a row from specific connections respectively.
 			/// @param locations the connections from which to get the next row
 			/// @param success success or not
@@ -49,6 +74,50 @@ namespace COMMON
             /// @return a map of connections and its rows fetched
             virtual map<DbLocation, Row> Fetch(vector<DbLocation*>& locations, bool& success, bool getNull = false);
 
+            /// @brief Fetch a block of rows from all the connections. The method will switch to the next connection
+            /// automatically when it comes to the end of the current connection. A block holds the rows of one
+            /// connection only. Do not mix it with @c Fetch() on the same result.
+            /// @param block the block to fill, its old rows are removed. Reuse it to avoid allocating.
+            /// @param success success or not
+            /// @return the number of rows fetched. If there is no more rows left, 0 will be returned.
+            virtual int FetchBlock(RowBlock& block, bool& success);
+
+            /// @brief Fetch a block of rows from a specific connection.
+            /// @param target the connection from which to get the next rows
+            /// @param block the block to fill, its old rows are removed. Reuse it to avoid allocating.
+            /// @param success success or not
+            /// @return the number of rows fetched. If there is no more rows left, 0 will be returned.
+            virtual int FetchBlock(const DbLocation* target, RowBlock& block, bool& success);
+
+            /// @brief Fetch a block of rows from all the connections, kept column by column, see @c FetchBlock().
+            /// @param block the block to fill, its old rows are removed. Reuse it to avoid allocating.
+            /// @param success success or not
+            /// @return the number of rows fetched. If there is no more rows left, 0 will be returned.
+            virtual int FetchColumns(ColumnBlock& block, bool& success);
+
+            /// @brief Fetch a block of rows from a specific connection, kept column by column.
+            /// @param target the connection from which to get the next rows
+            /// @param block the block to fill, its old rows are removed. Reuse it to avoid allocating.
+            /// @param success success or not
+            /// @return the number of rows fetched. If there is no more rows left, 0 will be returned.
+            virtual int FetchColumns(const DbLocation* target, ColumnBlock& block, bool& success);
+
+            /// @brief Fetch up to n rows from all the connections into a block kept by the result, see @c FetchBlock().
+            /// The block is reused by the next call, so nothing is allocated per row.
+            /// @param n the max number of rows to fetch
+            /// @param success success or not
+            /// @return the rows with their lengths, valid until the next call. No rows in it means there is no more rows left.
+            virtual RowBlock& FetchMany(int n, bool& success);
+
+            /// @brief Call a function for each of the rows left in all the connections. The rows are fetched block 
+            /// by block into a block kept by the result, so nothing is allocated per row.
+            /// @param visitor the function to call. The row is only valid in the call.
+            /// @param success success or not
+            /// @param blockRows the number of rows fetched at once
+            /// @return the number of rows the function is called for. If the function stops, 
+            /// the rows fetched with the last row are dropped.
+            virtual long long ForEachRow(RowVisitor visitor, bool& success, int blockRows = RowBlock::DEFAULT_CAPACITY);
+
             /// @brief Get the actual lengths of each columns of the current row.
 			/// @param success success or not
             /// @return a list of actual lengths to each columns orderly
@@ -68,6 +137,17 @@ namespace COMMON
             virtual map<DbLocation, unsigned long*> GetCurrentRowColumnsLength(
                 vector<DbLocation*>& locations, bool& success, bool getNull = false);
 
+            /// @brief Close the result set of a specific connection without fetching the rows left, such as when 
+            /// enough rows are got. No more rows are given by the connection. The rows read ahead by a stream are 
+            /// dropped, and a stream shared by all the connections is stopped for all of them.
+            /// @param target the connection whose result set to close
+            /// @param success success or not
+            virtual void Close(const DbLocation* target, bool& success);
+
+        protected:
+            // report the error met by the working thread filling a stream, false if there is one
+            bool CheckStream(RowStream* stream) throw (COMMON::EXCEPTION::ThrowableException);
+
         protected:
             // the current DB index from which to fetch the next row
             int current_fetch_db_index_;
@@ -80,6 +160,12 @@ namespace COMMON
 
             // buffer to avoid from calling static_cast
             tr1::shared_ptr<DbQueryAction> query_action_;
+
+            // the block reused by FetchMany() and ForEachRow()
+            RowBlock rows_;
+
+            // the block the rows are fetched into by FetchColumns() before they are put in columns
+            RowBlock column_rows_;
         };
     }
 }
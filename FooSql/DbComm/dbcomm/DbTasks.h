@@ -52,6 +52,9 @@ namespace COMMON
             // connections 
             vector<DbLocation> db_locations_;
 
+            // the number of connections to each DB location
+            int connections_per_location_;
+
         public:
             /// @brief Constructor
             /// @param dbLocations the database informations to the connections
@@ -68,6 +71,17 @@ namespace COMMON
 
             virtual DbQueryAction*   Select();
             
+            /// @brief Start an action to query with the rows read ahead by the working threads into bounded 
+            /// streams, see @c DbStreamQueryAction. The rows are got as a normal query.
+            /// @param maxRows the max number of rows read ahead for each connection
+            /// @param maxBytes the max number of bytes of the rows read ahead for each connection
+            /// @param unordered true to read all the connections at the same time into one stream bounded by @c maxRows 
+            /// and @c maxBytes, and give the rows in the order they arrive. @c DbQueryRslt::GetCurrentLocation() or 
+            /// @c RowBlock::GetLocation() tells where they come from.
+            /// @return the action, 0 if the last action is not finished
+            virtual DbQueryAction*   StreamSelect( 
+                int maxRows = RowStream::DEFAULT_MAX_ROWS, size_t maxBytes = RowStream::DEFAULT_MAX_BYTES, bool unordered = false );
+            
             virtual DbExecuteAction* Insert( int commitLimit = 5000 );
             
             virtual DbExecuteAction* BatchInsert( int commitLimit = 5000, int valuesLimit = 10);
@@ -82,6 +96,8 @@ namespace COMMON
             
             virtual DbExecuteAction* EscapeString();
             
+            virtual StringEscaper GetStringEscaper(const DbLocation& location);
+            
             virtual vector<DbLocation>& GetDbLocations();
 
             virtual string GetLastError() { return error_box_.GetLastError(); }
@@ -92,7 +108,17 @@ namespace COMMON
             virtual bool SetExceptionMode(bool exception_mode)
             { bool old = exception_; exception_ = exception_mode; return old; }
 
-            virtual bool IsExceptionMode() { return exception_; }
+            virtual bool IsExceptionMode();
+
+            /// @brief INTERNAL USE ONLY. Report the errors met on the calling thread by exceptions, whatever the
+            /// mode is. A thread working in the background keeps its errors for the thread of the user to report.
+            /// @param throws true to always throw on the calling thread
+            static void SetThreadThrows(bool throws);
+
+            virtual int SetConnectionsPerLocation(int connections)
+            { int old = connections_per_location_; connections_per_location_ = (connections < 1) ? 1 : connections; return old; }
+
+            virtual int GetConnectionsPerLocation() { return connections_per_location_; }
          
             virtual COMMON::EXCEPTION::ErrorBox* GetErrorBox() { return &error_box_; }
 
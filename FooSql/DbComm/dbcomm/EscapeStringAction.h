@@ -20,7 +20,9 @@ namespace COMMON
 {
     namespace DBCOMM
     {
-        /// @brief The class representing the action for escaping string
+        /// @brief The class representing the action for escaping string. The strings are escaped on the calling
+        /// thread by the escaper of each connection, see @c IDbTasks::GetStringEscaper(), which may also be
+        /// used directly for many strings.
         class EscapeStringAction : public DbExecuteAction
         {
         public:
@@ -39,6 +41,10 @@ namespace COMMON
             
             virtual bool Do(map<DbLocation, DbActionFilter*>& works, map<DbLocation, long long>* affected_rows = 0) throw (COMMON::EXCEPTION::ThrowableException);
 
+            /// @brief Escape several strings for each DB. They are got by @c GetEscapedString() in the order
+            /// of the DBs and of their strings, and @c GetEscapedString(location) gets the first of a DB.
+            virtual bool Do(map<DbLocation, vector<DbActionFilter*> >& works, map<DbLocation, long long>* affected_rows = 0) throw (COMMON::EXCEPTION::ThrowableException);
+
             virtual DbRslt* GetRslt();
 			
 			virtual bool EndAction() throw (COMMON::EXCEPTION::ThrowableException);
@@ -54,7 +60,7 @@ namespace COMMON
             string GetEscapedString(DbLocation& location);
 
         protected:
-            void PrepareEscapedString(map<DbLocation*, void*>& workRslt);
+            void PrepareEscapedString(map<DbLocation, vector<DbActionFilter*> >& works);
             
         private:
             map<DbLocation, int> escaped_strings_index_;
@@ -0,0 +1,196 @@
+/// @file ExternalSort.h
+/// @brief The file defines an operator sorting the rows of a query which may not fit in memory.
+
+/// @author Aicro Ai
+/// @date 2015/6/27
+
+#ifndef COMMON_DBCOMM_EXTERNALSORT_H_
+#define COMMON_DBCOMM_EXTERNALSORT_H_
+
+#include <string>
+#include <vector>
+#include <map>
+
+#include "dbcomm/Row.h"
+#include "dbcomm/RowBlock.h"
+#include "dbcomm/Arena.h"
+#include "dbcomm/SpillFile.h"
+#include "dbcomm/DbQueryRslt.h"
+
+#include "exception/ThrowableException.h"
+
+using namespace std;
+
+namespace COMMON
+{
+    namespace DBCOMM
+    {
+        /// @brief Sort the rows of a query by some columns within a memory budget, such as the rows of all the
+        /// shards by keys the DBMS can not sort across them. The rows are sorted in runs which fit in the
+        /// budget, and each full run is written into a temporary file. At last the files are mapped into
+        /// memory and merged with the run left in memory, so the rows are given without copying them again.
+        ///
+        /// The sort keys of a row are formed into bytes compared by memcmp, and the first 8 bytes are kept
+        /// next to the row as a number, so most rows are ordered without reading the rows themselves.
+        class ExternalSort
+        {
+        public:
+            /// @brief The default max number of bytes of the rows kept in memory
+            enum { DEFAULT_MEMORY_LIMIT = 64 * 1024 * 1024 };
+
+        public:
+            /// @brief Constructor
+            /// @param memoryLimit the max number of bytes of the rows kept in memory
+            /// @param spillDirectory the directory of the temporary files, empty for the one of the system
+            explicit ExternalSort(size_t memoryLimit = DEFAULT_MEMORY_LIMIT, const string& spillDirectory = "");
+
+            ~ExternalSort();
+
+            /// @brief Add a column to sort the rows by, after those added before. A NULL goes before the other
+            /// values. Call it before any row is added.
+            /// @param column the position of the column, begin with 0
+            /// @param numeric true to compare the values as floating point numbers, false as strings
+            /// @param descending true for the descending order
+            void AddKey(int column, bool numeric = false, bool descending = false);
+
+            /// @brief Add the rows of a block, before any row is fetched
+            /// @param block the rows
+            void Add(RowBlock& block) throw (COMMON::EXCEPTION::ThrowableException);
+
+            /// @brief Add all the rows left of a query, before any row is fetched
+            /// @param rslt the result of the query
+            /// @param success success or not
+            /// @return the number of rows added
+            long long Add(DbQueryRslt* rslt, bool& success) throw (COMMON::EXCEPTION::ThrowableException);
+
+            /// @brief Get the next row in the order. The rows with the same keys are given in any order.
+            /// @param success success or not
+            /// @return the row, valid until the next call. If there is no more rows left, an object with 0 inside will be returned.
+            Row Fetch(bool& success) throw (COMMON::EXCEPTION::ThrowableException);
+
+            /// @brief Get the actual lengths of each columns of the row given by the last @c Fetch()
+            /// @return a list of actual lengths to each columns orderly
+            unsigned long* GetCurrentRowColumnsLength();
+
+            /// @brief Get the connection the row given by the last @c Fetch() comes from
+            /// @return the connection
+            const DbLocation* GetCurrentLocation();
+
+            /// @brief Get the number of runs written into temporary files
+            /// @return the number of runs
+            int GetSpilledRunCount() const;
+
+        private:
+            ExternalSort(const ExternalSort&);
+            ExternalSort& operator=(const ExternalSort&);
+
+            // a column to sort by
+            struct Key
+            {
+                int column_;
+                bool numeric_;
+                bool descending_;
+            };
+
+            // a row in memory, see RowRecord
+            struct Entry
+            {
+                // the first bytes of the key
+                unsigned long long prefix_;
+                const char* record_;
+            };
+
+            // the rows of a run being merged, in a file or in memory
+            struct Source
+            {
+                // the rows left of a file
+                const char* next_;
+                const char* end_;
+
+                // the next row in memory, for the run in memory
+                int index_;
+                bool memory_;
+
+                // the current row
+                Entry current_;
+            };
+
+            // the order of the rows
+            class EntryOrder
+            {
+            public:
+                bool operator()(const Entry& left, const Entry& right) const;
+            };
+
+            // the order of the heap, whose top is the source with the first row
+            class SourceOrder;
+            friend class SourceOrder;
+
+            class SourceOrder
+            {
+            public:
+                SourceOrder(ExternalSort* sort) : sort_(sort) {}
+
+                bool operator()(int left, int right) const;
+
+            private:
+                ExternalSort* sort_;
+            };
+
+        private:
+            // form the key of a row
+            void FormKey(RowBlock& block, int row);
+
+            // the first bytes of a key as a number
+            static unsigned long long GetPrefix(const char* key, size_t length);
+
+            // sort the rows in memory and write them into a file
+            void Spill() throw (COMMON::EXCEPTION::ThrowableException);
+
+            // sort the rows in memory and start to merge
+            void Finish() throw (COMMON::EXCEPTION::ThrowableException);
+
+            // move a source to its next row, false if there is no more
+            bool Advance(Source& source);
+
+        private:
+            size_t memory_limit_;
+
+            string spill_directory_;
+
+            vector<Key> keys_;
+
+            // the rows in memory, whose chunks are smaller for a small budget
+            Arena arena_;
+            vector<Entry> entries_;
+
+            // the runs written
+            vector<SpillFile*> runs_;
+
+            // the runs being merged, and the heap of those having rows
+            vector<Source> sources_;
+            vector<int> heap_;
+
+            // the source of the row given by the last Fetch(), -1 for none
+            int last_;
+
+            bool finished_;
+
+            int columns_;
+
+            // the names of the columns
+            map<string, int> column_index_;
+
+            // the buffers to form a key or a row
+            string key_;
+            string record_;
+
+            // the row given
+            vector<char*> values_;
+            vector<unsigned long> lengths_;
+            const DbLocation* location_;
+        };
+    }
+}
+
+#endif
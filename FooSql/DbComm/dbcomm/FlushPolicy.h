@@ -0,0 +1,123 @@
+/// @file FlushPolicy.h
+/// @brief The file defines when the values buffered by a batch action are sent as a statement.
+
+/// @author Aicro Ai
+/// @date 2015/7/6
+
+#ifndef COMMON_DBCOMM_FLUSHPOLICY_H_
+#define COMMON_DBCOMM_FLUSHPOLICY_H_
+
+#include <stddef.h>
+
+#include <map>
+
+#include "dbcomm/DbLocation.h"
+
+using namespace std;
+
+namespace COMMON
+{
+    namespace DBCOMM
+    {
+        /// @brief Tells a @c DbBatchAction when the values buffered for a DB are sent as a statement.
+        /// They are sent as soon as any of the triggers is met:
+        ///  - the number of rows buffered reaches @c GetMaxRows(),
+        ///  - the statement reaches @c GetMaxBytes(), so that a batch of tiny rows is not sent too early,
+        ///  - the first row buffered has waited for @c GetMaxAge(), so that a slow trickle of rows is still
+        ///    sent in time. It is checked by a background timer of the action.
+        ///
+        /// Besides, a statement never goes beyond the packet limit of its DB, such as max_allowed_packet of
+        /// MYSQL. The buffered values are sent before a row which would make the statement too long.
+        class FlushPolicy
+        {
+        public:
+            /// @brief Constructor
+            /// @param maxRows the number of rows to send a statement, at least 1
+            /// @param maxBytes the length of a statement to send it, 0 for no limit
+            /// @param maxAge the milliseconds a row may be buffered for, 0 for no limit
+            explicit FlushPolicy(int maxRows = 10, size_t maxBytes = 0, long maxAge = 0);
+
+            /// @brief Set the number of rows to send a statement
+            /// @param maxRows the number of rows, a value less than 1 is taken as 1
+            void SetMaxRows(int maxRows);
+
+            /// @brief Get the number of rows to send a statement
+            /// @return the number of rows
+            int GetMaxRows() const { return max_rows_; }
+
+            /// @brief Set the length of a statement to send it
+            /// @param maxBytes the length in bytes, 0 for no limit
+            void SetMaxBytes(size_t maxBytes) { max_bytes_ = maxBytes; }
+
+            /// @brief Get the length of a statement to send it
+            /// @return the length in bytes, 0 for no limit
+            size_t GetMaxBytes() const { return max_bytes_; }
+
+            /// @brief Set the time a row may be buffered for
+            /// @param maxAge the time in milliseconds, 0 for no limit
+            void SetMaxAge(long maxAge) { max_age_ = (maxAge > 0) ? maxAge : 0; }
+
+            /// @brief Get the time a row may be buffered for
+            /// @return the time in milliseconds, 0 for no limit
+            long GetMaxAge() const { return max_age_; }
+
+            /// @brief Set the packet limit of the DBs which are not given one by @c SetPacketLimit(const DbLocation&, size_t)
+            /// @param bytes the longest statement in bytes, 0 for no limit
+            void SetPacketLimit(size_t bytes) { default_packet_limit_ = bytes; }
+
+            /// @brief Set the packet limit of a DB, such as its max_allowed_packet
+            /// @param location the DB
+            /// @param bytes the longest statement in bytes, 0 for no limit
+            void SetPacketLimit(const DbLocation& location, size_t bytes) { packet_limits_[location] = bytes; }
+
+            /// @brief Get the packet limit of a DB
+            /// @param location the DB
+            /// @return the longest statement in bytes, 0 for no limit
+            size_t GetPacketLimit(const DbLocation& location) const;
+
+            /// @brief Whether the buffered values are to be sent because of their rows or bytes
+            /// @param rows the number of rows buffered
+            /// @param bytes the length of the statement formed by them
+            /// @return true to send them
+            bool IsFull(int rows, size_t bytes) const
+            {
+                return rows >= max_rows_ || (max_bytes_ != 0 && bytes >= max_bytes_);
+            }
+
+            /// @brief Whether the buffered values are to be sent because of their rows or bytes, with the
+            /// rows limited by another number, such as the one tuned by a @c BatchTuner
+            /// @param rows the number of rows buffered
+            /// @param bytes the length of the statement formed by them
+            /// @param maxRows the number of rows to send a statement
+            /// @return true to send them
+            bool IsFull(int rows, size_t bytes, int maxRows) const
+            {
+                return rows >= maxRows || (max_bytes_ != 0 && bytes >= max_bytes_);
+            }
+
+            /// @brief Whether the buffered values are to be sent because of their age
+            /// @param age the milliseconds since the first of them was buffered
+            /// @return true to send them
+            bool IsExpired(long age) const
+            {
+                return max_age_ != 0 && age >= max_age_;
+            }
+
+            /// @brief Whether a statement would go beyond the packet limit of its DB
+            /// @param location the DB
+            /// @param bytes the length of the statement
+            /// @return true if it would
+            bool IsBeyondPacket(const DbLocation& location, size_t bytes) const;
+
+        private:
+            int max_rows_;
+            size_t max_bytes_;
+            long max_age_;
+
+            size_t default_packet_limit_;
+            map<DbLocation, size_t> packet_limits_;
+        };
+    }
+}
+
+#endif
@@ -0,0 +1,212 @@
+/// @file HashAggregator.h
+/// @brief The file defines an operator grouping and aggregating the rows of all the connections of a query.
+
+/// @author Aicro Ai
+/// @date 2015/6/25
+
+#ifndef COMMON_DBCOMM_HASHAGGREGATOR_H_
+#define COMMON_DBCOMM_HASHAGGREGATOR_H_
+
+#include <string>
+#include <vector>
+
+#include "dbcomm/RowBlock.h"
+#include "dbcomm/HashKeyTable.h"
+#include "dbcomm/DbQueryRslt.h"
+
+#include "exception/ThrowableException.h"
+
+#include "thread/Mutex.h"
+
+using namespace std;
+
+namespace COMMON
+{
+    namespace DBCOMM
+    {
+        /// @brief Group the rows of a query by some columns and aggregate the others, as GROUP BY does, such as
+        /// to combine the results of the same GROUP BY on all the connections. The groups are kept in a hash
+        /// table with open addressing, whose keys are kept in an arena.
+        ///
+        /// The aggregates are either of the raw values, see @c AddAggregate(), or of the partial aggregates
+        /// computed by each connection, see @c AddPartial(). The values are numbers, except those counted by COUNT.
+        ///
+        /// When the rows of each connection are read ahead by its own stream, see @c DbTasks::StreamSelect(),
+        /// the connections are aggregated by several threads at once, and their tables are merged by the
+        /// threads at last, each of which takes a part of the groups.
+        class HashAggregator
+        {
+        public:
+            /// @brief The aggregate functions
+            enum Function
+            {
+                COUNT,
+                SUM,
+                MIN,
+                MAX,
+                AVG
+            };
+
+        public:
+            /// @brief Constructor
+            /// @param threads the max number of threads, 0 for the number of the processors
+            explicit HashAggregator(int threads = 0);
+
+            ~HashAggregator();
+
+            /// @brief Add a column to group the rows by. A NULL is a group of its own. Call it before any row is added.
+            /// @param column the position of the column, begin with 0
+            void AddGroupColumn(int column);
+
+            /// @brief Add an aggregate of the raw values of a column, which goes after the group columns in
+            /// the result, in the order added. Call it before any row is added.
+            /// @param function the function
+            /// @param column the position of the column, begin with 0. -1 for COUNT(*).
+            /// @param distinct true to aggregate the distinct values only, which are compared as strings
+            /// @return the position of the aggregate in the result
+            int AddAggregate(Function function, int column, bool distinct = false);
+
+            /// @brief Add an aggregate of the partial aggregates of the same function computed by the
+            /// connections, such as SUM of the counts for COUNT. Call it before any row is added.
+            /// @param function the function computed by the connections
+            /// @param column the position of the partial aggregate, begin with 0. The sum for AVG.
+            /// @param countColumn the position of the count, for AVG only
+            /// @return the position of the aggregate in the result
+            int AddPartial(Function function, int column, int countColumn = -1);
+
+            /// @brief Add the rows of a block
+            /// @param block the rows
+            void Add(RowBlock& block);
+
+            /// @brief Add all the rows left of a query
+            /// @param rslt the result of the query. Do not fetch from it by other means.
+            /// @param success success or not
+            /// @return the number of rows added
+            long long Add(DbQueryRslt* rslt, bool& success) throw (COMMON::EXCEPTION::ThrowableException);
+
+            /// @brief Get the number of groups
+            /// @return the number of groups
+            int GetGroupCount();
+
+            /// @brief Get the result, one row per group, with the group columns first, followed by the
+            /// aggregates. COUNT and AVG are COLUMN_INTEGER and COLUMN_DOUBLE, and the others are COLUMN_INTEGER
+            /// if all of their values are integers, COLUMN_DOUBLE otherwise. An aggregate without any value
+            /// is NULL, except COUNT. Without group columns, there is always one row.
+            /// @param block the block to fill, its old rows are removed
+            /// @return the number of rows
+            int GetResult(RowBlock& block);
+
+            /// @brief Remove all the groups, the columns and the aggregates are kept
+            void Clear();
+
+        private:
+            HashAggregator(const HashAggregator&);
+            HashAggregator& operator=(const HashAggregator&);
+
+            // an aggregate added
+            struct Aggregate
+            {
+                Function function_;
+                int column_;
+                int count_column_;
+                bool distinct_;
+                bool partial_;
+            };
+
+            // the state of an aggregate of a group
+            struct Accumulator
+            {
+                // the values aggregated, or the sum of the partial counts
+                long long count_;
+
+                // the sum, or the min or the max, kept as an integer while all the values are integers
+                long long integer_;
+                double double_;
+                bool integral_;
+
+                bool has_value_;
+            };
+
+            // the groups aggregated by a thread
+            struct Table
+            {
+                HashKeyTable groups_;
+
+                // the accumulators of each group, one after another
+                vector<Accumulator> values_;
+
+                // the distinct values of each group and aggregate
+                HashKeyTable distincts_;
+
+                // the buffer to form a key
+                string key_;
+            };
+
+            // the work of a thread
+            struct Work
+            {
+                HashAggregator* aggregator_;
+                int index_;
+            };
+
+            static void* RunAddStreams(void* arg);
+
+            static void* RunMergePart(void* arg);
+
+        private:
+            // add the rows of a block to a table
+            void AddBlock(Table& table, RowBlock& block);
+
+            // add a value to an aggregate of a group
+            void AddValue(Table& table, int group, int aggregate, RowBlock& block, int row);
+
+            // update an accumulator by a value, or by an accumulator of the same aggregate
+            void Update(Accumulator& accumulator, const Aggregate& aggregate, bool integral, long long integer, double value, long long count);
+
+            // add the rows of the streams of the connections, run by several threads
+            void AddStreams(int index);
+
+            // merge the groups of a part of all the tables, run by several threads
+            void MergePart(int part);
+
+            // merge all the tables into one table per thread
+            void MergeTables();
+
+            // run a work by several threads, whose indexes begin with the given one
+            void RunThreads(int count, int first, void* (*work)(void*));
+
+            // the part of a group, when merged by several threads
+            int GetPart(unsigned int hash) const;
+
+        private:
+            int threads_;
+
+            vector<int> group_columns_;
+
+            vector<Aggregate> aggregates_;
+
+            // the tables, all of which are merged when the result is got
+            vector<Table*> tables_;
+
+            // the tables formed by MergeTables()
+            vector<Table*> merged_;
+
+            // for each table being merged, the number of each group in the merged table
+            vector<vector<int> > group_map_;
+
+            // the result being added by the threads
+            DbQueryRslt* rslt_;
+
+            // the next connection taken by a thread
+            int next_location_;
+
+            THREAD::Mutex mutex_;
+
+            // the rows added by the threads
+            long long rows_;
+
+        };
+    }
+}
+
+#endif
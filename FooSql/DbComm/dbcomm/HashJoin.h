@@ -0,0 +1,199 @@
+/// @file HashJoin.h
+/// @brief The file defines an operator joining the rows of two queries by a hash table.
+
+/// @author Aicro Ai
+/// @date 2015/6/26
+
+#ifndef COMMON_DBCOMM_HASHJOIN_H_
+#define COMMON_DBCOMM_HASHJOIN_H_
+
+#include <string>
+#include <vector>
+#include <map>
+
+#include "dbcomm/Row.h"
+#include "dbcomm/RowBlock.h"
+#include "dbcomm/Arena.h"
+#include "dbcomm/HashKeyTable.h"
+#include "dbcomm/SpillFile.h"
+#include "dbcomm/DbQueryRslt.h"
+
+#include "exception/ThrowableException.h"
+
+using namespace std;
+
+namespace COMMON
+{
+    namespace DBCOMM
+    {
+        /// @brief Join the rows of two queries on equal keys, as an inner join does, such as a dimension table
+        /// of one connection with the facts of all the shards. The rows of the build side are kept in a
+        /// hash table, which is probed by the rows of the other side one by one, so the probe side may be
+        /// as large as needed, read by a stream, see @c DbTasks::StreamSelect().
+        ///
+        /// The rows of the build side are kept in several parts by the hash of the key. With a memory
+        /// limit, the largest parts are moved into temporary files when the limit is reached, and the probe
+        /// rows of those parts are put into files too, to be joined part by part at last. A part is read
+        /// back whole, so the limit should leave room for one of them.
+        class HashJoin
+        {
+        public:
+            /// @brief The number of parts of the build side
+            enum { PARTS = 16 };
+
+        public:
+            /// @brief Constructor
+            /// @param memoryLimit the max number of bytes of the build rows kept in memory, 0 for no limit
+            /// @param spillDirectory the directory of the temporary files, empty for the one of the system
+            explicit HashJoin(size_t memoryLimit = 0, const string& spillDirectory = "");
+
+            ~HashJoin();
+
+            /// @brief Add a pair of columns which must be equal. The values are compared as strings, and a
+            /// NULL equals to nothing. Call it before any row is added.
+            /// @param buildColumn the position of the column of the build side, begin with 0
+            /// @param probeColumn the position of the column of the probe side, begin with 0
+            void AddKey(int buildColumn, int probeColumn);
+
+            /// @brief Add the rows of a block to the build side
+            /// @param block the rows
+            void Build(RowBlock& block) throw (COMMON::EXCEPTION::ThrowableException);
+
+            /// @brief Add all the rows left of a query to the build side
+            /// @param rslt the result of the query
+            /// @param success success or not
+            /// @return the number of rows added
+            long long Build(DbQueryRslt* rslt, bool& success) throw (COMMON::EXCEPTION::ThrowableException);
+
+            /// @brief Set the query of the probe side, after all the build rows are added
+            /// @param rslt the result of the query. Do not fetch from it by other means.
+            void Probe(DbQueryRslt* rslt);
+
+            /// @brief Get the next joined row, with the columns of the build side first, followed by those
+            /// of the probe side. A column name of both sides is the one of the build side.
+            /// @param success success or not
+            /// @return the row, valid until the next call. If there is no more rows left, an object with 0 inside will be returned.
+            Row Fetch(bool& success) throw (COMMON::EXCEPTION::ThrowableException);
+
+            /// @brief Get the actual lengths of each columns of the row given by the last @c Fetch()
+            /// @return a list of actual lengths to each columns orderly
+            unsigned long* GetCurrentRowColumnsLength();
+
+            /// @brief Get the connection the probe row of the row given by the last @c Fetch() comes from
+            /// @return the connection
+            const DbLocation* GetCurrentLocation();
+
+            /// @brief Get the number of parts moved into temporary files
+            /// @return the number of parts
+            int GetSpilledPartCount() const;
+
+        private:
+            HashJoin(const HashJoin&);
+            HashJoin& operator=(const HashJoin&);
+
+            // the rows of the build side with the same hash of the key
+            struct Part
+            {
+                Part(const string& directory) : build_file_(directory), probe_file_(directory), bytes_(0), spilled_(false) {}
+
+                // the rows kept in memory, see RowRecord
+                Arena arena_;
+                vector<const char*> rows_;
+                size_t bytes_;
+
+                // the keys of the rows, with the first row of each key and the next row of each row
+                HashKeyTable keys_;
+                vector<int> first_;
+                vector<int> next_;
+
+                bool spilled_;
+
+                // the rows moved out of memory, of both sides
+                SpillFile build_file_;
+                SpillFile probe_file_;
+            };
+
+            // the state of the probe
+            enum Phase
+            {
+                PHASE_BUILD,
+                PHASE_PROBE,
+                PHASE_SPILLED,
+                PHASE_DONE
+            };
+
+        private:
+            // form the key of a row, false if any of the columns is NULL
+            bool FormKey(RowBlock& block, int row, const vector<int>& columns);
+
+            // move the largest part in memory into its file
+            void SpillLargest() throw (COMMON::EXCEPTION::ThrowableException);
+
+            // index the rows of a part
+            void Index(Part& part);
+
+            // read the rows of a part from its file
+            void Load(Part& part) throw (COMMON::EXCEPTION::ThrowableException);
+
+            // read a row from a file into the buffer, false at the end
+            bool ReadRecord(SpillFile& file, string& buffer) throw (COMMON::EXCEPTION::ThrowableException);
+
+            // find the next probe row with build rows of the same key, false if there is no more
+            bool NextProbe(bool& success) throw (COMMON::EXCEPTION::ThrowableException);
+
+            // the part of a key
+            int GetPart(unsigned int hash) const;
+
+            // add the column names of a side
+            void AddColumnNames(map<string, int>* names, int first);
+
+        private:
+            size_t memory_limit_;
+
+            vector<int> build_keys_;
+            vector<int> probe_keys_;
+
+            vector<Part*> parts_;
+
+            // the bytes of the rows of all the parts in memory
+            size_t bytes_;
+
+            int build_columns_;
+            int probe_columns_;
+
+            // the names of the joined columns
+            map<string, int> column_index_;
+            bool build_names_;
+            bool probe_names_;
+
+            Phase phase_;
+
+            DbQueryRslt* probe_rslt_;
+
+            // the probe rows being read, and the current one
+            RowBlock block_;
+            int probe_row_;
+
+            // the part read from its file in PHASE_SPILLED
+            int spilled_part_;
+
+            // the probe row read from a file
+            string probe_record_;
+
+            // the part and the next build row to join with the current probe row, -1 for none
+            int match_part_;
+            int match_;
+
+            // the buffers to form a key or a row
+            string key_;
+            string record_;
+
+            // the joined row
+            vector<char*> values_;
+            vector<unsigned long> lengths_;
+            const DbLocation* location_;
+        };
+    }
+}
+
+#endif
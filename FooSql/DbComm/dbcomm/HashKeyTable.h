@@ -0,0 +1,106 @@
+/// @file HashKeyTable.h
+/// @brief The file defines a hash table of byte string keys, used by the operators over query results.
+
+/// @author Aicro Ai
+/// @date 2015/6/25
+
+#ifndef COMMON_DBCOMM_HASHKEYTABLE_H_
+#define COMMON_DBCOMM_HASHKEYTABLE_H_
+
+#include <cstddef>
+#include <vector>
+
+#include "dbcomm/Arena.h"
+
+using namespace std;
+
+namespace COMMON
+{
+    namespace DBCOMM
+    {
+        /// @brief A hash table of byte string keys with open addressing. Each distinct key gets a number,
+        /// given in the order the keys are inserted, by which the caller keeps its values in arrays.
+        /// The keys are copied into an arena, so a key costs no allocation of its own.
+        class HashKeyTable
+        {
+        public:
+            /// @brief Constructor
+            /// @param capacity the number of keys expected
+            explicit HashKeyTable(int capacity = 16);
+
+            /// @brief Hash a key
+            /// @param key the key
+            /// @param length the length of the key
+            /// @return the hash
+            static unsigned int Hash(const char* key, size_t length);
+
+            /// @brief Find a key
+            /// @param key the key
+            /// @param length the length of the key
+            /// @param hash the hash of the key, see @c Hash()
+            /// @return the number of the key, -1 if it is not found
+            int Find(const char* key, size_t length, unsigned int hash) const;
+
+            /// @brief Insert a key if it is not in the table
+            /// @param key the key
+            /// @param length the length of the key
+            /// @param hash the hash of the key, see @c Hash()
+            /// @param inserted true if the key is new
+            /// @return the number of the key
+            int Insert(const char* key, size_t length, unsigned int hash, bool& inserted);
+
+            /// @brief Get the number of keys
+            /// @return the number of keys
+            int GetCount() const;
+
+            /// @brief Get a key by its number
+            /// @param index the number of the key
+            /// @return the key
+            const char* GetKey(int index) const;
+
+            /// @brief Get the length of a key by its number
+            /// @param index the number of the key
+            /// @return the length
+            size_t GetKeyLength(int index) const;
+
+            /// @brief Get the hash of a key by its number
+            /// @param index the number of the key
+            /// @return the hash
+            unsigned int GetHash(int index) const;
+
+            /// @brief Get the number of bytes used by the table and its keys
+            /// @return the number of bytes
+            size_t GetByteCount() const;
+
+            /// @brief Remove all the keys. The memory is kept for reuse.
+            void Clear();
+
+        private:
+            HashKeyTable(const HashKeyTable&);
+            HashKeyTable& operator=(const HashKeyTable&);
+
+            // a key, where the data is in the arena
+            struct Entry
+            {
+                const char* key_;
+                size_t length_;
+                unsigned int hash_;
+            };
+
+            // double the slots
+            void Grow();
+
+        private:
+            Arena arena_;
+
+            vector<Entry> entries_;
+
+            // the number of the key in each slot, -1 for an empty slot. Its size is a power of 2.
+            vector<int> slots_;
+
+            size_t mask_;
+        };
+    }
+}
+
+#endif
@@ -16,6 +16,7 @@
 
 #include "dbcomm/DbQueryAction.h"
 #include "dbcomm/DbQueryRslt.h"
+#include "dbcomm/StringEscaper.h"
 
 using namespace std;
 
@@ -99,6 +100,12 @@ namespace COMMON
             /// @return a escape string action
             virtual DbExecuteAction* EscapeString() = 0;
             
+            /// @brief Get the escaper of strings following the character set of a connection, which runs on the
+            /// calling thread without an action. It is valid after @c Connect().
+            /// @param location the connection
+            /// @return the escaper
+            virtual StringEscaper GetStringEscaper(const DbLocation& location) = 0;
+            
             /// @brief Get a trying to get primary keys action
             /// @return a trying to get primary keys action
             virtual DbQueryAction* GetPriKeys() = 0;
@@ -127,6 +134,17 @@ namespace COMMON
             /// @brief Check whether the current exception mode is C++'s exception
             /// @return true means exception mode, false means c return code
             virtual bool IsExceptionMode() = 0;
+            
+            /// @brief Set the number of connections to each DB location. Each connection is served by its own 
+            /// working thread, so that several statements can run on the same DB at the same time.
+            /// @param connections the number of connections to each DB location, 1 by default
+            /// @return the original number of connections
+            /// @note It takes effect at the next @c Connect().
+            virtual int SetConnectionsPerLocation(int connections) = 0;
+            
+            /// @brief Get the number of connections to each DB location
+            /// @return the number of connections to each DB location
+            virtual int GetConnectionsPerLocation() = 0;
         };
     }
 }
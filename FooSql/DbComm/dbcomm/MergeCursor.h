@@ -0,0 +1,142 @@
+/// @file MergeCursor.h
+/// @brief The file defines a cursor merging the sorted rows of all the connections of a query.
+
+/// @author Aicro Ai
+/// @date 2015/6/24
+
+#ifndef COMMON_DBCOMM_MERGECURSOR_H_
+#define COMMON_DBCOMM_MERGECURSOR_H_
+
+#include <vector>
+#include <tr1/functional>
+
+#include "dbcomm/Row.h"
+#include "dbcomm/RowBlock.h"
+#include "dbcomm/DbQueryRslt.h"
+
+#include "exception/ThrowableException.h"
+
+using namespace std;
+
+namespace COMMON
+{
+    namespace DBCOMM
+    {
+        /// @brief Compare two rows by one of their columns, for @c MergeCursor. A NULL goes before the other values.
+        class ColumnOrder
+        {
+        public:
+            /// @brief Constructor
+            /// @param column the position of the column, begin with 0
+            /// @param numeric true to compare the values as numbers, false as strings
+            /// @param descending true for the descending order
+            ColumnOrder(int column, bool numeric = false, bool descending = false)
+                : column_(column), numeric_(numeric), descending_(descending)
+            {
+            }
+
+            /// @brief Whether the first row goes before the second one
+            bool operator()(Row& left, Row& right) const;
+
+        private:
+            int column_;
+            bool numeric_;
+            bool descending_;
+        };
+
+        /// @brief A cursor giving the rows of all the connections of a query in one order, when the rows
+        /// of each connection are in that order already, such as by the same ORDER BY. A k-way merge
+        /// is done by a heap over the next rows of the connections, which are fetched block by block.
+        ///
+        /// With a limit, the result sets of all the connections are closed as soon as enough rows are
+        /// given. The limit should also be put in the statement, so that no connection sends more.
+        ///
+        /// The rows are fetched connection by connection, so a stream shared by all the connections, see
+        /// @c DbTasks::StreamSelect(), is not supported.
+        class MergeCursor
+        {
+        public:
+            /// @brief The function telling whether the first row goes before the second one
+            typedef tr1::function<bool (Row& left, Row& right)> RowComparator;
+
+        public:
+            /// @brief Constructor
+            /// @param rslt the result of the query. Do not fetch from it by other means.
+            /// @param less the order of the rows
+            /// @param limit the max number of rows to give, 0 for no limit
+            /// @param blockRows the number of rows fetched at once from each connection
+            MergeCursor(DbQueryRslt* rslt, RowComparator less, long long limit = 0, int blockRows = RowBlock::DEFAULT_CAPACITY);
+
+            /// @brief Get the next row in the order
+            /// @param success success or not
+            /// @return the row, valid until the next call. If there is no more rows left, an object with 0 inside will be returned.
+            Row Fetch(bool& success) throw (COMMON::EXCEPTION::ThrowableException);
+
+            /// @brief Get the actual lengths of each columns of the row given by the last @c Fetch()
+            /// @return a list of actual lengths to each columns orderly, 0 if there is no such row
+            unsigned long* GetCurrentRowColumnsLength();
+
+            /// @brief Get the connection the row given by the last @c Fetch() comes from
+            /// @return the connection, 0 if there is no such row
+            const DbLocation* GetCurrentLocation();
+
+            /// @brief Close the result sets of all the connections without fetching the rows left
+            /// @param success success or not
+            void Close(bool& success) throw (COMMON::EXCEPTION::ThrowableException);
+
+        private:
+            // the rows fetched from a connection
+            struct Shard
+            {
+                const DbLocation* location_;
+                RowBlock block_;
+                int row_;
+                Row current_;
+                bool done_;
+            };
+
+            // the order of the heap, whose top is the shard with the first row
+            class ShardOrder;
+            friend class ShardOrder;
+
+            class ShardOrder
+            {
+            public:
+                ShardOrder(MergeCursor* cursor) : cursor_(cursor) {}
+
+                bool operator()(int left, int right) const;
+
+            private:
+                MergeCursor* cursor_;
+            };
+
+        private:
+            // move a shard to its next row, false if there is no more
+            bool Advance(int shard, bool& success);
+
+        private:
+            DbQueryRslt* rslt_;
+
+            RowComparator less_;
+
+            long long limit_;
+
+            // the number of rows given
+            long long given_;
+
+            vector<Shard> shards_;
+
+            // the shards having rows, as a heap
+            vector<int> heap_;
+
+            // the shard of the row given by the last Fetch(), -1 for none
+            int last_;
+
+            bool started_;
+
+            bool closed_;
+        };
+    }
+}
+
+#endif
@@ -38,6 +38,17 @@ namespace COMMON
             
             virtual DbQueryAction* GetPriKeys();
             
+            /// @brief Start an action to execute prepared statements. Each connection prepares a statement
+            /// the first time it meets its SQL text and keeps it for the next times.
+            /// @param commitLimit the limit of uncommited affected rows before a commit
+            /// @return the action, whose filters must be @c PreparedFilter. 0 if the last action is not finished.
+            virtual DbExecuteAction* PreparedExecute( int commitLimit = 5000 );
+            
+            /// @brief Start an action to query by prepared statements. The rows are sent in the binary
+            /// form, optionally through a cursor, see @c PreparedFilter::SetPrefetchRows().
+            /// @return the action, whose filters must be @c PreparedFilter. 0 if the last action is not finished.
+            virtual DbQueryAction* PreparedSelect();
+            
         protected:
             virtual bool InitEngine();
             virtual bool UninitEngine();
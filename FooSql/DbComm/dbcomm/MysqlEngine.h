@@ -12,6 +12,8 @@
    http://stackoverflow.com/questions/4597281/mysql-headers-conflict-with-stl-algorithm-in-c */
 #include <string>
 #include <algorithm>
+#include <map>
+#include <vector>
 
 // DB OPERATION
 #include "DbEngine.h"
@@ -30,6 +32,16 @@ namespace COMMON
         class MysqlEngine : public DbEngine
         {
         private:
+            /// @brief A prepared statement kept by a connection
+            struct CachedStatement
+            {
+                /// @brief the statement
+                MYSQL_STMT* stmt;
+                
+                /// @brief when it was used last time, to find the least recently used one
+                unsigned long long last_use;
+            };
+            
             /// @brief The handle wrapper for each MYSQL connection
             class MysqlRealHandle : public RealHandle
             {
@@ -37,30 +49,77 @@ namespace COMMON
                 MysqlRealHandle()
                 {
                     res = 0;
+                    stmt = 0;
+                    stmt_uses = 0;
                     mysql_init(&mysql);
                 }
                 
                 ~MysqlRealHandle()
                 {
                     // Make sure to free memory
+                    CloseStatements();
                     mysql_close(&mysql);
                 }
                 
+                /// @brief Close all the prepared statements, they must be closed before the connection
+                void CloseStatements()
+                {
+                    map<string, CachedStatement>::iterator it = stmts.begin();
+                    for (; it != stmts.end(); it++)
+                    {
+                        mysql_stmt_close(it->second.stmt);
+                    }
+                    stmts.clear();
+                    stmt = 0;
+                }
+                
             public:
                 /// @brief MYSQL handle
                 MYSQL       mysql;
                     
                 /// @brief MYSQL result set
                 MYSQL_RES*  res; 
+                
+                /// @brief the prepared statements of the connection, keyed by their SQL text
+                map<string, CachedStatement> stmts;
+                
+                /// @brief counts the uses of the prepared statements
+                unsigned long long stmt_uses;
+                
+                /// @brief the prepared statement whose result set is open, 0 if none
+                MYSQL_STMT* stmt;
+                
+                /// @brief the bindings of the parameters of the current row
+                vector<MYSQL_BIND> param_binds;
+                
+                /// @brief the lengths of the string parameters of the current row
+                vector<unsigned long> param_lengths;
+                
+                /// @brief the bindings of the columns of the open result set of @c stmt
+                vector<MYSQL_BIND> result_binds;
+                
+                /// @brief the buffers of the columns, each one has a byte more than it tells MYSQL for the '\0'
+                vector<vector<char> > result_buffers;
+                
+                /// @brief the lengths of the columns of the current row
+                vector<unsigned long> result_lengths;
+                
+                /// @brief whether the columns of the current row are NULL
+                vector<my_bool> result_nulls;
+                
+                /// @brief whether the columns of the current row are truncated
+                vector<my_bool> result_errors;
+                
+                /// @brief the current row, as @c Fetch() gives
+                vector<char*> result_row;
             };
-            /// @brief A set of handles for different connections
-            map<DbLocation, tr1::shared_ptr<MysqlRealHandle> > handles_;
             
         public:
             /// @brief Constructor
             /// @param locations The locations for MYSQL to connect
             /// @param task The pointer to a @c IDbTasks, from which this instance was generated
-            MysqlEngine(vector<DbLocation>& locations, tr1::shared_ptr<IDbTasks> task);
+            /// @param connectionsPerLocation The number of MYSQL connections to each location
+            MysqlEngine(vector<DbLocation>& locations, tr1::shared_ptr<IDbTasks> task, int connectionsPerLocation = 1);
             
             virtual ~MysqlEngine();
             
@@ -92,6 +151,15 @@ namespace COMMON
 
             virtual char*   EscapeString(void* handle, DbLocation* location, const char* src, long length, tr1::shared_ptr<EXCEPTION::IException>& exception) throw ();
             
+            /// @brief Create the escaper following the character set the connection has agreed on with the server
+            virtual StringEscaper   CreateStringEscaper(void* handle, DbLocation* location) throw ();
+            
+            virtual long long       PreparedExecute(void* handle,  DbLocation* location, const PreparedFilter* filter, tr1::shared_ptr<EXCEPTION::IException>& exception) throw ();
+            
+            virtual bool            PreparedQuery(void* handle, DbLocation* location, const PreparedFilter* filter, map<string, int>* colIndexMap, tr1::shared_ptr<EXCEPTION::IException>& exception) throw ();
+            
+            virtual int             GetColumnCount(void* handle, DbLocation* location, tr1::shared_ptr<EXCEPTION::IException>& exception) throw ();
+            
         protected:
             long long GetAffectedRows( long long &affectRows, void* handle, int sqlCode, string errorMsg );
             
@@ -100,11 +168,28 @@ namespace COMMON
                 
             virtual void UninitThread();
             
-            virtual tr1::shared_ptr<RealHandle> GetRealHandle(DbLocation& location);
+            virtual tr1::shared_ptr<RealHandle> CreateRealHandle(DbLocation& location);
             
         private:
             string& ExtractErrMsg( int sqlCode, void* handle, string& errorMsg );
             
+            string& ExtractStmtErrMsg( MYSQL_STMT* stmt, int& sqlCode, string& errorMsg );
+            
+            // get the prepared statement of a SQL text from the cache of the connection, prepare it if it is not there
+            MYSQL_STMT* GetStatement( MysqlRealHandle* handle, const char* statement, size_t length, int& sqlCode, string& errorMsg );
+            
+            // close a prepared statement and remove it from the cache, used when it may be broken
+            void DropStatement( MysqlRealHandle* handle, MYSQL_STMT* stmt );
+            
+            // bind a row of parameters, the values are pointed to, not copied
+            bool BindParams( MysqlRealHandle* handle, MYSQL_STMT* stmt, const PreparedFilter* filter, int row, int& sqlCode, string& errorMsg );
+            
+            // bind the columns of the result set to the buffers of the handle
+            bool BindResult( MysqlRealHandle* handle, MYSQL_STMT* stmt, map<string, int>* colIndexMap, int& sqlCode, string& errorMsg );
+            
+            // fetch a row of the open result set of a prepared statement
+            char** FetchStatement( MysqlRealHandle* handle, DbLocation* location, tr1::shared_ptr<EXCEPTION::IException>& exception );
+            
             static void HandleMysqlLibrary();
         };   
         
@@ -20,7 +20,11 @@ namespace COMMON
         class MysqlReplaceStmtGen : public StmtGenerator
         {
         public:
+            virtual StmtGenerator* NewInstance() const { return new MysqlReplaceStmtGen(); }
+            
             virtual string FormStatement(const DbLocation& dbLocation);
+            
+            virtual void FormStatement(const DbLocation& dbLocation, string& statement);
         };
         
 		/// @brief INTERNAL USE ONLY. The class is defined to generate a insert-ignore statement, 
@@ -29,7 +33,11 @@ namespace COMMON
         class MysqlInsertIgnoreStmtGen : public StmtGenerator
         {
         public:
+            virtual StmtGenerator* NewInstance() const { return new MysqlInsertIgnoreStmtGen(); }
+            
             virtual string FormStatement(const DbLocation& dbLocation);
+            
+            virtual void FormStatement(const DbLocation& dbLocation, string& statement);
         };
         
         /// @brief ڲͣҪƴճӦMYSQLĻȡ䡣
@@ -38,7 +46,7 @@ namespace COMMON
         class MysqlGetPriKeyStmtGen : public StmtGenerator
         {
         public:
-            virtual bool MakeupStatement(vector<string>& , string , string values, bool); 
+            virtual bool MakeupStatement(vector<string>& , const string& , const string& values, bool, unsigned long long); 
         
             virtual string FormStatement(const DbLocation& dbLocation);
         };
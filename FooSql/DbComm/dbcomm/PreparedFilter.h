@@ -0,0 +1,148 @@
+/// @file PreparedFilter.h
+/// @brief The file defines a filter for the statements with parameters, which are prepared once by the server
+/// and executed with the values bound in their binary form.
+
+/// @author Aicro Ai
+/// @date 2015/6/18
+
+#ifndef COMMON_DBCOMM_PREPAREDFILTER_H_
+#define COMMON_DBCOMM_PREPAREDFILTER_H_
+
+#include <string>
+#include <vector>
+
+#include "dbcomm/DbActionFilter.h"
+
+using namespace std;
+
+namespace COMMON
+{
+    namespace DBCOMM
+    {
+        /// @brief A filter for a statement with '?' placeholders, such as "INSERT INTO t VALUES (?, ?)",
+        /// and one or more rows of parameters for it. The statement is executed once for each row.
+        ///
+        /// No value is turned into text, quoted or escaped: numbers are sent as numbers and strings
+        /// are sent as they are, including '\0' inside.
+        class PreparedFilter : public DbActionFilter
+        {
+        public:
+            /// @brief The type of a parameter
+            enum ParamType
+            {
+                PARAM_NULL,
+                PARAM_INTEGER,
+                PARAM_DOUBLE,
+                PARAM_STRING
+            };
+
+            /// @brief A parameter. A string is kept in the filter, see @c GetString().
+            struct Param
+            {
+                /// @brief the type
+                ParamType type_;
+
+                /// @brief the value of a PARAM_INTEGER
+                long long integer_;
+
+                /// @brief the value of a PARAM_DOUBLE
+                double double_;
+
+                /// @brief where a PARAM_STRING begins in the filter
+                size_t offset_;
+
+                /// @brief the length of a PARAM_STRING
+                unsigned long length_;
+            };
+
+        public:
+            /// @brief Constructor
+            /// @param statement the statement with '?' placeholders
+            explicit PreparedFilter(const string& statement = "");
+
+            /// @brief Bind a NULL to the next placeholder of the current row
+            void BindNull();
+
+            /// @brief Bind an integer to the next placeholder of the current row
+            /// @param value the integer
+            void Bind(int value);
+
+            /// @brief Bind an integer to the next placeholder of the current row
+            /// @param value the integer
+            void Bind(long value);
+
+            /// @brief Bind an integer to the next placeholder of the current row
+            /// @param value the integer
+            void Bind(long long value);
+
+            /// @brief Bind a double to the next placeholder of the current row
+            /// @param value the double
+            void Bind(double value);
+
+            /// @brief Bind a string to the next placeholder of the current row
+            /// @param value the string, copied into the filter
+            void Bind(const string& value);
+
+            /// @brief Bind a buffer, which may have '\0' inside, to the next placeholder of the current row
+            /// @param length the length of the buffer
+            /// @param value the buffer, copied into the filter
+            void Bind(long length, const char* value);
+
+            /// @brief End the current row. The parameters bound afterwards go to a new row.
+            /// @note It is not necessary to call it after the last row.
+            void NextRow();
+
+            /// @brief Remove all the parameters, the statement is kept. The buffers are kept for the next rows.
+            void ClearParams();
+
+            /// @brief Get the number of rows. A statement without any parameter has one row.
+            /// @return the number of rows
+            int GetRowCount() const;
+
+            /// @brief Get the number of parameters of a row
+            /// @param row from 0 to GetRowCount() - 1
+            /// @return the number of parameters of the row
+            int GetParamCount(int row) const;
+
+            /// @brief Get a parameter
+            /// @param row from 0 to GetRowCount() - 1
+            /// @param index from 0 to GetParamCount(row) - 1
+            /// @return the parameter
+            const Param& GetParam(int row, int index) const;
+
+            /// @brief Get the buffer of a PARAM_STRING
+            /// @param param the parameter
+            /// @return the buffer, valid until more parameters are bound
+            const char* GetString(const Param& param) const;
+
+            /// @brief Read a query through a server-side cursor, which sends the rows in groups
+            /// instead of all at once. It is meant for big scans.
+            /// @param prefetchRows the number of rows of each group, 0 means no cursor, the default.
+            void SetPrefetchRows(unsigned long prefetchRows);
+
+            /// @brief Get the number of rows of each group sent by the cursor
+            /// @return the number of rows, 0 means no cursor
+            unsigned long GetPrefetchRows() const;
+
+        private:
+            // where the current row begins
+            size_t RowBegin(int row) const;
+
+            Param& NewParam(ParamType type);
+
+        private:
+            // the parameters of all the rows
+            vector<Param> params_;
+
+            // where each row ends in params_, the row not ended yet is not here
+            vector<size_t> row_ends_;
+
+            // the strings of all the parameters, one after another
+            string strings_;
+
+            unsigned long prefetch_rows_;
+        };
+    }
+}
+
+#endif
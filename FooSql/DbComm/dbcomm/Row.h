@@ -13,6 +13,8 @@
 
 #include "tool/StringHelper.h"
 
+#include "dbcomm/ColumnRef.h"
+
 #include "exception/CodingException.h"
 #include "exception/ThrowableException.h"
 
@@ -32,6 +34,12 @@ namespace COMMON
             /// @param column_index a map for column name and its associated position
             Row(char** row, map<string, int>* column_index);
 
+            /// @brief Constructor
+            /// @param row the raw data retrieved from DBMS by a SELECT statement
+            /// @param column_index a map for column name and its associated position
+            /// @param lengths the lengths of the values, 0 if they are not known, which are found by strlen() then
+            Row(char** row, map<string, int>* column_index, unsigned long* lengths);
+
             /// @brief Default constructor
             Row();
             
@@ -50,7 +58,12 @@ namespace COMMON
             /// @param column the column name
             /// @return The column value. 
 			/// @note If the column name specified cannot be found, an exception will be thrown out
-            const char* operator [](string column) const throw(ThrowableException);
+            const char* operator [](const string& column) const throw(ThrowableException);
+
+            /// @brief Get the column value by using a column resolved before, without looking up the name
+            /// @param column the column, see @c DbQueryRslt::GetColumnRef()
+            /// @return The column value. 
+            const char* operator [](const ColumnRef& column) const { return row_[column.GetIndex()]; }
 
             /// @brief Get the column value by using position
             /// @param index the position, begin with 0
@@ -60,14 +73,62 @@ namespace COMMON
             /// @brief Get the position of the specified column.
             /// @param colName column name
             /// @return The corresponding position index of the column name, if not found, -1 will be returned.
-            int GetIndexByColName(string colName) const throw(ThrowableException);
+            int GetIndexByColName(const string& colName) const throw(ThrowableException);
+
+            // The typed getters below read the text of a value without the locale. They return false
+            // for a NULL, or a value that is not of the type, whose result is then left as it is.
+
+            /// @brief Whether a value is NULL
+            /// @param column the column, see @c DbQueryRslt::GetColumnRef()
+            /// @return true if it is NULL
+            bool IsNull(const ColumnRef& column) const { return row_[column.GetIndex()] == 0; }
+
+            /// @brief Get a value as a string, which is ended by '\0'
+            /// @param column the column
+            /// @param length the length of the value
+            /// @return the value, 0 if it is NULL
+            const char* GetString(const ColumnRef& column, unsigned long& length) const;
+
+            /// @brief Get a value as a 32-bit integer
+            /// @param column the column
+            /// @param value the integer
+            /// @return false if it is NULL, not an integer, or out of the range
+            bool GetInt32(const ColumnRef& column, int& value) const;
+
+            /// @brief Get a value as a 64-bit integer
+            /// @param column the column
+            /// @param value the integer
+            /// @return false if it is NULL, not an integer, or out of the range
+            bool GetInt64(const ColumnRef& column, long long& value) const;
+
+            /// @brief Get a value as an unsigned 64-bit integer, such as a BIGINT UNSIGNED
+            /// @param column the column
+            /// @param value the integer
+            /// @return false if it is NULL, not an unsigned integer, or out of the range
+            bool GetUInt64(const ColumnRef& column, unsigned long long& value) const;
+
+            /// @brief Get a value as a double, which may be a DECIMAL
+            /// @param column the column
+            /// @param value the double
+            /// @return false if it is NULL, or not a number
+            bool GetDouble(const ColumnRef& column, double& value) const;
+
+            /// @brief Get a value as a bool, an integer which is true if not 0, or "true"/"false"
+            /// @param column the column
+            /// @param value the bool
+            /// @return false if it is NULL, or neither of them
+            bool GetBool(const ColumnRef& column, bool& value) const;
 
         private:
             string FormCandidates() const;
+
+            // find a column by the name as it is, or by the lower case one without blanks
+            map<string, int>::const_iterator Find(const string& colName) const;
             
         private:
             char** row_;
             map<string, int>* column_index_;
+            unsigned long* lengths_;
         };
     }
 }
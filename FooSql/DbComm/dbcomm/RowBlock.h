@@ -0,0 +1,238 @@
+/// @file RowBlock.h
+/// @brief The file defines a block of rows, which are fetched from a result set at once.
+
+/// @author Aicro Ai
+/// @date 2015/6/20
+
+#ifndef COMMON_DBCOMM_ROWBLOCK_H_
+#define COMMON_DBCOMM_ROWBLOCK_H_
+
+#include <string>
+#include <vector>
+#include <map>
+
+#include "dbcomm/Row.h"
+
+using namespace std;
+
+namespace COMMON
+{
+    namespace DBCOMM
+    {
+        class DbLocation;
+
+        /// @brief A block of rows fetched at once by @c DbQueryRslt::FetchBlock(). The buffers are kept when
+        /// the block is filled again, so a block reused for a whole result set allocates nothing per row.
+        ///
+        /// A row is read as a @c Row, or value by value. Unlike @c Row, a NULL is told from an empty string.
+        /// The numeric columns may be fetched in their binary form, see @c SetNativeNumbers(), and their
+        /// text is only formed when it is read.
+        class RowBlock
+        {
+        public:
+            /// @brief The default number of rows of a block
+            enum { DEFAULT_CAPACITY = 256 };
+
+            /// @brief How the values of a column are kept
+            enum ColumnType
+            {
+                COLUMN_TEXT,
+                COLUMN_INTEGER,
+                COLUMN_DOUBLE
+            };
+
+        public:
+            /// @brief Constructor
+            /// @param capacity the max number of rows fetched into the block at once
+            explicit RowBlock(int capacity = DEFAULT_CAPACITY);
+
+            /// @brief Set the max number of rows fetched into the block at once
+            /// @param capacity the number of rows, at least 1
+            void SetCapacity(int capacity);
+
+            /// @brief Get the max number of rows fetched into the block at once
+            /// @return the number of rows
+            int GetCapacity() const;
+
+            /// @brief Ask the DBMS to send the integer and floating point columns in their binary form,
+            /// which are read by @c GetInteger() and @c GetDouble() without parsing. Only the DBMS binding
+            /// the columns, such as DB2, supports it, the others keep all the columns in text.
+            /// @param nativeNumbers true to fetch the numbers in their binary form. It is off by default.
+            void SetNativeNumbers(bool nativeNumbers);
+
+            /// @brief Whether the numbers are asked for in their binary form
+            /// @return true if so
+            bool IsNativeNumbers() const;
+
+            /// @brief Get the number of rows in the block
+            /// @return the number of rows
+            int GetRowCount() const;
+
+            /// @brief Get the number of columns of each row
+            /// @return the number of columns
+            int GetColumnCount() const;
+
+            /// @brief Get how the values of a column are kept
+            /// @param column the position of the column, begin with 0
+            /// @return the type
+            ColumnType GetColumnType(int column) const;
+
+            /// @brief Get a row. The row is valid until the block is filled again.
+            /// @param row the position of the row, begin with 0
+            /// @return the row, a NULL column is 0 in it
+            Row GetRow(int row);
+
+            /// @brief Get the lengths of all the columns of a row, as @c DbQueryRslt::GetCurrentRowColumnsLength() gives
+            /// @param row the position of the row, begin with 0
+            /// @return the lengths, 0 for a NULL column
+            unsigned long* GetLengths(int row);
+
+            /// @brief Whether a value is NULL
+            /// @param row the position of the row, begin with 0
+            /// @param column the position of the column, begin with 0
+            /// @return true if it is NULL
+            bool IsNull(int row, int column) const;
+
+            /// @brief Get a value in text, ended by '\0'
+            /// @param row the position of the row, begin with 0
+            /// @param column the position of the column, begin with 0
+            /// @return the value, 0 if it is NULL
+            const char* GetValue(int row, int column);
+
+            /// @brief Get the length of a value in text
+            /// @param row the position of the row, begin with 0
+            /// @param column the position of the column, begin with 0
+            /// @return the length, 0 if it is NULL
+            unsigned long GetLength(int row, int column);
+
+            /// @brief Get a value of a COLUMN_INTEGER column
+            /// @param row the position of the row, begin with 0
+            /// @param column the position of the column, begin with 0
+            /// @return the value, 0 if it is NULL
+            long long GetInteger(int row, int column) const;
+
+            /// @brief Get a value of a COLUMN_DOUBLE column
+            /// @param row the position of the row, begin with 0
+            /// @param column the position of the column, begin with 0
+            /// @return the value, 0 if it is NULL
+            double GetDouble(int row, int column) const;
+
+            /// @brief Read the integers of a column for all the rows in one loop, which is faster than
+            /// reading them row by row. The text of a COLUMN_TEXT column is parsed, see @c Row::GetInt64().
+            /// @param column the position of the column, begin with 0
+            /// @param values the integers, one for each row, 0 for a NULL or a value not an integer
+            /// @return the number of rows which are NULL or not integers
+            int ParseIntegers(int column, long long* values) const;
+
+            /// @brief Read the doubles of a column for all the rows in one loop, see @c ParseIntegers()
+            /// @param column the position of the column, begin with 0
+            /// @param values the doubles, one for each row, 0 for a NULL or a value not a number
+            /// @return the number of rows which are NULL or not numbers
+            int ParseDoubles(int column, double* values) const;
+
+            /// @brief Get the map of the column names and their positions for the rows
+            /// @return the map, 0 if it is not known
+            map<string, int>* GetColumnIndex() const;
+
+            /// @brief Get the connection the rows come from
+            /// @return the connection, kept by the result
+            const DbLocation* GetLocation() const;
+
+            /// @brief Get the number of bytes of the values kept in text
+            /// @return the number of bytes
+            size_t GetByteCount() const;
+
+            /// @brief Exchange the rows with another block without copying them. The capacities and the
+            /// choices of @c SetNativeNumbers() are kept by each block.
+            /// @param other the other block
+            void Swap(RowBlock& other);
+
+            // The methods below are used by the engines to fill the block
+
+            /// @brief INTERNAL USE ONLY. Remove all the rows and start to fill the block with rows of
+            /// the given number of columns, all of which are COLUMN_TEXT. The buffers are kept.
+            /// @param columnCount the number of columns
+            void Reset(int columnCount);
+
+            /// @brief INTERNAL USE ONLY. Set the map of the column names and their positions for the rows
+            /// @param columnIndex the map, owned by the query action
+            void SetColumnIndex(map<string, int>* columnIndex);
+
+            /// @brief INTERNAL USE ONLY. Set the connection the rows come from
+            /// @param location the connection
+            void SetLocation(const DbLocation* location);
+
+            /// @brief INTERNAL USE ONLY. Set how the values of a column are kept, before any row is added
+            /// @param column the position of the column, begin with 0
+            /// @param type the type
+            void SetColumnType(int column, ColumnType type);
+
+            /// @brief INTERNAL USE ONLY. Add a value in text to the current row. A row ends when all of its columns are added.
+            /// @param value the value
+            /// @param length the length of the value
+            void AppendValue(const char* value, unsigned long length);
+
+            /// @brief INTERNAL USE ONLY. Add a NULL to the current row
+            void AppendNull();
+
+            /// @brief INTERNAL USE ONLY. Add a value to the current row of a COLUMN_INTEGER column
+            /// @param value the value
+            void AppendInteger(long long value);
+
+            /// @brief INTERNAL USE ONLY. Add a value to the current row of a COLUMN_DOUBLE column
+            /// @param value the value
+            void AppendDouble(double value);
+
+            /// @brief INTERNAL USE ONLY. Add a row fetched in text
+            /// @param values the values, 0 for NULL
+            /// @param lengths the lengths of the values
+            void AppendRow(char** values, unsigned long* lengths);
+
+        private:
+            // a value of a COLUMN_INTEGER or COLUMN_DOUBLE column
+            union Number
+            {
+                long long integer_;
+                double double_;
+            };
+            
+            // form the text of the numbers and the pointers to the values
+            void Materialize();
+
+            // point to the first values in data_
+            void UpdatePointers(size_t count);
+
+        private:
+            int capacity_;
+
+            bool native_numbers_;
+
+            int column_count_;
+
+            map<string, int>* column_index_;
+
+            const DbLocation* location_;
+
+            vector<ColumnType> column_types_;
+
+            // the values in text, one after another, each one is ended by '\0'
+            string data_;
+
+            // for each value, row by row: where it begins in data_, its length, and whether it is NULL
+            vector<size_t> offsets_;
+            vector<unsigned long> lengths_;
+            vector<char> nulls_;
+
+            // for each value, the number of a COLUMN_INTEGER or COLUMN_DOUBLE column
+            vector<Number> numbers_;
+
+            // for each value, the pointer to it, 0 for NULL. They are formed when the block is read.
+            vector<char*> pointers_;
+
+            // the number of values whose pointers and text are formed
+            size_t materialized_;
+        };
+    }
+}
+
+#endif
@@ -0,0 +1,65 @@
+/// @file RowRecord.h
+/// @brief The file defines the form of a row copied out of a block, with a key before its values.
+
+/// @author Aicro Ai
+/// @date 2015/6/27
+
+#ifndef COMMON_DBCOMM_ROWRECORD_H_
+#define COMMON_DBCOMM_ROWRECORD_H_
+
+#include <cstddef>
+#include <string>
+
+#include "dbcomm/RowBlock.h"
+
+using namespace std;
+
+namespace COMMON
+{
+    namespace DBCOMM
+    {
+        /// @brief A row copied out of a block into a string of bytes, with a key and the connection of the row,
+        /// so that it is kept in an arena or a temporary file. A record is formed as below:
+        ///   - the number of bytes after this field, 4 bytes
+        ///   - the length of the key, 4 bytes, followed by the key
+        ///   - the connection the row comes from, a pointer
+        ///   - for each column, its length, 4 bytes, -1 for NULL, followed by the value ended by '\0' if not NULL
+        ///
+        /// The values are read in place, so a row is given without copying it again.
+        class RowRecord
+        {
+        public:
+            /// @brief Form a record
+            /// @param block the block of the row
+            /// @param row the position of the row, begin with 0
+            /// @param key the key
+            /// @param record the record, its old content is removed
+            static void Encode(RowBlock& block, int row, const string& key, string& record);
+
+            /// @brief Get the number of bytes of a record
+            /// @param record the record
+            /// @return the number of bytes
+            static size_t GetSize(const char* record);
+
+            /// @brief Get the key of a record
+            /// @param record the record
+            /// @param length the length of the key
+            /// @return the key
+            static const char* GetKey(const char* record, size_t& length);
+
+            /// @brief Get the connection the row of a record comes from
+            /// @param record the record
+            /// @return the connection
+            static const DbLocation* GetLocation(const char* record);
+
+            /// @brief Point to the values of a record
+            /// @param record the record
+            /// @param count the number of columns
+            /// @param values the values to fill, 0 for NULL
+            /// @param lengths the lengths to fill
+            static void Decode(const char* record, int count, char** values, unsigned long* lengths);
+        };
+    }
+}
+
+#endif
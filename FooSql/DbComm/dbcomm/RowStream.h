@@ -0,0 +1,183 @@
+/// @file RowStream.h
+/// @brief The file defines a bounded ring of row blocks, which are read ahead by a working thread.
+
+/// @author Aicro Ai
+/// @date 2015/6/22
+
+#ifndef COMMON_DBCOMM_ROWSTREAM_H_
+#define COMMON_DBCOMM_ROWSTREAM_H_
+
+#include <deque>
+#include <vector>
+#include <map>
+#include <string>
+#include <tr1/memory>
+
+#include "dbcomm/RowBlock.h"
+#include "dbcomm/DbLocationMap.h"
+
+#include "exception/IException.h"
+
+#include "thread/Mutex.h"
+#include "thread/Condition.h"
+
+using namespace std;
+
+namespace COMMON
+{
+    namespace DBCOMM
+    {
+        /// @brief The rows of a result set read ahead by the working thread of a connection. The working
+        /// thread copies the rows into blocks and the consumer takes them away, so reading from the network
+        /// and handling the rows run at the same time.
+        ///
+        /// The rows kept by the stream, including the block being read by the consumer, are bounded both in
+        /// the number and in bytes. The working thread waits when the stream is full.
+        ///
+        /// Several connections may fill the same stream at once, then the rows are given in the order they
+        /// arrive, block by block, and each block tells the connection it comes from.
+        class RowStream
+        {
+        public:
+            /// @brief The default max number of rows kept
+            enum { DEFAULT_MAX_ROWS = 4096 };
+
+            /// @brief The default max number of bytes of the rows kept
+            enum { DEFAULT_MAX_BYTES = 4 * 1024 * 1024 };
+
+        public:
+            /// @brief Constructor
+            /// @param maxRows the max number of rows kept, at least 1
+            /// @param maxBytes the max number of bytes of the rows kept. A row is kept even if it is larger.
+            RowStream(int maxRows = DEFAULT_MAX_ROWS, size_t maxBytes = DEFAULT_MAX_BYTES);
+
+            ~RowStream();
+
+            // The methods below are used by the consumer
+
+            /// @brief Get the next row. Wait if the working thread has not read it yet.
+            /// @return the values of the row, 0 if there is no more rows left, or on error
+            char** Fetch();
+
+            /// @brief Get the lengths of all the columns of the row given by the last @c Fetch()
+            /// @return the lengths
+            unsigned long* GetCurrentLengths();
+
+            /// @brief Get the connection the row given by the last @c Fetch() comes from
+            /// @return the connection, 0 if there is no such row
+            const DbLocation* GetCurrentLocation();
+
+            /// @brief Get the next block of rows, which is exchanged with the given one without copying.
+            /// Wait if the working thread has not read it yet. Do not mix it with @c Fetch().
+            /// @param block the block to fill, its old rows are removed
+            /// @return the number of rows, 0 if there is no more rows left, or on error
+            int FetchBlock(RowBlock& block);
+
+            /// @brief Ask the working thread to stop reading. The rows not read yet are dropped.
+            void Cancel();
+
+            /// @brief Get the error met by the working thread. Only meaningful after @c Fetch() or
+            /// @c FetchBlock() returns 0.
+            /// @return the error, empty if there is none
+            tr1::shared_ptr<EXCEPTION::IException> GetException();
+
+            /// @brief INTERNAL USE ONLY. Add a connection which fills the stream, before the working threads start.
+            /// The stream is finished when all of them call @c Finish().
+            /// @param location the connection, kept by the query action
+            /// @param columnIndex the map of the column names and their positions of the connection, filled by its working thread
+            void AddSource(const DbLocation* location, map<string, int>* columnIndex);
+
+            /// @brief INTERNAL USE ONLY. Get the map of the column names and their positions of a connection
+            /// @param location the connection
+            /// @return the map, 0 if the connection does not fill the stream
+            map<string, int>* GetColumnIndex(const DbLocation& location);
+
+            // The methods below are used by the working thread
+
+            /// @brief INTERNAL USE ONLY. Get an empty block to fill. Wait if the stream is full.
+            /// @param location the connection filling the block
+            /// @return the block, 0 if the stream is cancelled
+            RowBlock* GetFreeBlock(const DbLocation& location);
+
+            /// @brief INTERNAL USE ONLY. Give a filled block to the consumer. An empty block is given back.
+            /// @param block the block got by @c GetFreeBlock()
+            void PushBlock(RowBlock* block);
+
+            /// @brief INTERNAL USE ONLY. Whether the block should be given to the consumer now
+            /// @param block the block being filled
+            /// @return true if it is full
+            bool IsBlockFull(const RowBlock* block) const;
+
+            /// @brief INTERNAL USE ONLY. Tell the consumer that there is no more rows from a connection
+            /// @param exception the error met, empty if there is none. The first one is kept.
+            void Finish(const tr1::shared_ptr<EXCEPTION::IException>& exception);
+
+        private:
+            // a connection which fills the stream
+            struct Source
+            {
+                const DbLocation* location_;
+                map<string, int>* column_index_;
+            };
+
+        private:
+            // give back the block being read, and take the next one. False if there is no more.
+            bool NextBlock();
+
+            // give back the block being read, the mutex must be held
+            void ReleaseCurrent();
+
+        private:
+            int max_rows_;
+
+            size_t max_bytes_;
+
+            // the max rows and bytes of a block, so that several blocks are kept at once
+            int block_rows_;
+            size_t block_bytes_;
+
+            // the connections filling the stream, read only after the working threads start
+            DbLocationMap<Source> sources_;
+
+            THREAD::Mutex mutex_;
+
+            // notified when a block is pushed or the stream is finished
+            THREAD::Condition not_empty_;
+
+            // notified when a block is given back or the stream is cancelled
+            THREAD::Condition not_full_;
+
+            // all the blocks, owned by the stream
+            vector<RowBlock*> blocks_;
+
+            // the blocks to fill
+            vector<RowBlock*> free_blocks_;
+
+            // the filled blocks not taken by the consumer yet
+            deque<RowBlock*> ready_blocks_;
+
+            // the rows and the bytes of the ready blocks and the block being read
+            int kept_rows_;
+            size_t kept_bytes_;
+
+            // the connections which have not finished
+            int running_;
+
+            bool finished_;
+
+            bool cancelled_;
+
+            tr1::shared_ptr<EXCEPTION::IException> exception_;
+
+            // the block being read by the consumer, with its rows and bytes counted in kept_rows_ and kept_bytes_
+            RowBlock* current_;
+            int current_rows_;
+            size_t current_bytes_;
+
+            // the row being read in current_
+            int current_row_;
+        };
+    }
+}
+
+#endif
@@ -0,0 +1,78 @@
+/// @file SpillFile.h
+/// @brief The file defines a temporary file for the rows which do not fit in memory.
+
+/// @author Aicro Ai
+/// @date 2015/6/26
+
+#ifndef COMMON_DBCOMM_SPILLFILE_H_
+#define COMMON_DBCOMM_SPILLFILE_H_
+
+#include <cstdio>
+#include <string>
+
+#include "exception/ThrowableException.h"
+
+using namespace std;
+
+namespace COMMON
+{
+    namespace DBCOMM
+    {
+        /// @brief A temporary file written once and then read from the beginning, or mapped into memory.
+        /// The file is created when it is first written, and is removed from the directory at once, so it
+        /// goes away with the process.
+        class SpillFile
+        {
+        public:
+            /// @brief Constructor
+            /// @param directory the directory of the file, empty for the one of the system
+            explicit SpillFile(const string& directory = "");
+
+            ~SpillFile();
+
+            /// @brief Add data to the end of the file
+            /// @param data the data
+            /// @param size the number of bytes
+            void Write(const char* data, size_t size) throw (COMMON::EXCEPTION::ThrowableException);
+
+            /// @brief Go to the beginning of the file to read it. Call it after all the data is written.
+            void Rewind() throw (COMMON::EXCEPTION::ThrowableException);
+
+            /// @brief Read data
+            /// @param data the buffer to fill
+            /// @param size the number of bytes
+            /// @return false if the end of the file is met
+            bool Read(char* data, size_t size) throw (COMMON::EXCEPTION::ThrowableException);
+
+            /// @brief Map the whole file into memory to read it in place. Call it after all the data is written.
+            /// @return the data, valid until the file is destroyed, 0 if nothing is written
+            const char* Map() throw (COMMON::EXCEPTION::ThrowableException);
+
+            /// @brief Get the number of bytes written
+            /// @return the number of bytes
+            size_t GetSize() const;
+
+        private:
+            SpillFile(const SpillFile&);
+            SpillFile& operator=(const SpillFile&);
+
+            // create the file
+            void Open() throw (COMMON::EXCEPTION::ThrowableException);
+
+        private:
+            string directory_;
+
+            // the name for the errors
+            string name_;
+
+            FILE* file_;
+
+            size_t size_;
+
+            // the data mapped by Map()
+            void* mapping_;
+        };
+    }
+}
+
+#endif
@@ -12,8 +12,10 @@
 
 #include <vector>
 #include <string>
+#include <tr1/memory>
 
 #include "dbcomm/DbLocation.h"
+#include "dbcomm/DbActionFilter.h"
 
 using namespace std;
 
@@ -21,6 +23,8 @@ namespace COMMON
 {
     namespace DBCOMM
     {
+        class PreparedFilter;
+        
         /// @brief This class is only for inner use, the main purpose of which is to generate 
 		/// valid part of statements such as multiple value insert. Therefore, this class will
 		/// only be used with @c BatchAction or its heritage classes.
@@ -32,11 +36,13 @@ namespace COMMON
             string col_list_; // column list separated by ',', such as "col1, col2, col3"
             string table_name_; // table name
             vector<string> columns_; // Columns name lists
-            stringstream values_; // Եеķʽֵ(Ѻ﷨Ϣ,'20150402'е"'")ļ
+            string values_; // Եеķʽֵ(Ѻ﷨Ϣ,'20150402'е"'")ļ
             bool has_value_; // Ƿйvalue
 
             bool clear_all_; // should we clear all the existing contents? This may be set to true when an incompatible values are input.
             
+            unsigned long long fingerprint_; // the fingerprint of the table and columns buffered, 0 if unknown
+            
         public:
             StmtGenerator();
         
@@ -54,10 +60,33 @@ namespace COMMON
             /// @param columns a list of column names
             /// @param tableName table name
             /// @param values a list of values with their correct format in a SQL statment
+            /// @param forceCheck whether to check the columns even without a fingerprint
+            /// @param fingerprint optional, the @c BatchFilter::GetFingerprint() of the table and columns. If it is given,
+            /// the compatibility is checked by comparing it with that of the buffered values, instead of the strings.
             /// @return Whether the input value is compatible with the existing ones.
             /// -true the input value is not compatible with the existing one, therefore we need to process the existing ones first.
             /// -false the input value is compatible with the existing one, no extra work should be done
-            virtual bool MakeupStatement(vector<string>& columns, string tableName, string values, bool forceCheck = true);
+            virtual bool MakeupStatement(
+                vector<string>& columns, 
+                const string& tableName, 
+                const string& values, 
+                bool forceCheck = true, 
+                unsigned long long fingerprint = 0);
+            
+            /// @brief Create an empty generator of the same kind, to buffer the values of another table
+            /// at the same time. The caller owns it.
+            /// @return the generator, 0 if the kind cannot have more than one
+            virtual StmtGenerator* NewInstance() const { return 0; }
+            
+            /// @brief Get the length of the statement formed by the buffered values. It is at least that
+            /// of the statement formed, so that a statement kept below a packet limit by it is never too long.
+            /// @return the length in bytes, 0 if there is nothing buffered
+            virtual size_t GetStatementSize() const;
+            
+            /// @brief Get the length a row of values adds to the statement
+            /// @param values the row of values, as given to @c MakeupStatement()
+            /// @return the length in bytes
+            static size_t GetRowSize(const string& values) { return values.size() + 3; }
             
             /// @brief Form a complete statement based on elements inside the instance.
 			/// If there is nothing passed before, an empty statement ("") will be returned.
@@ -65,16 +94,46 @@ namespace COMMON
             /// @return A complete SQL statement. If there is nothing passed before, an empty statement ("") will be returned.
             virtual string FormStatement(const DbLocation& dbLocation) = 0;
             
+            /// @brief Form a complete statement into a buffer, which can be handed to a filter by 
+            /// @c DbActionFilter::SwapContents() without copying. The generators of multi-value statements
+            /// write the values straight into the buffer.
+            /// @param dbLocation The location of the target DB
+            /// @param statement The buffer for the statement, its old contents are dropped. It will be empty if there is nothing passed before.
+            virtual void FormStatement(const DbLocation& dbLocation, string& statement);
+            
+            /// @brief Form a complete statement into the filter to send. By default the filter holds the statement
+            /// formed by @c FormStatement(const DbLocation&, string&). The generators for the DBMS binding arrays of
+            /// parameters return a @c PreparedFilter instead, whose statement text does not grow with the values.
+            /// @param dbLocation The location of the target DB
+            /// @param buffer The buffer to form the statement in, it may be handed to the filter
+            /// @return The filter. It is empty if there is nothing passed before.
+            virtual tr1::shared_ptr<DbActionFilter> FormFilter(const DbLocation& dbLocation, string& buffer);
+            
         protected:
             // form a statement like "([prefix.]xxx, [prefix.]bbb, [prefix.]ccc)", 
             string FormOneList(vector<string>& toForm, string prefix = "");
+            
+            // append a row of values, like ",(...)"
+            void AppendValues(const string& values);
+            
+            // form a statement like "<head> tbl (col1,col2) VALUES(...),(...)" into the buffer
+            void FormValuesStatement(const char* head, string& statement);
+            
+            // bind the values appended, a row of parameters for each row of values. Only the literals, 
+            // such as 12, 1.5, 'abc', X'6162' and NULL, can be bound. false for the others, such as NOW(),
+            // and nothing is left bound, so that the values are sent in the statement instead.
+            bool BindValues(PreparedFilter& filter);
         };
 
         /// @brief Internal use only. The class is designed for generate an INSERT statement.
         class InsertStmtGen : public StmtGenerator
         {
         public:
+            virtual StmtGenerator* NewInstance() const { return new InsertStmtGen(); }
+            
             virtual string FormStatement(const DbLocation& dbLocation);
+            
+            virtual void FormStatement(const DbLocation& dbLocation, string& statement);
         };
     }
 }
@@ -0,0 +1,163 @@
+/// @file StringEscaper.h
+/// @brief The file defines an escaper of strings which runs on the calling thread, following the character set of a connection.
+
+/// @author Aicro Ai
+/// @date 2015/7/2
+
+#ifndef COMMON_DBCOMM_STRINGESCAPER_H_
+#define COMMON_DBCOMM_STRINGESCAPER_H_
+
+#include <string>
+#include <vector>
+
+using namespace std;
+
+namespace COMMON
+{
+    namespace DBCOMM
+    {
+        /// @brief Escapes strings to be put between quotation marks in a statement, the same as the DBMS does,
+        /// without going to the working thread of a connection. It is got by @c IDbTasks::GetStringEscaper()
+        /// after connecting, and may be copied and used by any thread. There is no limit on the length.
+        ///
+        /// In a multi-byte character set such as GBK, the second byte of a character may be '\\' or '\'',
+        /// which is kept as it is. So the escaper must follow the character set of the connection.
+        class StringEscaper
+        {
+        public:
+            /// @brief How the special chars are escaped
+            enum Dialect
+            {
+                /// the same as mysql_real_escape_string(): '\\0', '\\n', '\\r', '\\\\', '\\'', '\\"' and '\\Z' (ctrl-Z)
+                DIALECT_MYSQL,
+
+                /// the SQL standard kept by DB2: '\\'' is written twice, the other bytes are as they are, 
+                /// since '\\\\' is not an escape char there
+                DIALECT_DB2
+            };
+
+            /// @brief The character sets which are told apart, as far as escaping and validating are concerned
+            enum Charset
+            {
+                /// a char set where any byte is a char, such as latin1
+                CHARSET_SINGLE_BYTE,
+                /// utf8, utf8mb4. Its bytes above 0x7F are never a special char, so it is escaped as a single-byte one.
+                CHARSET_UTF8,
+                CHARSET_GBK,
+                CHARSET_GB18030,
+                CHARSET_BIG5,
+                CHARSET_SJIS
+            };
+
+            /// @brief How the strings written by @c AppendQuoted() are written
+            struct Stats
+            {
+                Stats() : plain_values_(0), hex_values_(0), bytes_saved_(0) {}
+
+                /// @brief the number of strings valid in the character set, which are quoted and escaped
+                long long plain_values_;
+
+                /// @brief the number of strings invalid in the character set, which are written in hex
+                long long hex_values_;
+
+                /// @brief the number of bytes saved by writing the valid strings as they are rather than in hex
+                long long bytes_saved_;
+            };
+
+        public:
+            /// @brief Constructor
+            /// @param dialect how the special chars are escaped
+            /// @param charset the character set of the strings
+            explicit StringEscaper(Dialect dialect = DIALECT_MYSQL, Charset charset = CHARSET_SINGLE_BYTE);
+
+            /// @brief Find the character set by its name in the DBMS, such as "gbk" or "utf8mb4"
+            /// @param name the name, in any case
+            /// @return the character set, CHARSET_SINGLE_BYTE if it is none of the others
+            static Charset CharsetFromName(const string& name);
+
+            /// @brief Get the dialect
+            /// @return the dialect
+            Dialect GetDialect() const { return dialect_; }
+
+            /// @brief Get the character set
+            /// @return the character set
+            Charset GetCharset() const { return charset_; }
+
+            /// @brief Append an escaped string, without quotation marks. In a multi-byte character set of MySQL,
+            /// a lead byte without a valid second byte is escaped too, so that the server never takes the
+            /// escape char after it as a part of the char. DB2 has no escape char, so a string of a multi-byte
+            /// character set is only safe there by @c AppendQuoted(), which sends an invalid one in hex.
+            /// @param out the buffer to append to
+            /// @param src the string
+            /// @param length the length of the string
+            void Append(string& out, const char* src, size_t length) const;
+
+            /// @brief Whether a string is made of valid chars of the character set, which is then safe to
+            /// be sent as it is. The ASCII bytes are skipped 16 at a time.
+            /// @param src the string
+            /// @param length the length of the string
+            /// @return true if it is valid. Any string is valid in CHARSET_SINGLE_BYTE.
+            bool IsValid(const char* src, size_t length) const;
+
+            /// @brief Append a string in quotation marks, escaped if it is valid in the character set, such as
+            /// 'abc', or in hex if not, such as X'ff00'. So the text in the character set is sent as it is, and
+            /// only the binary data is doubled by hex.
+            /// @param out the buffer to append to
+            /// @param src the string
+            /// @param length the length of the string
+            /// @param stats optional. If it is not 0, the string is counted in it.
+            void AppendQuoted(string& out, const char* src, size_t length, Stats* stats = 0) const;
+
+            /// @brief Escape a string
+            /// @param src the string
+            /// @param length the length of the string
+            /// @return the escaped string, without quotation marks
+            string Escape(const char* src, size_t length) const;
+
+            /// @brief Escape a batch of strings
+            /// @param sources the strings
+            /// @param escaped output parameter. The escaped strings, one for each of @c sources
+            void Escape(const vector<string>& sources, vector<string>& escaped) const;
+
+        private:
+            // what a byte is
+            enum Kind
+            {
+                KIND_PLAIN = 0,
+                KIND_ESCAPE = 1,
+                KIND_LEAD = 2
+            };
+
+            // the max number of special chars of a dialect
+            enum { MAX_SPECIALS = 8 };
+
+            void AddSpecial(char c, char replacement);
+
+            // the length of the char of a multi-byte character set at the beginning of src, 0 if it is invalid
+            size_t MultiByteCharLength(const unsigned char* src, size_t length) const;
+
+        private:
+            Dialect dialect_;
+            Charset charset_;
+
+            // whether the character set has multi-byte chars whose second byte may be a special char
+            bool has_leads_;
+
+            // the char put before a special one, '\\' or '\'' of DB2
+            char escape_;
+
+            // the kind of each byte, and the char after the escape char for a special one
+            unsigned char kinds_[256];
+            char replacements_[256];
+
+            // the bytes which may follow a lead byte in a multi-byte char
+            unsigned char trails_[256];
+
+            // the special chars, compared with 16 bytes at once
+            char specials_[MAX_SPECIALS];
+            int special_count_;
+        };
+    }
+}
+
+#endif
@@ -9,8 +9,10 @@
 #define COMMON_DBCOMM_VALUE_H_
 
 #include <string.h>
-#include <sstream>
-#include <iomanip>
+#include <string>
+
+#include "dbcomm/ValueFormatter.h"
+#include "dbcomm/StringEscaper.h"
 
 using namespace std;
 
@@ -35,35 +37,28 @@ namespace COMMON
             /// @param intValue a value represents an INTEGER or related number type in its DBMS
             Value(int intValue)
             {
-                stringstream ss;
-                ss << intValue;
-                contents_ = ss.str();
+                ValueFormatter::AppendInteger(contents_, intValue);
             }
             /// @brief Constructor
             /// @param longValue a value represents an number type in its DBMS
             Value(long longValue)
             {
-                stringstream ss;
-                ss << longValue;
-                contents_ = ss.str();
+                ValueFormatter::AppendInteger(contents_, longValue);
             }
             
             /// @brief Constructor
             /// @param longValue a value represents an INTEGER or related number type in its DBMS
             Value(long long longlongValue)
             {
-                stringstream ss;
-                ss << longlongValue;
-                contents_ = ss.str();
+                ValueFormatter::AppendInteger(contents_, longlongValue);
             }
             
             /// @brief Constructor
-            /// @param doubleValue A value represents as DOUBLE or REAL type in its DBMS
+            /// @param doubleValue A value represents as DOUBLE or REAL type in its DBMS. It is written in the 
+            /// shortest form that reads back to the same double, such as "0.1" or "1e+300".
             Value(double doubleValue)
             {
-                stringstream ss;
-                ss << std::fixed << doubleValue;
-                contents_ = ss.str();
+                ValueFormatter::AppendDouble(contents_, doubleValue);
             }
 
             /// @brief Constructor
@@ -78,10 +73,11 @@ namespace COMMON
 			/// a '\0' should be taken special care in a string for it is generally be regarded as the end of a string. Other 
 			/// example is that when the user has input some Chinese characters in the C/C++ codes to generate a statement, 
 			/// they may be misunderstood as invalid string. Under this circumstance, the best way to deal with is to convert 
-			/// them into hex.
-            Value(string value, bool noNeedQuote = false, bool needHex = false)
+			/// them into hex. The constructor taking a @c StringEscaper does so only for the strings invalid in the
+			/// character set of the connection, and sends the others as they are.
+            Value(const string& value, bool noNeedQuote = false, bool needHex = false)
             {
-			    SetValue(value, noNeedQuote, needHex);
+                ValueFormatter::AppendString(contents_, value.data(), value.size(), noNeedQuote, needHex);
             }
 
             /// @brief Constructor
@@ -91,8 +87,18 @@ namespace COMMON
             /// @param needHex true, the default one, means we want to convert the value to its hex format explicitly.
             Value(long length, const char* value, bool noNeedQuote = false, bool needHex = false)
             {
-                string tmp(value, length);
-			    SetValue(tmp, noNeedQuote, needHex);
+                ValueFormatter::AppendString(contents_, value, length, noNeedQuote, needHex);
+            }
+
+            /// @brief Constructor. The value is quoted and escaped if it is valid in the character set of the connection,
+            /// or written in hex if not, without going to the working thread of the connection.
+            /// @param length the length of the value buffer
+            /// @param value the buffer for the value
+            /// @param escaper the escaper of the connection the statement goes to, see @c IDbTasks::GetStringEscaper()
+            /// @param stats optional. If it is not 0, the value is counted in it.
+            Value(long length, const char* value, const StringEscaper& escaper, StringEscaper::Stats* stats = 0)
+            {
+                escaper.AppendQuoted(contents_, value, length, stats);
             }
 
             /// @brief Copy constructor
@@ -104,7 +110,7 @@ namespace COMMON
 			
             /// @brief Get the inner contents
             /// @return the inner contents
-			string GetValue()
+			const string& GetValue() const
 			{
 			    return contents_;
 			}
@@ -117,47 +123,6 @@ namespace COMMON
                 return *this;
 			}
 		
-		private:
-		    void SetValue(string& value, bool noNeedQuote, bool needHex)
-			{
-                stringstream ss;
-                if (needHex)
-                {
-                    ss << "X";
-                }
-                
-	            if (!noNeedQuote)
-                {
-                    ss << "'";
-                }
-                
-                if (needHex)
-                {
-                    ss << std::hex << std::setfill('0');
-                    for (int i = 0; i < value.size(); i++)
-                    {
-						// the std::stringstream regards the value to be buffered as a 32 bit integer,
-						// rather than a 8 bit single char. Therefore, the high 3 bytes will be completed 
-						// with 0xFFFFFF, which is not what we want. 
-						// Details can be found in 
-                        // http://zhuoqiang.me/string-hex-format-output-in-cpp.html
-                        ss << std::setw(2) << (static_cast<unsigned>(value[i]) & 0x000000FF);
-                    }
-                    ss << std::dec;
-                }
-                else
-                {
-                    ss << value;
-                }
-                
-                if (!noNeedQuote)
-                {
-                    ss << "'";
-                }    
-                
-                contents_ = ss.str();
-			}	
-			
 	    private:
 		    string contents_;
         };
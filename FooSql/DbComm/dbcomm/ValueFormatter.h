@@ -0,0 +1,60 @@
+/// @file ValueFormatter.h
+/// @brief The file defines the routines to write values in their SQL format, used by @c Value and @c BatchFilter.
+
+/// @author Aicro Ai
+/// @date 2015/6/16
+
+#ifndef COMMON_DBCOMM_VALUEFORMATTER_H_
+#define COMMON_DBCOMM_VALUEFORMATTER_H_
+
+#include <string>
+
+using namespace std;
+
+namespace COMMON
+{
+    namespace DBCOMM
+    {
+        /// @brief INTERNAL USE ONLY. Writes numbers and strings in their SQL format at the end of a buffer,
+        /// without any stream or temporary string.
+        class ValueFormatter
+        {
+        public:
+            /// @brief the max length of a formatted 64-bit integer, including the sign
+            enum { MAX_INTEGER_LENGTH = 20 };
+
+            /// @brief Write an integer in decimal
+            /// @param value the integer
+            /// @param out the buffer, at least MAX_INTEGER_LENGTH long
+            /// @return the number of chars written
+            static int FormatInteger(long long value, char* out);
+
+            /// @brief Append an integer in decimal
+            /// @param out the buffer to append to
+            /// @param value the integer
+            static void AppendInteger(string& out, long long value);
+
+            /// @brief Append a double in the shortest decimal form that reads back to the same double,
+            /// such as "0.1", "1e+300". The point is always '.', whatever the locale is.
+            /// @param out the buffer to append to
+            /// @param value the double
+            static void AppendDouble(string& out, double value);
+
+            /// @brief Append bytes in hex, 2 lowercase chars for each byte
+            /// @param out the buffer to append to
+            /// @param value the bytes
+            /// @param length the number of bytes
+            static void AppendHex(string& out, const char* value, size_t length);
+
+            /// @brief Append a string value, the same as @c Value(long, const char*, bool, bool) gives.
+            /// @param out the buffer to append to
+            /// @param value the string
+            /// @param length the length of the string
+            /// @param noNeedQuote true means no quotation marks around the value
+            /// @param needHex true means the value is written in hex, such as X'6162'
+            static void AppendString(string& out, const char* value, size_t length, bool noNeedQuote, bool needHex);
+        };
+    }
+}
+
+#endif
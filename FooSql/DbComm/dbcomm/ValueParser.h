@@ -0,0 +1,53 @@
+/// @file ValueParser.h
+/// @brief The file defines the routines to read numbers from the text of the values fetched, used by @c Row and the blocks.
+
+/// @author Aicro Ai
+/// @date 2015/6/30
+
+#ifndef COMMON_DBCOMM_VALUEPARSER_H_
+#define COMMON_DBCOMM_VALUEPARSER_H_
+
+#include <stddef.h>
+
+namespace COMMON
+{
+    namespace DBCOMM
+    {
+        /// @brief INTERNAL USE ONLY. Reads numbers from text of a known length, which needs not be ended by '\0'.
+        /// Unlike strtol() and strtod(), the locale is not looked at, '.' is always the decimal point.
+        /// The blanks around the number are skipped, anything else makes the text not a number.
+        class ValueParser
+        {
+        public:
+            /// @brief Read a signed integer in decimal
+            /// @param text the text
+            /// @param length the length of the text
+            /// @param value the integer read
+            /// @return false if the text is not an integer, or it is out of the range of 64 bits
+            static bool ParseInteger(const char* text, size_t length, long long& value);
+
+            /// @brief Read an unsigned integer in decimal
+            /// @param text the text
+            /// @param length the length of the text
+            /// @param value the integer read
+            /// @return false if the text is not an unsigned integer, or it is out of the range of 64 bits
+            static bool ParseUnsigned(const char* text, size_t length, unsigned long long& value);
+
+            /// @brief Read a double, such as "12.5", "-1e+300", or an integer. The point is always '.', whatever the locale is.
+            /// @param text the text
+            /// @param length the length of the text
+            /// @param value the double read
+            /// @return false if the text is not a number
+            static bool ParseDouble(const char* text, size_t length, double& value);
+
+            /// @brief Read a bool, which is an integer, 0 for false, or "true"/"false" in any case
+            /// @param text the text
+            /// @param length the length of the text
+            /// @param value the bool read
+            /// @return false if the text is neither of them
+            static bool ParseBool(const char* text, size_t length, bool& value);
+        };
+    }
+}
+
+#endif
@@ -158,6 +158,40 @@ namespace COMMON
             string reason_;
 		};
 		
+		/// @brief The class represents the exception that a container cannot keep any more.
+		class ContainerFullException : public CodingException
+		{
+		public:
+			/// @brief Constructor
+			/// @param container the container which is full.
+			/// @param reason the limit met.
+			ContainerFullException(string container, string reason = "")
+                : container_(container), reason_(reason){}
+			
+			virtual ~ContainerFullException() throw () {}
+		
+			virtual string What(bool needDetail = false) const throw ()
+			{
+				stringstream ss;
+				ss << CodingException::What(needDetail) << "The container [" << container_ << "] cannot keep any more.";
+                if (reason_ != "")
+                {
+                    ss << "Detail : " << reason_ << endl;
+                }
+
+				return ss.str();
+			}
+
+			virtual std::string ToString() const throw()
+			{
+				return CodingException::ToString() + "." + "ContainerFullException";
+			}
+
+        private:
+            string container_;
+            string reason_;
+		};
+		
 		/// @brief The class represents that the number of work provided does not match that of the result.
 		class WorkNumNoMatchResultNumException : public CodingException
 		{
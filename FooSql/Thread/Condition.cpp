@@ -1,3 +1,6 @@
+#include <errno.h>
+#include <sys/time.h>
+
 #include "thread/Condition.h"
 #include "thread/Mutex.h"
 
@@ -46,6 +49,20 @@ namespace COMMON
             pthread_cond_wait(&cond, mutex.GetMutex());
         }
 
+        bool Condition::TimedWait(Mutex& mutex, long milliSeconds)
+        {
+            // pthread_cond_timedwait() takes the absolute time to wake up
+            struct timeval now;
+            gettimeofday(&now, 0);
+            
+            long long nanoSeconds = (long long)now.tv_usec * 1000 + (long long)(milliSeconds % 1000) * 1000000;
+            struct timespec until;
+            until.tv_sec = now.tv_sec + milliSeconds / 1000 + (time_t)(nanoSeconds / 1000000000);
+            until.tv_nsec = (long)(nanoSeconds % 1000000000);
+            
+            return pthread_cond_timedwait(&cond, mutex.GetMutex(), &until) != ETIMEDOUT;
+        }
+
         void Condition::Notify()
         {
             pthread_cond_signal(&cond);
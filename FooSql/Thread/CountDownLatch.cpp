@@ -0,0 +1,79 @@
+#include <sched.h>
+#include <unistd.h>
+
+#include "thread/CountDownLatch.h"
+#include "thread/MutexLockGuard.h"
+
+namespace COMMON
+{
+    namespace THREAD
+    {
+        // how many times to look at the counter before falling asleep,
+        // no spinning on a single processor for the workers could not run meanwhile
+        static const int LATCH_SPIN_TIMES = (sysconf(_SC_NPROCESSORS_ONLN) > 1) ? 100 : 0;
+    
+        CountDownLatch::CountDownLatch(int count)
+            : count_(count), mutex_(), cond_()
+        {
+        }
+
+        void CountDownLatch::Reset(int count)
+        {
+            count_ = count;
+            __sync_synchronize();
+        }
+
+        void CountDownLatch::CountDown()
+        {
+            // all but the last one only decrease the counter
+            int count = count_;
+            while (count > 1)
+            {
+                int seen = __sync_val_compare_and_swap(&count_, count, count - 1);
+                if (seen == count)
+                {
+                    return;
+                }
+                count = seen;
+            }
+            
+            // The last one reaches 0 under the mutex, and a waiter seeing 0 takes the mutex before it returns.
+            // So the owner of the latch never frees it while this thread is still notifying.
+            MutexLockGuard guard(mutex_);
+            if (__sync_sub_and_fetch(&count_, 1) <= 0)
+            {
+                cond_.NotifyAll();
+            }
+        }
+
+        void CountDownLatch::Wait()
+        {
+            for (int i = 0; i < LATCH_SPIN_TIMES; i++)
+            {
+                if (count_ <= 0)
+                {
+                    break;
+                }
+                sched_yield();
+            }
+        
+            MutexLockGuard guard(mutex_);
+            while (count_ > 0)
+            {
+                cond_.Wait(mutex_);
+            }
+        }
+
+        bool CountDownLatch::IsDone() const
+        {
+            if (count_ > 0)
+            {
+                return false;
+            }
+            
+            // wait for the last CountDown() to leave the mutex
+            MutexLockGuard guard(mutex_);
+            return true;
+        }
+    }
+}
@@ -28,6 +28,12 @@ namespace COMMON
                 /// @param mutex The mutex to prevent the condition variable be used in multiple threads simultaneously.
                 void Wait(Mutex& mutex);
                 
+                /// @brief Wait until signal to be sent, or until the time is out
+                /// @param mutex The mutex to prevent the condition variable be used in multiple threads simultaneously.
+                /// @param milliSeconds the longest time to wait
+                /// @return false if the time is out
+                bool TimedWait(Mutex& mutex, long milliSeconds);
+                
                 /// @brief Notify one thread waiting in the same condition to continue.
                 void Notify();
                 
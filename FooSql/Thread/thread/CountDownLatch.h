@@ -0,0 +1,55 @@
+/// @file CountDownLatch.h
+/// @brief The file defines a count down latch for waiting a group of works.
+
+/// @author Aicro Ai
+/// @date 2015/6/2
+
+#ifndef COMMON_THREAD_COUNT_DOWN_LATCH_H_
+#define COMMON_THREAD_COUNT_DOWN_LATCH_H_
+
+#include "thread/Mutex.h"
+#include "thread/Condition.h"
+
+namespace COMMON
+{
+    namespace THREAD
+    {
+        /// @brief A latch which lets one thread wait until a number of works have been done by other threads.
+        /// The counter is decreased atomically. Only the last CountDown() takes the mutex and wakes the waiter,
+        /// so N workers finishing cost one wake-up instead of N. Once @c Wait() returns or @c IsDone() is true,
+        /// no CountDown() uses the latch any more, so it may be freed.
+        class CountDownLatch
+        {
+            public:
+                /// @brief explicit constructor
+                /// @param count The number of CountDown() to wait for.
+                explicit CountDownLatch(int count = 0);
+                
+                /// @brief Arm the latch again.
+                /// @param count The number of CountDown() to wait for.
+                /// @note Must not be called while some thread is waiting on the latch.
+                void Reset(int count);
+                
+                /// @brief Decrease the counter. The waiter will be woken up when it reaches 0.
+                void CountDown();
+                
+                /// @brief Wait until the counter reaches 0.
+                void Wait();
+                
+                /// @brief Testify whether the counter has reached 0, without blocking.
+                /// @return true means all works have been done.
+                bool IsDone() const;
+                
+            private:
+                CountDownLatch(const CountDownLatch&);
+                CountDownLatch& operator=(const CountDownLatch&);
+                
+            private:
+                volatile int count_;
+                mutable Mutex mutex_;
+                Condition cond_;
+        };
+    }
+}
+
+#endif
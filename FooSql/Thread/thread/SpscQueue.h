@@ -0,0 +1,208 @@
+/// @file SpscQueue.h
+/// @brief The file defines a bounded single-producer/single-consumer ring.
+
+/// @author Aicro Ai
+/// @date 2015/6/2
+
+#ifndef THREAD_SPSCQUEUE_H_
+#define THREAD_SPSCQUEUE_H_
+
+#include <pthread.h>
+#include <sched.h>
+#include <unistd.h>
+
+#include "thread/Mutex.h"
+#include "thread/MutexLockGuard.h"
+#include "thread/Condition.h"
+
+namespace COMMON
+{
+    namespace THREAD
+    {
+        /// @brief A bounded ring buffer for exactly one producer thread and one consumer thread.
+        /// Items are passed without taking any lock. The mutex and the conditions inside are only
+        /// touched when one side has to sleep, that is when the ring is empty for the consumer
+        /// or full for the producer.
+        /// @note Calling Push() from two threads, or Pop() from two threads, at the same time is
+        /// not allowed. Use @c BlockingQueue for that.
+        template<typename T>
+        class SpscQueue
+        {
+            public:
+                /// @brief explicit constructor
+                /// @param max_size the max size for the ring. It will be rounded up to a power of 2.
+                explicit SpscQueue(int max_size = 1024)
+                    : head_(0), tail_(0), consumer_waiting_(0), producer_waiting_(0),
+                      mutex_(), not_empty_(), not_full_()
+                {
+                    unsigned long capacity = 2;
+                    while (capacity < (unsigned long)max_size)
+                    {
+                        capacity <<= 1;
+                    }
+
+                    mask_ = capacity - 1;
+                    buffer_ = new T [capacity];
+                }
+
+                ~SpscQueue()
+                {
+                    delete [] buffer_;
+                }
+
+                /// @brief Append an object to the end of the ring. PRODUCER ONLY.
+                /// If the ring is full, the method will be blocked until a Pop() be called.
+                /// @param a The object to be put into the ring.
+                void Push(const T& a)
+                {
+                    unsigned long tail = tail_;
+
+                    if (tail - head_ > mask_)
+                    {
+                        WaitNotFull(tail);
+                    }
+
+                    buffer_[tail & mask_] = a;
+
+                    // publish the slot before moving the tail
+                    __sync_synchronize();
+                    tail_ = tail + 1;
+
+                    // pairs with the barrier in WaitNotEmpty()
+                    __sync_synchronize();
+                    if (consumer_waiting_)
+                    {
+                        MutexLockGuard guard(mutex_);
+                        not_empty_.Notify();
+                    }
+                }
+
+                /// @brief Get an object from the front of the ring. CONSUMER ONLY.
+                /// @param d The method will be blocked if no items have been put in the ring.
+                void Pop(T& d)
+                {
+                    unsigned long head = head_;
+
+                    if (head == tail_)
+                    {
+                        WaitNotEmpty(head);
+                    }
+
+                    // the slot is read only after the tail has been seen
+                    __sync_synchronize();
+                    d = buffer_[head & mask_];
+
+                    __sync_synchronize();
+                    head_ = head + 1;
+
+                    // pairs with the barrier in WaitNotFull()
+                    __sync_synchronize();
+                    if (producer_waiting_)
+                    {
+                        MutexLockGuard guard(mutex_);
+                        not_full_.Notify();
+                    }
+                }
+
+                /// @brief Testify whether the ring is empty or not.
+                /// @return true means the ring is empty
+                bool IsEmpty() const
+                {
+                    return head_ == tail_;
+                }
+
+            private:
+                // spin for a while, then sleep until the producer has moved the tail
+                void WaitNotEmpty(unsigned long head)
+                {
+                    int spin_times = SpinTimes();
+                    for (int i = 0; i < spin_times; i++)
+                    {
+                        if (head != tail_)
+                        {
+                            return;
+                        }
+                        Relax(i);
+                    }
+
+                    MutexLockGuard guard(mutex_);
+                    consumer_waiting_ = 1;
+                    __sync_synchronize();
+                    while (head == tail_)
+                    {
+                        not_empty_.Wait(mutex_);
+                    }
+                    consumer_waiting_ = 0;
+                }
+
+                // spin for a while, then sleep until the consumer has moved the head
+                void WaitNotFull(unsigned long tail)
+                {
+                    int spin_times = SpinTimes();
+                    for (int i = 0; i < spin_times; i++)
+                    {
+                        if (tail - head_ <= mask_)
+                        {
+                            return;
+                        }
+                        Relax(i);
+                    }
+
+                    MutexLockGuard guard(mutex_);
+                    producer_waiting_ = 1;
+                    __sync_synchronize();
+                    while (tail - head_ > mask_)
+                    {
+                        not_full_.Wait(mutex_);
+                    }
+                    producer_waiting_ = 0;
+                }
+
+                // spinning only makes sense when the other side can run at the same time
+                static int SpinTimes()
+                {
+                    static const int spin_times = (sysconf(_SC_NPROCESSORS_ONLN) > 1) ? SPIN_TIMES : 0;
+                    return spin_times;
+                }
+
+                static void Relax(int times)
+                {
+#if defined(__i386__) || defined(__x86_64__)
+                    __asm__ __volatile__("pause" ::: "memory");
+#endif
+                    if (times > SPIN_TIMES / 2)
+                    {
+                        sched_yield();
+                    }
+                }
+
+            private:
+                SpscQueue(const SpscQueue&);
+                SpscQueue& operator=(const SpscQueue&);
+
+            private:
+                enum { SPIN_TIMES = 200 };
+
+                enum { CACHE_LINE_SIZE = 64 };
+
+                T* buffer_;
+                unsigned long mask_;
+
+                // keep the two indexes in different cache lines, so the producer and the consumer
+                // do not invalidate each other on every item
+                char pad0_[CACHE_LINE_SIZE];
+                volatile unsigned long head_;
+                char pad1_[CACHE_LINE_SIZE];
+                volatile unsigned long tail_;
+                char pad2_[CACHE_LINE_SIZE];
+
+                volatile int consumer_waiting_;
+                volatile int producer_waiting_;
+
+                Mutex mutex_;
+                Condition not_empty_;
+                Condition not_full_;
+        };
+    }
+}
+#endif
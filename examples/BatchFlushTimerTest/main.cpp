@@ -0,0 +1,355 @@
+#include <stdio.h>
+#include <string.h>
+#include <unistd.h>
+
+#include <string>
+#include <algorithm>
+#include <vector>
+#include <iostream>
+#include <tr1/memory>
+
+#include "dbcomm/DbTasks.h"
+#include "dbcomm/DbEngine.h"
+#include "dbcomm/DbBatchAction.h"
+#include "dbcomm/BatchFilter.h"
+#include "dbcomm/FlushPolicy.h"
+#include "dbcomm/DbException.h"
+#include "exception/ThrowableException.h"
+#include "exception/ErrorBox.h"
+
+#include "thread/Mutex.h"
+#include "thread/MutexLockGuard.h"
+
+using namespace std;
+using namespace COMMON::DBCOMM;
+using namespace COMMON::EXCEPTION;
+using namespace COMMON::EXCEPTION::DB;
+
+// Checks that a failure of the statements sent by the flush timer of a batch action does not
+// lose the values still buffered. No DB server is needed: the engine below keeps the INSERTs
+// in memory, and fails them while it is told to.
+//
+// A row of table A is buffered, then a row of table B. The timer sends A when it is too old,
+// which fails, and EndAction() is called before B is too old. B must still be sent and
+// committed, the failure must be reported, and the action must be finished so that the
+// next one can start.
+//
+// Then the failure of the timer is reported by the next Do() instead. The row given to that
+// Do() must still be buffered and sent. Without the exception mode the error box of the tasks
+// must be left to the thread of the user, the timer must not write it. Both are checked with and
+// without the exception mode.
+//
+// Before them, the rows of several tables and column sets are given in turn. Each must be kept in
+// a buffer of its own, so that each statement is full of the values of one of them.
+
+static COMMON::THREAD::Mutex inserts_mutex;
+static vector<string> inserts;
+static int commits = 0;
+static bool failing = false;
+
+// An engine keeping the INSERTs, or failing them
+class MemoryEngine : public DbEngine
+{
+public:
+    MemoryEngine(vector<DbLocation>& locations, tr1::shared_ptr<IDbTasks> tasks, int connections)
+        : DbEngine(locations, tasks, connections)
+    {
+    }
+
+protected:
+    virtual tr1::shared_ptr<RealHandle> CreateRealHandle(DbLocation& location)
+    {
+        return tr1::shared_ptr<RealHandle>(new RealHandle());
+    }
+
+    virtual bool Connect(void* handle, DbLocation* location, tr1::shared_ptr<IException>& exception) throw () { return true; }
+    virtual bool Disconnect(void* handle, DbLocation* location, tr1::shared_ptr<IException>& exception) throw () { return true; }
+    virtual bool Query(void* handle, DbLocation* location, const char* statement, size_t length, map<string, int>* colIndexMap, tr1::shared_ptr<IException>& exception) throw () { return true; }
+    virtual char** Fetch(void* handle, DbLocation* location, tr1::shared_ptr<IException>& exception) throw () { return 0; }
+    virtual bool CloseOpenRslt(void* handle, DbLocation* location, tr1::shared_ptr<IException>& exception) throw () { return true; }
+    virtual unsigned long* GetColumnsActureLength(void* handle, DbLocation* location, tr1::shared_ptr<IException>& exception) throw () { return 0; }
+    virtual long long GetAffectedRows(void* handle, DbLocation* location, tr1::shared_ptr<IException>& exception) throw () { return 0; }
+    virtual long long Delete(void* handle, DbLocation* location, const char* statement, size_t length, tr1::shared_ptr<IException>& exception) throw () { return 0; }
+    virtual long long Update(void* handle, DbLocation* location, const char* statement, size_t length, tr1::shared_ptr<IException>& exception) throw () { return 0; }
+    virtual long long Truncate(void* handle, DbLocation* location, const char* statement, size_t length, tr1::shared_ptr<IException>& exception) throw () { return 0; }
+    virtual unsigned int Execute(void* handle, DbLocation* location, const char* statement, size_t length, tr1::shared_ptr<IException>& exception) throw () { return 0; }
+    virtual char* EscapeString(void* handle, DbLocation* location, const char* src, long length, tr1::shared_ptr<IException>& exception) throw () { return 0; }
+
+    virtual bool Commit(void* handle, DbLocation* location, tr1::shared_ptr<IException>& exception) throw ()
+    {
+        COMMON::THREAD::MutexLockGuard guard(inserts_mutex);
+        commits++;
+        return true;
+    }
+
+    virtual long long Insert(void* handle, DbLocation* location, const char* statement, size_t length, tr1::shared_ptr<IException>& exception) throw ()
+    {
+        COMMON::THREAD::MutexLockGuard guard(inserts_mutex);
+        if (failing)
+        {
+            string error = "the INSERT is told to fail";
+            int code = -1;
+            exception.reset(new DbCommonExecuteException(*location, error, code, statement, length));
+            return 0;
+        }
+
+        inserts.push_back(string(statement, length));
+        return 1;
+    }
+};
+
+class MemoryDbTasks : public DbTasks
+{
+public:
+    MemoryDbTasks(vector<DbLocation>& locations, bool exception) : DbTasks(locations, exception) {}
+
+    // only the INSERTs are kept
+    virtual DbExecuteAction* BatchReplace(int commitLimit, int valuesLimit) { return 0; }
+    virtual DbExecuteAction* BatchInsertIgnore(int commitLimit, int valuesLimit) { return 0; }
+    virtual DbQueryAction* GetPriKeys() { return 0; }
+
+protected:
+    virtual bool InitEngine()
+    {
+        db_engine_ = tr1::shared_ptr<DbEngine>(new MemoryEngine(db_locations_, shared_from_this(), connections_per_location_));
+        db_engine_->InitEngine();
+        return true;
+    }
+
+    virtual bool UninitEngine()
+    {
+        db_engine_->UninitEngine();
+        return true;
+    }
+};
+
+static bool IsInserted(const string& table)
+{
+    COMMON::THREAD::MutexLockGuard guard(inserts_mutex);
+    for (int i = 0; i < inserts.size(); i++)
+    {
+        if (inserts[i].find(table) != string::npos)
+        {
+            return true;
+        }
+    }
+    return false;
+}
+
+static void SetFailing(bool fail)
+{
+    COMMON::THREAD::MutexLockGuard guard(inserts_mutex);
+    failing = fail;
+}
+
+static tr1::shared_ptr<IDbTasks> Connect(vector<DbLocation>& locations, bool exceptionMode)
+{
+    {
+        COMMON::THREAD::MutexLockGuard guard(inserts_mutex);
+        inserts.clear();
+        commits = 0;
+    }
+
+    locations.resize(1);
+    locations[0].SetDbId("SHARD_000");
+    locations[0].SetIp("127.0.0.1");
+    locations[0].SetPort("3306");
+
+    tr1::shared_ptr<IDbTasks> tasks(new MemoryDbTasks(locations, exceptionMode));
+    tasks->Connect();
+    return tasks;
+}
+
+static bool Run(bool exceptionMode)
+{
+    vector<DbLocation> locations;
+    tr1::shared_ptr<IDbTasks> tasks = Connect(locations, exceptionMode);
+
+    // the timer looks at the values every 200ms, and sends those older than 800ms
+    DbBatchAction* action = (DbBatchAction*)tasks->BatchInsert(5000, 1000);
+    action->SetFlushPolicy(FlushPolicy(1000, 0, 800));
+
+    SetFailing(true);
+
+    BatchFilter a("TABLE_A", false);
+    a.AppendColumnValue("id", 1, false);
+    action->Do(&a, &locations[0]);
+
+    usleep(400 * 1000);
+
+    BatchFilter b("TABLE_B", false);
+    b.AppendColumnValue("id", 2, false);
+    action->Do(&b, &locations[0]);
+
+    // A has been sent by the timer and failed, B is not old enough to be sent
+    usleep(700 * 1000);
+    SetFailing(false);
+    if (IsInserted("TABLE_A") || IsInserted("TABLE_B"))
+    {
+        cout << "the rows are sent out of time" << endl;
+        return false;
+    }
+
+    bool reported = false;
+    try
+    {
+        reported = !action->EndAction();
+    }
+    catch (ThrowableException& e)
+    {
+        reported = exceptionMode;
+    }
+
+    const char* mode = exceptionMode ? "exception mode" : "return code mode";
+    if (!reported)
+    {
+        cout << mode << ": the failure of the timer is not reported" << endl;
+        return false;
+    }
+
+    if (!IsInserted("TABLE_B") || commits == 0)
+    {
+        cout << mode << ": the rows left are not sent and committed" << endl;
+        return false;
+    }
+
+    // PrevWorkNotFinished if the action was not finished
+    try
+    {
+        if (tasks->BatchInsert(5000, 1000) == 0)
+        {
+            cout << mode << ": the action is not finished" << endl;
+            return false;
+        }
+    }
+    catch (ThrowableException& e)
+    {
+        cout << mode << ": the action is not finished, " << e.What() << endl;
+        return false;
+    }
+
+    tasks->Disconnect();
+
+    cout << mode << ": the rows left are sent and committed after the failure of the timer" << endl;
+    return true;
+}
+
+static bool RunReportedByDo(bool exceptionMode)
+{
+    vector<DbLocation> locations;
+    tr1::shared_ptr<IDbTasks> tasks = Connect(locations, exceptionMode);
+
+    DbBatchAction* action = (DbBatchAction*)tasks->BatchInsert(5000, 1000);
+    action->SetFlushPolicy(FlushPolicy(1000, 0, 800));
+
+    SetFailing(true);
+
+    BatchFilter a("TABLE_A", false);
+    a.AppendColumnValue("id", 1, false);
+    action->Do(&a, &locations[0]);
+
+    // A has been sent by the timer and failed
+    usleep(1100 * 1000);
+    SetFailing(false);
+
+    const char* mode = exceptionMode ? "exception mode" : "return code mode";
+    if (tasks->GetErrorBox()->GetLastException())
+    {
+        cout << mode << ": the error box is written by the timer" << endl;
+        return false;
+    }
+
+    // the row given to the Do() reporting the failure is kept
+    bool reported = false;
+    BatchFilter c("TABLE_C", false);
+    c.AppendColumnValue("id", 3, false);
+    try
+    {
+        reported = !action->Do(&c, &locations[0]) && tasks->GetErrorBox()->GetLastException();
+    }
+    catch (ThrowableException& e)
+    {
+        reported = exceptionMode;
+    }
+
+    if (!reported)
+    {
+        cout << mode << ": the failure of the timer is not reported by Do()" << endl;
+        return false;
+    }
+
+    if (!action->EndAction() || !IsInserted("TABLE_C"))
+    {
+        cout << mode << ": the row given to the Do() reporting the failure is lost" << endl;
+        return false;
+    }
+
+    tasks->Disconnect();
+
+    cout << mode << ": the row given to the Do() reporting the failure of the timer is sent" << endl;
+    return true;
+}
+
+static bool RunInterleaved()
+{
+    vector<DbLocation> locations;
+    tr1::shared_ptr<IDbTasks> tasks = Connect(locations, false);
+
+    // 3 values per statement, no timer
+    DbBatchAction* action = (DbBatchAction*)tasks->BatchInsert(5000, 3);
+
+    const int ROUNDS = 9;
+    for (int i = 0; i < ROUNDS; i++)
+    {
+        BatchFilter a("TABLE_A", false);
+        a.AppendColumnValue("id", i, false);
+        BatchFilter b("TABLE_B", false);
+        b.AppendColumnValue("id", i, false);
+        BatchFilter named("TABLE_A", false);
+        named.AppendColumnValue("id", i, false);
+        named.AppendColumnValue("name", "x", false);
+
+        action->Do(&a, &locations[0]);
+        action->Do(&b, &locations[0]);
+        action->Do(&named, &locations[0]);
+    }
+    action->EndAction();
+    tasks->Disconnect();
+
+    // each statement has the values of one table and column set, and is full
+    const char* heads[] = { "INSERT INTO TABLE_A (id) VALUES", "INSERT INTO TABLE_B (id) VALUES", "INSERT INTO TABLE_A (id,name) VALUES" };
+    COMMON::THREAD::MutexLockGuard guard(inserts_mutex);
+    for (int h = 0; h < 3; h++)
+    {
+        int statements = 0;
+        int values = 0;
+        for (size_t i = 0; i < inserts.size(); i++)
+        {
+            if (inserts[i].compare(0, strlen(heads[h]), heads[h]) == 0)
+            {
+                statements++;
+                values += (int)count(inserts[i].begin(), inserts[i].end(), '(') - 1;
+            }
+        }
+
+        if (statements != ROUNDS / 3 || values != ROUNDS)
+        {
+            cout << "interleaved tables: " << values << " values are sent by " << statements << " statements of " << heads[h] << endl;
+            return false;
+        }
+    }
+
+    if ((int)inserts.size() != ROUNDS)
+    {
+        cout << "interleaved tables: " << inserts.size() << " statements are sent" << endl;
+        return false;
+    }
+
+    cout << "the values of the tables interleaved are buffered and sent table by table" << endl;
+    return true;
+}
+
+int main(int argc, char** argv)
+{
+    return (RunInterleaved() && Run(false) && Run(true) && RunReportedByDo(false) && RunReportedByDo(true)) ? 0 : 1;
+}
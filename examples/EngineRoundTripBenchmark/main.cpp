@@ -0,0 +1,233 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <sys/time.h>
+#include <unistd.h>
+
+#include <map>
+#include <vector>
+#include <iostream>
+#include <tr1/memory>
+
+#include "dbcomm/DbEngine.h"
+#include "dbcomm/DbCompletion.h"
+#include "exception/ThrowableException.h"
+
+using namespace std;
+using namespace COMMON::DBCOMM;
+using namespace COMMON::EXCEPTION;
+
+// Measures the round trip of DbEngine::Do(map<DbLocation, DbActionFilter*>) for
+// different numbers of locations. No DB server is needed: the engine below does
+// nothing in its workers, so only the dispatch and the completion are timed.
+//
+// The second part sends several INSERTs to each location at once, with an INSERT
+// taking a fixed time, to show how the connections of a location work together.
+//
+// The third part makes up each INSERT with about 1ms of CPU work before sending
+// it, and compares waiting for every INSERT with Submit(), which lets the next
+// INSERT be made up while the current one is executed.
+
+static double NowInUs()
+{
+    struct timeval tv;
+    gettimeofday(&tv, 0);
+    return tv.tv_sec * 1000000.0 + tv.tv_usec;
+}
+
+// An engine whose DB operations do nothing
+class NullEngine : public DbEngine
+{
+public:
+    NullEngine(vector<DbLocation>& locations, int connections = 1, int insertUs = 0)
+        : DbEngine(locations, tr1::shared_ptr<IDbTasks>(), connections), insert_us_(insertUs)
+    {
+    }
+
+protected:
+    virtual tr1::shared_ptr<RealHandle> CreateRealHandle(DbLocation& location)
+    {
+        return tr1::shared_ptr<RealHandle>(new RealHandle());
+    }
+
+    virtual bool Connect(void* handle, DbLocation* location, tr1::shared_ptr<IException>& exception) throw () { return true; }
+    virtual bool Disconnect(void* handle, DbLocation* location, tr1::shared_ptr<IException>& exception) throw () { return true; }
+    virtual bool Query(void* handle, DbLocation* location, const char* statement, size_t length, map<string, int>* colIndexMap, tr1::shared_ptr<IException>& exception) throw () { return true; }
+    virtual char** Fetch(void* handle, DbLocation* location, tr1::shared_ptr<IException>& exception) throw () { return 0; }
+    virtual bool CloseOpenRslt(void* handle, DbLocation* location, tr1::shared_ptr<IException>& exception) throw () { return true; }
+    virtual unsigned long* GetColumnsActureLength(void* handle, DbLocation* location, tr1::shared_ptr<IException>& exception) throw () { return 0; }
+    virtual bool Commit(void* handle, DbLocation* location, tr1::shared_ptr<IException>& exception) throw () { return true; }
+    virtual long long GetAffectedRows(void* handle, DbLocation* location, tr1::shared_ptr<IException>& exception) throw () { return 0; }
+    virtual long long Delete(void* handle, DbLocation* location, const char* statement, size_t length, tr1::shared_ptr<IException>& exception) throw () { return 0; }
+    virtual long long Update(void* handle, DbLocation* location, const char* statement, size_t length, tr1::shared_ptr<IException>& exception) throw () { return 0; }
+    virtual long long Truncate(void* handle, DbLocation* location, const char* statement, size_t length, tr1::shared_ptr<IException>& exception) throw () { return 0; }
+    virtual long long Insert(void* handle, DbLocation* location, const char* statement, size_t length, tr1::shared_ptr<IException>& exception) throw () { usleep(insert_us_); return 1; }
+    virtual unsigned int Execute(void* handle, DbLocation* location, const char* statement, size_t length, tr1::shared_ptr<IException>& exception) throw () { return 0; }
+    virtual char* EscapeString(void* handle, DbLocation* location, const char* src, long length, tr1::shared_ptr<IException>& exception) throw () { return 0; }
+
+private:
+    int insert_us_;
+};
+
+static vector<DbLocation> MakeLocations(int count)
+{
+    vector<DbLocation> locations;
+    for (int i = 0; i < count; i++)
+    {
+        char name[32];
+        sprintf(name, "SHARD_%03d", i);
+        
+        DbLocation location;
+        location.SetDbId(name);
+        location.SetIp("127.0.0.1");
+        location.SetPort("3306");
+        location.SetUser("root");
+        location.SetPassword("123456");
+        locations.push_back(location);
+    }
+    return locations;
+}
+
+// stands for the CPU work of forming a statement
+static void MakeupStatement(int us)
+{
+    double start = NowInUs();
+    while (NowInUs() - start < us)
+    {
+    }
+}
+
+int main(int argc, char** argv)
+{
+    int rounds = (argc > 1) ? atoi(argv[1]) : 20000;
+    int shard_counts[] = { 1, 4, 16, 64 };
+    
+    printf("%8s %12s %12s\n", "shards", "trips", "us/trip");
+    
+    try
+    {
+        for (int c = 0; c < sizeof(shard_counts) / sizeof(shard_counts[0]); c++)
+        {
+            vector<DbLocation> locations = MakeLocations(shard_counts[c]);
+            int trips = rounds / shard_counts[c] + 100;
+            
+            tr1::shared_ptr<NullEngine> engine(new NullEngine(locations));
+            engine->InitEngine();
+            
+            map<DbLocation, DbActionFilter*> loc_filter;
+            for (int i = 0; i < locations.size(); i++)
+            {
+                loc_filter[locations[i]] = 0;
+            }
+            
+            // warm up
+            bool success = true;
+            for (int i = 0; i < 100; i++)
+            {
+                engine->Do(DbEngine::ActionTypeDef::NOTHING, loc_filter, success);
+            }
+            
+            double start = NowInUs();
+            for (int i = 0; i < trips; i++)
+            {
+                engine->Do(DbEngine::ActionTypeDef::NOTHING, loc_filter, success);
+            }
+            double us = (NowInUs() - start) / trips;
+            
+            engine->UninitEngine();
+            
+            printf("%8d %12d %12.2f\n", shard_counts[c], trips, us);
+        }
+        
+        // 4 shards, 8 INSERTs of 1ms to each shard at once
+        const int shards = 4;
+        const int statements = 8;
+        int connection_counts[] = { 1, 2, 4, 8 };
+        
+        printf("\n%8s %12s %12s\n", "conns", "statements", "ms/round");
+        
+        vector<DbLocation> locations = MakeLocations(shards);
+        for (int c = 0; c < sizeof(connection_counts) / sizeof(connection_counts[0]); c++)
+        {
+            tr1::shared_ptr<NullEngine> engine(new NullEngine(locations, connection_counts[c], 1000));
+            engine->InitEngine();
+            
+            vector<DbActionFilter> filters(statements);
+            map<DbLocation, vector<DbActionFilter*> > loc_filters;
+            for (int i = 0; i < locations.size(); i++)
+            {
+                for (int k = 0; k < statements; k++)
+                {
+                    loc_filters[locations[i]].push_back(&filters[k]);
+                }
+            }
+            
+            bool success = true;
+            int rounds_done = 20;
+            double start = NowInUs();
+            for (int i = 0; i < rounds_done; i++)
+            {
+                engine->Do(DbEngine::ActionTypeDef::INSERT, loc_filters, success);
+            }
+            double ms = (NowInUs() - start) / rounds_done / 1000;
+            
+            engine->UninitEngine();
+            
+            printf("%8d %12d %12.2f\n", connection_counts[c], shards * statements, ms);
+        }
+        
+        // 1ms to make up an INSERT, 1ms to execute it
+        const int inserts = 200;
+        
+        printf("\n%8s %12s %12s\n", "mode", "inserts", "ms/insert");
+        
+        for (int pipelined = 0; pipelined < 2; pipelined++)
+        {
+            tr1::shared_ptr<NullEngine> engine(new NullEngine(locations, 1, 1000));
+            engine->InitEngine();
+            
+            DbActionFilter filter;
+            map<DbLocation, DbActionFilter*> loc_filter;
+            for (int i = 0; i < locations.size(); i++)
+            {
+                loc_filter[locations[i]] = &filter;
+            }
+            
+            bool success = true;
+            tr1::shared_ptr<DbCompletion> in_flight;
+            double start = NowInUs();
+            for (int i = 0; i < inserts; i++)
+            {
+                MakeupStatement(1000);
+                
+                if (pipelined)
+                {
+                    if (in_flight)
+                    {
+                        in_flight->Wait();
+                    }
+                    in_flight = engine->Submit(DbEngine::ActionTypeDef::INSERT, loc_filter);
+                }
+                else
+                {
+                    engine->Do(DbEngine::ActionTypeDef::INSERT, loc_filter, success);
+                }
+            }
+            if (in_flight)
+            {
+                in_flight->Wait();
+            }
+            double ms = (NowInUs() - start) / inserts / 1000;
+            
+            engine->UninitEngine();
+            
+            printf("%8s %12d %12.2f\n", pipelined ? "submit" : "do", inserts, ms);
+        }
+    }
+    catch (ThrowableException& e)
+    {
+        cout << e.What(true) << endl;
+        return 1;
+    }
+    
+    return 0;
+}
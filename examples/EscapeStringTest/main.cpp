@@ -38,6 +38,10 @@ int main()
         
         escape_string_action->EndAction();
 
+        // the same without an action, on this thread
+        StringEscaper escaper = mysqlTasks->GetStringEscaper(dbLocation1);
+        cout << "The string escaped locally : [" << escaper.Escape(str1, 20) << "]" << endl;
+
         mysqlTasks->Disconnect();
     }
     catch (ThrowableException& e)
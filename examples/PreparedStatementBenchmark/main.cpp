@@ -0,0 +1,171 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <sys/time.h>
+
+#include <vector>
+#include <iostream>
+#include <tr1/memory>
+
+#include "dbcomm/DbComm.h"
+#include "exception/ThrowableException.h"
+
+using namespace std;
+using namespace COMMON::DBCOMM;
+using namespace COMMON::EXCEPTION;
+
+// Compares the text protocol with the prepared statements on a local mysqld.
+//
+// 1. INSERT a row at a time, as text built by Value, and as a prepared statement
+//    with the values bound in their binary form.
+// 2. SELECT all the rows back, as text by Select(), and in the binary form by
+//    PreparedSelect(), with and without a server-side cursor.
+//
+// The table tbl_prepared_bench in TEST_DB1 is dropped and created again.
+
+static const int ROWS = 20000;
+
+static double NowInUs()
+{
+    struct timeval tv;
+    gettimeofday(&tv, 0);
+    return tv.tv_sec * 1000000.0 + tv.tv_usec;
+}
+
+static void Execute(tr1::shared_ptr<MysqlDbTasks>& tasks, const string& statement)
+{
+    DbExecuteAction* action = tasks->Execute();
+    ExecuteFilter filter(statement);
+    action->Do(&filter);
+    action->EndAction();
+}
+
+static void PrepareTable(tr1::shared_ptr<MysqlDbTasks>& tasks)
+{
+    Execute(tasks, "DROP TABLE IF EXISTS tbl_prepared_bench");
+    Execute(tasks, "CREATE TABLE tbl_prepared_bench (id BIGINT PRIMARY KEY, score DOUBLE, name VARCHAR(64), data BLOB) ENGINE=InnoDB");
+}
+
+static double InsertByText(tr1::shared_ptr<MysqlDbTasks>& tasks, const char* blob, int blobLength)
+{
+    PrepareTable(tasks);
+
+    double start = NowInUs();
+
+    DbExecuteAction* action = tasks->Insert(1000);
+    string statement;
+    for (int i = 0; i < ROWS; i++)
+    {
+        statement = "INSERT INTO tbl_prepared_bench VALUES (";
+        statement += Value((long long)i).GetValue() + ",";
+        statement += Value(i / 7.0).GetValue() + ",";
+        statement += Value("name of the row").GetValue() + ",";
+        statement += Value(blobLength, blob, false, true).GetValue() + ")";
+
+        InsertFilter filter(statement);
+        action->Do(&filter);
+    }
+    action->EndAction();
+
+    return NowInUs() - start;
+}
+
+static double InsertByPrepared(tr1::shared_ptr<MysqlDbTasks>& tasks, const char* blob, int blobLength)
+{
+    PrepareTable(tasks);
+
+    double start = NowInUs();
+
+    DbExecuteAction* action = tasks->PreparedExecute(1000);
+    PreparedFilter filter("INSERT INTO tbl_prepared_bench VALUES (?, ?, ?, ?)");
+    for (int i = 0; i < ROWS; i++)
+    {
+        filter.ClearParams();
+        filter.Bind((long long)i);
+        filter.Bind(i / 7.0);
+        filter.Bind(string("name of the row"));
+        filter.Bind(blobLength, blob);
+
+        action->Do(&filter);
+    }
+    action->EndAction();
+
+    return NowInUs() - start;
+}
+
+static double SelectAll(DbQueryAction* action, DbActionFilter* filter, long long& checksum)
+{
+    double start = NowInUs();
+
+    action->Do(filter);
+    DbQueryRslt* rslt = (DbQueryRslt*)action->GetRslt();
+
+    bool success = false;
+    Row row;
+    checksum = 0;
+    while ((char**)(row = rslt->Fetch(success)) != 0)
+    {
+        unsigned long* lengths = rslt->GetCurrentRowColumnsLength(success);
+        checksum += atoll(row[0]) + lengths[3];
+    }
+    action->EndAction();
+
+    return NowInUs() - start;
+}
+
+int main(int argc, char** argv)
+{
+	DbLocation dbLocation1;
+	dbLocation1.SetDbId("TEST_DB1");
+    dbLocation1.SetIp("127.0.0.1");
+    dbLocation1.SetPort("3306");
+    dbLocation1.SetUser("root");
+    dbLocation1.SetPassword("123456");
+
+    char blob[256];
+    for (int i = 0; i < sizeof(blob); i++)
+    {
+        blob[i] = (char)i;
+    }
+
+    try
+    {
+        vector<DbLocation> dbLocations_array;
+        dbLocations_array.push_back(dbLocation1);
+
+        tr1::shared_ptr<MysqlDbTasks> mysqlTasks( new MysqlDbTasks(dbLocations_array, true) );
+        mysqlTasks->Connect();
+
+        double used = InsertByText(mysqlTasks, blob, sizeof(blob));
+        cout << "INSERT, text          : " << used / ROWS << " us/row" << endl;
+
+        used = InsertByPrepared(mysqlTasks, blob, sizeof(blob));
+        cout << "INSERT, prepared      : " << used / ROWS << " us/row" << endl;
+
+        long long checksum = 0;
+
+        QueryFilter textFilter("SELECT id, score, name, data FROM tbl_prepared_bench");
+        used = SelectAll(mysqlTasks->Select(), &textFilter, checksum);
+        cout << "SELECT, text          : " << used / ROWS << " us/row (checksum " << checksum << ")" << endl;
+
+        PreparedFilter binaryFilter("SELECT id, score, name, data FROM tbl_prepared_bench");
+        used = SelectAll(mysqlTasks->PreparedSelect(), &binaryFilter, checksum);
+        cout << "SELECT, binary        : " << used / ROWS << " us/row (checksum " << checksum << ")" << endl;
+
+        PreparedFilter cursorFilter("SELECT id, score, name, data FROM tbl_prepared_bench");
+        cursorFilter.SetPrefetchRows(1000);
+        used = SelectAll(mysqlTasks->PreparedSelect(), &cursorFilter, checksum);
+        cout << "SELECT, binary+cursor : " << used / ROWS << " us/row (checksum " << checksum << ")" << endl;
+
+        mysqlTasks->Disconnect();
+    }
+    catch (ThrowableException& e)
+    {
+        cout << e.What(true) << endl;
+    }
+    catch (...)
+    {
+        cout << "unknown exception" << std::endl;
+    }
+
+	return 0;
+}
@@ -0,0 +1,770 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <locale.h>
+
+#include <map>
+#include <string>
+#include <vector>
+#include <iostream>
+#include <tr1/memory>
+
+#include "dbcomm/DbTasks.h"
+#include "dbcomm/DbEngine.h"
+#include "dbcomm/DbQueryAction.h"
+#include "dbcomm/DbQueryRslt.h"
+#include "dbcomm/DbActionFilter.h"
+#include "dbcomm/RowBlock.h"
+#include "dbcomm/HashAggregator.h"
+#include "dbcomm/ColumnBlock.h"
+#include "dbcomm/MergeCursor.h"
+#include "dbcomm/HashJoin.h"
+#include "dbcomm/ExternalSort.h"
+#include "exception/ThrowableException.h"
+
+using namespace std;
+using namespace COMMON::DBCOMM;
+using namespace COMMON::EXCEPTION;
+
+// Checks the operators working on the rows of all the connections of a query. No DB server is needed:
+// the engine below gives the rows of a table kept in memory for each DB, whatever the statement is.
+//
+//  - HashAggregator, with the connections aggregated by several threads and their tables merged.
+//  - ColumnBlock, filled by two blocks of rows, with the text which is not a number taken as NULL.
+//  - MergeCursor, merging the sorted rows of the connections by numbers, also in a locale writing
+//    the point as ',' if one is installed, with and without a limit.
+//  - HashJoin, with a stream of the connections probing rows kept in memory, and again with a memory
+//    limit moving the parts into files.
+//  - ExternalSort, by a number and a name in the descending order, in memory and merged from several
+//    runs in files.
+
+// the rows of each DB, by its id. A NULL is 0.
+typedef vector<vector<const char*> > MemoryTable;
+static map<string, MemoryTable> tables;
+
+// the milliseconds a DB waits before its first row
+static map<string, int> delays;
+
+// An engine giving the rows of the tables
+class MemoryQueryEngine : public DbEngine
+{
+public:
+    MemoryQueryEngine(vector<DbLocation>& locations, tr1::shared_ptr<IDbTasks> tasks, int connections)
+        : DbEngine(locations, tasks, connections)
+    {
+    }
+
+protected:
+    // A connection reading a table
+    class MemoryHandle : public RealHandle
+    {
+    public:
+        MemoryHandle() : table_(0), next_(0) {}
+
+        const MemoryTable* table_;
+        size_t next_;
+        vector<char*> row_;
+        vector<unsigned long> lengths_;
+    };
+
+    virtual tr1::shared_ptr<RealHandle> CreateRealHandle(DbLocation& location)
+    {
+        return tr1::shared_ptr<RealHandle>(new MemoryHandle());
+    }
+
+    virtual bool Connect(void* handle, DbLocation* location, tr1::shared_ptr<IException>& exception) throw () { return true; }
+    virtual bool Disconnect(void* handle, DbLocation* location, tr1::shared_ptr<IException>& exception) throw () { return true; }
+    virtual bool Commit(void* handle, DbLocation* location, tr1::shared_ptr<IException>& exception) throw () { return true; }
+    virtual long long GetAffectedRows(void* handle, DbLocation* location, tr1::shared_ptr<IException>& exception) throw () { return 0; }
+    virtual long long Delete(void* handle, DbLocation* location, const char* statement, size_t length, tr1::shared_ptr<IException>& exception) throw () { return 0; }
+    virtual long long Update(void* handle, DbLocation* location, const char* statement, size_t length, tr1::shared_ptr<IException>& exception) throw () { return 0; }
+    virtual long long Truncate(void* handle, DbLocation* location, const char* statement, size_t length, tr1::shared_ptr<IException>& exception) throw () { return 0; }
+    virtual long long Insert(void* handle, DbLocation* location, const char* statement, size_t length, tr1::shared_ptr<IException>& exception) throw () { return 0; }
+    virtual unsigned int Execute(void* handle, DbLocation* location, const char* statement, size_t length, tr1::shared_ptr<IException>& exception) throw () { return 0; }
+    virtual char* EscapeString(void* handle, DbLocation* location, const char* src, long length, tr1::shared_ptr<IException>& exception) throw () { return 0; }
+
+    virtual bool Query(void* handle, DbLocation* location, const char* statement, size_t length, map<string, int>* colIndexMap, tr1::shared_ptr<IException>& exception) throw ()
+    {
+        MemoryHandle* memory = (MemoryHandle*)handle;
+        memory->table_ = &(tables[location->GetDbId()]);
+        memory->next_ = 0;
+
+        int delay = delays[location->GetDbId()];
+        if (delay > 0)
+        {
+            usleep(delay * 1000);
+        }
+        return true;
+    }
+
+    virtual int GetColumnCount(void* handle, DbLocation* location, tr1::shared_ptr<IException>& exception) throw ()
+    {
+        const MemoryTable& table = *(((MemoryHandle*)handle)->table_);
+        return table.empty() ? 0 : (int)table[0].size();
+    }
+
+    virtual char** Fetch(void* handle, DbLocation* location, tr1::shared_ptr<IException>& exception) throw ()
+    {
+        MemoryHandle* memory = (MemoryHandle*)handle;
+        if (memory->next_ >= memory->table_->size())
+        {
+            return 0;
+        }
+
+        const vector<const char*>& row = (*(memory->table_))[memory->next_++];
+        memory->row_.assign(row.size(), (char*)0);
+        memory->lengths_.assign(row.size(), 0);
+        for (size_t i = 0; i < row.size(); i++)
+        {
+            memory->row_[i] = (char*)row[i];
+            memory->lengths_[i] = (row[i] == 0) ? 0 : strlen(row[i]);
+        }
+        return &(memory->row_[0]);
+    }
+
+    virtual unsigned long* GetColumnsActureLength(void* handle, DbLocation* location, tr1::shared_ptr<IException>& exception) throw ()
+    {
+        return &(((MemoryHandle*)handle)->lengths_[0]);
+    }
+
+    virtual bool CloseOpenRslt(void* handle, DbLocation* location, tr1::shared_ptr<IException>& exception) throw ()
+    {
+        ((MemoryHandle*)handle)->table_ = 0;
+        return true;
+    }
+};
+
+class MemoryDbTasks : public DbTasks
+{
+public:
+    MemoryDbTasks(vector<DbLocation>& locations) : DbTasks(locations, true) {}
+
+    // only the queries are done
+    virtual DbExecuteAction* BatchReplace(int commitLimit, int valuesLimit) { return 0; }
+    virtual DbExecuteAction* BatchInsertIgnore(int commitLimit, int valuesLimit) { return 0; }
+    virtual DbQueryAction* GetPriKeys() { return 0; }
+
+protected:
+    virtual bool InitEngine()
+    {
+        db_engine_ = tr1::shared_ptr<DbEngine>(new MemoryQueryEngine(db_locations_, shared_from_this(), connections_per_location_));
+        db_engine_->InitEngine();
+        return true;
+    }
+
+    virtual bool UninitEngine()
+    {
+        db_engine_->UninitEngine();
+        return true;
+    }
+};
+
+static vector<DbLocation> MakeLocations(int count)
+{
+    vector<DbLocation> locations(count);
+    for (int i = 0; i < count; i++)
+    {
+        char id[16];
+        snprintf(id, sizeof(id), "SHARD_%03d", i);
+        locations[i].SetDbId(id);
+        locations[i].SetIp("127.0.0.1");
+        locations[i].SetPort("3306");
+    }
+    return locations;
+}
+
+static void AddRow(const string& db, const char* a, const char* b)
+{
+    vector<const char*> row;
+    row.push_back(a);
+    row.push_back(b);
+    tables[db].push_back(row);
+}
+
+// a number of the result, whatever its type is
+static double NumberAt(RowBlock& block, int row, int column)
+{
+    if (block.GetColumnType(column) == RowBlock::COLUMN_INTEGER)
+    {
+        return (double)block.GetInteger(row, column);
+    }
+    if (block.GetColumnType(column) == RowBlock::COLUMN_DOUBLE)
+    {
+        return block.GetDouble(row, column);
+    }
+    return atof(block.GetValue(row, column));
+}
+
+// the row of a group of the result, -1 if there is none. An empty name for NULL.
+static int FindGroup(RowBlock& block, const string& name)
+{
+    for (int r = 0; r < block.GetRowCount(); r++)
+    {
+        bool null = block.IsNull(r, 0);
+        if ((name.empty() && null) || (!null && name == string(block.GetValue(r, 0), block.GetLength(r, 0))))
+        {
+            return r;
+        }
+    }
+    return -1;
+}
+
+static bool CheckAggregates()
+{
+    tables.clear();
+    delays.clear();
+
+    // A group has a double on one DB and an integer on the other, in both orders, so that the
+    // merge meets an integral partial after a floating one whichever table comes first. The first
+    // DB is late, so each DB is aggregated by a thread of its own.
+    vector<DbLocation> locations = MakeLocations(2);
+    const string a = locations[0].GetDbId();
+    const string b = locations[1].GetDbId();
+    delays[a] = 200;
+
+    AddRow(a, "g1", "2.5");
+    AddRow(a, "g2", "5");
+    AddRow(a, "g3", "1");
+    AddRow(a, 0, "4");
+    AddRow(b, "g1", "5");
+    AddRow(b, "g2", "2.5");
+    AddRow(b, "g3", "1");
+    AddRow(b, "g3", "7");
+    AddRow(b, 0, 0);
+
+    // and enough groups for the merge to be split among the threads
+    const int MANY = 10000;
+    vector<string> names(MANY);
+    vector<string> numbers(MANY * 2);
+    for (int i = 0; i < MANY; i++)
+    {
+        char text[32];
+        snprintf(text, sizeof(text), "n%d", i);
+        names[i] = text;
+        snprintf(text, sizeof(text), "%d", i);
+        numbers[i * 2] = text;
+        snprintf(text, sizeof(text), "%d", i * 2);
+        numbers[i * 2 + 1] = text;
+    }
+    for (int i = 0; i < MANY; i++)
+    {
+        AddRow(a, names[i].c_str(), numbers[i * 2].c_str());
+        AddRow(b, names[i].c_str(), numbers[i * 2 + 1].c_str());
+    }
+
+    tr1::shared_ptr<DbTasks> tasks(new MemoryDbTasks(locations));
+    tasks->Connect();
+
+    DbQueryAction* action = tasks->StreamSelect();
+    QueryFilter filter("SELECT k, v FROM t");
+    action->Do(&filter);
+
+    HashAggregator aggregator(2);
+    aggregator.AddGroupColumn(0);
+    int sum = aggregator.AddAggregate(HashAggregator::SUM, 1);
+    int count = aggregator.AddAggregate(HashAggregator::COUNT, -1);
+    int min = aggregator.AddAggregate(HashAggregator::MIN, 1);
+    int max = aggregator.AddAggregate(HashAggregator::MAX, 1);
+    int avg = aggregator.AddAggregate(HashAggregator::AVG, 1);
+    int distinct = aggregator.AddAggregate(HashAggregator::COUNT, 1, true);
+
+    bool success = false;
+    long long rows = aggregator.Add((DbQueryRslt*)action->GetRslt(), success);
+    RowBlock block;
+    aggregator.GetResult(block);
+    action->EndAction();
+    tasks->Disconnect();
+
+    if (!success || rows != 9 + MANY * 2 || block.GetRowCount() != 4 + MANY)
+    {
+        cout << "aggregates: " << rows << " rows are added, " << block.GetRowCount() << " groups are got" << endl;
+        return false;
+    }
+
+    // sum, count, min, max, avg, count of distinct values
+    const char* groups[] = { "g1", "g2", "g3", "" };
+    double expected[][6] =
+    {
+        { 7.5, 2, 2.5, 5, 3.75, 2 },
+        { 7.5, 2, 2.5, 5, 3.75, 2 },
+        { 9,   3, 1,   7, 3,    2 },
+        { 4,   2, 4,   4, 4,    1 }
+    };
+    int columns[] = { sum, count, min, max, avg, distinct };
+
+    for (int g = 0; g < 4; g++)
+    {
+        int row = FindGroup(block, groups[g]);
+        for (int c = 0; c < 6 && row >= 0; c++)
+        {
+            if (NumberAt(block, row, columns[c]) != expected[g][c])
+            {
+                cout << "aggregates: column " << columns[c] << " of group '" << groups[g] << "' is "
+                     << NumberAt(block, row, columns[c]) << " instead of " << expected[g][c] << endl;
+                return false;
+            }
+        }
+
+        if (row < 0)
+        {
+            cout << "aggregates: group '" << groups[g] << "' is not got" << endl;
+            return false;
+        }
+    }
+
+    for (int i = 0; i < MANY; i += 97)
+    {
+        int row = FindGroup(block, names[i]);
+        if (row < 0 || NumberAt(block, row, sum) != i * 3 || NumberAt(block, row, count) != 2)
+        {
+            cout << "aggregates: group " << names[i] << " is not merged" << endl;
+            return false;
+        }
+    }
+
+    cout << "the groups of all the connections are aggregated and merged" << endl;
+    return true;
+}
+
+static void AppendText(RowBlock& rows, const char* value)
+{
+    if (value == 0)
+    {
+        rows.AppendNull();
+    }
+    else
+    {
+        rows.AppendValue(value, strlen(value));
+    }
+}
+
+static bool CheckColumnBlock()
+{
+    // a text column, and two parsed into integers and doubles
+    const char* first[][3] =
+    {
+        { "a",  "1", "1.5" },
+        { 0,    "x", "2.5" },
+        { "bc", "",  "y"   }
+    };
+    const char* second[][3] =
+    {
+        { "d",  "7", "-3e2" }
+    };
+
+    RowBlock rows;
+    rows.Reset(3);
+    for (int r = 0; r < 3; r++)
+    {
+        for (int c = 0; c < 3; c++)
+        {
+            AppendText(rows, first[r][c]);
+        }
+    }
+
+    ColumnBlock block;
+    block.ParseColumn(1, RowBlock::COLUMN_INTEGER);
+    block.ParseColumn(2, RowBlock::COLUMN_DOUBLE);
+    block.Assign(rows);
+
+    rows.Reset(3);
+    for (int c = 0; c < 3; c++)
+    {
+        AppendText(rows, second[0][c]);
+    }
+    block.Append(rows);
+
+    if (block.GetRowCount() != 4 || block.GetColumnType(0) != RowBlock::COLUMN_TEXT
+        || block.GetColumnType(1) != RowBlock::COLUMN_INTEGER || block.GetColumnType(2) != RowBlock::COLUMN_DOUBLE)
+    {
+        cout << "column block: " << block.GetRowCount() << " rows, or the types are wrong" << endl;
+        return false;
+    }
+
+    // the text is laid out one value after another
+    const int offsets[] = { 0, 1, 1, 3, 4 };
+    for (int r = 0; r <= 4; r++)
+    {
+        if (block.GetOffsets(0)[r] != offsets[r])
+        {
+            cout << "column block: offset " << r << " is " << block.GetOffsets(0)[r] << endl;
+            return false;
+        }
+    }
+    if (string(block.GetData(0), 4) != "abcd" || block.GetNullCount(0) != 1 || !block.IsNull(1, 0) || block.IsNull(2, 0))
+    {
+        cout << "column block: the text column is wrong" << endl;
+        return false;
+    }
+
+    // "x" and "" are not integers, "y" is not a double
+    const long long integers[] = { 1, 0, 0, 7 };
+    const bool integerNulls[] = { false, true, true, false };
+    const double doubles[] = { 1.5, 2.5, 0.0, -300.0 };
+    const bool doubleNulls[] = { false, false, true, false };
+    for (int r = 0; r < 4; r++)
+    {
+        if (block.GetIntegers(1)[r] != integers[r] || block.IsNull(r, 1) != integerNulls[r]
+            || block.GetDoubles(2)[r] != doubles[r] || block.IsNull(r, 2) != doubleNulls[r])
+        {
+            cout << "column block: the numbers of row " << r << " are wrong" << endl;
+            return false;
+        }
+    }
+    if (block.GetNullCount(1) != 2 || block.GetNullCount(2) != 1)
+    {
+        cout << "column block: " << block.GetNullCount(1) << " and " << block.GetNullCount(2) << " NULLs are counted" << endl;
+        return false;
+    }
+
+    cout << "the column block keeps the text, the numbers and the NULLs of the rows" << endl;
+    return true;
+}
+
+// the locales writing the point as ',' tried
+static const char* COMMA_LOCALES[] = { "de_DE.UTF-8", "de_DE.utf8", "fr_FR.UTF-8", "fr_FR.utf8", "ru_RU.UTF-8", "de_DE", "fr_FR" };
+
+static bool MergeInOrder(const string& locale)
+{
+    tables.clear();
+    delays.clear();
+
+    // Each DB is sorted by the numbers already. As strings "10" would go before "9", and read by
+    // the locale "1.9" and "1.1" would both be 1, with the larger one on the first DB.
+    vector<DbLocation> locations = MakeLocations(3);
+    const string a = locations[0].GetDbId();
+    const string b = locations[1].GetDbId();
+    const string c = locations[2].GetDbId();
+
+    AddRow(a, "a1", 0);
+    AddRow(a, "a2", "1.9");
+    AddRow(a, "a3", "10");
+    AddRow(a, "a4", "12.5");
+    AddRow(b, "b1", "-3");
+    AddRow(b, "b2", "1.1");
+    AddRow(b, "b3", "9");
+    AddRow(c, "c1", "2");
+    AddRow(c, "c2", "11");
+
+    const char* expected[] = { "a1", "b1", "b2", "a2", "c1", "b3", "a3", "c2", "a4" };
+    const int count = sizeof(expected) / sizeof(expected[0]);
+
+    tr1::shared_ptr<DbTasks> tasks(new MemoryDbTasks(locations));
+    tasks->Connect();
+
+    // the whole order, and the first rows with a limit, fetched 2 rows at once
+    bool same = true;
+    for (int limit = 0; limit <= 4 && same; limit += 4)
+    {
+        DbQueryAction* action = tasks->Select();
+        QueryFilter filter("SELECT k, v FROM t ORDER BY v");
+        action->Do(&filter);
+
+        MergeCursor cursor((DbQueryRslt*)action->GetRslt(), ColumnOrder(1, true, false), limit, 2);
+        bool success = false;
+        Row row;
+        int given = 0;
+        while (same && (char**)(row = cursor.Fetch(success)) != 0)
+        {
+            if (given >= count || string(row[0]) != expected[given])
+            {
+                cout << "merge" << locale << ": row " << given << " is " << row[0] << endl;
+                same = false;
+            }
+            given++;
+        }
+
+        action->EndAction();
+
+        if (same && (!success || given != (limit > 0 ? limit : count)))
+        {
+            cout << "merge" << locale << ": " << given << " rows are given with the limit " << limit << endl;
+            same = false;
+        }
+    }
+
+    tasks->Disconnect();
+    return same;
+}
+
+static bool CheckMerge()
+{
+    if (!MergeInOrder(""))
+    {
+        return false;
+    }
+
+    const char* name = 0;
+    for (int i = 0; i < (int)(sizeof(COMMA_LOCALES) / sizeof(COMMA_LOCALES[0])) && name == 0; i++)
+    {
+        if (setlocale(LC_NUMERIC, COMMA_LOCALES[i]) != 0 && strcmp(localeconv()->decimal_point, ",") == 0)
+        {
+            name = COMMA_LOCALES[i];
+        }
+    }
+
+    if (name == 0)
+    {
+        setlocale(LC_NUMERIC, "C");
+        cout << "the rows of all the connections are merged in order, no locale writing the point as ',' is checked" << endl;
+        return true;
+    }
+
+    bool same = MergeInOrder(string(" in ") + name);
+    setlocale(LC_NUMERIC, "C");
+    if (same)
+    {
+        cout << "the rows of all the connections are merged in order, also in " << name << endl;
+    }
+    return same;
+}
+
+static bool JoinAll(size_t memoryLimit)
+{
+    tables.clear();
+    delays.clear();
+
+    // the keys k0 to k2999 are built, the probe rows have the keys up to k3999 and a NULL
+    const int BUILD = 3000;
+    const int PROBE = 4000;
+    vector<string> keys(PROBE);
+    vector<string> names(BUILD);
+    vector<string> values(PROBE * 2);
+    for (int i = 0; i < PROBE; i++)
+    {
+        char text[32];
+        snprintf(text, sizeof(text), "k%d", i);
+        keys[i] = text;
+    }
+    for (int i = 0; i < BUILD; i++)
+    {
+        names[i] = "name" + keys[i].substr(1);
+    }
+
+    vector<DbLocation> locations = MakeLocations(2);
+    long long expectedRows = 0;
+    long long expectedSum = 0;
+    for (int i = 0; i < PROBE * 2; i++)
+    {
+        char text[32];
+        snprintf(text, sizeof(text), "%d", i);
+        values[i] = text;
+
+        // the keys are spread over both DBs in another order than they are built
+        int key = (i * 7) % PROBE;
+        AddRow(locations[i % 2].GetDbId(), keys[key].c_str(), values[i].c_str());
+        if (key < BUILD)
+        {
+            expectedRows++;
+            expectedSum += i;
+        }
+    }
+    AddRow(locations[0].GetDbId(), 0, "1");
+
+    HashJoin join(memoryLimit);
+    join.AddKey(0, 0);
+
+    RowBlock block;
+    block.Reset(2);
+    for (int i = 0; i <= BUILD; i++)
+    {
+        if (i == BUILD)
+        {
+            block.AppendNull();
+            block.AppendValue("null", 4);
+        }
+        else
+        {
+            block.AppendValue(keys[i].data(), keys[i].size());
+            block.AppendValue(names[i].data(), names[i].size());
+        }
+
+        if (block.GetRowCount() == 500 || i == BUILD)
+        {
+            join.Build(block);
+            block.Reset(2);
+        }
+    }
+
+    tr1::shared_ptr<DbTasks> tasks(new MemoryDbTasks(locations));
+    tasks->Connect();
+
+    DbQueryAction* action = tasks->StreamSelect();
+    QueryFilter filter("SELECT k, v FROM t");
+    action->Do(&filter);
+    join.Probe((DbQueryRslt*)action->GetRslt());
+
+    // the build columns first, then the probe columns
+    bool success = false;
+    Row row;
+    long long rows = 0;
+    long long sum = 0;
+    bool same = true;
+    while (same && (char**)(row = join.Fetch(success)) != 0)
+    {
+        if (string(row[0]) != row[2] || string("name") + (row[0] + 1) != row[1])
+        {
+            cout << "join: " << row[0] << " of the build side is joined with " << row[2] << endl;
+            same = false;
+        }
+        rows++;
+        sum += atoll(row[3]);
+    }
+
+    action->EndAction();
+    tasks->Disconnect();
+
+    if (same && (!success || rows != expectedRows || sum != expectedSum))
+    {
+        cout << "join: " << rows << " rows are joined instead of " << expectedRows << endl;
+        same = false;
+    }
+    if (same && (memoryLimit > 0) != (join.GetSpilledPartCount() > 0))
+    {
+        cout << "join: " << join.GetSpilledPartCount() << " parts are spilled with the limit " << memoryLimit << endl;
+        same = false;
+    }
+    return same;
+}
+
+static bool CheckJoin()
+{
+    // all in memory, and most of the parts in files
+    if (!JoinAll(0) || !JoinAll(16 * 1024))
+    {
+        return false;
+    }
+
+    cout << "the rows of all the connections are joined, in memory and through the files" << endl;
+    return true;
+}
+
+// whether the row given by the sort goes after the one before it: by the numbers, then by the
+// names in the descending order. A NULL number goes first.
+static bool InSortOrder(const string& lastName, const char* lastNumber, bool first, Row& row)
+{
+    if (first || lastNumber == 0)
+    {
+        return true;
+    }
+    if (row[1] == 0)
+    {
+        return false;
+    }
+
+    double last = atof(lastNumber);
+    double current = atof(row[1]);
+    return last < current || (last == current && lastName >= row[0]);
+}
+
+static bool SortAll(size_t memoryLimit)
+{
+    // the numbers are spread with repeats, some with a fraction and some NULL
+    const int ROWS = 6000;
+    vector<string> names(ROWS);
+    vector<string> numbers(ROWS);
+    vector<string> ids(ROWS);
+    for (int i = 0; i < ROWS; i++)
+    {
+        char text[32];
+        snprintf(text, sizeof(text), "s%02d", (i * 13) % 17);
+        names[i] = text;
+        int number = (i * 7919) % 1000;
+        snprintf(text, sizeof(text), (number % 3 == 0) ? "%d.5" : "%d", number - 500);
+        numbers[i] = text;
+        snprintf(text, sizeof(text), "%d", i);
+        ids[i] = text;
+    }
+
+    ExternalSort sort(memoryLimit);
+    sort.AddKey(1, true, false);
+    sort.AddKey(0, false, true);
+
+    RowBlock block;
+    block.Reset(3);
+    for (int i = 0; i < ROWS; i++)
+    {
+        block.AppendValue(names[i].data(), names[i].size());
+        if (i % 101 == 0)
+        {
+            block.AppendNull();
+        }
+        else
+        {
+            block.AppendValue(numbers[i].data(), numbers[i].size());
+        }
+        block.AppendValue(ids[i].data(), ids[i].size());
+
+        if (block.GetRowCount() == 256 || i == ROWS - 1)
+        {
+            sort.Add(block);
+            block.Reset(3);
+        }
+    }
+
+    bool success = false;
+    Row row;
+    long long rows = 0;
+    long long sum = 0;
+    string lastName;
+    string lastNumber;
+    bool lastNull = false;
+    bool same = true;
+    while (same && (char**)(row = sort.Fetch(success)) != 0)
+    {
+        if (!InSortOrder(lastName, lastNull ? 0 : lastNumber.c_str(), rows == 0, row))
+        {
+            cout << "sort: " << row[0] << " " << (row[1] ? row[1] : "NULL") << " goes after " << lastName << " " << lastNumber << endl;
+            same = false;
+        }
+
+        lastName = row[0];
+        lastNull = (row[1] == 0);
+        lastNumber = lastNull ? "NULL" : row[1];
+        rows++;
+        sum += atoll(row[2]);
+    }
+
+    if (same && (!success || rows != ROWS || sum != (long long)ROWS * (ROWS - 1) / 2))
+    {
+        cout << "sort: " << rows << " rows are given instead of " << ROWS << endl;
+        same = false;
+    }
+    if (same && (memoryLimit < (size_t)ExternalSort::DEFAULT_MEMORY_LIMIT) != (sort.GetSpilledRunCount() > 1))
+    {
+        cout << "sort: " << sort.GetSpilledRunCount() << " runs are spilled with the limit " << memoryLimit << endl;
+        same = false;
+    }
+    return same;
+}
+
+static bool CheckSort()
+{
+    // all in memory, and several runs merged from the files
+    if (!SortAll(ExternalSort::DEFAULT_MEMORY_LIMIT) || !SortAll(16 * 1024))
+    {
+        return false;
+    }
+
+    cout << "the rows are sorted, in memory and merged from several runs" << endl;
+    return true;
+}
+
+int main(int argc, char** argv)
+{
+    try
+    {
+        if (!CheckAggregates() || !CheckColumnBlock() || !CheckMerge() || !CheckJoin() || !CheckSort())
+        {
+            return 1;
+        }
+    }
+    catch (ThrowableException& e)
+    {
+        cout << e.What() << endl;
+        return 1;
+    }
+
+    return 0;
+}
@@ -0,0 +1,260 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <locale.h>
+#include <sys/time.h>
+
+#include <iostream>
+#include <vector>
+
+#include "dbcomm/RowBlock.h"
+#include "dbcomm/ValueFormatter.h"
+#include "dbcomm/ValueParser.h"
+
+using namespace std;
+using namespace COMMON::DBCOMM;
+
+// Measures how fast the numbers of a wide scan are read from the text the DBMS sends.
+// Three ways are compared:
+//  - strtoll() and strtod() on the values of each Row, as the callers did before,
+//  - the typed getters of Row, which use the lengths and do not look at the locale,
+//  - RowBlock::ParseIntegers() and ParseDoubles(), which read a whole column in one loop.
+//
+// The numbers must come out the same as strtoll() and strtod() give, and the same when LC_NUMERIC
+// of the process writes the point as ',', if such a locale is installed. The doubles written
+// by ValueFormatter in that locale must still have '.'.
+
+static double NowInUs()
+{
+    struct timeval tv;
+    gettimeofday(&tv, 0);
+    return tv.tv_sec * 1000000.0 + tv.tv_usec;
+}
+
+static const int ROWS = 4096;
+static const int INTEGER_COLUMNS = 8;
+static const int DOUBLE_COLUMNS = 8;
+static const int COLUMNS = INTEGER_COLUMNS + DOUBLE_COLUMNS;
+static const int ROUNDS = 50;
+
+static long long IntAt(int i)
+{
+    return (i % 2 ? -1LL : 1LL) * ((long long)i * 2654435761LL);
+}
+
+static double DoubleAt(int i)
+{
+    // prices with 2 decimals, whole numbers, and the ones that need all 17 digits
+    switch (i % 3)
+    {
+    case 0:  return i / 100.0;
+    case 1:  return (double)i;
+    default: return i / 7.0 + 0.1;
+    }
+}
+
+// a block of rows in text, as a MYSQL result is fetched
+static void Fill(RowBlock& block)
+{
+    block.Reset(COLUMNS);
+    string text;
+    for (int r = 0; r < ROWS; r++)
+    {
+        for (int c = 0; c < COLUMNS; c++)
+        {
+            text.clear();
+            if (c < INTEGER_COLUMNS)
+            {
+                ValueFormatter::AppendInteger(text, IntAt(r * COLUMNS + c));
+            }
+            else
+            {
+                ValueFormatter::AppendDouble(text, DoubleAt(r * COLUMNS + c));
+            }
+            block.AppendValue(text.data(), text.size());
+        }
+    }
+}
+
+static bool Check(RowBlock& block)
+{
+    vector<long long> integers(ROWS);
+    vector<double> doubles(ROWS);
+    for (int c = 0; c < COLUMNS; c++)
+    {
+        bool integral = (c < INTEGER_COLUMNS);
+        int failed = integral ? block.ParseIntegers(c, &(integers[0])) : block.ParseDoubles(c, &(doubles[0]));
+        if (failed != 0)
+        {
+            cout << failed << " values are not read in column " << c << endl;
+            return false;
+        }
+
+        ColumnRef column(c);
+        for (int r = 0; r < ROWS; r++)
+        {
+            Row row = block.GetRow(r);
+            long long integer = 0;
+            double value = 0.0;
+            if (integral && (!row.GetInt64(column, integer) || integer != strtoll(row[column], 0, 10) || integers[r] != integer))
+            {
+                cout << "integer differs: " << row[column] << endl;
+                return false;
+            }
+
+            if (!integral && (!row.GetDouble(column, value) || value != strtod(row[column], 0) || doubles[r] != value))
+            {
+                cout << "double differs: " << row[column] << endl;
+                return false;
+            }
+        }
+    }
+    return true;
+}
+
+static const locale_t C_LOCALE = newlocale(LC_NUMERIC_MASK, "C", (locale_t)0);
+
+// the locales writing the point as ',' tried
+static const char* COMMA_LOCALES[] = { "de_DE.UTF-8", "de_DE.utf8", "fr_FR.UTF-8", "fr_FR.utf8", "ru_RU.UTF-8", "de_DE", "fr_FR" };
+
+static bool CheckCommaLocale()
+{
+    // those read by the loop, and those left to strtod() such as 17 digits and big exponents
+    const char* texts[] = { "12.5", "-0.001", "3e10", "0.14285714285714285", "-1.7976931348623157e+308", "4.9e-324", "123456789012345678901.25" };
+    const int count = sizeof(texts) / sizeof(texts[0]);
+    double expected[count];
+    for (int i = 0; i < count; i++)
+    {
+        expected[i] = strtod(texts[i], 0);
+    }
+
+    const char* name = 0;
+    for (int i = 0; i < (int)(sizeof(COMMA_LOCALES) / sizeof(COMMA_LOCALES[0])) && name == 0; i++)
+    {
+        if (setlocale(LC_NUMERIC, COMMA_LOCALES[i]) != 0 && strcmp(localeconv()->decimal_point, ",") == 0)
+        {
+            name = COMMA_LOCALES[i];
+        }
+    }
+
+    if (name == 0)
+    {
+        setlocale(LC_NUMERIC, "C");
+        cout << "no locale writing the point as ',' is installed, the locale is not checked" << endl;
+        return true;
+    }
+
+    bool same = true;
+    for (int i = 0; i < count && same; i++)
+    {
+        double value = 0.0;
+        if (!ValueParser::ParseDouble(texts[i], strlen(texts[i]), value) || value != expected[i])
+        {
+            cout << "double differs in " << name << ": " << texts[i] << endl;
+            same = false;
+        }
+
+        // and written back with '.'
+        string text;
+        ValueFormatter::AppendDouble(text, expected[i]);
+        if (same && (text.find(',') != string::npos || strtod_l(text.c_str(), 0, C_LOCALE) != expected[i]))
+        {
+            cout << "double is not written back in " << name << ": " << text << endl;
+            same = false;
+        }
+    }
+
+    setlocale(LC_NUMERIC, "C");
+    if (same)
+    {
+        cout << "doubles are read and written the same in " << name << endl;
+    }
+    return same;
+}
+
+int main(int argc, char** argv)
+{
+    RowBlock block(ROWS);
+    Fill(block);
+
+    if (!Check(block) || !CheckCommaLocale())
+    {
+        return 1;
+    }
+    cout << "integers and doubles are the same as strtoll() and strtod() give" << endl;
+
+    vector<ColumnRef> columns;
+    for (int c = 0; c < COLUMNS; c++)
+    {
+        columns.push_back(ColumnRef(c));
+    }
+
+    // the sums keep the loops from being optimized away
+    double sum = 0.0;
+    double start, used;
+    double values = (double)ROWS * COLUMNS * ROUNDS;
+
+    start = NowInUs();
+    for (int round = 0; round < ROUNDS; round++)
+    {
+        for (int r = 0; r < ROWS; r++)
+        {
+            Row row = block.GetRow(r);
+            for (int c = 0; c < INTEGER_COLUMNS; c++)
+            {
+                sum += (double)strtoll(row[columns[c]], 0, 10);
+            }
+            for (int c = INTEGER_COLUMNS; c < COLUMNS; c++)
+            {
+                sum += strtod(row[columns[c]], 0);
+            }
+        }
+    }
+    used = NowInUs() - start;
+    cout << "strtoll/strtod       : " << used * 1000 / values << " ns/value" << endl;
+
+    start = NowInUs();
+    for (int round = 0; round < ROUNDS; round++)
+    {
+        for (int r = 0; r < ROWS; r++)
+        {
+            Row row = block.GetRow(r);
+            for (int c = 0; c < INTEGER_COLUMNS; c++)
+            {
+                long long integer = 0;
+                row.GetInt64(columns[c], integer);
+                sum += (double)integer;
+            }
+            for (int c = INTEGER_COLUMNS; c < COLUMNS; c++)
+            {
+                double value = 0.0;
+                row.GetDouble(columns[c], value);
+                sum += value;
+            }
+        }
+    }
+    used = NowInUs() - start;
+    cout << "Row typed getters    : " << used * 1000 / values << " ns/value" << endl;
+
+    vector<long long> integers(ROWS);
+    vector<double> doubles(ROWS);
+    start = NowInUs();
+    for (int round = 0; round < ROUNDS; round++)
+    {
+        for (int c = 0; c < INTEGER_COLUMNS; c++)
+        {
+            block.ParseIntegers(c, &(integers[0]));
+            sum += (double)integers[ROWS - 1];
+        }
+        for (int c = INTEGER_COLUMNS; c < COLUMNS; c++)
+        {
+            block.ParseDoubles(c, &(doubles[0]));
+            sum += doubles[ROWS - 1];
+        }
+    }
+    used = NowInUs() - start;
+    cout << "RowBlock column parse: " << used * 1000 / values << " ns/value" << endl;
+
+    printf("(checksum %g)\n", sum);
+    return 0;
+}